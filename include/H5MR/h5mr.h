@@ -20,6 +20,24 @@ typedef struct {
 } h5r_block_t;
 
 int h5r_open(const char *path, struct h5r **out); /* 初期化 */
+
+/* オープン時に一括取得するファイルメタデータ（キャッシュ可能な固定長構造体） */
+typedef struct {
+    uint64_t rows, cols;        /* population_data の次元 */
+    uint64_t crows, ccols;      /* チャンク形状（非チャンク時は 1 x cols） */
+    int32_t layout;             /* H5D_layout_t */
+    int32_t has_meshid_list;    /* meshid_list データセットの有無 */
+    char start_datetime[32];    /* start_datetime 属性（無ければ空文字列） */
+} h5r_metadata_t;
+
+int h5r_open_with_metadata(const char *path, const h5r_metadata_t *cached, struct h5r **out); /* cached が非 NULL ならメタデータ取得を省略 */
+int h5r_get_metadata(struct h5r *ctx, h5r_metadata_t *meta); /* メタデータ取得 */
+
+/* ファイル固有のメッシュ ID 表（組み込みの meshid_list と異なるファイル用） */
+struct mesh_dict;
+int h5r_read_meshid_list(struct h5r *ctx, uint32_t **ids, size_t *count); /* 格納された meshid_list を読む（呼び出し側で free） */
+void h5r_set_mesh_dict(struct h5r *ctx, struct mesh_dict *dict); /* 所有権を移す（h5r_close で解放） */
+const struct mesh_dict *h5r_get_mesh_dict(struct h5r *ctx); /* 未設定なら NULL */
 int h5r_read_cell(struct h5r *ctx, uint64_t row, uint64_t col, int32_t *value); /* 単一セル読み */
 int h5r_read_cells(struct h5r *ctx, uint64_t row, uint64_t *cols, size_t ncols, int32_t *values); /* 複数セル読み */
 int h5r_read_column_range(struct h5r *ctx, uint64_t start_row, uint64_t end_row, uint64_t col, int32_t *values);
@@ -47,15 +65,47 @@ int h5r_extend_time_dimension(struct h5r *ctx, size_t new_time_points); /* 時
 int h5r_write_cell(struct h5r *ctx, uint64_t row, uint64_t col, int32_t value); /* 単一セル書き込み */
 int h5r_write_cells(struct h5r *ctx, uint64_t row, const uint64_t *cols, const int32_t *values, size_t ncols); /* 複数セル書き込み */
 int h5r_write_bulk_buffer(struct h5r *ctx, const int32_t *buffer, size_t time_points, size_t mesh_count, size_t start_time_idx); /* バルク書き込み */
+int h5r_write_chunk(struct h5r *ctx, uint64_t row0, uint64_t col0, uint64_t nrows, const int32_t *tile); /* チャンク単位書き込み（tile は nrows x ccols の連続領域）。整列した crows 行なら直接チャンク書き込みで 1、それ以外の成功は 0 */
 int h5r_flush(struct h5r *ctx); /* フラッシュ */
 int h5r_get_dimensions(struct h5r *ctx, size_t *time_points, size_t *mesh_count); /* 次元取得 */
 
 /* 時系列読み */
 int h5r_read_columns_range(struct h5r *ctx, uint64_t *rows, size_t nrows, uint64_t *cols, size_t ncols,
                            int32_t *values); /* 複数メッシュ×複数時系列 */
+/* 周期的な時間選択：start から stride 時間ごとに block 時間連続、count 回（例：毎日 9 時 = stride 24, block 1） */
+typedef struct {
+    uint64_t start;  /* 最初の時間インデックス */
+    uint64_t stride; /* 周期（時間、block 以上。count が 1 なら無視） */
+    uint64_t block;  /* 1 周期内で連続して取る時間数 */
+    uint64_t count;  /* 周期の数 */
+} h5r_time_pattern_t;
+
+uint64_t h5r_pattern_rows(const h5r_time_pattern_t *pattern); /* 選択される行数（不正なパターンなら 0） */
+int h5r_read_pattern(struct h5r *ctx, const h5r_time_pattern_t *pattern, uint64_t *cols, size_t ncols,
+                     int32_t *values); /* 周期的時系列×複数メッシュ：values[(k * block + b) * ncols + 列] */
+int h5r_read_points(struct h5r *ctx, const uint64_t *rows, const uint64_t *cols, size_t n,
+                    int32_t *values); /* 任意の (行, 列) 点集合：チャンク順に 1 回ずつ読み、入力順に返す */
 int h5r_read_blocks_union(struct h5r *ctx, uint64_t row0, uint64_t nrows, const h5r_block_t *blocks, size_t nblk,
                           int32_t *dst, size_t dst_stride);
 
+/* チャンクごとの最大値（chunk_max データセット、[時間チャンク][メッシュチャンク]）。h5r_write_* で書き込むと削除されるので再構築すること */
+int h5r_build_chunk_max(struct h5r *ctx); /* population_data を走査して chunk_max を作り直す（読み書き用コンテキスト） */
+int h5r_read_chunk_max(struct h5r *ctx, int32_t **max, uint64_t *ntime, uint64_t *nmesh); /* 無い・行数が変わった場合は -1（呼び出し側で free） */
+
+/* 曜日・時刻別ベースライン（baseline データセット、float32 [2][168][メッシュ]：[0] が中心値、[1] がばらつき） */
+#define H5R_HOURS_PER_WEEK 168
+typedef struct {
+    uint64_t start, end; /* 集計した時間インデックスの範囲（両端を含む） */
+    uint64_t slot0;      /* 行 0 の週内スロット（月曜 0 時 = 0）。行 t は (t + slot0) % 168 */
+    uint64_t method;     /* 集計方法（h5mobaku_baseline_method_t） */
+} h5r_baseline_info_t;
+
+int h5r_create_baseline(struct h5r *ctx, const h5r_baseline_info_t *info); /* baseline を作り直す（読み書き用コンテキスト） */
+int h5r_write_baseline(struct h5r *ctx, uint64_t col0, uint64_t ncols,
+                       const float *values); /* 連続列を書く：values[(k * 168 + スロット) * ncols + 列] */
+int h5r_read_baseline(struct h5r *ctx, h5r_baseline_info_t *info, const uint64_t *cols, size_t ncols,
+                      float *values); /* 任意の列を入力順に読む（cols が NULL なら info のみ）。無ければ -1 */
+
 void h5r_close(struct h5r *ctx); /* 終了 */
 
 
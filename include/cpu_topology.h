@@ -0,0 +1,32 @@
+//
+// Usable CPUs and NUMA nodes, for sizing and pinning worker threads
+//
+
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <pthread.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cpu_topology cpu_topology_t;
+
+// Snapshot of the CPUs this process may run on, grouped by NUMA node. Without NUMA information
+// (no /sys/devices/system/node) every CPU is reported on node 0. Returns NULL on failure.
+cpu_topology_t *cpu_topology_detect(void);
+void cpu_topology_destroy(cpu_topology_t *topo);
+
+int cpu_topology_num_cpus(const cpu_topology_t *topo);
+int cpu_topology_num_nodes(const cpu_topology_t *topo);
+int cpu_topology_node_cpus(const cpu_topology_t *topo, int node);
+
+// Restrict a thread to the CPUs of one node, or to every usable CPU with node -1
+int cpu_topology_bind_thread(const cpu_topology_t *topo, pthread_t thread, int node);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CPU_TOPOLOGY_H
@@ -6,11 +6,19 @@
 #define CSV_TO_H5_CONVERTER_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// How rows for the same (hour, mesh) within one run are combined
+typedef enum {
+    CSV_TO_H5_MERGE_OVERWRITE = 0,  // Last row wins (order across reader threads is unspecified)
+    CSV_TO_H5_MERGE_SUM,            // Add up, e.g. residence/age/gender breakdown rows into a total
+    CSV_TO_H5_MERGE_MAX             // Keep the largest value
+} csv_to_h5_merge_policy_t;
+
 // Converter configuration
 typedef struct {
     const char* output_h5_file;     // Output HDF5 filename
@@ -19,6 +27,14 @@ typedef struct {
     int verbose;                    // Enable verbose output
     int create_new;                 // Create new file (1) or append (0)
     int use_bulk_write;             // Use bulk write mode for year-wise processing
+    int bulk_year_buffers;          // Bulk mode: 1 alternates parsing and writing; 2 (opt-in, if memory allows) overlaps them
+    const uint32_t* mesh_ids;       // New files only: restrict columns to these meshes (NULL = all)
+    size_t num_meshes;              // Number of entries in mesh_ids
+    csv_to_h5_merge_policy_t merge_policy;  // Rows sharing a cell: overwrite, sum or max
+    int store_breakdown;            // Also keep rows split by residence/age/gender in population_breakdown
+    int reader_threads;             // CSV reader threads, 0 = one per usable CPU less one for the writer
+    int pin_threads;                // Pin readers and the writer to the NUMA node of the memory they use
+    const char* record_output_dir;  // Also save each CSV's parsed rows as <dir>/<name>.mrec (NULL = off)
 } csv_to_h5_config_t;
 
 // Default configuration
@@ -28,7 +44,15 @@ typedef struct {
     .batch_size = 10000, \
     .verbose = 0, \
     .create_new = 1, \
-    .use_bulk_write = 0 \
+    .use_bulk_write = 0, \
+    .bulk_year_buffers = 1, \
+    .mesh_ids = NULL, \
+    .num_meshes = 0, \
+    .merge_policy = CSV_TO_H5_MERGE_OVERWRITE, \
+    .store_breakdown = 0, \
+    .reader_threads = 0, \
+    .pin_threads = 0, \
+    .record_output_dir = NULL \
 }
 
 // Converter statistics
@@ -37,12 +61,17 @@ typedef struct {
     size_t unique_timestamps;
     size_t unique_meshes;
     size_t errors;
+    size_t direct_chunks;       // Bulk mode: chunks stored whole with direct chunk writes
 } csv_to_h5_stats_t;
 
+// Parse "overwrite", "sum" or "max". Returns 0 on success, -1 for an unknown name.
+int csv_to_h5_parse_merge_policy(const char* name, csv_to_h5_merge_policy_t* policy);
+
 // Convert single CSV file to HDF5
 int csv_to_h5_convert_file(const char* csv_filename, const csv_to_h5_config_t* config, csv_to_h5_stats_t* stats);
 
-// Convert multiple CSV files to HDF5
+// Convert multiple CSV files to HDF5. Record files (see record_stream.h) may be given in place of CSV files;
+// they are replayed without parsing.
 int csv_to_h5_convert_files(const char** csv_filenames, size_t num_files, 
                            const csv_to_h5_config_t* config, csv_to_h5_stats_t* stats);
 
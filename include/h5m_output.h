@@ -0,0 +1,120 @@
+//
+// Buffered output engine for CLI tools: fast integer/datetime formatting and
+// large-block writes to a file descriptor
+//
+
+#ifndef H5M_OUTPUT_H
+#define H5M_OUTPUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H5M_OUTPUT_DEFAULT_BUFFER (1u << 20)
+#define H5M_OUTPUT_SLACK 128     // Largest single reservation; blocks overhang by this much
+
+// Output flags
+#define H5M_OUTPUT_VMSPLICE 0x1  // Gift full buffers to a pipe with vmsplice(2) when fd is a pipe
+
+#define H5M_DATETIME_LEN 19      // "YYYY-MM-DD HH:MM:SS"
+#define H5M_INT64_MAX_LEN 20
+
+typedef struct {
+    int fd;
+    unsigned flags;
+    char *buf;            // Current fill block
+    size_t cap;           // Bytes emitted per full block
+    size_t len;           // May overhang cap by up to H5M_OUTPUT_SLACK until the next drain
+    size_t block_size;    // Bytes allocated for buf
+    int mapped;           // buf is an anonymous mapping (vmsplice mode) rather than heap memory
+    int use_vmsplice;
+    int error;            // Sticky: set on the first failed write
+} h5m_output_t;
+
+// Initialize an output engine on `fd`. buffer_size 0 selects H5M_OUTPUT_DEFAULT_BUFFER.
+// Returns 0 on success, -1 on failure.
+int h5m_output_init(h5m_output_t *out, int fd, size_t buffer_size, unsigned flags);
+
+// Write out buffered data. Returns 0 on success, -1 on failure.
+int h5m_output_flush(h5m_output_t *out);
+
+// Emit one full block and keep the overhang (used by the inline helpers)
+int h5m_output_drain(h5m_output_t *out);
+
+// Flush and release the buffer (the fd is left open). Returns 0 on success, -1 if any write failed.
+int h5m_output_close(h5m_output_t *out);
+
+// Append bytes. Blocks at least as large as the buffer bypass it and are written directly.
+int h5m_output_write(h5m_output_t *out, const void *data, size_t len);
+
+// Integer formatters: write the decimal digits to dst (no terminator) and return the length
+size_t h5m_format_uint64(char *dst, uint64_t value);
+size_t h5m_format_int64(char *dst, int64_t value);
+
+// Return where to write the next `len` (<= H5M_OUTPUT_SLACK) bytes, or NULL on error.
+// The caller advances out->len by the number of bytes actually written.
+static inline char *h5m_output_reserve(h5m_output_t *out, size_t len) {
+    (void)len;
+    if (out->len >= out->cap && h5m_output_drain(out) < 0) return NULL;
+    return out->buf + out->len;
+}
+
+static inline void h5m_output_put_char(h5m_output_t *out, char c) {
+    char *p = h5m_output_reserve(out, 1);
+    if (!p) return;
+    *p = c;
+    out->len++;
+}
+
+static inline void h5m_output_put_str(h5m_output_t *out, const char *str) {
+    h5m_output_write(out, str, strlen(str));
+}
+
+static inline void h5m_output_put_int64(h5m_output_t *out, int64_t value) {
+    char *p = h5m_output_reserve(out, H5M_INT64_MAX_LEN);
+    if (!p) return;
+    out->len += h5m_format_int64(p, value);
+}
+
+static inline void h5m_output_put_uint64(h5m_output_t *out, uint64_t value) {
+    char *p = h5m_output_reserve(out, H5M_INT64_MAX_LEN);
+    if (!p) return;
+    out->len += h5m_format_uint64(p, value);
+}
+
+// Append `value` padded with spaces to `width` (right-aligned unless left_align; width <= 64)
+void h5m_output_put_int64_padded(h5m_output_t *out, int64_t value, int width, int left_align);
+
+// Calendar cursor that steps hour by hour without libc time calls.
+// Initialized once from a time_t in the process time zone; assumes the zone
+// has no DST transitions in the covered range (true for Asia/Tokyo).
+typedef struct {
+    int year;
+    int month;   // 1-12
+    int day;     // 1-31
+    int hour;    // 0-23
+    int minute;
+    int second;
+} h5m_datetime_cursor_t;
+
+void h5m_datetime_cursor_init(h5m_datetime_cursor_t *cursor, time_t t);
+void h5m_datetime_cursor_advance(h5m_datetime_cursor_t *cursor);  // +1 hour
+void h5m_datetime_cursor_format(const h5m_datetime_cursor_t *cursor, char *dst);  // H5M_DATETIME_LEN bytes
+
+static inline void h5m_output_put_datetime(h5m_output_t *out, const h5m_datetime_cursor_t *cursor) {
+    char *p = h5m_output_reserve(out, H5M_DATETIME_LEN);
+    if (!p) return;
+    h5m_datetime_cursor_format(cursor, p);
+    out->len += H5M_DATETIME_LEN;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5M_OUTPUT_H
@@ -0,0 +1,117 @@
+//
+// Framed binary protocol spoken by h5m-serve over a Unix domain socket
+//
+// Every message is a fixed 16-byte header followed by payload_len bytes of
+// payload. All fields are in host byte order (the socket is local). Requests
+// may be pipelined; responses carry the request_id of the request they answer
+// and can arrive out of order.
+//
+
+#ifndef H5M_PROTOCOL_H
+#define H5M_PROTOCOL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H5M_REQUEST_MAGIC  0x51354D48u  // "HM5Q"
+#define H5M_RESPONSE_MAGIC 0x52354D48u  // "HM5R"
+#define H5M_PROTOCOL_VERSION 1
+
+#define H5M_MAX_REQUEST_PAYLOAD (16u * 1024 * 1024)
+#define H5M_MAX_RESPONSE_PAYLOAD (1024u * 1024 * 1024)
+
+typedef struct {
+    uint32_t magic;        // H5M_REQUEST_MAGIC or H5M_RESPONSE_MAGIC
+    uint16_t version;      // H5M_PROTOCOL_VERSION
+    uint16_t code;         // h5m_op_t for requests, h5m_status_t for responses
+    uint32_t request_id;   // Chosen by the client, echoed in the response
+    uint32_t payload_len;
+} h5m_frame_header_t;
+
+typedef enum {
+    H5M_OP_PING = 0,              // No payload; empty response
+    H5M_OP_SINGLE = 1,            // h5m_req_single_t            -> int32
+    H5M_OP_MULTI = 2,             // h5m_req_multi_t + ids       -> int32[num_meshes]
+    H5M_OP_SERIES = 3,            // h5m_req_series_t            -> int32[num_times]
+    H5M_OP_MULTI_SERIES = 4,      // h5m_req_multi_series_t + ids -> int32[num_times * num_meshes] (time-major)
+    H5M_OP_AGGREGATE = 5,         // h5m_req_aggregate_t + ids   -> int64[num_times]
+    H5M_OP_INFO = 6               // h5m_req_info_t              -> h5m_resp_info_t
+} h5m_op_t;
+
+typedef enum {
+    H5M_STATUS_OK = 0,
+    H5M_STATUS_BAD_REQUEST = 1,   // Malformed header or payload
+    H5M_STATUS_BAD_SLOT = 2,      // No file loaded in the requested slot
+    H5M_STATUS_READ_ERROR = 3,    // Unknown mesh ID or out-of-range time index
+    H5M_STATUS_TOO_LARGE = 4,     // Response would exceed H5M_MAX_RESPONSE_PAYLOAD
+    H5M_STATUS_INTERNAL = 5
+} h5m_status_t;
+
+typedef enum {
+    H5M_AGG_SUM = 0,
+    H5M_AGG_MIN = 1,
+    H5M_AGG_MAX = 2
+} h5m_agg_t;
+
+// Request payloads. `slot` selects one of the files given to h5m-serve, in
+// command line order. Time indices are rows of that file (end inclusive).
+typedef struct {
+    uint16_t slot;
+    uint16_t reserved;
+    int32_t time_index;
+    uint32_t mesh_id;
+} h5m_req_single_t;
+
+typedef struct {
+    uint16_t slot;
+    uint16_t reserved;
+    int32_t time_index;
+    uint32_t num_meshes;          // Followed by uint32_t mesh_ids[num_meshes]
+} h5m_req_multi_t;
+
+typedef struct {
+    uint16_t slot;
+    uint16_t reserved;
+    int32_t start_time_index;
+    int32_t end_time_index;
+    uint32_t mesh_id;
+} h5m_req_series_t;
+
+typedef struct {
+    uint16_t slot;
+    uint16_t reserved;
+    int32_t start_time_index;
+    int32_t end_time_index;
+    uint32_t num_meshes;          // Followed by uint32_t mesh_ids[num_meshes]
+} h5m_req_multi_series_t;
+
+// Aggregates across the listed meshes for every hour of the range
+typedef struct {
+    uint16_t slot;
+    uint16_t agg;                 // h5m_agg_t
+    int32_t start_time_index;
+    int32_t end_time_index;
+    uint32_t num_meshes;          // Followed by uint32_t mesh_ids[num_meshes]
+} h5m_req_aggregate_t;
+
+typedef struct {
+    uint16_t slot;
+    uint16_t reserved;
+} h5m_req_info_t;
+
+typedef struct {
+    uint64_t time_points;
+    uint64_t mesh_count;
+    int64_t start_datetime;       // Unix seconds of time index 0
+    uint32_t num_slots;
+    uint32_t reserved;
+} h5m_resp_info_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5M_PROTOCOL_H
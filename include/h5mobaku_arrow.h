@@ -0,0 +1,78 @@
+//
+// Apache Arrow C Data Interface export of h5mobaku query results
+//
+
+#ifndef H5MOBAKU_ARROW_H
+#define H5MOBAKU_ARROW_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include "h5mobaku_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Structure definitions from the Arrow C Data Interface specification
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+    const char* format;
+    const char* name;
+    const char* metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema** children;
+    struct ArrowSchema* dictionary;
+    void (*release)(struct ArrowSchema*);
+    void* private_data;
+};
+
+struct ArrowArray {
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void** buffers;
+    struct ArrowArray** children;
+    struct ArrowArray* dictionary;
+    void (*release)(struct ArrowArray*);
+    void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+// Export flags
+#define H5MOBAKU_ARROW_DICT_MESH_IDS 0x1  // Dictionary-encode the mesh_id column
+
+// Export a time x mesh result as a struct array with one row per cell:
+//   mesh_id     uint32 (or int32 indices into a uint32 dictionary)
+//   timestamp   timestamp[s, Asia/Tokyo]
+//   population  int32
+// `data` is the row-major buffer returned by the h5mobaku read functions
+// (data[time_idx * num_meshes + mesh_idx]). Ownership of `data` moves to the
+// exported array: it becomes the population buffer without a copy and is
+// released through h5mobaku_free_data() by the consumer's release callback.
+// On failure `data` is left untouched and still owned by the caller.
+int h5mobaku_arrow_export_time_mesh(int32_t *data, const uint32_t *mesh_ids, size_t num_meshes,
+                                    int start_time_index, size_t num_times, time_t start_datetime,
+                                    unsigned flags, struct ArrowArray *out_array, struct ArrowSchema *out_schema);
+
+// Read a multi-mesh time series and export it in one step
+int h5mobaku_read_multi_mesh_time_series_arrow(struct h5mobaku *ctx, cmph_t *hash,
+                                               uint32_t *mesh_ids, size_t num_meshes,
+                                               int start_time_index, int end_time_index, unsigned flags,
+                                               struct ArrowArray *out_array, struct ArrowSchema *out_schema);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_ARROW_H
@@ -0,0 +1,87 @@
+//
+// Hour-of-week baseline profiles and anomaly scoring
+//
+// A baseline holds, for every mesh and each of the 168 hours of the week, a typical value and
+// its spread over a trailing window of weeks. It is built once into the population file as the
+// compact "baseline" dataset (2 x 168 floats per mesh), so scoring new hours reads only those
+// hours and the profile instead of the history behind it.
+//
+
+#ifndef H5MOBAKU_BASELINE_H
+#define H5MOBAKU_BASELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "h5mobaku_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    H5MOBAKU_BASELINE_MEAN,     // Mean and standard deviation
+    H5MOBAKU_BASELINE_MEDIAN    // Median and 1.4826 x median absolute deviation (robust to past events)
+} h5mobaku_baseline_method_t;
+
+typedef struct {
+    h5mobaku_baseline_method_t method;
+    size_t weeks;               // Trailing whole weeks ending at end_time (fewer when the file is shorter)
+    int end_time;               // Last hour included; -1 for the last hour of the file
+} h5mobaku_baseline_spec_t;
+
+#define H5MOBAKU_BASELINE_DEFAULT_SPEC { \
+    .method = H5MOBAKU_BASELINE_MEDIAN, \
+    .weeks = 8, \
+    .end_time = -1 \
+}
+
+typedef enum {
+    H5MOBAKU_SCORE_Z,           // (value - center) / spread
+    H5MOBAKU_SCORE_RATIO        // value / center
+} h5mobaku_score_t;
+
+typedef struct {
+    h5mobaku_score_t score;
+    double min_divisor;         // Floor for the spread (Z) or center (RATIO), so quiet meshes stay finite
+    size_t band_cells;          // Hours x meshes scored per band; 0 for about 4M
+} h5mobaku_anomaly_spec_t;
+
+#define H5MOBAKU_ANOMALY_DEFAULT_SPEC { \
+    .score = H5MOBAKU_SCORE_Z, \
+    .min_divisor = 1.0, \
+    .band_cells = 0 \
+}
+
+// Receives one tile: scores[(t - first_time) * num_meshes + (m - first_mesh)] for num_times hours
+// and meshes first_mesh..first_mesh+num_meshes-1 of the request. The buffer is reused after the
+// call returns. Return non-zero to stop with an error.
+typedef int (*h5mobaku_anomaly_sink_t)(void *user, int first_time, size_t num_times, size_t first_mesh,
+                                       size_t num_meshes, const double *scores);
+
+// Parse "mean"/"median" and "z"/"ratio"
+int h5mobaku_parse_baseline_method(const char *name, h5mobaku_baseline_method_t *method);
+int h5mobaku_parse_score(const char *name, h5mobaku_score_t *score);
+
+// Build (or rebuild) the baseline of every mesh in a file opened with h5mobaku_open_readwrite.
+// At least one whole week must lie before end_time. Returns 0 on success, -1 on error.
+int h5mobaku_build_baseline(struct h5mobaku *ctx, const h5mobaku_baseline_spec_t *spec);
+
+// Range and method of the stored baseline; -1 when the file has none
+int h5mobaku_baseline_info(struct h5r *h5_ctx, h5r_baseline_info_t *info);
+
+// Score hours start_time..end_time of the meshes against the stored baseline, tile by tile.
+// mesh_ids NULL scores every column of the file (mesh index = column, num_meshes ignored).
+// Returns 0 on success, -1 on error.
+int h5mobaku_anomaly_stream(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                            int start_time, int end_time, const h5mobaku_anomaly_spec_t *spec,
+                            h5mobaku_anomaly_sink_t sink, void *user);
+
+// Same, collected into out[(t - start_time) * num_meshes + m]; release with free()
+double* h5mobaku_read_anomaly(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                              int start_time, int end_time, const h5mobaku_anomaly_spec_t *spec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_BASELINE_H
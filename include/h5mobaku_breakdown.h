@@ -0,0 +1,79 @@
+//
+// Demographic breakdown (residence / age / gender) of population_data
+//
+// population_breakdown is a 3-D int32 dataset [time][mesh][category] next to population_data,
+// with the same mesh columns. Categories are (residence, age, gender) triples listed in the
+// breakdown_categories dataset in the order they were first stored. Chunks are
+// chunk_time x 1 x chunk_categories, so one mesh with all of its categories over a time range
+// is a single contiguous run per chunk.
+//
+
+#ifndef H5MOBAKU_BREAKDOWN_H
+#define H5MOBAKU_BREAKDOWN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define H5MOBAKU_BREAKDOWN_DATASET "population_breakdown"
+#define H5MOBAKU_BREAKDOWN_CATEGORIES "breakdown_categories"
+
+// One breakdown category; -1 in a field means the row is not split by it
+typedef struct {
+    int32_t residence;
+    int32_t age;
+    int32_t gender;
+} h5mobaku_category_t;
+
+// Layout used when the datasets are created
+typedef struct {
+    size_t chunk_time_size;
+    size_t chunk_categories;    // Categories beyond this spill into a second chunk per time band
+    int compression_level;
+} h5mobaku_breakdown_config_t;
+
+#define H5MOBAKU_BREAKDOWN_DEFAULT_CONFIG { \
+    .chunk_time_size = 8784, \
+    .chunk_categories = 64, \
+    .compression_level = 0 \
+}
+
+typedef struct h5mobaku_breakdown h5mobaku_breakdown_t;
+
+// Open the breakdown of a population file. Writable handles create the datasets when the file has
+// none yet (sized from population_data, laid out by config; NULL for the defaults).
+int h5mobaku_breakdown_open(const char *path, int writable, const h5mobaku_breakdown_config_t *config,
+                            h5mobaku_breakdown_t **out);
+void h5mobaku_breakdown_close(h5mobaku_breakdown_t *bd);
+
+// Whether the file at path has a breakdown dataset (0/1), -1 when it cannot be opened
+int h5mobaku_breakdown_exists(const char *path);
+
+int h5mobaku_breakdown_get_dimensions(const h5mobaku_breakdown_t *bd, size_t *time_points, size_t *mesh_count);
+
+// Category table; the pointer stays valid until the next add or close
+const h5mobaku_category_t *h5mobaku_breakdown_categories(const h5mobaku_breakdown_t *bd, size_t *count);
+
+// Index of a category, or -1 when the file has no such category
+int h5mobaku_breakdown_find_category(const h5mobaku_breakdown_t *bd, h5mobaku_category_t category);
+
+// Index of a category, appending it to the table (and widening the dataset) when new. Writable only.
+int h5mobaku_breakdown_add_category(h5mobaku_breakdown_t *bd, h5mobaku_category_t category);
+
+// Rows [row0, row0 + nrows) of one mesh column with every category:
+// values[t * num_categories + c]. Reads past the stored time range return 0.
+int h5mobaku_breakdown_read(h5mobaku_breakdown_t *bd, uint64_t col, uint64_t row0, uint64_t nrows, int32_t *values);
+
+// Write rows [row0, row0 + nrows) of one mesh column in the same layout, extending the time axis as needed
+int h5mobaku_breakdown_write(h5mobaku_breakdown_t *bd, uint64_t col, uint64_t row0, uint64_t nrows, const int32_t *values);
+
+int h5mobaku_breakdown_flush(h5mobaku_breakdown_t *bd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_BREAKDOWN_H
@@ -0,0 +1,39 @@
+//
+// Reader for the .h5mc partition files written by h5m-export
+//
+
+#ifndef H5MOBAKU_H5MC_H
+#define H5MOBAKU_H5MC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Container constants (layout documented in src/h5m-export.c)
+#define H5MC_MAGIC "H5MC"
+#define H5MC_VERSION 1
+#define H5MC_HEADER_BYTES 32
+
+// One decoded partition: the hourly series of num_meshes meshes of one 1st mesh and year
+typedef struct {
+    int32_t year;
+    uint32_t mesh1;
+    int64_t start_epoch;        // Unix seconds of the first hour
+    uint32_t num_times;
+    uint32_t num_meshes;
+    uint32_t *mesh_ids;         // In file column order
+    int32_t *values;            // values[m * num_times + t]
+} h5mobaku_h5mc_t;
+
+// Read and decode a whole .h5mc file. 0 on success, -1 on a malformed or unreadable file.
+int h5mobaku_read_h5mc(const char *path, h5mobaku_h5mc_t *out);
+void h5mobaku_h5mc_free(h5mobaku_h5mc_t *h5mc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_H5MC_H
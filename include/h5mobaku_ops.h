@@ -10,6 +10,7 @@
 #include <time.h>
 #include "H5MR/h5mr.h"
 #include "meshid_ops.h"
+#include "h5mobaku_breakdown.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -20,12 +21,51 @@ struct h5mobaku {
     struct h5r *h5r_ctx;      // Wrapped h5r context
     time_t start_datetime;    // Start datetime from HDF5 attribute
     char *start_datetime_str; // String representation of start datetime
+    char *path;               // Kept to open the breakdown dataset on first use
+    h5mobaku_breakdown_t *breakdown; // Opened by the breakdown readers, NULL until then
 };
 
+// Open options
+typedef struct {
+    const char *metadata_cache;  // Metadata cache file keyed by inode/size/mtime; NULL disables it
+    int verify_meshid_list;      // Compare the stored meshid_list with the compiled-in one
+} h5mobaku_open_config_t;
+
+#define H5MOBAKU_OPEN_DEFAULT_CONFIG { \
+    .metadata_cache = NULL, \
+    .verify_meshid_list = 0 \
+}
+
 // Initialize/cleanup functions
+// h5mobaku_open uses the cache named by H5MOBAKU_METADATA_CACHE when it is set and
+// verifies meshid_list when H5MOBAKU_VERIFY_MESHID_LIST is non-zero
 int h5mobaku_open(const char *path, struct h5mobaku **out);
+int h5mobaku_open_with_config(const char *path, const h5mobaku_open_config_t *config, struct h5mobaku **out);
 void h5mobaku_close(struct h5mobaku *ctx);
 
+// Compare the file's meshid_list with the compiled-in list. Returns 0 when they match,
+// 1 when they differ (lookups switch to a table built from the file's list), -1 on error.
+int h5mobaku_verify_meshid_list(struct h5mobaku *ctx);
+
+// Column of mesh_id in this file (honours a file-specific table), or MESHID_NOT_FOUND
+uint32_t h5mobaku_mesh_index(struct h5r *h5_ctx, cmph_t *hash, uint32_t mesh_id);
+
+// Columns of num_meshes mesh IDs into cols (columns 0..num_meshes-1 when mesh_ids is NULL).
+// Returns 0, or -1 with a message when a mesh ID is not in the file.
+int h5mobaku_mesh_columns(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                          uint64_t *cols);
+
+// Sink for the streaming time x mesh readers (rolling windows, anomaly scores) that gathers their
+// output into data[(t - start_time) * num_meshes + mesh]; user points to an h5mobaku_collect_t
+typedef struct {
+    double *data;
+    int start_time;
+    size_t num_meshes;
+} h5mobaku_collect_t;
+
+int h5mobaku_collect_sink(void *user, int first_time, size_t num_times, size_t first_mesh, size_t num_meshes,
+                          const double *values);
+
 // Time-based API functions (using datetime strings)
 // Read population data for a single mesh at a specific time
 int32_t h5mobaku_read_population_single_at_time(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id, const char *datetime_str);
@@ -47,6 +87,34 @@ int32_t* h5mobaku_read_multi_mesh_time_series(struct h5r *h5_ctx, cmph_t *hash,
                                                uint32_t *mesh_ids, size_t num_meshes,
                                                int start_time_index, int end_time_index);
 
+// Periodic time selection (every day at 09:00: stride 24, block 1; business hours on Mondays:
+// stride 168, block 9). Only the selected hours are read, for one mesh or many:
+// data[(k * block + b) * num_meshes + mesh_idx] for period k and hour b within it
+int32_t* h5mobaku_read_population_pattern(struct h5r *h5_ctx, cmph_t *hash, uint32_t *mesh_ids, size_t num_meshes,
+                                          const h5r_time_pattern_t *pattern);
+
+// Pattern starting at a datetime ("YYYY-MM-DD HH:MM:SS"); 0 on success, -1 on error
+int h5mobaku_time_pattern_at(struct h5mobaku *ctx, const char *first_datetime_str, uint64_t stride, uint64_t block,
+                             uint64_t count, h5r_time_pattern_t *pattern);
+
+// Arbitrary (time index, mesh) points, e.g. random validation samples: out[i] is the value at
+// (time_indices[i], mesh_ids[i]). Points are read chunk by chunk, each chunk once. 0 on success, -1 on error.
+int h5mobaku_read_points(struct h5r *h5_ctx, cmph_t *hash, const int *time_indices, const uint32_t *mesh_ids,
+                         size_t n, int32_t *out);
+
+// Demographic breakdown (see h5mobaku_breakdown.h); the dataset is opened on first use.
+// Category table of the file, NULL when it has no breakdown
+const h5mobaku_category_t *h5mobaku_get_breakdown_categories(struct h5mobaku *ctx, size_t *count);
+
+// All categories of one mesh between two time indices:
+// data[(t - start_time_index) * num_categories + c], categories as returned above
+int32_t* h5mobaku_read_breakdown_time_series(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id,
+                                             int start_time_index, int end_time_index, size_t *num_categories);
+
+// One category of one mesh at a time index; -1 on error (including an unknown category)
+int32_t h5mobaku_read_breakdown_single(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id, int time_index,
+                                       h5mobaku_category_t category);
+
 // Free allocated memory from multi/time_series functions
 void h5mobaku_free_data(int32_t *data);
 
@@ -59,6 +127,11 @@ int h5mobaku_open_readwrite(const char *path, struct h5mobaku **out);
 int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, const h5r_writer_config_t* config, struct h5mobaku **out);
 int h5mobaku_open_readwrite_with_dataset(const char *path, const char *dataset_name, struct h5mobaku **out);
 
+// Create a file holding only the given meshes (column i = mesh_ids[i]). The list is stored in the
+// file and opening it builds a lookup table from it, so subset files work with any build.
+int h5mobaku_create_with_meshes(const char *path, const h5r_writer_config_t* config,
+                                const uint32_t *mesh_ids, size_t num_meshes, struct h5mobaku **out);
+
 // Time-based writing API
 int h5mobaku_write_population_single_at_time(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id, const char *datetime_str, int32_t value);
 int h5mobaku_write_population_multi_at_time(struct h5mobaku *ctx, cmph_t *hash, uint32_t *mesh_ids, const int32_t *values, size_t num_meshes, const char *datetime_str);
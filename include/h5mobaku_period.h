@@ -0,0 +1,47 @@
+//
+// Period-over-period comparison of a mesh set
+//
+// Both windows are read together: their hours form one row selection, so each strip of meshes
+// takes a single read and chunks holding both windows (same season of consecutive years sits in
+// adjacent 8784-hour chunks) are visited once. Peak memory is one strip of both windows.
+//
+
+#ifndef H5MOBAKU_PERIOD_H
+#define H5MOBAKU_PERIOD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "h5mobaku_ops.h"
+#include "h5mobaku_topk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Weekday-aligned shift to the same hours one year earlier (52 weeks)
+#define H5MOBAKU_HOURS_52_WEEKS (52 * 168)
+
+typedef struct {
+    int start_time;             // First time index
+    int end_time;               // Last time index (inclusive)
+} h5mobaku_window_t;
+
+typedef struct {
+    double base;                // Reduced value over the base window
+    double current;             // Reduced value over the current window
+    double delta;               // current - base
+    double ratio;               // current / base; NAN when base is 0
+} h5mobaku_period_change_t;
+
+// Reduce every mesh over both windows (use MEAN for windows of different lengths) and compare.
+// out[m] follows mesh_ids; mesh_ids NULL compares every column of the file (num_meshes ignored,
+// out holds one entry per column). The windows may overlap. Returns 0 on success, -1 on error.
+int h5mobaku_compare_periods(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                             h5mobaku_window_t base, h5mobaku_window_t current, h5mobaku_reducer_t reducer,
+                             h5mobaku_period_change_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_PERIOD_H
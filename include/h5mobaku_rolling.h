@@ -0,0 +1,72 @@
+//
+// Rolling-window statistics over hourly series of a mesh set
+//
+// The series are read band by band (a bounded number of hours for every mesh) and each band is
+// folded into the running statistics as soon as it arrives, so the full time x mesh matrix is
+// never held. The kernels walk the hours in order with the meshes innermost, which the compiler
+// vectorizes across the meshes of a strip.
+//
+
+#ifndef H5MOBAKU_ROLLING_H
+#define H5MOBAKU_ROLLING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "h5mobaku_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    H5MOBAKU_ROLL_SUM,
+    H5MOBAKU_ROLL_MEAN,
+    H5MOBAKU_ROLL_MIN,
+    H5MOBAKU_ROLL_MAX,
+    H5MOBAKU_ROLL_EWMA
+} h5mobaku_rolling_op_t;
+
+// The value at hour t covers hours t-window+1..t; windows are cut short at the start of the file
+// (MEAN divides by the hours present). EWMA is y = alpha * x + (1 - alpha) * y, seeded with the
+// first of the window-1 hours read ahead of start_time, so window also sets its warm-up length.
+typedef struct {
+    h5mobaku_rolling_op_t op;
+    size_t window;              // Hours, at least 1
+    double alpha;               // EWMA smoothing factor in (0, 1]
+    size_t band_hours;          // Hours read per band; 0 sizes bands to the cell budget
+    size_t band_cells;          // Hours x meshes held per strip; 0 for about 4M
+} h5mobaku_rolling_spec_t;
+
+#define H5MOBAKU_ROLLING_DEFAULT_SPEC { \
+    .op = H5MOBAKU_ROLL_MEAN, \
+    .window = 24, \
+    .alpha = 0.1, \
+    .band_hours = 0, \
+    .band_cells = 0 \
+}
+
+// Receives one tile: values[(t - first_time) * num_meshes + (m - first_mesh)] for num_times hours
+// and meshes first_mesh..first_mesh+num_meshes-1 of the request. Each strip of meshes runs to
+// end_time before the next begins. The buffer is reused after the call returns. Return non-zero
+// to stop with an error.
+typedef int (*h5mobaku_rolling_sink_t)(void *user, int first_time, size_t num_times, size_t first_mesh,
+                                       size_t num_meshes, const double *values);
+
+// Parse "sum", "mean", "min", "max" or "ewma"
+int h5mobaku_parse_rolling_op(const char *name, h5mobaku_rolling_op_t *op);
+
+// Stream the rolling statistic of every mesh for start_time..end_time to sink. mesh_ids NULL covers
+// every column of the file (mesh index = column, num_meshes ignored). 0 on success, -1 on error.
+int h5mobaku_rolling_stream(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                            int start_time, int end_time, const h5mobaku_rolling_spec_t *spec,
+                            h5mobaku_rolling_sink_t sink, void *user);
+
+// Same, collected into out[(t - start_time) * num_meshes + m]; release with free()
+double* h5mobaku_read_rolling(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                              int start_time, int end_time, const h5mobaku_rolling_spec_t *spec);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_ROLLING_H
@@ -0,0 +1,62 @@
+//
+// Top-K meshes by population over a time range
+//
+// Column bands (one chunk wide) are read by worker threads, reduced over the time range and
+// kept in per-thread heaps that are merged at the end. When the file carries a current
+// chunk_max dataset (h5r_build_chunk_max), bands are visited in order of their upper bound
+// and the scan stops once no remaining band can reach the K-th value.
+//
+
+#ifndef H5MOBAKU_TOPK_H
+#define H5MOBAKU_TOPK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "h5mobaku_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    H5MOBAKU_REDUCE_SUM,
+    H5MOBAKU_REDUCE_MEAN,
+    H5MOBAKU_REDUCE_MAX
+} h5mobaku_reducer_t;
+
+typedef struct {
+    uint32_t mesh_id;
+    double value;               // Reduced population (exact for SUM and MAX)
+} h5mobaku_topk_entry_t;
+
+typedef struct {
+    const uint32_t *mesh1;      // Only meshes in these 1st mesh codes (AABB); NULL for nationwide
+    size_t num_mesh1;
+    int threads;                // Worker threads; 0 for the number of online CPUs
+    int use_chunk_max;          // Prune with the chunk_max dataset when it is present and current
+} h5mobaku_topk_config_t;
+
+#define H5MOBAKU_TOPK_DEFAULT_CONFIG { \
+    .mesh1 = NULL, \
+    .num_mesh1 = 0, \
+    .threads = 0, \
+    .use_chunk_max = 1 \
+}
+
+// Parse "sum", "mean" or "max"
+int h5mobaku_parse_reducer(const char *name, h5mobaku_reducer_t *reducer);
+
+// The k meshes with the largest reduced value over time indices start_time..end_time (inclusive),
+// largest first, ties broken by the smaller mesh ID. out holds k entries; *count receives the
+// number filled (fewer than k when the region has fewer meshes). Returns 0 on success, -1 on error.
+int h5mobaku_top_k(struct h5mobaku *ctx, size_t k, int start_time, int end_time, h5mobaku_reducer_t reducer,
+                   const h5mobaku_topk_config_t *config, h5mobaku_topk_entry_t *out, size_t *count);
+
+// Build (or rebuild) the chunk_max dataset of a closed population file
+int h5mobaku_build_chunk_max(const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // H5MOBAKU_TOPK_H
@@ -0,0 +1,49 @@
+//
+// Large anonymous buffers, first-touched in parallel so their pages land on the intended NUMA nodes
+//
+
+#ifndef LARGE_BUFFER_H
+#define LARGE_BUFFER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Where the pages of a buffer are placed (by which node's threads touch them first)
+typedef enum {
+    LARGE_BUFFER_INTERLEAVE = 0,    // 2 MiB blocks round-robin over the nodes, for writers all over the buffer
+    LARGE_BUFFER_NODE,              // Every page on one node, for threads pinned to it
+    LARGE_BUFFER_PARTITION          // Contiguous slice i on node i, for per-node writers of their own slice
+} large_buffer_placement_t;
+
+typedef struct {
+    large_buffer_placement_t placement;
+    int node;                       // LARGE_BUFFER_NODE: node index as in cpu_topology.h
+    int threads;                    // Touch/zero threads, 0 = one per usable CPU
+    int huge_pages;                 // Try reserved huge pages, then transparent ones; normal pages otherwise
+} large_buffer_config_t;
+
+#define LARGE_BUFFER_DEFAULT_CONFIG { \
+    .placement = LARGE_BUFFER_INTERLEAVE, \
+    .node = 0, \
+    .threads = 0, \
+    .huge_pages = 1 \
+}
+
+// Allocate size zeroed bytes (page aligned). NULL config uses the defaults. Returns NULL on failure.
+void *large_buffer_alloc(size_t size, const large_buffer_config_t *config);
+
+// Zero a buffer from large_buffer_alloc in parallel, each thread writing pages of its own node
+int large_buffer_zero(void *buf);
+
+// Release a buffer from large_buffer_alloc. Returns -1 (and does nothing) for any other pointer,
+// so callers holding either kind can try this first and fall back to free().
+int large_buffer_free(void *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LARGE_BUFFER_H
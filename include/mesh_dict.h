@@ -0,0 +1,32 @@
+//
+// File-specific mesh ID -> column lookup, built from a file's own meshid_list
+//
+
+#ifndef MESH_DICT_H
+#define MESH_DICT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct mesh_dict mesh_dict_t;
+
+// Build a lookup table mapping ids[i] -> i. Returns NULL on failure.
+mesh_dict_t *mesh_dict_create(const uint32_t *ids, size_t count);
+void mesh_dict_destroy(mesh_dict_t *dict);
+
+// Column of mesh_id, or MESHID_NOT_FOUND when the file does not contain it
+uint32_t mesh_dict_lookup(const mesh_dict_t *dict, uint32_t mesh_id);
+size_t mesh_dict_size(const mesh_dict_t *dict);
+
+// Vectorized equality check of two mesh ID lists of the same length
+int mesh_list_equal(const uint32_t *a, const uint32_t *b, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MESH_DICT_H
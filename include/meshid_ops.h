@@ -5,7 +5,9 @@
 #ifndef MESHID_OPS_H
 #define MESHID_OPS_H
 
+#ifndef _GNU_SOURCE
 #define _GNU_SOURCE
+#endif
 
 #include <stdint.h>
 #include <stddef.h>
@@ -26,10 +28,6 @@ extern unsigned char _binary_meshid_mobaku_mph_start[];
 extern unsigned char _binary_meshid_mobaku_mph_end[];
 extern unsigned char _binary_meshid_mobaku_mph_size[];
 
-#ifdef __cplusplus
-}
-#endif
-
 // Time-related constants
 #define REFERENCE_MOBAKU_DATETIME "2016-01-01 00:00:00"
 static const time_t REFERENCE_MOBAKU_TIME = 1451574000;
@@ -61,6 +59,11 @@ int meshid_get_time_index_from_time(time_t now_time);
 
 char* meshid_get_datetime_from_time_index(int time_index);
 
+// Calendar-year helpers (JST, independent of the process time zone)
+int meshid_get_time_index_of_year(int year);      // Time index of YYYY-01-01 00:00:00; negative before 2016
+int meshid_get_hours_in_year(int year);           // 8760 or 8784
+int meshid_get_year_from_time_index(int time_index);
+
 void meshid_uint_to_str(unsigned int num, char *str);
 
 // 検索準備関数
@@ -84,5 +87,9 @@ void meshid_print_progress_bar(int now, int all);
 
 int* meshid_get_all_meshes_in_1st_mesh(int meshid_1, int num_meshes);
 
+#ifdef __cplusplus
+}
+#endif
+
 
 #endif //MESHID_OPS_H
@@ -0,0 +1,65 @@
+//
+// PostgreSQL binary COPY files (COPY ... TO ... (FORMAT binary)) as a source of population rows
+//
+
+#ifndef PGCOPY_OPS_H
+#define PGCOPY_OPS_H
+
+#include <stddef.h>
+#include "csv_ops.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Column layouts, told apart by the number of fields per tuple:
+//   7 fields: date, time, area, residence, age, gender, population (the CSV columns)
+//             date is a PostgreSQL date or an integer YYYYMMDD, time a PostgreSQL time or an integer HHMM
+//   6 fields: timestamp, area, residence, age, gender, population
+//   3 fields: timestamp, area, population
+// timestamp is a timestamp without time zone holding JST wall-clock time. Integer columns may be
+// smallint, integer or bigint; NULL residence/age/gender read as -1.
+typedef struct pgcopy_reader pgcopy_reader_t;
+
+// 1 if the file starts with the PGCOPY signature, 0 otherwise
+int pgcopy_is_pgcopy(const char* filename);
+
+// Map a file for reading its tuples in order. Returns NULL for unreadable or malformed files.
+pgcopy_reader_t* pgcopy_open(const char* filename);
+
+// Parts a file can be split into for parallel reading: 1 unless every tuple has the width of the
+// first one (checked tuple by tuple), then at most max_parts with at least min_part_bytes each
+int pgcopy_count_parts(const char* filename, int max_parts, size_t min_part_bytes);
+
+// Open part `part` of `num_parts` (as sized by pgcopy_count_parts). A part holding a tuple of
+// another width stops with an error.
+pgcopy_reader_t* pgcopy_open_part(const char* filename, int part, int num_parts);
+
+// Tuples of a file whose tuples all have the width of the first one (stored in *width; checked
+// tuple by tuple), 0 for any other file, which is then read whole
+size_t pgcopy_count_tuples(const char* filename, size_t* width);
+
+// Open tuples [first, end) of a file counted by pgcopy_count_tuples
+pgcopy_reader_t* pgcopy_open_tuples(const char* filename, size_t first, size_t end);
+
+// Read tuple `tuple` of the file (counted from its first tuple, whatever the reader's range) without
+// moving the reader. Only for readers opened in parts or by tuples. Returns 0 or -1.
+int pgcopy_read_row_at(pgcopy_reader_t* reader, size_t tuple, csv_row_t* row);
+
+// Read the next tuple. Returns 0 for a row, 1 at the end of the file or part, -1 on error.
+int pgcopy_read_row(pgcopy_reader_t* reader, csv_row_t* row);
+
+// Tuples read so far (for error reporting)
+size_t pgcopy_get_tuple_number(const pgcopy_reader_t* reader);
+
+void pgcopy_close(pgcopy_reader_t* reader);
+
+// Recursively find PGCOPY files (any name, recognised by their signature), appending to files
+// as find_csv_files does
+void pgcopy_find_files(const char* dir_path, char*** files, size_t* count, size_t* capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PGCOPY_OPS_H
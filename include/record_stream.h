@@ -0,0 +1,80 @@
+//
+// Pre-parsed population records: a binary intermediate written while CSV files are parsed,
+// so later rebuilds (other chunking, compression or VDS cutoffs) skip parsing and mesh ID lookup
+//
+
+#ifndef RECORD_STREAM_H
+#define RECORD_STREAM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECORD_STREAM_MAGIC "H5MRREC"       // 8 bytes including the terminating NUL
+#define RECORD_STREAM_VERSION 2
+#define RECORD_STREAM_EXTENSION ".mrec"
+
+// One population value; mesh_index is the position in the full meshid_list (not a subset file's column).
+// The breakdown fields are -1 when the row is not split by them.
+typedef struct {
+    uint32_t time_index;            // Hours since 2016-01-01 00:00 JST
+    uint32_t mesh_index;
+    int32_t population;
+    int32_t residence;
+    int16_t age;
+    int16_t gender;
+} record_stream_record_t;
+
+// 64-byte file header, followed by count records in native byte order
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;            // 0x01020304 as written; a swapped value means another endianness
+    uint32_t record_size;
+    uint32_t mesh_count;            // Size of the mesh index space (MOBAKU_MESH_COUNT)
+    uint64_t count;
+    uint32_t chunk_rows, chunk_cols;    // Chunk shape the records are sorted by
+    uint32_t min_time, max_time;        // Time index range of the records (0, 0 when empty)
+    uint8_t reserved[16];
+} record_stream_header_t;
+
+typedef struct record_stream_writer record_stream_writer_t;
+typedef struct record_stream record_stream_t;
+
+// Collect records for one output file. Records are sorted chunk by chunk (time band of chunk_rows,
+// then column band of chunk_cols) when the writer is closed; rows for the same cell keep their order.
+record_stream_writer_t *record_stream_writer_create(const char *path, uint32_t chunk_rows, uint32_t chunk_cols);
+// age and gender must fit in 16 bits (-1 for none); returns -1 otherwise
+int record_stream_writer_add(record_stream_writer_t *writer, uint32_t time_index, uint32_t mesh_index,
+                             int32_t population, int32_t residence, int32_t age, int32_t gender);
+
+// Sort and write the file (through a temporary name, so a partial file never looks complete) and
+// free the writer. Returns 0 on success, -1 on failure.
+int record_stream_writer_close(record_stream_writer_t *writer);
+
+// Free the writer without writing anything
+void record_stream_writer_discard(record_stream_writer_t *writer);
+
+// Map a record file read-only. Returns NULL (with a message) for missing, truncated or foreign files.
+record_stream_t *record_stream_open(const char *path);
+const record_stream_header_t *record_stream_header(const record_stream_t *stream);
+const record_stream_record_t *record_stream_records(const record_stream_t *stream, size_t *count);
+void record_stream_close(record_stream_t *stream);
+
+// 1 if the file starts with the record stream magic, 0 otherwise
+int record_stream_is_stream(const char *path);
+
+// Record file for a CSV file: dir/<CSV name without .csv>.mrec (malloc'd, NULL on failure)
+char *record_stream_path_for(const char *dir, const char *csv_path);
+
+// Recursively find record files, appending to files as find_csv_files does
+void record_stream_find_files(const char *dir_path, char ***files, size_t *count, size_t *capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORD_STREAM_H
@@ -0,0 +1,251 @@
+//
+// Python bindings for H5Mobaku (pybind11)
+//
+// Results are returned as NumPy arrays that wrap the buffers allocated by the
+// C library; the array owns the buffer through a capsule and hands it back to
+// h5mobaku_free_data() when it is garbage collected, so no copy is made.
+//
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+
+#include <cstdint>
+#include <ctime>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+namespace py = pybind11;
+
+namespace {
+
+// HDF5 is not built thread-safe; all library calls made with the GIL released
+// are serialized through this lock instead.
+std::mutex g_h5_mutex;
+
+using mesh_array_t = py::array_t<uint32_t, py::array::c_style | py::array::forcecast>;
+
+py::array_t<int32_t> wrap_owned(int32_t *data, std::vector<py::ssize_t> shape)
+{
+    py::capsule owner(data, [](void *p) { h5mobaku_free_data(static_cast<int32_t *>(p)); });
+    return py::array_t<int32_t>(shape, data, owner);
+}
+
+const uint32_t *mesh_ids_ptr(const mesh_array_t &mesh_ids)
+{
+    if (mesh_ids.ndim() != 1) {
+        throw std::invalid_argument("mesh_ids must be a 1-D array");
+    }
+    if (mesh_ids.size() == 0) {
+        throw std::invalid_argument("mesh_ids must not be empty");
+    }
+    return mesh_ids.data();
+}
+
+class Reader {
+public:
+    explicit Reader(const std::string &path)
+    {
+        py::gil_scoped_release release;
+        std::lock_guard<std::mutex> lock(g_h5_mutex);
+        if (h5mobaku_open(path.c_str(), &ctx_) != 0) {
+            throw std::runtime_error("Failed to open HDF5 file: " + path);
+        }
+        hash_ = meshid_prepare_search();
+        if (!hash_) {
+            h5mobaku_close(ctx_);
+            ctx_ = nullptr;
+            throw std::runtime_error("Failed to prepare mesh ID search");
+        }
+    }
+
+    ~Reader() { close(); }
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(g_h5_mutex);
+        if (hash_) {
+            cmph_destroy(hash_);
+            hash_ = nullptr;
+        }
+        if (ctx_) {
+            h5mobaku_close(ctx_);
+            ctx_ = nullptr;
+        }
+    }
+
+    std::string start_datetime() const
+    {
+        std::lock_guard<std::mutex> lock(g_h5_mutex);
+        check_open();
+        return ctx_->start_datetime_str ? ctx_->start_datetime_str : "";
+    }
+
+    // Hours since the file's start_datetime (same rule as the *_at_time C API)
+    int time_index(const std::string &datetime) const
+    {
+        time_t start;
+        {
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            start = ctx_->start_datetime;
+        }
+        struct tm tm = {};
+        if (strptime(datetime.c_str(), "%Y-%m-%d %H:%M:%S", &tm) == nullptr) {
+            throw std::invalid_argument("Failed to parse datetime '" + datetime + "' (expected YYYY-MM-DD HH:MM:SS)");
+        }
+        time_t t = mktime(&tm);
+        int index = static_cast<int>(difftime(t, start) / 3600.0);
+        if (index < 0) {
+            throw std::invalid_argument("Datetime '" + datetime + "' is before start datetime");
+        }
+        return index;
+    }
+
+    py::tuple shape() const
+    {
+        size_t time_points = 0, mesh_count = 0;
+        {
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            h5r_get_dimensions(ctx_->h5r_ctx, &time_points, &mesh_count);
+        }
+        return py::make_tuple(time_points, mesh_count);
+    }
+
+    // Batch mesh ID -> column index of this file (subset and reordered files have their own
+    // columns); unknown IDs map to -1
+    py::array_t<int64_t> mesh_indices(const mesh_array_t &mesh_ids) const
+    {
+        const uint32_t *ids = mesh_ids_ptr(mesh_ids);
+        const py::ssize_t n = mesh_ids.size();
+        py::array_t<int64_t> out(n);
+        int64_t *dst = out.mutable_data();
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            size_t time_points = 0, mesh_count = 0;
+            h5r_get_dimensions(ctx_->h5r_ctx, &time_points, &mesh_count);
+            for (py::ssize_t i = 0; i < n; ++i) {
+                uint32_t idx = h5mobaku_mesh_index(ctx_->h5r_ctx, hash_, ids[i]);
+                dst[i] = (idx == MESHID_NOT_FOUND || idx >= mesh_count) ? -1 : static_cast<int64_t>(idx);
+            }
+        }
+        return out;
+    }
+
+    int32_t read_single(uint32_t mesh_id, int time_index)
+    {
+        int32_t value;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            value = h5mobaku_read_population_single(ctx_->h5r_ctx, hash_, mesh_id, time_index);
+        }
+        if (value < 0) {
+            throw std::runtime_error("Failed to read population data");
+        }
+        return value;
+    }
+
+    py::array_t<int32_t> read_multi(const mesh_array_t &mesh_ids, int time_index)
+    {
+        const uint32_t *ids = mesh_ids_ptr(mesh_ids);
+        const size_t n = static_cast<size_t>(mesh_ids.size());
+        int32_t *data;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            data = h5mobaku_read_population_multi(ctx_->h5r_ctx, hash_, const_cast<uint32_t *>(ids), n, time_index);
+        }
+        if (!data) {
+            throw std::runtime_error("Failed to read population data for multiple meshes");
+        }
+        return wrap_owned(data, {static_cast<py::ssize_t>(n)});
+    }
+
+    py::array_t<int32_t> read_time_series(uint32_t mesh_id, int start_time_index, int end_time_index)
+    {
+        int32_t *data;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            data = h5mobaku_read_population_time_series(ctx_->h5r_ctx, hash_, mesh_id,
+                                                        start_time_index, end_time_index);
+        }
+        if (!data) {
+            throw std::runtime_error("Failed to read time series");
+        }
+        return wrap_owned(data, {static_cast<py::ssize_t>(end_time_index - start_time_index + 1)});
+    }
+
+    // Returns a (num_times, num_meshes) array in the C library's row-major layout
+    py::array_t<int32_t> read_multi_mesh_time_series(const mesh_array_t &mesh_ids,
+                                                     int start_time_index, int end_time_index)
+    {
+        const uint32_t *ids = mesh_ids_ptr(mesh_ids);
+        const size_t n = static_cast<size_t>(mesh_ids.size());
+        int32_t *data;
+        {
+            py::gil_scoped_release release;
+            std::lock_guard<std::mutex> lock(g_h5_mutex);
+            check_open();
+            data = h5mobaku_read_multi_mesh_time_series(ctx_->h5r_ctx, hash_, const_cast<uint32_t *>(ids), n,
+                                                        start_time_index, end_time_index);
+        }
+        if (!data) {
+            throw std::runtime_error("Failed to read multi-mesh time series");
+        }
+        return wrap_owned(data, {static_cast<py::ssize_t>(end_time_index - start_time_index + 1),
+                                 static_cast<py::ssize_t>(n)});
+    }
+
+private:
+    // Caller holds g_h5_mutex, so close() cannot run in between
+    void check_open() const
+    {
+        if (!ctx_ || !hash_) {
+            throw std::runtime_error("Reader is closed");
+        }
+    }
+
+    struct h5mobaku *ctx_ = nullptr;
+    cmph_t *hash_ = nullptr;
+};
+
+} // namespace
+
+PYBIND11_MODULE(h5mr_py, m)
+{
+    m.doc() = "H5Mobaku population data reader";
+
+    py::class_<Reader>(m, "Reader")
+        .def(py::init<const std::string &>(), py::arg("path"))
+        .def("close", &Reader::close)
+        .def("__enter__", [](Reader &self) -> Reader & { return self; }, py::return_value_policy::reference)
+        .def("__exit__", [](Reader &self, py::args) { self.close(); })
+        .def_property_readonly("start_datetime", &Reader::start_datetime)
+        .def_property_readonly("shape", &Reader::shape)
+        .def("time_index", &Reader::time_index, py::arg("datetime"))
+        .def("mesh_indices", &Reader::mesh_indices, py::arg("mesh_ids"))
+        .def("read_single", &Reader::read_single, py::arg("mesh_id"), py::arg("time_index"))
+        .def("read_multi", &Reader::read_multi, py::arg("mesh_ids"), py::arg("time_index"))
+        .def("read_time_series", &Reader::read_time_series,
+             py::arg("mesh_id"), py::arg("start_time_index"), py::arg("end_time_index"))
+        .def("read_multi_mesh_time_series", &Reader::read_multi_mesh_time_series,
+             py::arg("mesh_ids"), py::arg("start_time_index"), py::arg("end_time_index"));
+
+    m.attr("MESH_COUNT") = MOBAKU_MESH_COUNT;
+    m.attr("TIME_POINTS") = MOBAKU_TIME_POINTS;
+}
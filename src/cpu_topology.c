@@ -0,0 +1,108 @@
+//
+// CPU and NUMA node discovery from the affinity mask and sysfs
+//
+
+#define _GNU_SOURCE
+#include "cpu_topology.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NUMA_NODES 64
+
+struct cpu_topology {
+    cpu_set_t usable;                   // Process affinity mask at detection time
+    int num_cpus;
+    int num_nodes;                      // Nodes with at least one usable CPU
+    cpu_set_t nodes[MAX_NUMA_NODES];
+};
+
+// Parse a sysfs cpulist such as "0-15,32-47"
+static int parse_cpulist(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p && *p != '\n') {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0) return -1;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            last = strtol(p + 1, &end, 10);
+            if (end == p + 1 || last < first) return -1;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) CPU_SET((int)cpu, set);
+        if (*p == ',') p++;
+    }
+    return 0;
+}
+
+static int read_list_file(const char *path, cpu_set_t *set) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char line[4096];
+    int ok = fgets(line, sizeof(line), fp) && parse_cpulist(line, set) == 0;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+static void read_nodes(cpu_topology_t *topo) {
+    // The online node list uses the same range syntax as a cpulist
+    cpu_set_t online;
+    if (read_list_file("/sys/devices/system/node/online", &online) < 0) return;
+
+    for (int node = 0; node < CPU_SETSIZE && topo->num_nodes < MAX_NUMA_NODES; node++) {
+        if (!CPU_ISSET(node, &online)) continue;
+        char path[64];
+        cpu_set_t set;
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+        if (read_list_file(path, &set) < 0) continue;
+
+        // Memory-only nodes and nodes outside the affinity mask have nothing to run on
+        CPU_AND(&set, &set, &topo->usable);
+        if (CPU_COUNT(&set) > 0) topo->nodes[topo->num_nodes++] = set;
+    }
+}
+
+cpu_topology_t *cpu_topology_detect(void) {
+    cpu_topology_t *topo = calloc(1, sizeof(*topo));
+    if (!topo) return NULL;
+
+    if (sched_getaffinity(0, sizeof(topo->usable), &topo->usable) != 0) {
+        free(topo);
+        return NULL;
+    }
+    topo->num_cpus = CPU_COUNT(&topo->usable);
+
+    read_nodes(topo);
+    if (topo->num_nodes == 0) {
+        topo->nodes[0] = topo->usable;
+        topo->num_nodes = 1;
+    }
+    return topo;
+}
+
+void cpu_topology_destroy(cpu_topology_t *topo) {
+    free(topo);
+}
+
+int cpu_topology_num_cpus(const cpu_topology_t *topo) {
+    return topo ? topo->num_cpus : 1;
+}
+
+int cpu_topology_num_nodes(const cpu_topology_t *topo) {
+    return topo ? topo->num_nodes : 1;
+}
+
+int cpu_topology_node_cpus(const cpu_topology_t *topo, int node) {
+    if (!topo || node < 0 || node >= topo->num_nodes) return 0;
+    return CPU_COUNT(&topo->nodes[node]);
+}
+
+int cpu_topology_bind_thread(const cpu_topology_t *topo, pthread_t thread, int node) {
+    if (!topo || node >= topo->num_nodes) return -1;
+    const cpu_set_t *set = node < 0 ? &topo->usable : &topo->nodes[node];
+    return pthread_setaffinity_np(thread, sizeof(*set), set) == 0 ? 0 : -1;
+}
@@ -5,6 +5,11 @@
 #include "csv_to_h5_converter.h"
 #include "csv_ops.h"
 #include "h5mobaku_ops.h"
+#include "h5mobaku_breakdown.h"
+#include "cpu_topology.h"
+#include "large_buffer.h"
+#include "record_stream.h"
+#include "pgcopy_ops.h"
 #include "meshid_ops.h"
 #include "fifioq.h"
 #include <stdlib.h>
@@ -14,13 +19,13 @@
 #include <fnmatch.h>
 #include <sys/stat.h>
 #include <pthread.h>
-#include <sys/mman.h>
 #include <stdbool.h>
 #include <time.h>
 #include <hdf5.h>
 #include <errno.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 
 // Internal structure to track unique timestamps and their indices
 typedef struct {
@@ -29,10 +34,51 @@ typedef struct {
     size_t index;
 } timestamp_entry_t;
 
+// Pre-processed write data structure (sent from producer to consumer)
+typedef struct {
+    size_t time_index;    // Calculated time index for HDF5
+    uint32_t mesh_index;  // Calculated mesh index  
+    int32_t population;   // Population value to write
+    bool use_bulk_mode;   // Whether to use bulk buffer or direct write
+} write_data_t;
+
+// Row split by residence/age/gender, kept for population_breakdown until its stage or band is flushed
+typedef struct {
+    size_t time_index;
+    uint32_t mesh_index;
+    int32_t population;
+    h5mobaku_category_t category;
+    int category_index;   // Resolved when written
+} breakdown_row_t;
+
+#define MAX_YEAR_BUFFERS 2
+
+// Breakdown rows (32 bytes each) the incremental consumer lets pile up before writing them out
+#define BREAKDOWN_FLUSH_ROWS ((size_t)1 << 20)
+
+// Cells already written in this run, so sum/max in incremental mode merge only with rows of the run
+// (only needed for hours the file held before the run): one bit per output column for each such hour
+// the run touches. Up to CELL_SET_MEMORY_BYTES of hour bitmaps are kept in memory; further hours are
+// spilled to a sparse, unlinked file next to the output, mapped shared so the kernel can write its
+// pages back instead of holding them.
+#ifndef CELL_SET_MEMORY_BYTES
+#define CELL_SET_MEMORY_BYTES ((size_t)256 << 20)
+#endif
+
+typedef struct {
+    uint8_t** rows;             // Bitmap per hour below num_rows, NULL until the hour is touched
+    size_t num_rows;
+    size_t row_bytes;
+    size_t memory_bytes;        // Bitmaps allocated in memory so far
+    uint8_t* spill;             // num_rows bitmaps in the spill file, NULL until the first spill
+    size_t spill_size;
+} cell_set_t;
+
 // Internal converter context
 typedef struct {
     struct h5mobaku* writer;
     cmph_t* mesh_hash;
+    size_t mesh_count;    // Columns in the output file (subset files are narrower)
     timestamp_entry_t* timestamps;
     size_t timestamp_count;
     size_t timestamp_capacity;
@@ -41,20 +87,77 @@ typedef struct {
     csv_to_h5_stats_t stats;
     pthread_mutex_t stats_mutex;
     pthread_mutex_t timestamp_mutex;
-    // Bulk write buffer for year-wise processing (51 GiB)
-    int32_t* year_buffer;
+    // Bulk write buffers for year-wise processing (≈ 51 GiB each), laid out chunk-major on the
+    // file's chunk grid: tiles of up to tile_rows x tile_cols (the chunk shape) are each contiguous,
+    // and the partial first and last time bands of a year hold only the year's rows.
+    // With two buffers the next year is parsed while the previous one is written.
+    int32_t* year_buffers[MAX_YEAR_BUFFERS];
+    int num_year_buffers;
     size_t year_buffer_size;
+    size_t tile_rows, tile_cols;
+    size_t stage_rows, col_tiles;   // Hours a buffer holds (a leap year) and tiles across
     bool use_bulk_write;
-    int bulk_write_year;  // Year of data for bulk mode
+    // Bulk-mode rows from a different year than their file's stage, written chunk by chunk once their year is on disk
+    write_data_t* spill;
+    size_t spill_count;
+    size_t spill_capacity;
+    pthread_mutex_t spill_mutex;
+    csv_to_h5_merge_policy_t merge_policy;
+    cell_set_t written_cells;   // Consumer thread only: sum/max cells of this run below merge_initial_rows
+    size_t merge_initial_rows;  // Time points stored before the run (0 for a new file)
+    const char* output_path;    // Spill file of written_cells is created next to it
+    size_t saturated_cells;     // Summed cells clamped to the int32 range (atomic)
+    // Breakdown rows, collected by the readers and written per mesh and time band: after each bulk
+    // stage, or by the incremental consumer once BREAKDOWN_FLUSH_ROWS have piled up. Rows for hours
+    // stored before the run are held until the end, so a cell the run covers replaces the stored one.
+    h5mobaku_breakdown_t* breakdown;    // NULL unless store_breakdown is set
+    breakdown_row_t* breakdown_rows;
+    size_t breakdown_count;
+    size_t breakdown_capacity;
+    size_t breakdown_initial_rows;      // Time points of population_breakdown when the run started
+    size_t breakdown_flush_at;          // Incremental mode: row count that triggers the next flush
+    pthread_mutex_t breakdown_mutex;
+    // Thread sizing and placement
+    cpu_topology_t* topology;
+    int reader_threads;         // Fixed reader count, 0 sizes from usable CPUs
+    bool pin_threads;
+    int year_buffer_nodes[MAX_YEAR_BUFFERS];    // Node each buffer was first touched on (pinning only)
+    // Pre-parsed record files written next to the parse (NULL when off)
+    const char* record_dir;
+    uint32_t record_chunk_rows, record_chunk_cols;
+    bool subset_columns;        // Output columns are a subset, not meshid_list positions
 } converter_ctx_t;
 
-// Pre-processed write data structure (sent from producer to consumer)
+// One unit of reader work: a whole file, or tuples [first_tuple, end_tuple) of a PGCOPY file with
+// fixed-width tuples. part/num_parts number the pieces of one file (its record files are named after them).
 typedef struct {
-    size_t time_index;    // Calculated time index for HDF5
-    uint32_t mesh_index;  // Calculated mesh index  
-    int32_t population;   // Population value to write
-    bool use_bulk_mode;   // Whether to use bulk buffer or direct write
-} write_data_t;
+    const char* path;
+    int part;
+    int num_parts;
+    bool pgcopy;
+    size_t first_tuple;
+    size_t end_tuple;       // 0 reads the whole file
+    int year;               // Bulk mode: year of the first row, 0 when the input has none
+} reader_input_t;
+
+// One year of bulk input: a range of the year-sorted reader inputs and the buffer it fills
+typedef struct {
+    int year;
+    const reader_input_t* inputs;
+    size_t num_inputs;
+    int32_t* buffer;
+    size_t row_offset;      // Row of the year's first hour within its chunk (time index % tile_rows)
+    bool last;
+} bulk_stage_t;
+
+// Bulk writer thread: writes filled stages and hands their buffers back
+typedef struct {
+    converter_ctx_t* ctx;
+    FIFOQueue* full_stages;     // Stages ready to write; NULL ends the thread
+    FIFOQueue* free_buffers;
+    int verbose;
+    int failed;
+} bulk_writer_data_t;
 
 // Consumer thread data for parallel processing
 typedef struct {
@@ -64,15 +167,27 @@ typedef struct {
     volatile int* should_stop;
 } consumer_thread_data_t;
 
+// Readers of one run claim inputs one at a time, so uneven file sizes do not leave threads idle.
+// In incremental mode a reader parks between inputs while the consumer's queue is nearly full:
+// a single writer only needs as many producers as keep it fed.
+typedef struct {
+    const reader_input_t* inputs;
+    size_t num_inputs;
+    size_t next_input;
+    pthread_mutex_t mutex;
+    pthread_cond_t changed;
+    int active;                 // Readers running and not parked
+} reader_pool_t;
+
 // Enhanced CSV reader thread data structure that includes converter context
 typedef struct {
     int thread_id;
-    char** filepaths;
-    size_t num_files;
+    reader_pool_t* pool;
     FIFOQueue* queue;
     size_t* rows_processed;
     pthread_mutex_t* stats_mutex;
     converter_ctx_t* ctx;  // Added for processing
+    bulk_stage_t* stage;   // Bulk mode: year being staged (NULL in incremental mode)
     bool verbose;
     size_t* total_files_processed;  // For progress tracking
     size_t total_files;             // Total number of files
@@ -177,48 +292,205 @@ static size_t find_or_add_timestamp(converter_ctx_t* ctx, uint32_t date, uint16_
     return result;
 }
 
+int csv_to_h5_parse_merge_policy(const char* name, csv_to_h5_merge_policy_t* policy) {
+    if (!name || !policy) return -1;
+    if (strcmp(name, "overwrite") == 0) {
+        *policy = CSV_TO_H5_MERGE_OVERWRITE;
+    } else if (strcmp(name, "sum") == 0) {
+        *policy = CSV_TO_H5_MERGE_SUM;
+    } else if (strcmp(name, "max") == 0) {
+        *policy = CSV_TO_H5_MERGE_MAX;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+// Sum that saturates at the int32 range instead of wrapping; saturated sums are counted for the final warning
+static inline int32_t saturating_sum(converter_ctx_t* ctx, int32_t stored, int32_t value) {
+    int32_t sum;
+    if (!__builtin_add_overflow(stored, value, &sum)) return sum;
+    __atomic_fetch_add(&ctx->saturated_cells, 1, __ATOMIC_RELAXED);
+    return value > 0 ? INT32_MAX : INT32_MIN;
+}
+
+static inline int32_t merge_values(converter_ctx_t* ctx, int32_t stored, int32_t value) {
+    switch (ctx->merge_policy) {
+        case CSV_TO_H5_MERGE_SUM: return saturating_sum(ctx, stored, value);
+        case CSV_TO_H5_MERGE_MAX: return value > stored ? value : stored;
+        default:                  return value;
+    }
+}
+
+// Merge a value into a staging cell shared by all reader threads
+static inline void merge_into_cell(converter_ctx_t* ctx, int32_t* cell, int32_t value) {
+    int32_t current = __atomic_load_n(cell, __ATOMIC_RELAXED);
+    switch (ctx->merge_policy) {
+        case CSV_TO_H5_MERGE_SUM: {
+            int32_t sum;
+            bool saturated;
+            do {
+                saturated = __builtin_add_overflow(current, value, &sum);
+                if (saturated) sum = value > 0 ? INT32_MAX : INT32_MIN;
+            } while (!__atomic_compare_exchange_n(cell, &current, sum, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+            if (saturated) __atomic_fetch_add(&ctx->saturated_cells, 1, __ATOMIC_RELAXED);
+            break;
+        }
+        case CSV_TO_H5_MERGE_MAX:
+            while (value > current &&
+                   !__atomic_compare_exchange_n(cell, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            }
+            break;
+        default:
+            *cell = value;
+            break;
+    }
+}
+
+// Map the spill file of the set: an unlinked sparse file holding a bitmap slot for every hour
+static int cell_set_map_spill(cell_set_t* set, const char* output_path) {
+    size_t len = strlen(output_path) + sizeof(".cells.XXXXXX");
+    char* path = malloc(len);
+    if (!path) return -1;
+    snprintf(path, len, "%s.cells.XXXXXX", output_path);
+    int fd = mkstemp(path);
+    if (fd >= 0) unlink(path);
+    free(path);
+    if (fd < 0) return -1;
+    
+    const size_t size = set->num_rows * set->row_bytes;
+    void* map = ftruncate(fd, (off_t)size) == 0 ? mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                                : MAP_FAILED;
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    set->spill = map;
+    set->spill_size = size;
+    return 0;
+}
+
+// Returns 1 when the cell was not in the set yet, 0 when it was, -1 on allocation failure
+static int cell_set_insert(cell_set_t* set, const char* output_path, uint64_t row, uint32_t col) {
+    uint8_t* bits = set->rows[row];
+    if (!bits) {
+        if (set->memory_bytes + set->row_bytes <= CELL_SET_MEMORY_BYTES) {
+            bits = calloc(1, set->row_bytes);
+            if (!bits) return -1;
+            set->memory_bytes += set->row_bytes;
+        } else {
+            if (!set->spill && cell_set_map_spill(set, output_path) < 0) return -1;
+            bits = set->spill + row * set->row_bytes;
+        }
+        set->rows[row] = bits;
+    }
+    
+    const uint8_t mask = (uint8_t)(1u << (col & 7));
+    if (bits[col >> 3] & mask) return 0;
+    bits[col >> 3] |= mask;
+    return 1;
+}
+
+static int cell_set_init(cell_set_t* set, size_t num_rows, size_t num_cols) {
+    set->num_rows = num_rows;
+    set->row_bytes = (num_cols + 7) / 8;
+    set->rows = num_rows > 0 ? calloc(num_rows, sizeof(uint8_t*)) : NULL;
+    return num_rows > 0 && !set->rows ? -1 : 0;
+}
+
+static void cell_set_free(cell_set_t* set) {
+    for (size_t r = 0; set->rows && r < set->num_rows; r++) {
+        // Spilled hours point into the mapping
+        if (set->rows[r] && !(set->spill && set->rows[r] >= set->spill && set->rows[r] < set->spill + set->spill_size)) {
+            free(set->rows[r]);
+        }
+    }
+    free(set->rows);
+    if (set->spill) munmap(set->spill, set->spill_size);
+}
+
+// Time band of the year buffer holding hour-of-year time_idx: its first hour and its number of
+// rows. Bands follow the chunk grid, so only the first and the last can be short.
+static inline void staging_band(const converter_ctx_t* ctx, const bulk_stage_t* stage, size_t time_idx,
+                                size_t* first, size_t* rows) {
+    const size_t row = time_idx + stage->row_offset;
+    const size_t band_start = row - row % ctx->tile_rows;
+    const size_t lo = band_start > stage->row_offset ? band_start : stage->row_offset;
+    const size_t end = stage->row_offset + ctx->stage_rows;
+    const size_t hi = band_start + ctx->tile_rows < end ? band_start + ctx->tile_rows : end;
+    *first = lo - stage->row_offset;
+    *rows = hi - lo;
+}
+
+// Offset of (hour of year, column) in the chunk-major year buffer: bands are stored one after
+// another, each as col_tiles tiles of its rows x tile_cols
+static inline size_t staging_offset(const converter_ctx_t* ctx, const bulk_stage_t* stage, size_t time_idx,
+                                    size_t mesh_idx) {
+    size_t first, rows;
+    staging_band(ctx, stage, time_idx, &first, &rows);
+    return first * ctx->col_tiles * ctx->tile_cols + (mesh_idx / ctx->tile_cols) * rows * ctx->tile_cols
+         + (time_idx - first) * ctx->tile_cols + mesh_idx % ctx->tile_cols;
+}
+
+// Physical memory not in use right now, in bytes (SIZE_MAX when unknown)
+static size_t available_memory(void) {
+    long pages = sysconf(_SC_AVPHYS_PAGES);
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (pages <= 0 || page_size <= 0) return SIZE_MAX;
+    return (size_t)pages * (size_t)page_size;
+}
+
+// Allocate one more year buffer (the first call also fixes the tile layout)
 static int allocate_year_buffer(converter_ctx_t* ctx, bool verbose) {
-    // Calculate buffer size: 8784 hours × MOBAKU_MESH_COUNT meshes × 4 bytes ≈ 51 GiB
+    const int buffer_index = ctx->num_year_buffers;
+    if (ctx->num_year_buffers >= MAX_YEAR_BUFFERS) return -1;
+    
+    // Tiles follow the file's chunk shape so each one maps onto exactly one chunk
+    h5r_metadata_t meta;
+    if (h5r_get_metadata(ctx->writer->h5r_ctx, &meta) < 0 || meta.layout != H5D_CHUNKED) {
+        if (verbose) {
+            fprintf(stderr, "Bulk write needs a chunked dataset\n");
+        }
+        return -1;
+    }
+    
+    // Calculate buffer size: 8784 hours × mesh_count meshes × 4 bytes (≈ 51 GiB for the full mesh set),
+    // rounded up to whole tiles across
     const size_t HOURS_PER_YEAR = 8784; // Leap year: 366 days * 24 hours (max possible)
-    const size_t MESH_COUNT = MOBAKU_MESH_COUNT;
+    const size_t MESH_COUNT = ctx->mesh_count;
     const size_t BYTES_PER_ELEMENT = sizeof(int32_t);
     
-    ctx->year_buffer_size = HOURS_PER_YEAR * MESH_COUNT * BYTES_PER_ELEMENT;
+    ctx->tile_rows = meta.crows;
+    ctx->tile_cols = meta.ccols;
+    ctx->stage_rows = HOURS_PER_YEAR;
+    ctx->col_tiles = (MESH_COUNT + ctx->tile_cols - 1) / ctx->tile_cols;
+    ctx->year_buffer_size = ctx->stage_rows * ctx->col_tiles * ctx->tile_cols * BYTES_PER_ELEMENT;
     
     if (verbose) {
         printf("Attempting to allocate %.2f GiB for year buffer...\n", 
                (double)ctx->year_buffer_size / (1024.0 * 1024.0 * 1024.0));
     }
     
-    // Try aligned allocation with HugeTLB optimization
-    void* buf_raw = NULL;
-    int result = posix_memalign(&buf_raw, 4096, ctx->year_buffer_size);
-    
-    if (result != 0) {
+    // Zeroed by first touch in parallel. With pinning every page is placed on the buffer's node, where
+    // the stage's readers and its writer then run; otherwise pages are interleaved over all nodes.
+    large_buffer_config_t buffer_config = LARGE_BUFFER_DEFAULT_CONFIG;
+    int node = -1;
+    if (ctx->pin_threads) {
+        node = buffer_index % cpu_topology_num_nodes(ctx->topology);
+        buffer_config.placement = LARGE_BUFFER_NODE;
+        buffer_config.node = node;
+    }
+    void* buf_raw = large_buffer_alloc(ctx->year_buffer_size, &buffer_config);
+    if (!buf_raw) {
         if (verbose) {
-            fprintf(stderr, "Failed to allocate aligned memory: %s\n", strerror(result));
-        }
-        // Fallback to regular allocation
-        buf_raw = malloc(ctx->year_buffer_size);
-        if (!buf_raw) {
-            if (verbose) {
-                fprintf(stderr, "Failed to allocate regular memory for year buffer\n");
-            }
-            return -1;
-        }
-    } else {
-        // Enable HugeTLB for better performance
-        if (madvise(buf_raw, ctx->year_buffer_size, MADV_HUGEPAGE) != 0) {
-            if (verbose) {
-                fprintf(stderr, "Warning: Could not enable HugeTLB optimization\n");
-            }
+            fprintf(stderr, "Failed to allocate memory for year buffer\n");
         }
+        return -1;
     }
     
-    ctx->year_buffer = (int32_t*)buf_raw;
-    
-    // Initialize buffer to zero
-    memset(ctx->year_buffer, 0, ctx->year_buffer_size);
+    ctx->year_buffers[ctx->num_year_buffers++] = (int32_t*)buf_raw;
+    ctx->year_buffer_nodes[buffer_index] = node;
+    if (verbose && node >= 0) {
+        printf("Year buffer %d placed on NUMA node %d\n", buffer_index, node);
+    }
     
     if (verbose) {
         printf("Successfully allocated year buffer (%.2f GiB)\n", 
@@ -228,6 +500,8 @@ static int allocate_year_buffer(converter_ctx_t* ctx, bool verbose) {
     return 0;
 }
 
+static void converter_destroy(converter_ctx_t* ctx);
+
 static converter_ctx_t* converter_create(const csv_to_h5_config_t* config) {
     converter_ctx_t* ctx = calloc(1, sizeof(converter_ctx_t));
     if (!ctx) return NULL;
@@ -242,6 +516,19 @@ static converter_ctx_t* converter_create(const csv_to_h5_config_t* config) {
         free(ctx);
         return NULL;
     }
+    if (pthread_mutex_init(&ctx->spill_mutex, NULL) != 0) {
+        pthread_mutex_destroy(&ctx->timestamp_mutex);
+        pthread_mutex_destroy(&ctx->stats_mutex);
+        free(ctx);
+        return NULL;
+    }
+    if (pthread_mutex_init(&ctx->breakdown_mutex, NULL) != 0) {
+        pthread_mutex_destroy(&ctx->spill_mutex);
+        pthread_mutex_destroy(&ctx->timestamp_mutex);
+        pthread_mutex_destroy(&ctx->stats_mutex);
+        free(ctx);
+        return NULL;
+    }
     
     // Initialize mesh hash
     ctx->mesh_hash = meshid_prepare_search();
@@ -261,38 +548,19 @@ static converter_ctx_t* converter_create(const csv_to_h5_config_t* config) {
         return NULL;
     }
     
-    // Initialize batch buffer
-    ctx->batch_size = config->batch_size;
-    ctx->batch_buffer = calloc(MOBAKU_MESH_COUNT, sizeof(int32_t));
-    if (!ctx->batch_buffer) {
-        free(ctx->timestamps);
-        cmph_destroy(ctx->mesh_hash);
-        free(ctx);
-        return NULL;
-    }
-    
-    // Check if bulk write mode is enabled
-    ctx->use_bulk_write = config->use_bulk_write;
-    ctx->year_buffer = NULL;
-    ctx->year_buffer_size = 0;
-    
-    // Allocate year buffer if bulk write is enabled
-    if (ctx->use_bulk_write) {
-        if (allocate_year_buffer(ctx, config->verbose) < 0) {
-            if (config->verbose) {
-                fprintf(stderr, "Falling back to incremental write mode\n");
-            }
-            ctx->use_bulk_write = false;
-        }
-    }
-    
     // Create or open HDF5 file
     if (config->create_new) {
         h5r_writer_config_t h5_config = H5R_WRITER_DEFAULT_CONFIG;
         ctx->writer = NULL;
         // Use configurable dataset name, fallback to default if not specified
         const char* dataset_name = config->dataset_name ? config->dataset_name : "/population_data";
-        if (h5mobaku_create_with_dataset(config->output_h5_file, dataset_name, &h5_config, &ctx->writer) < 0) {
+        if (config->mesh_ids && config->num_meshes > 0) {
+            // Subset file: rows for meshes outside the list are skipped as unknown
+            if (h5mobaku_create_with_meshes(config->output_h5_file, &h5_config,
+                                            config->mesh_ids, config->num_meshes, &ctx->writer) < 0) {
+                ctx->writer = NULL;
+            }
+        } else if (h5mobaku_create_with_dataset(config->output_h5_file, dataset_name, &h5_config, &ctx->writer) < 0) {
             ctx->writer = NULL;
         }
     } else {
@@ -301,17 +569,87 @@ static converter_ctx_t* converter_create(const csv_to_h5_config_t* config) {
         const char* dataset_name = config->dataset_name ? config->dataset_name : "/population_data";
         if (h5mobaku_open_readwrite_with_dataset(config->output_h5_file, dataset_name, &ctx->writer) < 0) {
             ctx->writer = NULL;
+        } else {
+            size_t num_meshes;
+            h5r_get_dimensions(ctx->writer->h5r_ctx, &ctx->merge_initial_rows, &num_meshes);
         }
     }
     
     if (!ctx->writer) {
-        free(ctx->batch_buffer);
         free(ctx->timestamps);
         cmph_destroy(ctx->mesh_hash);
         free(ctx);
         return NULL;
     }
     
+    // Buffers follow the output file's width
+    size_t time_points = 0;
+    h5r_get_dimensions(ctx->writer->h5r_ctx, &time_points, &ctx->mesh_count);
+    
+    // Initialize batch buffer
+    ctx->batch_size = config->batch_size;
+    ctx->batch_buffer = calloc(ctx->mesh_count, sizeof(int32_t));
+    if (!ctx->batch_buffer) {
+        h5mobaku_close(ctx->writer);
+        free(ctx->timestamps);
+        cmph_destroy(ctx->mesh_hash);
+        free(ctx);
+        return NULL;
+    }
+    
+    ctx->merge_policy = config->merge_policy;
+    ctx->output_path = config->output_h5_file;
+    if (ctx->merge_initial_rows > 0 && ctx->merge_policy != CSV_TO_H5_MERGE_OVERWRITE &&
+        cell_set_init(&ctx->written_cells, ctx->merge_initial_rows, ctx->mesh_count) < 0) {
+        fprintf(stderr, "Error: Failed to allocate written-cell index\n");
+        converter_destroy(ctx);
+        return NULL;
+    }
+    
+    // Record files are sorted by the output's chunk shape; their mesh indices are meshid_list positions
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->writer->h5r_ctx, &meta);
+    ctx->record_dir = config->record_output_dir;
+    if (ctx->record_dir && mkdir(ctx->record_dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Error: Cannot create record directory %s\n", ctx->record_dir);
+        converter_destroy(ctx);
+        return NULL;
+    }
+    ctx->record_chunk_rows = (uint32_t)meta.crows;
+    ctx->record_chunk_cols = (uint32_t)meta.ccols;
+    ctx->subset_columns = h5r_get_mesh_dict(ctx->writer->h5r_ctx) != NULL;
+    
+    // The breakdown lives next to population_data and shares its mesh columns
+    if (config->store_breakdown &&
+        h5mobaku_breakdown_open(config->output_h5_file, 1, NULL, &ctx->breakdown) < 0) {
+        converter_destroy(ctx);
+        return NULL;
+    }
+    if (ctx->breakdown) {
+        h5mobaku_breakdown_get_dimensions(ctx->breakdown, &ctx->breakdown_initial_rows, NULL);
+        ctx->breakdown_flush_at = BREAKDOWN_FLUSH_ROWS;
+    }
+    
+    // Thread sizing follows the CPUs this process may use; without a snapshot everything runs unpinned
+    ctx->topology = cpu_topology_detect();
+    ctx->reader_threads = config->reader_threads;
+    ctx->pin_threads = config->pin_threads && ctx->topology;
+    
+    // Check if bulk write mode is enabled
+    ctx->use_bulk_write = config->use_bulk_write;
+    ctx->num_year_buffers = 0;
+    ctx->year_buffer_size = 0;
+    
+    // Allocate the first year buffer if bulk write is enabled (the second once several years are found)
+    if (ctx->use_bulk_write) {
+        if (allocate_year_buffer(ctx, config->verbose) < 0) {
+            if (config->verbose) {
+                fprintf(stderr, "Falling back to incremental write mode\n");
+            }
+            ctx->use_bulk_write = false;
+        }
+    }
+    
     return ctx;
 }
 
@@ -322,43 +660,34 @@ static void converter_destroy(converter_ctx_t* ctx) {
     if (ctx->mesh_hash) cmph_destroy(ctx->mesh_hash);
     if (ctx->timestamps) free(ctx->timestamps);
     if (ctx->batch_buffer) free(ctx->batch_buffer);
-    if (ctx->year_buffer) free(ctx->year_buffer);
+    for (int i = 0; i < ctx->num_year_buffers; i++) large_buffer_free(ctx->year_buffers[i]);
+    free(ctx->spill);
+    cell_set_free(&ctx->written_cells);
+    h5mobaku_breakdown_close(ctx->breakdown);
+    free(ctx->breakdown_rows);
+    cpu_topology_destroy(ctx->topology);
+    pthread_mutex_destroy(&ctx->breakdown_mutex);
+    pthread_mutex_destroy(&ctx->spill_mutex);
     pthread_mutex_destroy(&ctx->timestamp_mutex);
     pthread_mutex_destroy(&ctx->stats_mutex);
     free(ctx);
 }
 
 
-static int perform_bulk_write(converter_ctx_t* ctx, int verbose) {
-    if (!ctx->use_bulk_write || !ctx->year_buffer) {
-        return 0; // Nothing to do if not in bulk write mode
-    }
-    
+static int perform_bulk_write(converter_ctx_t* ctx, const bulk_stage_t* stage, int verbose) {
     if (verbose) {
         printf("Performing bulk HDF5 write (%.2f GiB)...\n", 
                (double)ctx->year_buffer_size / (1024.0 * 1024.0 * 1024.0));
     }
     
-    // Calculate the start time index based on the year of data
-    // Bulk mode assumes a single year of data, so we need to determine which year
-    // For now, we'll need to pass this information or detect it from the data
-    // TODO: This needs to be properly tracked during data loading
-    int data_year = ctx->bulk_write_year; // Need to add this field to track the year
-    
-    // Calculate hours since 2016-01-01 00:00:00 for the start of data_year
-    struct tm base_tm = {0};
-    base_tm.tm_year = 2016 - 1900;
-    base_tm.tm_mon = 0;
-    base_tm.tm_mday = 1;
-    
-    struct tm year_tm = {0};
-    year_tm.tm_year = data_year - 1900;
-    year_tm.tm_mon = 0;
-    year_tm.tm_mday = 1;
-    
-    time_t base_time = mktime(&base_tm);
-    time_t year_time = mktime(&year_tm);
-    size_t start_time_idx = (year_time - base_time) / 3600;
+    // Hours since 2016-01-01 00:00:00 for the start of the stage's year
+    int data_year = stage->year;
+    int year_index = meshid_get_time_index_of_year(data_year);
+    if (year_index < 0) {
+        fprintf(stderr, "Error: Bulk write year %d precedes %s\n", data_year, REFERENCE_MOBAKU_DATETIME);
+        return -1;
+    }
+    size_t start_time_idx = (size_t)year_index;
     
     if (verbose) {
         printf("Bulk write year: %d, start time index: %zu\n", data_year, start_time_idx);
@@ -369,9 +698,7 @@ static int perform_bulk_write(converter_ctx_t* ctx, int verbose) {
     h5r_get_dimensions(ctx->writer->h5r_ctx, &current_time_points, &mesh_count);
     
     // Calculate time points based on the actual year (check if it's a leap year)
-    bool is_leap = (data_year % 4 == 0 && data_year % 100 != 0) || (data_year % 400 == 0);
-    const size_t REQUIRED_TIME_POINTS = is_leap ? 8784 : 8760; // Leap year: 366 * 24 hours, normal: 365 * 24 hours
-    const size_t REQUIRED_MESH_COUNT = MOBAKU_MESH_COUNT;
+    const size_t REQUIRED_TIME_POINTS = (size_t)meshid_get_hours_in_year(data_year); // 8784 in leap years, else 8760
     
     // Ensure dataset is large enough for the target year
     size_t needed_time_points = start_time_idx + REQUIRED_TIME_POINTS;
@@ -385,22 +712,52 @@ static int perform_bulk_write(converter_ctx_t* ctx, int verbose) {
         }
     }
     
-    // True bulk write: write entire buffer in single HDF5 operation
+    // Write tile by tile; bands follow the file's chunk grid, so every full band is a direct chunk
+    // write of contiguous memory and only the bands at the ends of the year are partial
+    const size_t tile_elems_per_row = ctx->col_tiles * ctx->tile_cols;
+    size_t num_bands = 0;
+    for (size_t h = 0; h < REQUIRED_TIME_POINTS; num_bands++) {
+        size_t first, rows;
+        staging_band(ctx, stage, h, &first, &rows);
+        h = first + rows;
+    }
+    const size_t total_tiles = num_bands * ctx->col_tiles;
     if (verbose) {
-        printf("Performing true bulk write of entire buffer (%.2f GiB)...\n", 
-               (double)ctx->year_buffer_size / (1024.0 * 1024.0 * 1024.0));
-        display_progress(0, 1, "HDF5 Bulk Write");
+        printf("Writing %zu chunk tiles of %zux%zu (year starts %zu rows into a chunk)...\n", total_tiles,
+               ctx->tile_rows, ctx->tile_cols, stage->row_offset);
+        display_progress(0, total_tiles, "HDF5 Bulk Write");
     }
     
-    // Perform single bulk write operation at the correct time index
-    if (h5r_write_bulk_buffer(ctx->writer->h5r_ctx, ctx->year_buffer, 
-                              REQUIRED_TIME_POINTS, REQUIRED_MESH_COUNT, start_time_idx) < 0) {
-        fprintf(stderr, "Error: Bulk buffer write failed\n");
-        return -1;
+    size_t tiles_done = 0, direct = 0;
+    for (size_t h = 0; h < REQUIRED_TIME_POINTS; ) {
+        size_t first, rows;
+        staging_band(ctx, stage, h, &first, &rows);
+        // A common year leaves the tail of the last band unused
+        const size_t nrows = first + rows <= REQUIRED_TIME_POINTS ? rows : REQUIRED_TIME_POINTS - first;
+        const int32_t* band = stage->buffer + first * tile_elems_per_row;
+        for (size_t ct = 0; ct < ctx->col_tiles; ct++) {
+            const int32_t* tile = band + ct * rows * ctx->tile_cols;
+            int written = h5r_write_chunk(ctx->writer->h5r_ctx, start_time_idx + first, ct * ctx->tile_cols,
+                                          nrows, tile);
+            if (written < 0) {
+                fprintf(stderr, "Error: Bulk write failed for tile at row %zu, column %zu\n",
+                        start_time_idx + first, ct * ctx->tile_cols);
+                return -1;
+            }
+            direct += written == 1;
+            tiles_done++;
+            if (verbose && (tiles_done % 4096 == 0 || tiles_done == total_tiles)) {
+                display_progress(tiles_done, total_tiles, "HDF5 Bulk Write");
+            }
+        }
+        h = first + rows;
     }
     
+    pthread_mutex_lock(&ctx->stats_mutex);
+    ctx->stats.direct_chunks += direct;
+    pthread_mutex_unlock(&ctx->stats_mutex);
+    
     if (verbose) {
-        display_progress(1, 1, "HDF5 Bulk Write");
         printf("Bulk HDF5 write completed successfully\n");
     }
     
@@ -412,6 +769,101 @@ static int perform_bulk_write(converter_ctx_t* ctx, int verbose) {
     return 0;
 }
 
+static int write_spilled_rows(converter_ctx_t* ctx, size_t limit, int verbose);
+static bool breakdown_flush_due(converter_ctx_t* ctx);
+static int queue_fill(FIFOQueue* queue);
+static int write_breakdown_rows(converter_ctx_t* ctx, size_t limit, bool all, int verbose);
+
+// Chunk shape for the comparator (qsort has no context argument)
+static _Thread_local size_t spill_chunk_rows, spill_chunk_cols;
+
+// Chunk first, then hour and column inside the chunk
+static int spill_chunk_compare(const void* a, const void* b) {
+    const write_data_t* wa = (const write_data_t*)a;
+    const write_data_t* wb = (const write_data_t*)b;
+    const size_t ta = wa->time_index / spill_chunk_rows, tb = wb->time_index / spill_chunk_rows;
+    if (ta != tb) return (ta > tb) - (ta < tb);
+    const size_t ca = wa->mesh_index / spill_chunk_cols, cb = wb->mesh_index / spill_chunk_cols;
+    if (ca != cb) return (ca > cb) - (ca < cb);
+    if (wa->time_index != wb->time_index) return (wa->time_index > wb->time_index) - (wa->time_index < wb->time_index);
+    return (wa->mesh_index > wb->mesh_index) - (wa->mesh_index < wb->mesh_index);
+}
+
+// Rows the incremental consumer takes off the queue at a time
+#define CONSUMER_BATCH QUEUE_SIZE
+
+// A queued row and its place in the batch, which keeps the order of the rows for one cell
+typedef struct {
+    write_data_t data;
+    size_t seq;
+} batch_row_t;
+
+static int batch_row_compare(const void* a, const void* b) {
+    const batch_row_t* ra = (const batch_row_t*)a;
+    const batch_row_t* rb = (const batch_row_t*)b;
+    int c = spill_chunk_compare(&ra->data, &rb->data);
+    return c != 0 ? c : (ra->seq > rb->seq) - (ra->seq < rb->seq);
+}
+
+static void count_error(converter_ctx_t* ctx) {
+    pthread_mutex_lock(&ctx->stats_mutex);
+    ctx->stats.errors++;
+    pthread_mutex_unlock(&ctx->stats_mutex);
+}
+
+// Write one batch of incremental rows. The rows for a cell are combined in memory first, so a cell costs
+// one write (and with sum/max one read) per batch, and the cells go out in chunk order.
+static void write_consumer_batch(converter_ctx_t* ctx, batch_row_t* batch, size_t count) {
+    struct h5r* h5 = ctx->writer->h5r_ctx;
+    size_t current_time_points, mesh_count, needed = 0;
+    h5r_get_dimensions(h5, &current_time_points, &mesh_count);
+    for (size_t i = 0; i < count; i++) {
+        if (batch[i].data.time_index + 1 > needed) needed = batch[i].data.time_index + 1;
+    }
+    if (needed > current_time_points) {
+        size_t new_size = current_time_points * 3 / 2;
+        if (new_size < needed) new_size = needed + 100;
+        if (h5mobaku_extend_time_dimension(ctx->writer, new_size) < 0) {
+            count_error(ctx);
+            return;
+        }
+    }
+    
+    qsort(batch, count, sizeof(batch_row_t), batch_row_compare);
+    for (size_t k = 0; k < count; ) {
+        const write_data_t* row = &batch[k].data;
+        int32_t value = row->population;
+        size_t l = k + 1;
+        for (; l < count && batch[l].data.time_index == row->time_index && batch[l].data.mesh_index == row->mesh_index; l++) {
+            value = ctx->merge_policy != CSV_TO_H5_MERGE_OVERWRITE
+                  ? merge_values(ctx, value, batch[l].data.population) : batch[l].data.population;
+        }
+        
+        // Merge with what earlier batches stored. Hours past the file's extent at the start of the run
+        // held only the fill value (0) before it, as in bulk mode; below it, written_cells tells the
+        // cells of this run from data stored by earlier runs, which is overwritten.
+        if (ctx->merge_policy != CSV_TO_H5_MERGE_OVERWRITE) {
+            int first = row->time_index < ctx->merge_initial_rows
+                      ? cell_set_insert(&ctx->written_cells, ctx->output_path, row->time_index, row->mesh_index) : 0;
+            int32_t stored;
+            if (first == 0 && h5r_read_cell(h5, row->time_index, row->mesh_index, &stored) == 0) {
+                value = merge_values(ctx, stored, value);
+            } else if (first < 0) {
+                count_error(ctx);
+            }
+        }
+        
+        if (h5r_write_cell(h5, row->time_index, row->mesh_index, value) < 0) {
+            count_error(ctx);
+        }
+        k = l;
+    }
+    
+    pthread_mutex_lock(&ctx->stats_mutex);
+    ctx->stats.total_rows_processed += count;
+    pthread_mutex_unlock(&ctx->stats_mutex);
+}
+
 // Consumer thread function that processes pre-calculated write data from the queue
 static void* h5_consumer_thread_func(void* arg) {
     consumer_thread_data_t* data = (consumer_thread_data_t*)arg;
@@ -421,7 +873,7 @@ static void* h5_consumer_thread_func(void* arg) {
     }
     
     // If bulk mode is enabled, consumer does nothing - producers write directly to buffer
-    if (data->ctx->use_bulk_write && data->ctx->year_buffer) {
+    if (data->ctx->use_bulk_write) {
         if (data->config->verbose) {
             printf("H5 consumer: Bulk mode enabled, consumer idle (producers write directly to buffer)\n");
         }
@@ -440,53 +892,52 @@ static void* h5_consumer_thread_func(void* arg) {
             free(write_data);
         }
     } else {
-        // Incremental mode: process write operations from queue
-        while (!(*data->should_stop)) {
-            // Dequeue will block until data is available
-            write_data_t* write_data = (write_data_t*)dequeue(data->queue);
-            
-            // Check if this is a sentinel value (NULL) indicating shutdown
-            if (!write_data) {
-                if (data->config->verbose) {
-                    printf("H5 consumer: Received shutdown signal, stopping\n");
-                }
-                break;
+        // Incremental mode: take what the queue holds, up to a batch, and write it in one go
+        converter_ctx_t* ctx = data->ctx;
+        h5r_metadata_t meta;
+        h5r_get_metadata(ctx->writer->h5r_ctx, &meta);
+        spill_chunk_rows = meta.layout == H5D_CHUNKED ? meta.crows : 1;
+        spill_chunk_cols = meta.layout == H5D_CHUNKED ? meta.ccols : (meta.cols > 0 ? meta.cols : 1);
+        
+        batch_row_t* batch = malloc(CONSUMER_BATCH * sizeof(batch_row_t));
+        if (!batch) {
+            // Nothing can be written; drain the queue so the readers finish
+            fprintf(stderr, "Error: Memory allocation failed for the consumer batch\n");
+            write_data_t* write_data;
+            while ((write_data = (write_data_t*)dequeue(data->queue)) != NULL) {
+                free(write_data);
+                count_error(ctx);
             }
-            
-            // Incremental mode: write directly to HDF5
-            // Extend HDF5 file if needed
-            size_t current_time_points, mesh_count;
-            h5r_get_dimensions(data->ctx->writer->h5r_ctx, &current_time_points, &mesh_count);
-            
-            if (write_data->time_index >= current_time_points) {
-                size_t new_size = current_time_points * 3 / 2;
-                if (new_size <= write_data->time_index) new_size = write_data->time_index + 100;
-                
-                if (h5mobaku_extend_time_dimension(data->ctx->writer, new_size) < 0) {
-                    pthread_mutex_lock(&data->ctx->stats_mutex);
-                    data->ctx->stats.errors++;
-                    pthread_mutex_unlock(&data->ctx->stats_mutex);
-                    free(write_data);
-                    continue;
+        }
+        bool done = batch == NULL;
+        while (!done && !(*data->should_stop)) {
+            // Dequeue will block until data is available; the rows already queued follow without waiting
+            size_t count = 0;
+            int available = 1;
+            do {
+                write_data_t* write_data = (write_data_t*)dequeue(data->queue);
+                // A sentinel value (NULL) indicates shutdown
+                if (!write_data) {
+                    if (data->config->verbose) {
+                        printf("H5 consumer: Received shutdown signal, stopping\n");
+                    }
+                    done = true;
+                    break;
                 }
-            }
-            
+                batch[count] = (batch_row_t){*write_data, count};
+                count++;
+                free(write_data);
+                if (--available == 0) available = queue_fill(data->queue);
+            } while (available > 0 && count < CONSUMER_BATCH);
+            if (count > 0) write_consumer_batch(ctx, batch, count);
             
-            // Write single cell to HDF5
-            if (h5r_write_cell(data->ctx->writer->h5r_ctx, write_data->time_index, write_data->mesh_index, write_data->population) < 0) {
-                pthread_mutex_lock(&data->ctx->stats_mutex);
-                data->ctx->stats.errors++;
-                pthread_mutex_unlock(&data->ctx->stats_mutex);
+            // The consumer is the only HDF5 user here, so it also drains the breakdown rows
+            if (breakdown_flush_due(ctx) &&
+                write_breakdown_rows(ctx, SIZE_MAX, false, data->config->verbose) < 0) {
+                count_error(ctx);
             }
-            
-            // Update statistics
-            pthread_mutex_lock(&data->ctx->stats_mutex);
-            data->ctx->stats.total_rows_processed++;
-            pthread_mutex_unlock(&data->ctx->stats_mutex);
-            
-            // Clean up
-            free(write_data);
         }
+        free(batch);
     }
     
     if (data->config->verbose) {
@@ -495,168 +946,432 @@ static void* h5_consumer_thread_func(void* arg) {
     return NULL;
 }
 
-// Enhanced CSV reader thread function that does preprocessing on producer side
-static void* enhanced_csv_reader_thread_func(void* arg) {
-    enhanced_csv_reader_thread_data_t* data = (enhanced_csv_reader_thread_data_t*)arg;
-    
-    if (data->verbose) {
-        printf("Enhanced CSV reader thread %d started, processing %zu files\n", 
-               data->thread_id, data->num_files);
+// Record a bulk-mode row that belongs to another year than its stage
+static int add_spill(converter_ctx_t* ctx, size_t time_index, uint32_t mesh_index, int32_t population) {
+    pthread_mutex_lock(&ctx->spill_mutex);
+    if (ctx->spill_count == ctx->spill_capacity) {
+        size_t new_capacity = ctx->spill_capacity ? ctx->spill_capacity * 2 : 1024;
+        write_data_t* new_spill = realloc(ctx->spill, new_capacity * sizeof(write_data_t));
+        if (!new_spill) {
+            pthread_mutex_unlock(&ctx->spill_mutex);
+            return -1;
+        }
+        ctx->spill = new_spill;
+        ctx->spill_capacity = new_capacity;
     }
-    
-    for (size_t i = 0; i < data->num_files; i++) {
-        const char* filepath = data->filepaths[i];
-        csv_reader_t* reader = csv_open(filepath);
-        
-        if (!reader) {
-            fprintf(stderr, "Thread %d: Failed to open %s\n", 
-                    data->thread_id, filepath);
-            continue;
+    ctx->spill[ctx->spill_count++] = (write_data_t){time_index, mesh_index, population, false};
+    pthread_mutex_unlock(&ctx->spill_mutex);
+    return 0;
+}
+
+// Record a row split by residence/age/gender; the totals path sees it as before
+static int add_breakdown_row(converter_ctx_t* ctx, size_t time_index, uint32_t mesh_index, const csv_row_t* row) {
+    pthread_mutex_lock(&ctx->breakdown_mutex);
+    if (ctx->breakdown_count == ctx->breakdown_capacity) {
+        size_t new_capacity = ctx->breakdown_capacity ? ctx->breakdown_capacity * 2 : 4096;
+        breakdown_row_t* new_rows = realloc(ctx->breakdown_rows, new_capacity * sizeof(breakdown_row_t));
+        if (!new_rows) {
+            pthread_mutex_unlock(&ctx->breakdown_mutex);
+            return -1;
         }
-        
-        csv_row_t row;
-        size_t row_count = 0;
-        
-        while (csv_read_row(reader, &row) == 0) {
-            // Process the CSV row to calculate indices
-            write_data_t* write_data = malloc(sizeof(write_data_t));
-            if (!write_data) {
-                fprintf(stderr, "Thread %d: Failed to allocate memory\n", 
-                        data->thread_id);
-                break;
+        ctx->breakdown_rows = new_rows;
+        ctx->breakdown_capacity = new_capacity;
+    }
+    ctx->breakdown_rows[ctx->breakdown_count++] = (breakdown_row_t){
+        time_index, mesh_index, row->population, {row->residence, row->age, row->gender}, -1
+    };
+    pthread_mutex_unlock(&ctx->breakdown_mutex);
+    return 0;
+}
+
+static inline bool has_breakdown(const csv_row_t* row) {
+    return row->residence != -1 || row->age != -1 || row->gender != -1;
+}
+
+#define QUEUE_PARK_LEVEL (QUEUE_SIZE * 3 / 4)    // Consumer falling behind: park a reader
+#define QUEUE_RESUME_LEVEL (QUEUE_SIZE / 4)     // Consumer catching up: resume it
+#define PARK_POLL_MS 50
+
+static int queue_fill(FIFOQueue* queue) {
+    pthread_mutex_lock(&queue->mutex);
+    int count = queue->count;
+    pthread_mutex_unlock(&queue->mutex);
+    return count;
+}
+
+// Next input for a reader, NULL once the run's inputs are all claimed
+static const reader_input_t* claim_next_input(enhanced_csv_reader_thread_data_t* data) {
+    reader_pool_t* pool = data->pool;
+    pthread_mutex_lock(&pool->mutex);
+    
+    // The queue level measures the consumer against the producers; at least one reader stays active
+    if (!data->stage && pool->active > 1 && pool->next_input < pool->num_inputs &&
+        queue_fill(data->queue) >= QUEUE_PARK_LEVEL) {
+        pool->active--;
+        while (pool->active > 0 && pool->next_input < pool->num_inputs &&
+               queue_fill(data->queue) > QUEUE_RESUME_LEVEL) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += PARK_POLL_MS * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
             }
-            
-            // Find mesh index
-            uint32_t mesh_idx = meshid_search_id(data->ctx->mesh_hash, (uint32_t)row.area);
-            if (mesh_idx == MESHID_NOT_FOUND) {
-                if (data->verbose) {
-                    fprintf(stderr, "Thread %d: Unknown mesh ID %lu\n", 
-                           data->thread_id, row.area);
-                }
-                free(write_data);
-                continue;
+            pthread_cond_timedwait(&pool->changed, &pool->mutex, &deadline);
+        }
+        pool->active++;
+    }
+    
+    const reader_input_t* input = pool->next_input < pool->num_inputs ? &pool->inputs[pool->next_input++] : NULL;
+    if (!input) {
+        // Let parked readers see that nothing is left
+        pool->active--;
+        pthread_cond_broadcast(&pool->changed);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return input;
+}
+
+// Append a parsed row to the file's record stream, under its meshid_list position. Rows outside a subset
+// output (mesh_idx MESHID_NOT_FOUND) are recorded too, so the records serve any output; a mesh ID that is
+// not in meshid_list at all is left out.
+static int add_record(const converter_ctx_t* ctx, record_stream_writer_t* records, size_t time_index,
+                      uint32_t mesh_idx, const csv_row_t* row) {
+    uint32_t mesh_index = ctx->subset_columns ? meshid_search_id(ctx->mesh_hash, (uint32_t)row->area) : mesh_idx;
+    if (mesh_index >= MOBAKU_MESH_COUNT || meshid_list[mesh_index] != (uint32_t)row->area) {
+        return mesh_idx == MESHID_NOT_FOUND ? 0 : -1;
+    }
+    if (time_index > UINT32_MAX) return -1;
+    return record_stream_writer_add(records, (uint32_t)time_index, mesh_index, row->population,
+                                    row->residence, row->age, row->gender);
+}
+
+// Rows of one input, from CSV text or PGCOPY tuples
+typedef struct {
+    csv_reader_t* csv;
+    pgcopy_reader_t* pg;
+} row_source_t;
+
+static int source_open(row_source_t* source, const reader_input_t* input) {
+    source->csv = NULL;
+    source->pg = NULL;
+    if (input->pgcopy) {
+        source->pg = input->end_tuple > 0 ? pgcopy_open_tuples(input->path, input->first_tuple, input->end_tuple)
+                                          : pgcopy_open(input->path);
+        return source->pg ? 0 : -1;
+    }
+    source->csv = csv_open(input->path);
+    return source->csv ? 0 : -1;
+}
+
+static inline int source_read_row(row_source_t* source, csv_row_t* row) {
+    return source->pg ? pgcopy_read_row(source->pg, row) : csv_read_row(source->csv, row);
+}
+
+static void source_close(row_source_t* source) {
+    csv_close(source->csv);
+    pgcopy_close(source->pg);
+}
+
+// Parse one CSV file or PGCOPY part and hand its rows to the consumer (incremental) or the stage buffer (bulk)
+static int read_row_input(enhanced_csv_reader_thread_data_t* data, const reader_input_t* input,
+                          size_t* rows_out, size_t* errors_out) {
+    bulk_stage_t* stage = data->stage;
+    const char* filepath = input->path;
+    row_source_t source;
+    
+    if (source_open(&source, input) < 0) {
+        fprintf(stderr, "Thread %d: Failed to open %s\n", 
+                data->thread_id, filepath);
+        return -1;
+    }
+    
+    // The parsed rows also go to a record file, written when the input is done
+    record_stream_writer_t* records = NULL;
+    if (data->ctx->record_dir) {
+        // Parts of one file get a record file each
+        char part_path[1024];
+        if (input->num_parts > 1) {
+            snprintf(part_path, sizeof(part_path), "%s.part%03d", filepath, input->part);
+        }
+        char* record_path = record_stream_path_for(data->ctx->record_dir, input->num_parts > 1 ? part_path : filepath);
+        records = record_path ? record_stream_writer_create(record_path, data->ctx->record_chunk_rows,
+                                                            data->ctx->record_chunk_cols) : NULL;
+        free(record_path);
+        if (!records) {
+            fprintf(stderr, "Thread %d: Failed to start record file for %s\n", data->thread_id, filepath);
+            source_close(&source);
+            return -1;
+        }
+    }
+    
+    csv_row_t row;
+    size_t row_count = 0;
+    size_t row_errors = 0;
+    int status;
+    
+    while ((status = source_read_row(&source, &row)) == 0) {
+        // Find mesh index
+        uint32_t mesh_idx = h5mobaku_mesh_index(data->ctx->writer->h5r_ctx, data->ctx->mesh_hash, (uint32_t)row.area);
+        if (mesh_idx == MESHID_NOT_FOUND) {
+            if (data->verbose) {
+                fprintf(stderr, "Thread %d: Unknown mesh ID %lu\n", 
+                       data->thread_id, row.area);
             }
+            // A mesh outside a subset output still goes to the records below
+            if (!records || !data->ctx->subset_columns) continue;
+        }
+        
+        int year = row.date / 10000;
+        int month = (row.date / 100) % 100;
+        int day = row.date % 100;
+        int hour = row.time / 100;
+        
+        if (stage) {
+            // Bulk mode: calculate year-relative hour index
+            // Calculate day of year (0-based)
+            int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+            bool is_leap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
+            if (is_leap) days_in_month[1] = 29;
             
-            // Calculate time index
-            size_t time_idx;
-            if (data->ctx->use_bulk_write && data->ctx->year_buffer) {
-                // Bulk mode: calculate year-relative hour index
-                int year = row.date / 10000;
-                int month = (row.date / 100) % 100;
-                int day = row.date % 100;
-                int hour = row.time / 100;
-                
-                // Track the year for bulk write (assume all data is from same year)
-                if (data->ctx->bulk_write_year == 0) {
-                    data->ctx->bulk_write_year = year;
-                }
-                
-                // Calculate day of year (0-based)
-                int days_in_month[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
-                bool is_leap = (year % 4 == 0 && year % 100 != 0) || (year % 400 == 0);
-                if (is_leap) days_in_month[1] = 29;
-                
-                int day_of_year = day - 1;
-                for (int m = 1; m < month; m++) {
-                    day_of_year += days_in_month[m - 1];
+            int day_of_year = day - 1;
+            for (int m = 1; m < month && m <= 12; m++) {
+                day_of_year += days_in_month[m - 1];
+            }
+            
+            size_t time_idx = (size_t)day_of_year * 24 + hour;
+            size_t max_hours = is_leap ? 8784 : 8760;
+            int year_index = meshid_get_time_index_of_year(year);
+            
+            if (month < 1 || month > 12 || day < 1 || time_idx >= max_hours || year_index < 0) {
+                if (data->verbose) {
+                    fprintf(stderr, "Thread %d: Hour index %zu out of range for date %u time %u\n", 
+                           data->thread_id, time_idx, row.date, row.time);
                 }
-                
-                time_idx = day_of_year * 24 + hour;
-                size_t max_hours = is_leap ? 8784 : 8760;
-                
-                if (time_idx >= max_hours) {
-                    if (data->verbose) {
-                        fprintf(stderr, "Thread %d: Hour index %zu out of range for date %u time %u\n", 
-                               data->thread_id, time_idx, row.date, row.time);
-                    }
-                    free(write_data);
+                row_errors++;
+                continue;
+            }
+            
+            if (records && add_record(data->ctx, records, (size_t)year_index + time_idx, mesh_idx, &row) < 0) {
+                row_errors++;
+                continue;
+            }
+            if (mesh_idx == MESHID_NOT_FOUND) continue;
+            
+            if (data->ctx->breakdown && has_breakdown(&row) &&
+                add_breakdown_row(data->ctx, (size_t)year_index + time_idx, mesh_idx, &row) < 0) {
+                row_errors++;
+                continue;
+            }
+            
+            if (year != stage->year) {
+                // Files are staged by the year of their first row; stray rows are kept aside
+                if (add_spill(data->ctx, (size_t)year_index + time_idx, mesh_idx, row.population) < 0) {
+                    row_errors++;
                     continue;
                 }
-                
-                write_data->use_bulk_mode = true;
             } else {
-                // Incremental mode: calculate time index based on 2016-01-01 00:00:00
-                int year = row.date / 10000;
-                int month = (row.date / 100) % 100;
-                int day = row.date % 100;
-                int hour = row.time / 100;
-                int minute = row.time % 100;
-                
-                // Calculate hours since 2016-01-01 00:00:00
-                struct tm base_tm = {0};
-                base_tm.tm_year = 2016 - 1900;
-                base_tm.tm_mon = 0;
-                base_tm.tm_mday = 1;
-                
-                struct tm curr_tm = {0};
-                curr_tm.tm_year = year - 1900;
-                curr_tm.tm_mon = month - 1;
-                curr_tm.tm_mday = day;
-                curr_tm.tm_hour = hour;
-                curr_tm.tm_min = minute;
-                
-                time_t base_time = mktime(&base_tm);
-                time_t curr_time = mktime(&curr_tm);
-                
-                if (base_time == -1 || curr_time == -1) {
-                    if (data->verbose) {
-                        fprintf(stderr, "Thread %d: Failed to calculate time for %u %u\n", 
-                               data->thread_id, row.date, row.time);
-                    }
-                    free(write_data);
-                    continue;
-                }
-                
-                // Calculate time index (hours since base)
-                time_idx = (size_t)((curr_time - base_time) / 3600);
-                
-                // Also track this timestamp for statistics
-                find_or_add_timestamp(data->ctx, row.date, row.time);
-                
-                write_data->use_bulk_mode = false;
+                // Write directly to the stage buffer in the producer thread
+                merge_into_cell(data->ctx, &stage->buffer[staging_offset(data->ctx, stage, time_idx, mesh_idx)],
+                                row.population);
             }
+            row_count++;
+        } else {
+            // Incremental mode: calculate time index based on 2016-01-01 00:00:00
+            int minute = row.time % 100;
             
-            if (write_data->use_bulk_mode) {
-                // Bulk mode: write directly to buffer in producer thread
-                size_t buffer_offset = time_idx * MOBAKU_MESH_COUNT + mesh_idx;
-                
-                // Bounds check
-                if (buffer_offset < (data->ctx->year_buffer_size / sizeof(int32_t))) {
-                    data->ctx->year_buffer[buffer_offset] = row.population;
-                } else {
-                    if (data->verbose) {
-                        fprintf(stderr, "Thread %d: Buffer offset %zu exceeds buffer size\n", 
-                               data->thread_id, buffer_offset);
-                    }
+            // Calculate hours since 2016-01-01 00:00:00
+            struct tm base_tm = {0};
+            base_tm.tm_year = 2016 - 1900;
+            base_tm.tm_mon = 0;
+            base_tm.tm_mday = 1;
+            
+            struct tm curr_tm = {0};
+            curr_tm.tm_year = year - 1900;
+            curr_tm.tm_mon = month - 1;
+            curr_tm.tm_mday = day;
+            curr_tm.tm_hour = hour;
+            curr_tm.tm_min = minute;
+            
+            time_t base_time = mktime(&base_tm);
+            time_t curr_time = mktime(&curr_tm);
+            
+            if (base_time == -1 || curr_time == -1) {
+                if (data->verbose) {
+                    fprintf(stderr, "Thread %d: Failed to calculate time for %u %u\n", 
+                           data->thread_id, row.date, row.time);
                 }
-                
-                // No need to enqueue for bulk mode
-                free(write_data);
-                row_count++;
-            } else {
-                // Incremental mode: fill write data and enqueue for consumer
-                write_data->time_index = time_idx;
-                write_data->mesh_index = mesh_idx;
-                write_data->population = row.population;
-                
-                // Enqueue the processed data
-                enqueue(data->queue, write_data);
-                row_count++;
+                continue;
+            }
+            
+            size_t time_index = (size_t)((curr_time - base_time) / 3600);
+            if (records && add_record(data->ctx, records, time_index, mesh_idx, &row) < 0) {
+                row_errors++;
+            }
+            if (mesh_idx == MESHID_NOT_FOUND) continue;
+            
+            // Also track this timestamp for statistics
+            find_or_add_timestamp(data->ctx, row.date, row.time);
+            
+            if (data->ctx->breakdown && has_breakdown(&row) &&
+                add_breakdown_row(data->ctx, time_index, mesh_idx, &row) < 0) {
+                fprintf(stderr, "Thread %d: Failed to allocate memory\n", 
+                        data->thread_id);
+                break;
+            }
+            
+            // Fill write data and enqueue for consumer
+            write_data_t* write_data = malloc(sizeof(write_data_t));
+            if (!write_data) {
+                fprintf(stderr, "Thread %d: Failed to allocate memory\n", 
+                        data->thread_id);
+                break;
             }
+            write_data->time_index = time_index;
+            write_data->mesh_index = mesh_idx;
+            write_data->population = row.population;
+            write_data->use_bulk_mode = false;
+            
+            // Enqueue the processed data
+            enqueue(data->queue, write_data);
+            row_count++;
+        }
+    }
+    
+    // A malformed tuple ends a PGCOPY input (there is no next line to resynchronise on)
+    if (status < 0 && source.pg) {
+        fprintf(stderr, "Thread %d: Malformed tuple %zu in %s\n", data->thread_id,
+                pgcopy_get_tuple_number(source.pg) + 1, filepath);
+        row_errors++;
+    }
+    source_close(&source);
+    if (records && record_stream_writer_close(records) < 0) {
+        pthread_mutex_lock(&data->ctx->stats_mutex);
+        data->ctx->stats.errors++;
+        pthread_mutex_unlock(&data->ctx->stats_mutex);
+    }
+    
+    *rows_out = row_count;
+    *errors_out = row_errors;
+    return 0;
+}
+
+// CSV date (YYYYMMDD) and time (HHMM) of an hour index, for the timestamp statistics of replayed records
+static void record_timestamp(uint32_t time_index, uint32_t* date, uint16_t* time) {
+    struct tm tm = {0};
+    tm.tm_year = 2016 - 1900;
+    tm.tm_mday = 1;
+    tm.tm_hour = (int)time_index;
+    mktime(&tm);
+    *date = (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+    *time = (uint16_t)(tm.tm_hour * 100);
+}
+
+// Replay a record file: no parsing or mesh ID lookup, only the subset column mapping if the output has one
+static int read_record_file(enhanced_csv_reader_thread_data_t* data, const char* filepath,
+                            size_t* rows_out, size_t* errors_out) {
+    converter_ctx_t* ctx = data->ctx;
+    bulk_stage_t* stage = data->stage;
+    record_stream_t* stream = record_stream_open(filepath);
+    if (!stream) return -1;
+    
+    size_t count = 0;
+    const record_stream_record_t* records = record_stream_records(stream, &count);
+    
+    // Bulk mode: rows inside the stage's year go to its buffer, the rest are spilled as usual
+    const int stage_start = stage ? meshid_get_time_index_of_year(stage->year) : -1;
+    const size_t stage_hours = stage ? (size_t)meshid_get_hours_in_year(stage->year) : 0;
+    
+    size_t row_count = 0;
+    size_t row_errors = 0;
+    uint32_t last_time = UINT32_MAX;
+    for (size_t i = 0; i < count; i++) {
+        const record_stream_record_t* rec = &records[i];
+        uint32_t mesh_idx = rec->mesh_index;
+        if (mesh_idx >= MOBAKU_MESH_COUNT) {
+            row_errors++;
+            continue;
+        }
+        if (ctx->subset_columns) {
+            mesh_idx = h5mobaku_mesh_index(ctx->writer->h5r_ctx, ctx->mesh_hash, meshid_list[mesh_idx]);
+            if (mesh_idx == MESHID_NOT_FOUND) continue;
+        } else if (mesh_idx >= ctx->mesh_count) {
+            row_errors++;
+            continue;
+        }
+        
+        const csv_row_t row = {.population = rec->population, .residence = rec->residence,
+                               .age = rec->age, .gender = rec->gender};
+        if (ctx->breakdown && has_breakdown(&row) && add_breakdown_row(ctx, rec->time_index, mesh_idx, &row) < 0) {
+            row_errors++;
+            continue;
         }
         
-        csv_close(reader);
+        if (stage) {
+            const size_t t = rec->time_index;
+            if (stage_start >= 0 && t >= (size_t)stage_start && t - (size_t)stage_start < stage_hours) {
+                merge_into_cell(ctx, &stage->buffer[staging_offset(ctx, stage, t - (size_t)stage_start, mesh_idx)],
+                                rec->population);
+            } else if (add_spill(ctx, t, mesh_idx, rec->population) < 0) {
+                row_errors++;
+                continue;
+            }
+        } else {
+            // Track the timestamp as the CSV path does; records of one hour mostly come together
+            if (rec->time_index != last_time) {
+                uint32_t date;
+                uint16_t time;
+                record_timestamp(rec->time_index, &date, &time);
+                find_or_add_timestamp(ctx, date, time);
+                last_time = rec->time_index;
+            }
+            
+            write_data_t* write_data = malloc(sizeof(write_data_t));
+            if (!write_data) {
+                fprintf(stderr, "Thread %d: Failed to allocate memory\n", data->thread_id);
+                break;
+            }
+            *write_data = (write_data_t){rec->time_index, mesh_idx, rec->population, false};
+            enqueue(data->queue, write_data);
+        }
+        row_count++;
+    }
+    
+    record_stream_close(stream);
+    *rows_out = row_count;
+    *errors_out = row_errors;
+    return 0;
+}
+
+// Enhanced CSV reader thread function that does preprocessing on producer side
+static void* enhanced_csv_reader_thread_func(void* arg) {
+    enhanced_csv_reader_thread_data_t* data = (enhanced_csv_reader_thread_data_t*)arg;
+    bulk_stage_t* stage = data->stage;
+    
+    if (data->verbose) {
+        printf("Enhanced CSV reader thread %d started\n", data->thread_id);
+    }
+    
+    const reader_input_t* input;
+    while ((input = claim_next_input(data)) != NULL) {
+        size_t row_count = 0;
+        size_t row_errors = 0;
+        int read = !input->pgcopy && record_stream_is_stream(input->path)
+                 ? read_record_file(data, input->path, &row_count, &row_errors)
+                 : read_row_input(data, input, &row_count, &row_errors);
+        if (read < 0) continue;
         
-        // Update statistics
+        // Update statistics; a split file counts as processed with its last part
         pthread_mutex_lock(data->stats_mutex);
         (*data->rows_processed) += row_count;
-        (*data->total_files_processed)++;
+        if (input->part + 1 == input->num_parts) (*data->total_files_processed)++;
         pthread_mutex_unlock(data->stats_mutex);
         
         // For bulk mode, also update converter statistics since consumer doesn't process
-        if (data->ctx->use_bulk_write && data->ctx->year_buffer) {
+        if (stage) {
             pthread_mutex_lock(&data->ctx->stats_mutex);
             data->ctx->stats.total_rows_processed += row_count;
+            data->ctx->stats.errors += row_errors;
             pthread_mutex_unlock(&data->ctx->stats_mutex);
         }
         
@@ -681,6 +1396,735 @@ int csv_to_h5_convert_file(const char* csv_filename, const csv_to_h5_config_t* c
 }
 
 
+// Progress counters shared by the reader threads of every stage
+typedef struct {
+    size_t total_rows_read;
+    size_t total_files_processed;
+    size_t total_files;
+    pthread_mutex_t mutex;
+} reader_progress_t;
+
+// NUMA node a run's threads are pinned to, -1 when unpinned. A bulk stage runs next to its buffer;
+// incremental runs keep the readers and the consumer on one node so the queue stays local.
+static int run_node(const converter_ctx_t* ctx, const bulk_stage_t* stage) {
+    if (!ctx->pin_threads) return -1;
+    if (!stage) return 0;
+    for (int i = 0; i < ctx->num_year_buffers; i++) {
+        if (ctx->year_buffers[i] == stage->buffer) return ctx->year_buffer_nodes[i];
+    }
+    return -1;
+}
+
+// Readers for a run: the configured count, or one per usable CPU (of the node when pinned) less one
+// for the thread writing HDF5, never more than there are files
+static int reader_thread_count(const converter_ctx_t* ctx, size_t num_files, int node) {
+    int num_threads = ctx->reader_threads;
+    if (num_threads <= 0) {
+        int cpus = node >= 0 ? cpu_topology_node_cpus(ctx->topology, node) : cpu_topology_num_cpus(ctx->topology);
+        num_threads = cpus - 1;
+    }
+    if (num_threads < 1) num_threads = 1;
+    if ((size_t)num_threads > num_files) num_threads = (int)num_files;
+    return num_threads;
+}
+
+static double elapsed_sec(const struct timespec* since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) + (double)(now.tv_nsec - since->tv_nsec) * 1e-9;
+}
+
+#define PGCOPY_MIN_PART_BYTES ((size_t)64 * 1024 * 1024)
+
+static bool has_csv_suffix(const char* path) {
+    size_t len = strlen(path);
+    return len > 4 && strcmp(path + len - 4, ".csv") == 0;
+}
+
+// Year of the first data row of a file (the earliest record of a record file), 0 when it has none
+static int first_row_year(const char* filepath) {
+    if (record_stream_is_stream(filepath)) {
+        record_stream_t* stream = record_stream_open(filepath);
+        if (!stream) return 0;
+        const record_stream_header_t* header = record_stream_header(stream);
+        int year = header->count > 0 ? meshid_get_year_from_time_index((int)header->min_time) : 0;
+        record_stream_close(stream);
+        return year;
+    }
+    
+    csv_row_t row;
+    if (!has_csv_suffix(filepath) && pgcopy_is_pgcopy(filepath)) {
+        pgcopy_reader_t* reader = pgcopy_open(filepath);
+        if (!reader) return 0;
+        int year = pgcopy_read_row(reader, &row) == 0 ? (int)(row.date / 10000) : 0;
+        pgcopy_close(reader);
+        return year;
+    }
+    
+    csv_reader_t* reader = csv_open(filepath);
+    if (!reader) return 0;
+    
+    int year = csv_read_row(reader, &row) == 0 ? (int)(row.date / 10000) : 0;
+    csv_close(reader);
+    return year;
+}
+
+typedef struct {
+    reader_input_t* items;
+    size_t count;
+    size_t capacity;
+} input_list_t;
+
+static int push_input(input_list_t* list, reader_input_t input) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 16;
+        reader_input_t* grown = realloc(list->items, capacity * sizeof(reader_input_t));
+        if (!grown) return -1;
+        list->items = grown;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = input;
+    return 0;
+}
+
+// Year of tuple `tuple` of a fixed-width PGCOPY file, 0 when it cannot be read
+static int tuple_year(pgcopy_reader_t* reader, size_t tuple) {
+    csv_row_t row;
+    return pgcopy_read_row_at(reader, tuple, &row) == 0 ? (int)(row.date / 10000) : 0;
+}
+
+// Append tuples [first, end) of a fixed-width PGCOPY file, split so that up to max_parts readers share
+// them with at least PGCOPY_MIN_PART_BYTES each. A split point on a tuple of another width keeps the range whole.
+static int append_tuple_parts(input_list_t* list, const char* path, pgcopy_reader_t* reader, size_t width,
+                              size_t first, size_t end, int max_parts, int year) {
+    const size_t num_tuples = end - first;
+    size_t parts = max_parts > 1 ? (size_t)max_parts : 1;
+    if (parts > num_tuples * width / PGCOPY_MIN_PART_BYTES) parts = num_tuples * width / PGCOPY_MIN_PART_BYTES;
+    if (parts > num_tuples) parts = num_tuples;
+    if (parts < 1) parts = 1;
+    csv_row_t row;
+    for (size_t k = 1; k < parts; k++) {
+        if (pgcopy_read_row_at(reader, first + num_tuples * k / parts, &row) < 0) {
+            parts = 1;
+            break;
+        }
+    }
+    for (size_t k = 0; k < parts; k++) {
+        reader_input_t input = {.path = path, .pgcopy = true, .year = year,
+                                .first_tuple = first + num_tuples * k / parts,
+                                .end_tuple = first + num_tuples * (k + 1) / parts};
+        if (push_input(list, input) < 0) return -1;
+    }
+    return 0;
+}
+
+// Append the reader inputs of one file. PGCOPY files with fixed-width tuples are split so that up to
+// max_parts readers share one large dump; everything else is read whole. With by_year (bulk mode) each
+// input carries the year of its first row, and a dump is also cut at the first tuple of each year, found
+// by bisection: a time-ordered multi-year dump then fills each year's stage instead of spilling.
+static int append_file_inputs(input_list_t* list, const char* path, int max_parts, bool by_year) {
+    const size_t first_input = list->count;
+    const bool pgcopy = !has_csv_suffix(path) && pgcopy_is_pgcopy(path);
+    size_t width = 0;
+    const size_t num_tuples = pgcopy && (max_parts > 1 || by_year) ? pgcopy_count_tuples(path, &width) : 0;
+    pgcopy_reader_t* reader = num_tuples > 0 ? pgcopy_open_tuples(path, 0, num_tuples) : NULL;
+    
+    int ret = 0;
+    if (reader) {
+        int year = by_year ? tuple_year(reader, 0) : 0;
+        const int last_year = by_year ? tuple_year(reader, num_tuples - 1) : 0;
+        size_t first = 0;
+        while (ret == 0 && first < num_tuples) {
+            // Tuple `hi` is always of a later year; rows out of time order only cost spilled writes
+            size_t end = num_tuples;
+            if (year > 0 && last_year > year) {
+                size_t lo = first + 1, hi = num_tuples - 1;
+                while (lo < hi) {
+                    const size_t mid = lo + (hi - lo) / 2;
+                    if (tuple_year(reader, mid) > year) hi = mid;
+                    else lo = mid + 1;
+                }
+                end = hi;
+            }
+            ret = append_tuple_parts(list, path, reader, width, first, end, max_parts, year);
+            first = end;
+            if (first < num_tuples) year = tuple_year(reader, first);
+        }
+        pgcopy_close(reader);
+        // A single piece reads the file whole, which does not depend on every tuple having one width
+        if (ret == 0 && list->count == first_input + 1) list->count = first_input;
+    }
+    if (ret == 0 && list->count == first_input) {
+        ret = push_input(list, (reader_input_t){.path = path, .pgcopy = pgcopy,
+                                                .year = by_year ? first_row_year(path) : 0});
+    }
+    
+    for (size_t i = first_input; i < list->count; i++) {
+        list->items[i].part = (int)(i - first_input);
+        list->items[i].num_parts = (int)(list->count - first_input);
+    }
+    return ret;
+}
+
+// Reader inputs for a list of files (incremental mode, where the order of the rows does not matter)
+static reader_input_t* make_reader_inputs(const char** files, size_t num_files, int max_parts, size_t* num_inputs) {
+    input_list_t list = {0};
+    for (size_t i = 0; i < num_files; i++) {
+        if (append_file_inputs(&list, files[i], max_parts, false) < 0) {
+            free(list.items);
+            return NULL;
+        }
+    }
+    *num_inputs = list.count;
+    return list.items;
+}
+
+// Run reader threads over a list of inputs and wait for them (stage is NULL in incremental mode)
+static int run_reader_threads(converter_ctx_t* ctx, const reader_input_t* inputs, size_t num_inputs, FIFOQueue* queue,
+                              bulk_stage_t* stage, reader_progress_t* progress, bool verbose) {
+    const int node = run_node(ctx, stage);
+    const int num_threads = reader_thread_count(ctx, num_inputs, node);
+    
+    pthread_t* reader_threads = malloc(num_threads * sizeof(pthread_t));
+    enhanced_csv_reader_thread_data_t* thread_data = malloc(num_threads * sizeof(enhanced_csv_reader_thread_data_t));
+    
+    if (!reader_threads || !thread_data) {
+        fprintf(stderr, "Failed to allocate memory for threads\n");
+        free(reader_threads);
+        free(thread_data);
+        return -1;
+    }
+    
+    reader_pool_t pool = {
+        .inputs = inputs,
+        .num_inputs = num_inputs,
+        .next_input = 0,
+        .mutex = PTHREAD_MUTEX_INITIALIZER,
+        .changed = PTHREAD_COND_INITIALIZER,
+        .active = num_threads
+    };
+    
+    if (verbose) {
+        printf("Starting %d CSV reader threads for %zu inputs", num_threads, num_inputs);
+        if (node >= 0) printf(" on NUMA node %d", node);
+        printf("\n");
+    }
+    
+    struct timespec started_at;
+    clock_gettime(CLOCK_MONOTONIC, &started_at);
+    pthread_mutex_lock(&progress->mutex);
+    const size_t rows_before = progress->total_rows_read;
+    pthread_mutex_unlock(&progress->mutex);
+    
+    int started = 0;
+    for (int i = 0; i < num_threads; i++) {
+        thread_data[i].thread_id = i;
+        thread_data[i].queue = queue;
+        thread_data[i].pool = &pool;
+        thread_data[i].rows_processed = &progress->total_rows_read;
+        thread_data[i].stats_mutex = &progress->mutex;
+        thread_data[i].ctx = ctx;  // Add converter context
+        thread_data[i].stage = stage;
+        thread_data[i].verbose = verbose;
+        thread_data[i].total_files_processed = &progress->total_files_processed;
+        thread_data[i].total_files = progress->total_files;
+        
+        if (pthread_create(&reader_threads[i], NULL, enhanced_csv_reader_thread_func, &thread_data[i]) != 0) {
+            fprintf(stderr, "Failed to create reader thread %d\n", i);
+            // Started readers claim the remaining files
+            pthread_mutex_lock(&pool.mutex);
+            pool.active -= num_threads - i;
+            pthread_cond_broadcast(&pool.changed);
+            pthread_mutex_unlock(&pool.mutex);
+            break;
+        }
+        if (node >= 0) cpu_topology_bind_thread(ctx->topology, reader_threads[i], node);
+        started++;
+    }
+    
+    // Wait for all reader threads to finish
+    if (verbose) {
+        printf("Waiting for all reader threads to complete...\n");
+    }
+    
+    for (int i = 0; i < started; i++) {
+        pthread_join(reader_threads[i], NULL);
+    }
+    
+    if (verbose && started > 0) {
+        pthread_mutex_lock(&progress->mutex);
+        size_t rows = progress->total_rows_read - rows_before;
+        pthread_mutex_unlock(&progress->mutex);
+        double seconds = elapsed_sec(&started_at);
+        printf("Read %zu rows in %.2f s (%.0f rows/s) with %d reader thread(s)\n",
+               rows, seconds, seconds > 0 ? rows / seconds : 0.0, started);
+    }
+    
+    pthread_cond_destroy(&pool.changed);
+    pthread_mutex_destroy(&pool.mutex);
+    free(reader_threads);
+    free(thread_data);
+    return started > 0 ? 0 : -1;
+}
+
+typedef struct {
+    const char** files;
+    size_t begin, end;
+    int max_parts;
+    input_list_t inputs;
+    int failed;
+} year_scan_data_t;
+
+static void* year_scan_thread_func(void* arg) {
+    year_scan_data_t* data = (year_scan_data_t*)arg;
+    for (size_t i = data->begin; i < data->end && !data->failed; i++) {
+        if (append_file_inputs(&data->inputs, data->files[i], data->max_parts, true) < 0) data->failed = 1;
+    }
+    return NULL;
+}
+
+typedef struct {
+    int year;
+    size_t index;
+} input_year_t;
+
+static int input_year_compare(const void* a, const void* b) {
+    const input_year_t* ia = (const input_year_t*)a;
+    const input_year_t* ib = (const input_year_t*)b;
+    if (ia->year != ib->year) return (ia->year > ib->year) - (ia->year < ib->year);
+    return (ia->index > ib->index) - (ia->index < ib->index);
+}
+
+// Partition the input into one stage per year, keyed by the first row of each file or PGCOPY piece
+static bulk_stage_t* partition_inputs_by_year(const char** files, size_t num_files, int max_parts,
+                                              reader_input_t** sorted_out, size_t* num_stages) {
+    // Only a few rows of each file are read, spread over a few threads
+    enum { MAX_SCAN_THREADS = 16 };
+    size_t num_threads = num_files / 64 + 1;
+    if (num_threads > MAX_SCAN_THREADS) num_threads = MAX_SCAN_THREADS;
+    pthread_t threads[MAX_SCAN_THREADS];
+    year_scan_data_t scan[MAX_SCAN_THREADS];
+    bool running[MAX_SCAN_THREADS];
+    for (size_t t = 0; t < num_threads; t++) {
+        scan[t] = (year_scan_data_t){.files = files, .begin = num_files * t / num_threads,
+                                     .end = num_files * (t + 1) / num_threads, .max_parts = max_parts};
+        running[t] = pthread_create(&threads[t], NULL, year_scan_thread_func, &scan[t]) == 0;
+        if (!running[t]) year_scan_thread_func(&scan[t]);
+    }
+    size_t num_inputs = 0;
+    bool failed = false;
+    for (size_t t = 0; t < num_threads; t++) {
+        if (running[t]) pthread_join(threads[t], NULL);
+        num_inputs += scan[t].inputs.count;
+        failed |= scan[t].failed != 0;
+    }
+    
+    // Inputs in file order, which keeps the pieces of one dump in tuple order within a stage
+    reader_input_t* inputs = failed ? NULL : malloc((num_inputs + 1) * sizeof(reader_input_t));
+    input_year_t* order = failed ? NULL : malloc((num_inputs + 1) * sizeof(input_year_t));
+    reader_input_t* sorted = failed ? NULL : malloc((num_inputs + 1) * sizeof(reader_input_t));
+    bulk_stage_t* stages = failed ? NULL : calloc(num_inputs + 1, sizeof(bulk_stage_t));
+    size_t n = 0;
+    for (size_t t = 0; t < num_threads; t++) {
+        if (inputs) memcpy(inputs + n, scan[t].inputs.items, scan[t].inputs.count * sizeof(reader_input_t));
+        n += scan[t].inputs.count;
+        free(scan[t].inputs.items);
+    }
+    if (!inputs || !order || !sorted || !stages) {
+        free(inputs);
+        free(order);
+        free(sorted);
+        free(stages);
+        return NULL;
+    }
+    
+    // Inputs without rows ride along with the first stage
+    int first_year = 0;
+    for (size_t i = 0; i < num_inputs; i++) {
+        if (inputs[i].year > 0 && (first_year == 0 || inputs[i].year < first_year)) first_year = inputs[i].year;
+    }
+    for (size_t i = 0; i < num_inputs; i++) {
+        order[i] = (input_year_t){inputs[i].year > 0 ? inputs[i].year : first_year, i};
+    }
+    qsort(order, num_inputs, sizeof(input_year_t), input_year_compare);
+    
+    size_t count = 0;
+    for (size_t i = 0; i < num_inputs; i++) {
+        sorted[i] = inputs[order[i].index];
+        if (count == 0 || stages[count - 1].year != order[i].year) {
+            stages[count++] = (bulk_stage_t){.year = order[i].year, .inputs = &sorted[i]};
+        }
+        stages[count - 1].num_inputs++;
+    }
+    if (count > 0) stages[count - 1].last = true;
+    free(inputs);
+    free(order);
+    
+    *sorted_out = sorted;
+    *num_stages = count;
+    return stages;
+}
+
+static void* bulk_writer_thread_func(void* arg) {
+    bulk_writer_data_t* data = (bulk_writer_data_t*)arg;
+    converter_ctx_t* ctx = data->ctx;
+    
+    for (;;) {
+        bulk_stage_t* stage = (bulk_stage_t*)dequeue(data->full_stages);
+        if (!stage) break;
+        
+        // Write from the node holding the stage's buffer
+        int node = run_node(ctx, stage);
+        if (node >= 0) cpu_topology_bind_thread(ctx->topology, pthread_self(), node);
+        
+        if (!data->failed && perform_bulk_write(ctx, stage, data->verbose) < 0) {
+            data->failed = 1;
+        }
+        
+        // Stray rows up to the end of this year are safe to write now, which keeps the spill list short;
+        // the breakdown rows of the stage go out with them
+        const int next_year = meshid_get_time_index_of_year(stage->year + 1);
+        if (!data->failed && next_year > 0 &&
+            (write_spilled_rows(ctx, (size_t)next_year, data->verbose) < 0 ||
+             write_breakdown_rows(ctx, (size_t)next_year, false, data->verbose) < 0)) {
+            data->failed = 1;
+        }
+        
+        // Clear the buffer here so the parser side never waits on it; each node clears its own pages
+        if (!stage->last) {
+            large_buffer_zero(stage->buffer);
+        }
+        enqueue(data->free_buffers, stage->buffer);
+    }
+    return NULL;
+}
+
+// Stage the input year by year; year N is written while year N+1 is parsed
+static int run_bulk_stages(converter_ctx_t* ctx, const char** files, size_t num_files, FIFOQueue* queue,
+                           reader_progress_t* progress, const csv_to_h5_config_t* config) {
+    reader_input_t* sorted = NULL;
+    size_t num_stages = 0;
+    bulk_stage_t* stages = partition_inputs_by_year(files, num_files, reader_thread_count(ctx, SIZE_MAX, -1),
+                                                    &sorted, &num_stages);
+    if (!stages) {
+        fprintf(stderr, "Error: Failed to partition input files by year\n");
+        return -1;
+    }
+    
+    // The second buffer only pays off with more than one year, and is only taken while it still fits
+    // in available memory (it is as large as the first, ≈ 51 GiB for the full mesh set)
+    int wanted = config->bulk_year_buffers < MAX_YEAR_BUFFERS ? config->bulk_year_buffers : MAX_YEAR_BUFFERS;
+    while (ctx->num_year_buffers < wanted && (size_t)ctx->num_year_buffers < num_stages) {
+        if (ctx->num_year_buffers > 0 && available_memory() < ctx->year_buffer_size) {
+            if (config->verbose) {
+                fprintf(stderr, "Not enough available memory for another %.2f GiB year buffer\n",
+                        (double)ctx->year_buffer_size / (1024.0 * 1024.0 * 1024.0));
+            }
+            break;
+        }
+        if (allocate_year_buffer(ctx, config->verbose) < 0) {
+            if (config->verbose) {
+                fprintf(stderr, "Continuing with %d year buffer(s); years are parsed and written in turn\n",
+                        ctx->num_year_buffers);
+            }
+            break;
+        }
+    }
+    
+    if (config->verbose) {
+        printf("Bulk mode: %zu year stage(s), %d year buffer(s)\n", num_stages, ctx->num_year_buffers);
+        for (size_t s = 0; s < num_stages; s++) {
+            printf("  %d: %zu inputs\n", stages[s].year, stages[s].num_inputs);
+        }
+    }
+    
+    FIFOQueue full_stages, free_buffers;
+    init_queue(&full_stages);
+    init_queue(&free_buffers);
+    for (int i = 0; i < ctx->num_year_buffers; i++) {
+        enqueue(&free_buffers, ctx->year_buffers[i]);
+    }
+    
+    bulk_writer_data_t writer_data = {
+        .ctx = ctx,
+        .full_stages = &full_stages,
+        .free_buffers = &free_buffers,
+        .verbose = config->verbose,
+    };
+    pthread_t writer_thread;
+    if (pthread_create(&writer_thread, NULL, bulk_writer_thread_func, &writer_data) != 0) {
+        fprintf(stderr, "Failed to create bulk writer thread\n");
+        free(stages);
+        free(sorted);
+        return -1;
+    }
+    
+    int ret = 0;
+    for (size_t s = 0; s < num_stages && ret == 0; s++) {
+        stages[s].buffer = (int32_t*)dequeue(&free_buffers);
+        // The buffer follows the chunk grid, which a year only starts on by chance
+        const int year_start = meshid_get_time_index_of_year(stages[s].year);
+        stages[s].row_offset = year_start > 0 ? (size_t)year_start % ctx->tile_rows : 0;
+        if (run_reader_threads(ctx, stages[s].inputs, stages[s].num_inputs, queue, &stages[s],
+                               progress, config->verbose) < 0) {
+            ret = -1;
+        }
+        // Even a failed stage goes through the writer so its buffer comes back
+        enqueue(&full_stages, &stages[s]);
+    }
+    enqueue(&full_stages, NULL);
+    pthread_join(writer_thread, NULL);
+    
+    free(stages);
+    free(sorted);
+    return (ret < 0 || writer_data.failed) ? -1 : 0;
+}
+
+// Take the spilled rows before hour `limit` out of the list (readers of the next stage keep adding to it)
+static int take_spilled_rows(converter_ctx_t* ctx, size_t limit, write_data_t** rows, size_t* count) {
+    pthread_mutex_lock(&ctx->spill_mutex);
+    size_t taken = 0;
+    for (size_t i = 0; i < ctx->spill_count; i++) {
+        if (ctx->spill[i].time_index < limit) taken++;
+    }
+    *rows = NULL;
+    *count = 0;
+    if (taken > 0) {
+        *rows = malloc(taken * sizeof(write_data_t));
+        if (!*rows) {
+            pthread_mutex_unlock(&ctx->spill_mutex);
+            return -1;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < ctx->spill_count; i++) {
+            if (ctx->spill[i].time_index < limit) (*rows)[(*count)++] = ctx->spill[i];
+            else ctx->spill[kept++] = ctx->spill[i];
+        }
+        ctx->spill_count = kept;
+    }
+    pthread_mutex_unlock(&ctx->spill_mutex);
+    return 0;
+}
+
+// Write the spilled rows before hour `limit`. Called by the bulk writer after each stage (every year up
+// to the stage's is on disk, so nothing staged later overwrites them) and once more after the last.
+// Rows are grouped by chunk: each chunk takes one read-modify-write of the hours its rows span.
+static int write_spilled_rows(converter_ctx_t* ctx, size_t limit, int verbose) {
+    write_data_t* rows;
+    size_t count;
+    if (take_spilled_rows(ctx, limit, &rows, &count) < 0) {
+        fprintf(stderr, "Error: Memory allocation failed for out-of-year rows\n");
+        return -1;
+    }
+    if (count == 0) return 0;
+    if (verbose) {
+        printf("Writing %zu rows from outside their file's year\n", count);
+    }
+    
+    struct h5r* h5 = ctx->writer->h5r_ctx;
+    h5r_metadata_t meta;
+    if (h5r_get_metadata(h5, &meta) < 0) {
+        free(rows);
+        return -1;
+    }
+    const size_t crows = meta.layout == H5D_CHUNKED ? meta.crows : 1;
+    const size_t ccols = meta.layout == H5D_CHUNKED ? meta.ccols : meta.cols;
+    
+    // As with the incremental path, the order among rows for one cell is unspecified
+    spill_chunk_rows = crows;
+    spill_chunk_cols = ccols;
+    qsort(rows, count, sizeof(write_data_t), spill_chunk_compare);
+    
+    size_t current_time_points, mesh_count, needed = 0;
+    h5r_get_dimensions(h5, &current_time_points, &mesh_count);
+    for (size_t i = 0; i < count; i++) {
+        if (rows[i].time_index + 1 > needed) needed = rows[i].time_index + 1;
+    }
+    if (needed > current_time_points && h5mobaku_extend_time_dimension(ctx->writer, needed) < 0) {
+        fprintf(stderr, "Error: Failed to extend HDF5 dataset for out-of-year rows\n");
+        free(rows);
+        return -1;
+    }
+    
+    int32_t* tile = calloc(crows * ccols, sizeof(int32_t));
+    if (!tile) {
+        fprintf(stderr, "Error: Memory allocation failed for out-of-year chunk\n");
+        free(rows);
+        return -1;
+    }
+    
+    int ret = 0;
+    for (size_t i = 0; i < count; ) {
+        // Rows of one chunk are adjacent, in hour order
+        const size_t band = rows[i].time_index / crows, col_tile = rows[i].mesh_index / ccols;
+        size_t j = i + 1;
+        while (j < count && rows[j].time_index / crows == band && rows[j].mesh_index / ccols == col_tile) j++;
+        const size_t row0 = rows[i].time_index, nrows = rows[j - 1].time_index - row0 + 1;
+        const size_t col0 = col_tile * ccols, ncols = col0 + ccols <= mesh_count ? ccols : mesh_count - col0;
+        
+        // Cells without spilled rows keep what is stored; with sum/max the spilled rows for a cell are
+        // combined first and then merged with what the cell's year stage (if any) stored
+        const h5r_block_t block = {col0, 0, ncols};
+        if (h5r_read_blocks_union(h5, row0, nrows, &block, 1, tile, ccols) < 0) {
+            ret = -1;
+            break;
+        }
+        for (size_t k = i; k < j; ) {
+            int32_t value = rows[k].population;
+            size_t l = k + 1;
+            for (; l < j && rows[l].time_index == rows[k].time_index && rows[l].mesh_index == rows[k].mesh_index; l++) {
+                value = merge_values(ctx, value, rows[l].population);
+            }
+            int32_t* cell = &tile[(rows[k].time_index - row0) * ccols + (rows[k].mesh_index - col0)];
+            *cell = ctx->merge_policy != CSV_TO_H5_MERGE_OVERWRITE ? merge_values(ctx, *cell, value)
+                                                                   : value;
+            k = l;
+        }
+        if (h5r_write_chunk(h5, row0, col0, nrows, tile) < 0) {
+            ret = -1;
+            break;
+        }
+        i = j;
+    }
+    if (ret < 0) {
+        fprintf(stderr, "Error: Failed to write out-of-year rows\n");
+    }
+    
+    free(tile);
+    free(rows);
+    return ret;
+}
+
+static int breakdown_row_compare(const void* a, const void* b) {
+    const breakdown_row_t* ra = (const breakdown_row_t*)a;
+    const breakdown_row_t* rb = (const breakdown_row_t*)b;
+    if (ra->mesh_index != rb->mesh_index) return (ra->mesh_index > rb->mesh_index) - (ra->mesh_index < rb->mesh_index);
+    return (ra->time_index > rb->time_index) - (ra->time_index < rb->time_index);
+}
+
+// Take the breakdown rows before hour `limit` out of the collection; rows for hours stored before the
+// run stay unless `all` is set
+static int take_breakdown_rows(converter_ctx_t* ctx, size_t limit, bool all, breakdown_row_t** rows, size_t* count) {
+    pthread_mutex_lock(&ctx->breakdown_mutex);
+    size_t taken = 0;
+    for (size_t i = 0; i < ctx->breakdown_count; i++) {
+        const size_t t = ctx->breakdown_rows[i].time_index;
+        if (all || (t >= ctx->breakdown_initial_rows && t < limit)) taken++;
+    }
+    *rows = NULL;
+    *count = 0;
+    if (taken > 0) {
+        *rows = malloc(taken * sizeof(breakdown_row_t));
+        if (!*rows) {
+            pthread_mutex_unlock(&ctx->breakdown_mutex);
+            return -1;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < ctx->breakdown_count; i++) {
+            const size_t t = ctx->breakdown_rows[i].time_index;
+            if (all || (t >= ctx->breakdown_initial_rows && t < limit)) (*rows)[(*count)++] = ctx->breakdown_rows[i];
+            else ctx->breakdown_rows[kept++] = ctx->breakdown_rows[i];
+        }
+        ctx->breakdown_count = kept;
+    }
+    // Rows held back do not count towards the next flush
+    ctx->breakdown_flush_at = ctx->breakdown_count + BREAKDOWN_FLUSH_ROWS;
+    pthread_mutex_unlock(&ctx->breakdown_mutex);
+    return 0;
+}
+
+// Whether the incremental consumer should write the breakdown rows collected so far
+static bool breakdown_flush_due(converter_ctx_t* ctx) {
+    if (!ctx->breakdown) return false;
+    pthread_mutex_lock(&ctx->breakdown_mutex);
+    bool due = ctx->breakdown_count >= ctx->breakdown_flush_at;
+    pthread_mutex_unlock(&ctx->breakdown_mutex);
+    return due;
+}
+
+// Write the collected breakdown rows before hour `limit` (every row when `all` is set): one
+// read-modify-write per mesh and chunk time band, so every category of a mesh is stored in a single
+// contiguous run. A cell past the hours stored before the run holds 0 or what an earlier flush of this
+// run wrote, so rows are merged into it; older cells are only flushed once, at the end, and replaced.
+static int write_breakdown_rows(converter_ctx_t* ctx, size_t limit, bool all, int verbose) {
+    if (!ctx->breakdown) return 0;
+    breakdown_row_t* rows;
+    size_t count;
+    if (take_breakdown_rows(ctx, limit, all, &rows, &count) < 0) {
+        fprintf(stderr, "Error: Memory allocation failed for breakdown rows\n");
+        return -1;
+    }
+    if (count == 0) return 0;
+    if (verbose) {
+        printf("Writing %zu breakdown rows\n", count);
+    }
+    
+    // New categories widen the dataset, so resolve them all before any data of this flush is written
+    for (size_t i = 0; i < count; i++) {
+        breakdown_row_t* row = &rows[i];
+        row->category_index = h5mobaku_breakdown_add_category(ctx->breakdown, row->category);
+        if (row->category_index < 0) {
+            free(rows);
+            return -1;
+        }
+    }
+    size_t ncat = 0;
+    h5mobaku_breakdown_categories(ctx->breakdown, &ncat);
+    
+    qsort(rows, count, sizeof(breakdown_row_t), breakdown_row_compare);
+    
+    const h5mobaku_breakdown_config_t layout = H5MOBAKU_BREAKDOWN_DEFAULT_CONFIG;
+    const size_t band_rows = layout.chunk_time_size;
+    int32_t* band = malloc(band_rows * ncat * sizeof(int32_t));
+    uint8_t* seen = malloc(band_rows * ncat);
+    if (!band || !seen) {
+        fprintf(stderr, "Error: Memory allocation failed for breakdown band\n");
+        free(band);
+        free(seen);
+        free(rows);
+        return -1;
+    }
+    
+    int ret = 0;
+    for (size_t i = 0; i < count; ) {
+        const breakdown_row_t* first = &rows[i];
+        const size_t band_index = first->time_index / band_rows;
+        size_t j = i;
+        while (j < count && rows[j].mesh_index == first->mesh_index && rows[j].time_index / band_rows == band_index) {
+            j++;
+        }
+        const size_t row0 = first->time_index;
+        const size_t nrows = rows[j - 1].time_index - row0 + 1;
+        
+        // Categories not in this run keep their stored values; rows for the same category and
+        // hour are combined by the merge policy
+        if (h5mobaku_breakdown_read(ctx->breakdown, first->mesh_index, row0, nrows, band) < 0) {
+            ret = -1;
+            break;
+        }
+        memset(seen, 0, nrows * ncat);
+        for (size_t k = i; k < j; k++) {
+            const breakdown_row_t* row = &rows[k];
+            size_t offset = (row->time_index - row0) * ncat + (size_t)row->category_index;
+            band[offset] = seen[offset] || row->time_index >= ctx->breakdown_initial_rows
+                         ? merge_values(ctx, band[offset], row->population)
+                         : row->population;
+            seen[offset] = 1;
+        }
+        if (h5mobaku_breakdown_write(ctx->breakdown, first->mesh_index, row0, nrows, band) < 0) {
+            ret = -1;
+            break;
+        }
+        i = j;
+    }
+    
+    free(band);
+    free(seen);
+    free(rows);
+    if (ret == 0) ret = h5mobaku_breakdown_flush(ctx->breakdown);
+    return ret;
+}
+
 int csv_to_h5_convert_files(const char** csv_filenames, size_t num_files, 
                            const csv_to_h5_config_t* config, csv_to_h5_stats_t* stats) {
     if (!csv_filenames || num_files == 0) return -1;
@@ -717,83 +2161,32 @@ int csv_to_h5_convert_files(const char** csv_filenames, size_t num_files,
         converter_destroy(ctx);
         return -1;
     }
-    
-    // Determine number of producer threads (max 8, or 1 per 2 files)
-    const int max_threads = 32;
-    int num_threads = (int)num_files / 2;
-    if (num_threads < 1) num_threads = 1;
-    if (num_threads > max_threads) num_threads = max_threads;
-    
-    pthread_t* reader_threads = malloc(num_threads * sizeof(pthread_t));
-    enhanced_csv_reader_thread_data_t* thread_data = malloc(num_threads * sizeof(enhanced_csv_reader_thread_data_t));
-    
-    if (!reader_threads || !thread_data) {
-        fprintf(stderr, "Failed to allocate memory for threads\n");
-        should_stop = 1;
-        enqueue(&queue, NULL);
-        pthread_join(consumer_thread, NULL);
-        converter_destroy(ctx);
-        free(reader_threads);
-        free(thread_data);
-        return -1;
+    if (!ctx->use_bulk_write && ctx->pin_threads) {
+        cpu_topology_bind_thread(ctx->topology, consumer_thread, run_node(ctx, NULL));
     }
     
-    // Distribute files among reader threads
-    size_t files_per_thread = num_files / num_threads;
-    size_t extra_files = num_files % num_threads;
-    size_t file_index = 0;
-    
-    size_t total_rows_read = 0;
-    size_t total_files_processed = 0;
-    pthread_mutex_t reader_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
-    
-    if (local_config.verbose) {
-        printf("Starting %d CSV reader threads for %zu files\n", num_threads, num_files);
-    }
+    reader_progress_t progress = {
+        .total_rows_read = 0,
+        .total_files_processed = 0,
+        .total_files = num_files,
+        .mutex = PTHREAD_MUTEX_INITIALIZER
+    };
     
-    for (int i = 0; i < num_threads; i++) {
-        thread_data[i].thread_id = i;
-        thread_data[i].queue = &queue;
-        thread_data[i].filepaths = (char**)&csv_filenames[file_index];
-        thread_data[i].num_files = files_per_thread + (i < extra_files ? 1 : 0);
-        thread_data[i].rows_processed = &total_rows_read;
-        thread_data[i].stats_mutex = &reader_stats_mutex;
-        thread_data[i].ctx = ctx;  // Add converter context
-        thread_data[i].verbose = local_config.verbose;
-        thread_data[i].total_files_processed = &total_files_processed;
-        thread_data[i].total_files = num_files;
-        
-        if (local_config.verbose) {
-            printf("  Thread %d: %zu files (indices %zu-%zu)\n", 
-                   i, thread_data[i].num_files, file_index, 
-                   file_index + thread_data[i].num_files - 1);
-        }
-        
-        if (pthread_create(&reader_threads[i], NULL, enhanced_csv_reader_thread_func, &thread_data[i]) != 0) {
-            fprintf(stderr, "Failed to create reader thread %d\n", i);
-            // Clean up and return error
-            should_stop = 1;
-            for (int j = 0; j < i; j++) {
-                pthread_join(reader_threads[j], NULL);
-            }
-            enqueue(&queue, NULL);
-            pthread_join(consumer_thread, NULL);
-            converter_destroy(ctx);
-            free(reader_threads);
-            free(thread_data);
-            return -1;
+    // Bulk mode stages the input year by year; incremental mode streams everything to the consumer
+    int result;
+    if (ctx->use_bulk_write) {
+        result = run_bulk_stages(ctx, csv_filenames, num_files, &queue, &progress, &local_config);
+    } else {
+        size_t num_inputs = 0;
+        reader_input_t* inputs = make_reader_inputs(csv_filenames, num_files,
+                                                    reader_thread_count(ctx, SIZE_MAX, run_node(ctx, NULL)), &num_inputs);
+        if (!inputs) {
+            fprintf(stderr, "Failed to allocate memory for reader inputs\n");
+            result = -1;
+        } else {
+            result = run_reader_threads(ctx, inputs, num_inputs, &queue, NULL, &progress, local_config.verbose);
         }
-        
-        file_index += thread_data[i].num_files;
-    }
-    
-    // Wait for all reader threads to finish
-    if (local_config.verbose) {
-        printf("Waiting for all reader threads to complete...\n");
-    }
-    
-    for (int i = 0; i < num_threads; i++) {
-        pthread_join(reader_threads[i], NULL);
+        free(inputs);
     }
     
     if (local_config.verbose) {
@@ -807,24 +2200,28 @@ int csv_to_h5_convert_files(const char** csv_filenames, size_t num_files,
     // Wait for consumer thread
     pthread_join(consumer_thread, NULL);
     
-    // Perform bulk write if enabled, then flush data
-    if (perform_bulk_write(ctx, local_config.verbose) < 0) {
+    // Rows staged outside their year are written last, then the rest of the breakdown, then flush data
+    if (result < 0 || write_spilled_rows(ctx, SIZE_MAX, local_config.verbose) < 0 ||
+        write_breakdown_rows(ctx, SIZE_MAX, true, local_config.verbose) < 0) {
         // Clean up
-        pthread_mutex_destroy(&reader_stats_mutex);
-        free(reader_threads);
-        free(thread_data);
+        pthread_mutex_destroy(&progress.mutex);
         converter_destroy(ctx);
         return -1;
     }
     h5mobaku_flush(ctx->writer);
+    if (ctx->saturated_cells > 0) {
+        fprintf(stderr, "Warning: %zu summed cells exceeded the int32 range and were saturated\n",
+                ctx->saturated_cells);
+    }
     
     // Final statistics
     if (stats) {
         pthread_mutex_lock(&ctx->stats_mutex);
         stats->total_rows_processed = ctx->stats.total_rows_processed;
         stats->unique_timestamps = ctx->timestamp_count;
-        stats->unique_meshes = MOBAKU_MESH_COUNT;
+        stats->unique_meshes = ctx->mesh_count;
         stats->errors = ctx->stats.errors;
+        stats->direct_chunks = ctx->stats.direct_chunks;
         pthread_mutex_unlock(&ctx->stats_mutex);
     }
     
@@ -837,16 +2234,14 @@ int csv_to_h5_convert_files(const char** csv_filenames, size_t num_files,
         pthread_mutex_lock(&ctx->stats_mutex);
         printf("Multi-threaded conversion completed:\n");
         printf("  Total rows processed: %zu\n", ctx->stats.total_rows_processed);
-        printf("  Total files processed: %zu\n", total_files_processed);
+        printf("  Total files processed: %zu\n", progress.total_files_processed);
         printf("  Unique timestamps: %zu\n", ctx->timestamp_count);
         printf("  Errors: %zu\n", ctx->stats.errors);
         pthread_mutex_unlock(&ctx->stats_mutex);
     }
     
     // Clean up
-    pthread_mutex_destroy(&reader_stats_mutex);
-    free(reader_threads);
-    free(thread_data);
+    pthread_mutex_destroy(&progress.mutex);
     converter_destroy(ctx);
     
     return 0;
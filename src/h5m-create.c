@@ -14,6 +14,10 @@
 #include <hdf5.h>
 #include "csv_to_h5_converter.h"
 #include "csv_ops.h"
+#include "record_stream.h"
+#include "pgcopy_ops.h"
+#include "h5mobaku_topk.h"
+#include "h5mobaku_baseline.h"
 #include "meshid_ops.h"
 
 typedef struct {
@@ -26,6 +30,16 @@ typedef struct {
     int verbose;
     int help;
     int use_bulk_write;
+    int bulk_buffers;
+    csv_to_h5_merge_policy_t merge_policy;
+    int store_breakdown;
+    int reader_threads;
+    int pin_threads;
+    char* record_output_dir;
+    int from_records;
+    int from_pgcopy;
+    int build_chunk_max;
+    int baseline_weeks;
 } h5m_create_config_t;
 
 static void print_usage(const char* prog_name) {
@@ -38,7 +52,20 @@ static void print_usage(const char* prog_name) {
     printf("  -v, --vds-source <file>      Reference dataset for VDS integration\n");
     printf("  -y, --vds-year <year>        Cutoff year for VDS reference (required with --vds-source)\n");
     printf("  -b, --batch-size <size>      Processing batch size (default: 10000)\n");
-    printf("      --bulk-write             Enable year-wise bulk write mode (51 GiB memory)\n");
+    printf("      --bulk-write             Enable year-wise bulk write mode (51 GiB memory per year buffer)\n");
+    printf("      --bulk-buffers <n>       Year buffers in bulk mode (default: 1); 2 parses the next year\n");
+    printf("                               while writing the previous one if memory allows (2 x 51 GiB)\n");
+    printf("      --merge <policy>         Rows for the same hour and mesh: overwrite, sum or max\n");
+    printf("                               (default: overwrite; sum totals demographic breakdowns)\n");
+    printf("      --breakdown              Also store residence/age/gender rows in population_breakdown\n");
+    printf("  -j, --threads <n>            CSV reader threads (default: usable CPUs minus one)\n");
+    printf("      --pin-threads            Pin readers and the writer to the NUMA node of their buffer\n");
+    printf("      --emit-records <dir>     Also save the parsed rows of each CSV file as <dir>/<name>.mrec\n");
+    printf("      --from-records           Ingest the .mrec files under -d instead of CSV files\n");
+    printf("      --from-pgcopy            Ingest PostgreSQL binary COPY files under -d instead of CSV files\n");
+    printf("      --chunk-max              Store per-chunk maxima afterwards so top-k queries can skip chunks\n");
+    printf("      --baseline <weeks>       Store hour-of-week median profiles over the trailing weeks afterwards\n");
+    printf("                               for anomaly scoring\n");
     printf("      --verbose                Enable verbose output\n");
     printf("  -h, --help                   Show this help message\n");
     
@@ -52,8 +79,12 @@ static void print_usage(const char* prog_name) {
     printf("  With custom pattern and batch size:\n");
     printf("    %s -o output.h5 -d /path/to/csv -p \"data_*.csv\" -b 50000 --verbose\n", prog_name);
     printf("  \n");
-    printf("  Year-wise bulk processing (requires 51 GiB RAM):\n");
-    printf("    %s -o output.h5 -d /path/to/2024_csv --bulk-write --verbose\n", prog_name);
+    printf("  Year-wise bulk processing (requires 51 GiB RAM per year buffer):\n");
+    printf("    %s -o output.h5 -d /path/to/2016_2023_csv --bulk-write --verbose\n", prog_name);
+    printf("  \n");
+    printf("  Parse once, rebuild later from the pre-parsed records:\n");
+    printf("    %s -o first.h5 -d /path/to/csv --emit-records /path/to/records\n", prog_name);
+    printf("    %s -o rebuilt.h5 -d /path/to/records --from-records --bulk-write\n", prog_name);
     
     printf("\nVirtual Dataset (VDS) Integration:\n");
     printf("  When --vds-source and --vds-year are specified, the output file will include\n");
@@ -70,6 +101,7 @@ static int parse_arguments(int argc, char* argv[], h5m_create_config_t* config)
     config->csv_pattern = "*.csv";
     config->batch_size = 10000;
     config->vds_cutoff_year = -1;
+    config->bulk_buffers = 1;
     
     static struct option long_options[] = {
         {"output",      required_argument, 0, 'o'},
@@ -79,13 +111,23 @@ static int parse_arguments(int argc, char* argv[], h5m_create_config_t* config)
         {"vds-year",    required_argument, 0, 'y'},
         {"batch-size",  required_argument, 0, 'b'},
         {"bulk-write",  no_argument,       0, 1002},
+        {"bulk-buffers", required_argument, 0, 1003},
+        {"merge",       required_argument, 0, 1004},
+        {"breakdown",   no_argument,       0, 1005},
+        {"threads",     required_argument, 0, 'j'},
+        {"pin-threads", no_argument,       0, 1006},
+        {"emit-records", required_argument, 0, 1007},
+        {"from-records", no_argument,      0, 1008},
+        {"from-pgcopy", no_argument,       0, 1009},
+        {"chunk-max",   no_argument,       0, 1010},
+        {"baseline",    required_argument, 0, 1011},
         {"verbose",     no_argument,       0, 1001},
         {"help",        no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "o:d:p:v:y:b:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "o:d:p:v:y:b:j:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'o':
                 config->output_file = strdup(optarg);
@@ -115,6 +157,51 @@ static int parse_arguments(int argc, char* argv[], h5m_create_config_t* config)
             case 1002:
                 config->use_bulk_write = 1;
                 break;
+            case 1003:
+                config->bulk_buffers = atoi(optarg);
+                if (config->bulk_buffers < 1 || config->bulk_buffers > 2) {
+                    fprintf(stderr, "Error: Bulk buffers must be 1 or 2\n");
+                    return -1;
+                }
+                break;
+            case 1004:
+                if (csv_to_h5_parse_merge_policy(optarg, &config->merge_policy) < 0) {
+                    fprintf(stderr, "Error: Merge policy must be overwrite, sum or max\n");
+                    return -1;
+                }
+                break;
+            case 1005:
+                config->store_breakdown = 1;
+                break;
+            case 'j':
+                config->reader_threads = atoi(optarg);
+                if (config->reader_threads <= 0) {
+                    fprintf(stderr, "Error: Thread count must be positive\n");
+                    return -1;
+                }
+                break;
+            case 1006:
+                config->pin_threads = 1;
+                break;
+            case 1007:
+                config->record_output_dir = strdup(optarg);
+                break;
+            case 1008:
+                config->from_records = 1;
+                break;
+            case 1009:
+                config->from_pgcopy = 1;
+                break;
+            case 1010:
+                config->build_chunk_max = 1;
+                break;
+            case 1011:
+                config->baseline_weeks = atoi(optarg);
+                if (config->baseline_weeks <= 0) {
+                    fprintf(stderr, "Error: Baseline weeks must be positive\n");
+                    return -1;
+                }
+                break;
             case 'h':
                 config->help = 1;
                 return 0;
@@ -134,6 +221,15 @@ static int parse_arguments(int argc, char* argv[], h5m_create_config_t* config)
         return -1;
     }
     
+    if (config->from_records && config->record_output_dir) {
+        fprintf(stderr, "Error: --emit-records needs CSV or PGCOPY input, not --from-records\n");
+        return -1;
+    }
+    if (config->from_records && config->from_pgcopy) {
+        fprintf(stderr, "Error: --from-records and --from-pgcopy are exclusive\n");
+        return -1;
+    }
+    
     // Validate VDS options
     if (config->vds_source_file && config->vds_cutoff_year == -1) {
         fprintf(stderr, "Error: VDS year (-y) is required when VDS source (-v) is specified\n");
@@ -169,6 +265,7 @@ static void free_config(h5m_create_config_t* config) {
     if (config->csv_directory) free(config->csv_directory);
     if (config->csv_pattern && strcmp(config->csv_pattern, "*.csv") != 0) free(config->csv_pattern);
     if (config->vds_source_file) free(config->vds_source_file);
+    if (config->record_output_dir) free(config->record_output_dir);
 }
 
 static int get_vds_time_dimensions(const char* vds_file, hsize_t* time_dim, hsize_t* mesh_dim) {
@@ -222,6 +319,38 @@ static int filter_csv_files_by_year(char** all_files, size_t total_count,
     
     // For each CSV file, check if it contains data from cutoff_year or later
     for (size_t i = 0; i < total_count; i++) {
+        // Record files carry their time range in the header
+        if (record_stream_is_stream(all_files[i])) {
+            record_stream_t* stream = record_stream_open(all_files[i]);
+            if (!stream) continue;
+            const record_stream_header_t* header = record_stream_header(stream);
+            if (header->count > 0 && meshid_get_year_from_time_index((int)header->max_time) >= cutoff_year) {
+                (*filtered_files)[*filtered_count] = strdup(all_files[i]);
+                (*filtered_count)++;
+            }
+            record_stream_close(stream);
+            continue;
+        }
+        
+        if (pgcopy_is_pgcopy(all_files[i])) {
+            pgcopy_reader_t* reader = pgcopy_open(all_files[i]);
+            if (!reader) continue;
+            csv_row_t row;
+            int has_recent_data = 0;
+            for (int j = 0; j < 10 && pgcopy_read_row(reader, &row) == 0; j++) {
+                if ((int)(row.date / 10000) >= cutoff_year) {
+                    has_recent_data = 1;
+                    break;
+                }
+            }
+            pgcopy_close(reader);
+            if (has_recent_data) {
+                (*filtered_files)[*filtered_count] = strdup(all_files[i]);
+                (*filtered_count)++;
+            }
+            continue;
+        }
+        
         csv_reader_t* reader = csv_open(all_files[i]);
         if (!reader) continue;
         
@@ -277,6 +406,12 @@ static int create_vds_integrated_file(const h5m_create_config_t* config,
     csv_config.verbose = config->verbose;
     csv_config.create_new = 1; // Create new file
     csv_config.use_bulk_write = config->use_bulk_write;
+    csv_config.bulk_year_buffers = config->bulk_buffers;
+    csv_config.merge_policy = config->merge_policy;
+    csv_config.store_breakdown = config->store_breakdown;
+    csv_config.reader_threads = config->reader_threads;
+    csv_config.pin_threads = config->pin_threads;
+    csv_config.record_output_dir = config->record_output_dir;
     
     if (config->verbose) {
         printf("Converting %zu CSV files directly to output file...\n", csv_count);
@@ -500,17 +635,24 @@ int main(int argc, char* argv[]) {
     size_t total_file_count = 0;
     size_t file_capacity = 10000;
     
-    find_csv_files(config.csv_directory, &all_csv_files, &total_file_count, &file_capacity);
+    const char* input_kind = config.from_records ? "record" : config.from_pgcopy ? "PGCOPY" : "CSV";
+    if (config.from_records) {
+        record_stream_find_files(config.csv_directory, &all_csv_files, &total_file_count, &file_capacity);
+    } else if (config.from_pgcopy) {
+        pgcopy_find_files(config.csv_directory, &all_csv_files, &total_file_count, &file_capacity);
+    } else {
+        find_csv_files(config.csv_directory, &all_csv_files, &total_file_count, &file_capacity);
+    }
     
     if (total_file_count == 0) {
-        fprintf(stderr, "Error: No CSV files found in directory: %s\n", config.csv_directory);
+        fprintf(stderr, "Error: No %s files found in directory: %s\n", input_kind, config.csv_directory);
         free(all_csv_files);
         free_config(&config);
         return 1;
     }
     
     if (config.verbose) {
-        printf("Found %zu CSV files\n", total_file_count);
+        printf("Found %zu %s files\n", total_file_count, input_kind);
     }
     
     csv_to_h5_stats_t stats;
@@ -551,6 +693,12 @@ int main(int argc, char* argv[]) {
         csv_config.verbose = config.verbose;
         csv_config.create_new = 1;
         csv_config.use_bulk_write = config.use_bulk_write;
+        csv_config.bulk_year_buffers = config.bulk_buffers;
+        csv_config.merge_policy = config.merge_policy;
+        csv_config.store_breakdown = config.store_breakdown;
+        csv_config.reader_threads = config.reader_threads;
+        csv_config.pin_threads = config.pin_threads;
+        csv_config.record_output_dir = config.record_output_dir;
         
         result = csv_to_h5_convert_files((const char**)all_csv_files, total_file_count, &csv_config, &stats);
     }
@@ -561,6 +709,19 @@ int main(int argc, char* argv[]) {
     }
     free(all_csv_files);
     
+    if (result == 0 && config.build_chunk_max) {
+        if (config.verbose) printf("Building chunk maxima...\n");
+        result = h5mobaku_build_chunk_max(config.output_file);
+    }
+    if (result == 0 && config.baseline_weeks > 0) {
+        if (config.verbose) printf("Building %d-week baseline...\n", config.baseline_weeks);
+        struct h5mobaku *h5 = NULL;
+        h5mobaku_baseline_spec_t baseline = H5MOBAKU_BASELINE_DEFAULT_SPEC;
+        baseline.weeks = (size_t)config.baseline_weeks;
+        result = h5mobaku_open_readwrite(config.output_file, &h5) == 0 ? h5mobaku_build_baseline(h5, &baseline) : -1;
+        h5mobaku_close(h5);
+    }
+    
     if (result == 0) {
         printf("\nConversion completed successfully!\n");
         printf("Output file: %s\n", config.output_file);
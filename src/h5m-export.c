@@ -0,0 +1,647 @@
+//
+// h5m-export: partitioned columnar export of population_data
+//
+// Output layout (Hive-style partitions):
+//   <outdir>/year=YYYY/mesh1=NNNN.h5mc
+//
+// Each .h5mc file holds the hourly series of every mesh in one 1st mesh for
+// one calendar year (JST). Columns are split into row groups of chunk-aligned
+// column bands so that every band maps onto whole HDF5 chunks and the memory
+// used per worker stays bounded. All integers are written little-endian
+// whatever the host order; h5mobaku_read_h5mc() reads a file back.
+//
+//   header     "H5MC" u16 version, u16 flags, i32 year, u32 mesh1,
+//              i64 start_epoch (unix seconds of the first hour),
+//              u32 num_times, u32 num_meshes
+//   row group  u32 num_meshes, u32 dict_bytes, mesh dictionary,
+//              u32 series_bytes[num_meshes], series data
+//   footer     u32 num_row_groups, u64 row_group_offset[num_row_groups],
+//              u64 footer_offset, "H5MC"
+//
+// The mesh dictionary stores the mesh IDs of the row group once, as zigzag
+// varint deltas. IDs come from the file's meshid_list (the built-in list for
+// national files written without one). Each series is the population of one mesh over num_times
+// hours, stored as zigzag varint deltas from the previous hour (first value
+// against 0).
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "h5mobaku_ops.h"
+#include "h5mobaku_h5mc.h"
+#include "meshid_ops.h"
+
+#define FIRST_MESH_DIVISOR 100000
+#define DEFAULT_MEMORY_MB 1024
+#define MAX_VARINT_BYTES 5  // zigzag of an int32 delta fits in 33 bits
+#define MAX_MESH1_FILTER 256
+
+// Contiguous column run sharing a 1st mesh
+typedef struct {
+    uint64_t col0;
+    uint64_t ncols;
+} column_run_t;
+
+typedef struct {
+    uint32_t mesh1;
+    column_run_t *runs;
+    size_t num_runs;
+    uint64_t num_meshes;
+} mesh1_group_t;
+
+typedef struct {
+    int year;
+    uint64_t row0;
+    uint64_t nrows;
+    const mesh1_group_t *group;
+} export_task_t;
+
+typedef struct {
+    struct h5mobaku *ctx;
+    pthread_mutex_t h5_mutex;      // HDF5 is not thread-safe; reads are serialized
+
+    export_task_t *tasks;
+    size_t num_tasks;
+    size_t next_task;
+    size_t done_tasks;
+    pthread_mutex_t task_mutex;
+
+    const uint32_t *mesh_ids;      // Mesh ID of every column
+    uint64_t chunk_cols;           // Chunk width of population_data
+    const char *output_dir;
+    uint64_t band_cols;            // Columns per row group (multiple of the chunk width)
+    uint64_t max_rows;
+    int verbose;
+    int failed;
+    uint64_t bytes_written;
+} export_ctx_t;
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s -f <hdf5_file> -o <output_dir> [options]\n", prog_name);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  -f, --file <path>        HDF5 file path (required)\n");
+    fprintf(stderr, "  -o, --output <dir>       Output directory (required)\n");
+    fprintf(stderr, "  -s, --start-year <year>  First year to export (default: first year in file)\n");
+    fprintf(stderr, "  -e, --end-year <year>    Last year to export (default: last year in file)\n");
+    fprintf(stderr, "  -m, --mesh1 <list>       Comma-separated 1st mesh codes to export (default: all)\n");
+    fprintf(stderr, "  -j, --threads <n>        Worker threads (default: number of online CPUs)\n");
+    fprintf(stderr, "  -M, --memory <MiB>       Memory budget for band buffers (default: %d)\n", DEFAULT_MEMORY_MB);
+    fprintf(stderr, "  -v, --verbose            Print progress\n");
+    fprintf(stderr, "  -h, --help               Show this help message\n");
+    fprintf(stderr, "\nExamples:\n");
+    fprintf(stderr, "  %s -f data.h5 -o export -s 2019 -e 2020\n", prog_name);
+    fprintf(stderr, "  %s -f data.h5 -o export -m 5339,5340 -j 16 -M 4096\n", prog_name);
+}
+
+static inline uint64_t zigzag_encode(int64_t v) {
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline size_t put_varint(uint8_t *dst, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        dst[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    dst[n++] = (uint8_t)v;
+    return n;
+}
+
+static inline uint8_t *put_u16le(uint8_t *dst, uint16_t v) {
+    dst[0] = (uint8_t)v;
+    dst[1] = (uint8_t)(v >> 8);
+    return dst + 2;
+}
+
+static inline uint8_t *put_u32le(uint8_t *dst, uint32_t v) {
+    for (int i = 0; i < 4; i++) dst[i] = (uint8_t)(v >> (8 * i));
+    return dst + 4;
+}
+
+static inline uint8_t *put_u64le(uint8_t *dst, uint64_t v) {
+    for (int i = 0; i < 8; i++) dst[i] = (uint8_t)(v >> (8 * i));
+    return dst + 8;
+}
+
+static int mkdir_p(const char *path) {
+    char tmp[4096];
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(tmp)) return -1;
+    memcpy(tmp, path, len + 1);
+
+    for (char *p = tmp + 1; *p; p++) {
+        if (*p != '/') continue;
+        *p = '\0';
+        if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+        *p = '/';
+    }
+    if (mkdir(tmp, 0755) != 0 && errno != EEXIST) return -1;
+    return 0;
+}
+
+// Group the columns of the file's mesh list by 1st mesh code
+static mesh1_group_t *build_mesh1_groups(const uint32_t *mesh_ids, size_t num_cols, size_t *num_groups) {
+    mesh1_group_t *groups = NULL;
+    size_t count = 0, capacity = 0;
+
+    uint64_t col = 0;
+    while (col < num_cols) {
+        uint32_t mesh1 = mesh_ids[col] / FIRST_MESH_DIVISOR;
+        uint64_t end = col + 1;
+        while (end < num_cols && mesh_ids[end] / FIRST_MESH_DIVISOR == mesh1) end++;
+
+        mesh1_group_t *g = NULL;
+        for (size_t i = 0; i < count; i++) {
+            if (groups[i].mesh1 == mesh1) {
+                g = &groups[i];
+                break;
+            }
+        }
+        if (!g) {
+            if (count == capacity) {
+                capacity = capacity ? capacity * 2 : 256;
+                mesh1_group_t *tmp = realloc(groups, capacity * sizeof(mesh1_group_t));
+                if (!tmp) goto fail;
+                groups = tmp;
+            }
+            g = &groups[count++];
+            memset(g, 0, sizeof(*g));
+            g->mesh1 = mesh1;
+        }
+
+        column_run_t *runs = realloc(g->runs, (g->num_runs + 1) * sizeof(column_run_t));
+        if (!runs) goto fail;
+        g->runs = runs;
+        g->runs[g->num_runs++] = (column_run_t){col, end - col};
+        g->num_meshes += end - col;
+        col = end;
+    }
+
+    *num_groups = count;
+    return groups;
+
+fail:
+    fprintf(stderr, "Error: Memory allocation failed for 1st mesh groups\n");
+    for (size_t i = 0; i < count; i++) free(groups[i].runs);
+    free(groups);
+    return NULL;
+}
+
+static void free_mesh1_groups(mesh1_group_t *groups, size_t num_groups) {
+    if (!groups) return;
+    for (size_t i = 0; i < num_groups; i++) free(groups[i].runs);
+    free(groups);
+}
+
+static int write_all(FILE *fp, const void *buf, size_t len, uint64_t *offset) {
+    if (len && fwrite(buf, 1, len, fp) != len) return -1;
+    *offset += len;
+    return 0;
+}
+
+// Encode one band (data is row-major: data[t * ncols + c]) and append it as a row group.
+// series_bytes holds ncols little-endian u32 lengths.
+static int write_row_group(FILE *fp, uint64_t *offset, const int32_t *data, uint64_t nrows,
+                           const uint32_t *mesh_ids, uint64_t ncols, uint8_t *enc, uint8_t *series_bytes) {
+    // Mesh dictionary
+    size_t dict_len = 0;
+    int64_t prev_id = 0;
+    for (uint64_t c = 0; c < ncols; c++) {
+        int64_t id = mesh_ids[c];
+        dict_len += put_varint(enc + dict_len, zigzag_encode(id - prev_id));
+        prev_id = id;
+    }
+
+    // Per-mesh delta-encoded series, walked down the column
+    uint8_t *series = enc + dict_len;
+    size_t series_len = 0;
+    for (uint64_t c = 0; c < ncols; c++) {
+        size_t start = series_len;
+        int64_t prev = 0;
+        const int32_t *p = data + c;
+        for (uint64_t t = 0; t < nrows; t++, p += ncols) {
+            series_len += put_varint(series + series_len, zigzag_encode((int64_t)*p - prev));
+            prev = *p;
+        }
+        put_u32le(series_bytes + 4 * c, (uint32_t)(series_len - start));
+    }
+
+    uint8_t hdr[8];
+    put_u32le(put_u32le(hdr, (uint32_t)ncols), (uint32_t)dict_len);
+    if (write_all(fp, hdr, sizeof(hdr), offset) < 0 ||
+        write_all(fp, enc, dict_len, offset) < 0 ||
+        write_all(fp, series_bytes, ncols * sizeof(uint32_t), offset) < 0 ||
+        write_all(fp, series, series_len, offset) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static int export_partition(export_ctx_t *ex, const export_task_t *task,
+                            int32_t *band, uint8_t *enc, uint8_t *series_bytes) {
+    const mesh1_group_t *g = task->group;
+
+    char dir[4096], path[4096], tmp_path[4096];
+    snprintf(dir, sizeof(dir), "%s/year=%d", ex->output_dir, task->year);
+    snprintf(path, sizeof(path), "%s/mesh1=%u.h5mc", dir, g->mesh1);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    if (mkdir_p(dir) < 0) {
+        fprintf(stderr, "Error: Cannot create directory %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+
+    FILE *fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot create %s: %s\n", tmp_path, strerror(errno));
+        return -1;
+    }
+
+    uint64_t offset = 0;
+    const int64_t start_epoch = (int64_t)ex->ctx->start_datetime + (int64_t)task->row0 * 3600;
+    uint8_t header[H5MC_HEADER_BYTES];
+    uint8_t *h = header;
+    memcpy(h, H5MC_MAGIC, 4);
+    h = put_u16le(h + 4, H5MC_VERSION);
+    h = put_u16le(h, 0);
+    h = put_u32le(h, (uint32_t)task->year);
+    h = put_u32le(h, g->mesh1);
+    h = put_u64le(h, (uint64_t)start_epoch);
+    h = put_u32le(h, (uint32_t)task->nrows);
+    put_u32le(h, (uint32_t)g->num_meshes);
+
+    int ret = write_all(fp, header, sizeof(header), &offset);
+
+    uint64_t *rg_offsets = NULL;
+    uint32_t num_row_groups = 0;
+    size_t rg_capacity = 0;
+
+    for (size_t r = 0; r < g->num_runs && ret == 0; r++) {
+        const uint64_t run_end = g->runs[r].col0 + g->runs[r].ncols;
+        uint64_t c = g->runs[r].col0;
+        while (c < run_end) {
+            // Band boundaries fall on chunk boundaries of the dataset
+            uint64_t next = (c + ex->band_cols) / ex->chunk_cols * ex->chunk_cols;
+            if (next <= c) next = (c / ex->chunk_cols + 1) * ex->chunk_cols;
+            if (next > run_end) next = run_end;
+            const uint64_t ncols = next - c;
+
+            h5r_block_t blk = {.dcol0 = c, .mcol0 = 0, .ncols = ncols};
+            pthread_mutex_lock(&ex->h5_mutex);
+            int rret = h5r_read_blocks_union(ex->ctx->h5r_ctx, task->row0, task->nrows, &blk, 1, band, ncols);
+            pthread_mutex_unlock(&ex->h5_mutex);
+            if (rret < 0) {
+                fprintf(stderr, "Error: Failed to read columns %lu-%lu for year %d\n",
+                        (unsigned long)c, (unsigned long)(next - 1), task->year);
+                ret = -1;
+                break;
+            }
+
+            if (num_row_groups == rg_capacity) {
+                rg_capacity = rg_capacity ? rg_capacity * 2 : 16;
+                uint64_t *tmp = realloc(rg_offsets, rg_capacity * sizeof(uint64_t));
+                if (!tmp) {
+                    fprintf(stderr, "Error: Memory allocation failed for row group offsets\n");
+                    ret = -1;
+                    break;
+                }
+                rg_offsets = tmp;
+            }
+            put_u64le((uint8_t *)&rg_offsets[num_row_groups++], offset);
+
+            if (write_row_group(fp, &offset, band, task->nrows, ex->mesh_ids + c, ncols, enc, series_bytes) < 0) {
+                fprintf(stderr, "Error: Failed to write row group to %s\n", tmp_path);
+                ret = -1;
+                break;
+            }
+            c = next;
+        }
+    }
+
+    if (ret == 0) {
+        // rg_offsets already hold little-endian bytes
+        uint8_t count[4], tail[8];
+        put_u32le(count, num_row_groups);
+        put_u64le(tail, offset);
+        if (write_all(fp, count, sizeof(count), &offset) < 0 ||
+            write_all(fp, rg_offsets, num_row_groups * sizeof(uint64_t), &offset) < 0 ||
+            write_all(fp, tail, sizeof(tail), &offset) < 0 ||
+            write_all(fp, H5MC_MAGIC, 4, &offset) < 0) {
+            fprintf(stderr, "Error: Failed to write footer to %s\n", tmp_path);
+            ret = -1;
+        }
+    }
+    free(rg_offsets);
+
+    if (fclose(fp) != 0) ret = -1;
+    if (ret == 0 && rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Error: Cannot rename %s to %s: %s\n", tmp_path, path, strerror(errno));
+        ret = -1;
+    }
+    if (ret != 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    pthread_mutex_lock(&ex->task_mutex);
+    ex->bytes_written += offset;
+    pthread_mutex_unlock(&ex->task_mutex);
+    return 0;
+}
+
+static void *export_worker(void *arg) {
+    export_ctx_t *ex = (export_ctx_t*)arg;
+
+    int32_t *band = malloc(ex->max_rows * ex->band_cols * sizeof(int32_t));
+    uint8_t *enc = malloc(ex->band_cols * (ex->max_rows + 1) * MAX_VARINT_BYTES);
+    uint8_t *series_bytes = malloc(ex->band_cols * sizeof(uint32_t));
+    if (!band || !enc || !series_bytes) {
+        fprintf(stderr, "Error: Memory allocation failed for export worker buffers\n");
+        pthread_mutex_lock(&ex->task_mutex);
+        ex->failed = 1;
+        pthread_mutex_unlock(&ex->task_mutex);
+        free(band);
+        free(enc);
+        free(series_bytes);
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&ex->task_mutex);
+        if (ex->failed || ex->next_task >= ex->num_tasks) {
+            pthread_mutex_unlock(&ex->task_mutex);
+            break;
+        }
+        const export_task_t *task = &ex->tasks[ex->next_task++];
+        pthread_mutex_unlock(&ex->task_mutex);
+
+        int ret = export_partition(ex, task, band, enc, series_bytes);
+
+        pthread_mutex_lock(&ex->task_mutex);
+        if (ret < 0) ex->failed = 1;
+        ex->done_tasks++;
+        if (ex->verbose) {
+            fprintf(stderr, "\r[%zu/%zu] year=%d mesh1=%u", ex->done_tasks, ex->num_tasks,
+                    task->year, task->group->mesh1);
+        }
+        pthread_mutex_unlock(&ex->task_mutex);
+    }
+
+    free(band);
+    free(enc);
+    free(series_bytes);
+    return NULL;
+}
+
+static int parse_mesh1_list(char *arg, uint32_t *out, size_t max, size_t *count) {
+    *count = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        char *endptr;
+        unsigned long v = strtoul(tok, &endptr, 10);
+        if (*endptr != '\0' || v < 1000 || v > 9999 || *count >= max) return -1;
+        out[(*count)++] = (uint32_t)v;
+    }
+    return *count > 0 ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *hdf5_file = NULL;
+    const char *output_dir = NULL;
+    int start_year = 0, end_year = 0;
+    uint32_t mesh1_filter[MAX_MESH1_FILTER];
+    size_t num_mesh1_filter = 0;
+    long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+    long memory_mb = DEFAULT_MEMORY_MB;
+    int verbose = 0;
+    int opt;
+
+    static struct option long_options[] = {
+        {"file",       required_argument, 0, 'f'},
+        {"output",     required_argument, 0, 'o'},
+        {"start-year", required_argument, 0, 's'},
+        {"end-year",   required_argument, 0, 'e'},
+        {"mesh1",      required_argument, 0, 'm'},
+        {"threads",    required_argument, 0, 'j'},
+        {"memory",     required_argument, 0, 'M'},
+        {"verbose",    no_argument,       0, 'v'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "f:o:s:e:m:j:M:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                hdf5_file = optarg;
+                break;
+            case 'o':
+                output_dir = optarg;
+                break;
+            case 's':
+                start_year = atoi(optarg);
+                break;
+            case 'e':
+                end_year = atoi(optarg);
+                break;
+            case 'm':
+                if (parse_mesh1_list(optarg, mesh1_filter, MAX_MESH1_FILTER, &num_mesh1_filter) < 0) {
+                    fprintf(stderr, "Error: Invalid 1st mesh list\n");
+                    return 1;
+                }
+                break;
+            case 'j':
+                num_threads = atol(optarg);
+                break;
+            case 'M':
+                memory_mb = atol(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!hdf5_file || !output_dir) {
+        fprintf(stderr, "Error: HDF5 file (-f) and output directory (-o) are required\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (num_threads < 1) num_threads = 1;
+    if (memory_mb < 1) {
+        fprintf(stderr, "Error: Memory budget must be positive\n");
+        return 1;
+    }
+
+    struct h5mobaku *ctx = NULL;
+    if (h5mobaku_open(hdf5_file, &ctx) != 0) {
+        fprintf(stderr, "Error: Failed to open HDF5 file: %s\n", hdf5_file);
+        return 1;
+    }
+
+    size_t num_rows = 0, num_cols = 0;
+    if (h5r_get_dimensions(ctx->h5r_ctx, &num_rows, &num_cols) < 0 || num_rows == 0) {
+        fprintf(stderr, "Error: Failed to get dataset dimensions\n");
+        h5mobaku_close(ctx);
+        return 1;
+    }
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+
+    // Columns are labelled from the file's own mesh list; only national files may lack one
+    uint32_t *mesh_ids = NULL;
+    size_t num_ids = 0;
+    if (meta.has_meshid_list) {
+        if (h5r_read_meshid_list(ctx->h5r_ctx, &mesh_ids, &num_ids) < 0) {
+            fprintf(stderr, "Error: Failed to read meshid_list from %s\n", hdf5_file);
+            h5mobaku_close(ctx);
+            return 1;
+        }
+    } else {
+        num_ids = meshid_list_size;
+        mesh_ids = malloc(num_ids * sizeof(uint32_t));
+        if (mesh_ids) memcpy(mesh_ids, meshid_list, num_ids * sizeof(uint32_t));
+    }
+    if (!mesh_ids || num_ids != num_cols) {
+        fprintf(stderr, "Error: Dataset has %zu mesh columns but its mesh list has %zu\n", num_cols, num_ids);
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+    const uint64_t chunk_cols = meta.ccols > 0 ? meta.ccols : 1;
+
+    // Time indices in the file are relative to its start_datetime attribute
+    const int file_offset = meshid_get_time_index_from_time(ctx->start_datetime);
+    if (file_offset < 0) {
+        fprintf(stderr, "Error: File start datetime precedes %s\n", REFERENCE_MOBAKU_DATETIME);
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+    const int first_year = meshid_get_year_from_time_index(file_offset);
+    const int last_year = meshid_get_year_from_time_index(file_offset + (int)num_rows - 1);
+    if (start_year == 0 || start_year < first_year) start_year = first_year;
+    if (end_year == 0 || end_year > last_year) end_year = last_year;
+    if (start_year > end_year) {
+        fprintf(stderr, "Error: No data in year range %d-%d\n", start_year, end_year);
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+
+    size_t num_groups = 0;
+    mesh1_group_t *groups = build_mesh1_groups(mesh_ids, num_cols, &num_groups);
+    if (!groups) {
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+
+    // One task per (year, 1st mesh) partition
+    size_t max_tasks = (size_t)(end_year - start_year + 1) * num_groups;
+    export_task_t *tasks = malloc(max_tasks * sizeof(export_task_t));
+    if (!tasks) {
+        fprintf(stderr, "Error: Memory allocation failed for export tasks\n");
+        free_mesh1_groups(groups, num_groups);
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+    size_t num_tasks = 0;
+    uint64_t max_rows = 0;
+    for (int year = start_year; year <= end_year; year++) {
+        int64_t row0 = (int64_t)meshid_get_time_index_of_year(year) - file_offset;
+        int64_t row1 = row0 + meshid_get_hours_in_year(year);
+        if (row0 < 0) row0 = 0;
+        if (row1 > (int64_t)num_rows) row1 = (int64_t)num_rows;
+        if (row1 <= row0) continue;
+        if ((uint64_t)(row1 - row0) > max_rows) max_rows = (uint64_t)(row1 - row0);
+
+        for (size_t g = 0; g < num_groups; g++) {
+            if (num_mesh1_filter > 0) {
+                int wanted = 0;
+                for (size_t i = 0; i < num_mesh1_filter; i++) {
+                    if (mesh1_filter[i] == groups[g].mesh1) wanted = 1;
+                }
+                if (!wanted) continue;
+            }
+            tasks[num_tasks++] = (export_task_t){year, (uint64_t)row0, (uint64_t)(row1 - row0), &groups[g]};
+        }
+    }
+    if (num_tasks == 0) {
+        fprintf(stderr, "Error: Nothing to export\n");
+        free(tasks);
+        free_mesh1_groups(groups, num_groups);
+        free(mesh_ids);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+    if ((size_t)num_threads > num_tasks) num_threads = (long)num_tasks;
+
+    // Each worker holds one raw band and its worst-case encoding
+    const uint64_t per_worker = (uint64_t)memory_mb * 1024 * 1024 / (uint64_t)num_threads;
+    const uint64_t bytes_per_col = max_rows * (sizeof(int32_t) + MAX_VARINT_BYTES) + MAX_VARINT_BYTES + sizeof(uint32_t);
+    uint64_t band_cols = per_worker / bytes_per_col / chunk_cols * chunk_cols;
+    if (band_cols < chunk_cols) band_cols = chunk_cols;
+
+    export_ctx_t ex = {
+        .ctx = ctx,
+        .mesh_ids = mesh_ids,
+        .chunk_cols = chunk_cols,
+        .tasks = tasks,
+        .num_tasks = num_tasks,
+        .output_dir = output_dir,
+        .band_cols = band_cols,
+        .max_rows = max_rows,
+        .verbose = verbose,
+    };
+    pthread_mutex_init(&ex.h5_mutex, NULL);
+    pthread_mutex_init(&ex.task_mutex, NULL);
+
+    if (verbose) {
+        fprintf(stderr, "Exporting %zu partitions (years %d-%d) with %ld threads, %lu columns per row group\n",
+                num_tasks, start_year, end_year, num_threads, (unsigned long)band_cols);
+    }
+
+    TIC(export);
+    pthread_t *threads = malloc((size_t)num_threads * sizeof(pthread_t));
+    long started = 0;
+    if (threads) {
+        for (; started < num_threads; started++) {
+            if (pthread_create(&threads[started], NULL, export_worker, &ex) != 0) break;
+        }
+    }
+    if (started == 0) {
+        fprintf(stderr, "Error: Failed to start export threads\n");
+        ex.failed = 1;
+    }
+    for (long i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    TOC(export);
+
+    if (verbose) {
+        fprintf(stderr, "\nWrote %zu partitions, %.1f MiB\n", ex.done_tasks,
+                (double)ex.bytes_written / (1024.0 * 1024.0));
+    }
+
+    int failed = ex.failed;
+    pthread_mutex_destroy(&ex.h5_mutex);
+    pthread_mutex_destroy(&ex.task_mutex);
+    free(threads);
+    free(tasks);
+    free_mesh1_groups(groups, num_groups);
+    free(mesh_ids);
+    h5mobaku_close(ctx);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,461 @@
+//
+// h5m-extract: regional subset files
+//
+// Copies the columns of a set of 1st meshes (or of every mesh whose center lies in a
+// latitude/longitude box) into a new population file. The output stores its own
+// meshid_list, so it opens with a file-specific mesh dictionary and answers the same
+// mesh-ID queries as the source without the national-width dataset.
+//
+// The selected columns keep their source order and are read as the union of their
+// contiguous runs, one time band at a time, and written back at the same rows; band
+// boundaries fall on output chunk boundaries so every write fills whole chunks. When one
+// chunk-row of the whole selection does not fit the memory budget, each band is copied
+// in groups of whole output chunk columns instead. The copy is serial.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <hdf5.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define FIRST_MESH_DIVISOR 100000
+#define DEFAULT_MEMORY_MB 1024
+#define MAX_MESH1_FILTER 256
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s -f <hdf5_file> -o <output_file> (-m <list> | -b <bbox>) [options]\n", prog_name);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  -f, --file <path>        Source HDF5 file (required)\n");
+    fprintf(stderr, "  -o, --output <path>      Output HDF5 file (required)\n");
+    fprintf(stderr, "  -m, --mesh1 <list>       Comma-separated 1st mesh codes to extract\n");
+    fprintf(stderr, "  -b, --bbox <box>         lat0,lon0,lat1,lon1: meshes whose center lies in the box\n");
+    fprintf(stderr, "  -c, --chunk-mesh <n>     Output chunk width in meshes (default: %d)\n", HDF5_MESH_CHUNK);
+    fprintf(stderr, "  -M, --memory <MiB>       Memory budget for the band buffer (default: %d)\n", DEFAULT_MEMORY_MB);
+    fprintf(stderr, "  -v, --verbose            Print progress\n");
+    fprintf(stderr, "  -h, --help               Show this help message\n");
+    fprintf(stderr, "\nExamples:\n");
+    fprintf(stderr, "  %s -f data.h5 -o tokyo.h5 -m 5339,5340\n", prog_name);
+    fprintf(stderr, "  %s -f data.h5 -o osaka.h5 -b 34.5,135.3,34.8,135.7\n", prog_name);
+}
+
+static int parse_mesh1_list(char *arg, uint32_t *out, size_t max, size_t *count) {
+    *count = 0;
+    for (char *tok = strtok(arg, ","); tok; tok = strtok(NULL, ",")) {
+        char *endptr;
+        unsigned long v = strtoul(tok, &endptr, 10);
+        if (*endptr != '\0' || v < 1000 || v > 9999 || *count >= max) return -1;
+        out[(*count)++] = (uint32_t)v;
+    }
+    return *count > 0 ? 0 : -1;
+}
+
+static int parse_bbox(const char *arg, double box[4]) {
+    if (sscanf(arg, "%lf,%lf,%lf,%lf", &box[0], &box[1], &box[2], &box[3]) != 4) return -1;
+    // Accept the corners in either order
+    if (box[0] > box[2]) { double t = box[0]; box[0] = box[2]; box[2] = t; }
+    if (box[1] > box[3]) { double t = box[1]; box[1] = box[3]; box[3] = t; }
+    return 0;
+}
+
+// Center of a 1/2 mesh (9 digits: AABB C D E F S)
+//   1st mesh  lat AA / 1.5, lon BB + 100   (40' x 1 deg)
+//   2nd mesh  C, D in 0-7                  (5' x 7'30")
+//   3rd mesh  E, F in 0-9                  (30" x 45")
+//   1/2 mesh  S = 1 SW, 2 SE, 3 NW, 4 NE   (15" x 22.5")
+static void mesh_center(uint32_t mesh_id, double *lat, double *lon) {
+    const uint32_t s = mesh_id % 10;
+    const uint32_t f = mesh_id / 10 % 10;
+    const uint32_t e = mesh_id / 100 % 10;
+    const uint32_t d = mesh_id / 1000 % 10;
+    const uint32_t c = mesh_id / 10000 % 10;
+    const uint32_t bb = mesh_id / 100000 % 100;
+    const uint32_t aa = mesh_id / 10000000;
+
+    *lat = aa / 1.5 + c / 12.0 + e / 120.0 + (s >= 3 ? 1.0 / 240.0 : 0.0) + 1.0 / 480.0;
+    *lon = bb + 100.0 + d / 8.0 + f / 80.0 + (s % 2 == 0 ? 1.0 / 160.0 : 0.0) + 1.0 / 320.0;
+}
+
+// Mark the source columns of every mesh in the requested 1st meshes
+static int select_mesh1(struct h5mobaku *src, const uint32_t *src_ids, const uint32_t *mesh1,
+                        size_t num_mesh1, uint8_t *selected) {
+    cmph_t *hash = meshid_prepare_search();
+    if (!hash) {
+        fprintf(stderr, "Error: Failed to prepare mesh ID search\n");
+        return -1;
+    }
+
+    for (size_t i = 0; i < num_mesh1; i++) {
+        int *candidates = meshid_get_all_meshes_in_1st_mesh((int)mesh1[i], NUM_MESHES_1ST);
+        if (!candidates) {
+            cmph_destroy(hash);
+            return -1;
+        }
+        for (int k = 0; k < NUM_MESHES_1ST; k++) {
+            uint32_t id = (uint32_t)candidates[k];
+            uint32_t col = h5mobaku_mesh_index(src->h5r_ctx, hash, id);
+            // The compiled-in hash maps unknown keys to arbitrary columns
+            if (col != MESHID_NOT_FOUND && src_ids[col] == id) selected[col] = 1;
+        }
+        free(candidates);
+    }
+
+    cmph_destroy(hash);
+    return 0;
+}
+
+static void select_bbox(const uint32_t *src_ids, size_t num_cols, const double box[4], uint8_t *selected) {
+    for (size_t col = 0; col < num_cols; col++) {
+        double lat, lon;
+        mesh_center(src_ids[col], &lat, &lon);
+        if (lat >= box[0] && lat <= box[2] && lon >= box[1] && lon <= box[3]) selected[col] = 1;
+    }
+}
+
+// Turn the selection mask into contiguous runs and the output mesh list
+static h5r_block_t *build_blocks(const uint8_t *selected, const uint32_t *src_ids, size_t num_cols,
+                                 size_t *nblk, uint32_t **out_ids, size_t *width) {
+    size_t count = 0, runs = 0;
+    for (size_t col = 0; col < num_cols; col++) {
+        if (!selected[col]) continue;
+        count++;
+        if (col == 0 || !selected[col - 1]) runs++;
+    }
+    if (count == 0) {
+        fprintf(stderr, "Error: No meshes of the source file match the selection\n");
+        return NULL;
+    }
+
+    h5r_block_t *blocks = malloc(runs * sizeof(h5r_block_t));
+    uint32_t *ids = malloc(count * sizeof(uint32_t));
+    if (!blocks || !ids) {
+        fprintf(stderr, "Error: Memory allocation failed for column runs\n");
+        free(blocks);
+        free(ids);
+        return NULL;
+    }
+
+    size_t b = 0, m = 0;
+    for (size_t col = 0; col < num_cols; col++) {
+        if (!selected[col]) continue;
+        if (col == 0 || !selected[col - 1]) {
+            blocks[b++] = (h5r_block_t){.dcol0 = col, .mcol0 = m, .ncols = 0};
+        }
+        blocks[b - 1].ncols++;
+        ids[m++] = src_ids[col];
+    }
+
+    *nblk = runs;
+    *out_ids = ids;
+    *width = count;
+    return blocks;
+}
+
+// Restrict the column runs to output columns [m0, m0 + ncols), renumbered from 0
+static size_t slice_blocks(const h5r_block_t *blocks, size_t nblk, uint64_t m0, uint64_t ncols, h5r_block_t *out) {
+    size_t n = 0;
+    for (size_t i = 0; i < nblk; i++) {
+        const uint64_t lo = blocks[i].mcol0 > m0 ? blocks[i].mcol0 : m0;
+        const uint64_t hi = blocks[i].mcol0 + blocks[i].ncols < m0 + ncols ? blocks[i].mcol0 + blocks[i].ncols
+                                                                           : m0 + ncols;
+        if (lo >= hi) continue;
+        out[n++] = (h5r_block_t){.dcol0 = blocks[i].dcol0 + (lo - blocks[i].mcol0), .mcol0 = lo - m0, .ncols = hi - lo};
+    }
+    return n;
+}
+
+// Write a group of output columns chunk by chunk (nrows is at most one chunk-row)
+static int write_group(struct h5mobaku *dst, const int32_t *band, uint64_t nrows, uint64_t group_width,
+                       uint64_t row0, uint64_t m0, uint64_t chunk_cols, int32_t *tile) {
+    for (uint64_t c = 0; c < group_width; c += chunk_cols) {
+        const uint64_t ncols = c + chunk_cols <= group_width ? chunk_cols : group_width - c;
+        for (uint64_t r = 0; r < nrows; r++) {
+            memcpy(tile + r * chunk_cols, band + r * group_width + c, ncols * sizeof(int32_t));
+        }
+        if (h5r_write_chunk(dst->h5r_ctx, row0, m0 + c, nrows, tile) < 0) return -1;
+    }
+    return 0;
+}
+
+// Copy the selected columns band by band, group_width output columns at a time
+static int copy_bands(struct h5mobaku *src, struct h5mobaku *dst, const h5r_block_t *blocks, size_t nblk,
+                      uint64_t width, uint64_t num_rows, uint64_t band_rows, uint64_t group_width,
+                      uint64_t chunk_cols, int verbose) {
+    int32_t *band = malloc(band_rows * group_width * sizeof(int32_t));
+    int32_t *tile = group_width < width ? calloc(band_rows * chunk_cols, sizeof(int32_t)) : NULL;
+    h5r_block_t *group = malloc(nblk * sizeof(h5r_block_t));
+    if (!band || !group || (group_width < width && !tile)) {
+        fprintf(stderr, "Error: Memory allocation failed for band buffer\n");
+        free(band);
+        free(tile);
+        free(group);
+        return -1;
+    }
+
+    int ret = 0;
+    for (uint64_t row0 = 0; row0 < num_rows && ret == 0; row0 += band_rows) {
+        const uint64_t nrows = row0 + band_rows <= num_rows ? band_rows : num_rows - row0;
+        for (uint64_t m0 = 0; m0 < width && ret == 0; m0 += group_width) {
+            const uint64_t ncols = m0 + group_width <= width ? group_width : width - m0;
+            const size_t ngroup = slice_blocks(blocks, nblk, m0, ncols, group);
+            if (h5r_read_blocks_union(src->h5r_ctx, row0, nrows, group, ngroup, band, ncols) < 0) {
+                fprintf(stderr, "Error: Failed to read rows %lu-%lu\n",
+                        (unsigned long)row0, (unsigned long)(row0 + nrows - 1));
+                ret = -1;
+            } else if (ncols == width ? h5r_write_bulk_buffer(dst->h5r_ctx, band, nrows, width, row0) < 0
+                                      : write_group(dst, band, nrows, ncols, row0, m0, chunk_cols, tile) < 0) {
+                fprintf(stderr, "Error: Failed to write rows %lu-%lu\n",
+                        (unsigned long)row0, (unsigned long)(row0 + nrows - 1));
+                ret = -1;
+            }
+        }
+        if (verbose) {
+            fprintf(stderr, "\r[%lu/%lu] rows", (unsigned long)(row0 + nrows), (unsigned long)num_rows);
+        }
+    }
+
+    free(band);
+    free(tile);
+    free(group);
+    return ret;
+}
+
+// New files start at the reference datetime; carry over the source's start instead
+static int copy_start_datetime(const char *path, const char *datetime) {
+    if (strcmp(datetime, REFERENCE_MOBAKU_DATETIME) == 0) return 0;
+
+    hid_t file = H5Fopen(path, H5F_ACC_RDWR, H5P_DEFAULT);
+    if (file < 0) return -1;
+    hid_t dset = H5Dopen2(file, "population_data", H5P_DEFAULT);
+    if (dset < 0) {
+        H5Fclose(file);
+        return -1;
+    }
+
+    hid_t str_type = H5Tcopy(H5T_C_S1);
+    H5Tset_size(str_type, H5T_VARIABLE);
+    H5Tset_strpad(str_type, H5T_STR_NULLTERM);
+    H5Tset_cset(str_type, H5T_CSET_UTF8);
+
+    int ret = -1;
+    hid_t attr = H5Aopen(dset, "start_datetime", H5P_DEFAULT);
+    if (attr >= 0) {
+        ret = H5Awrite(attr, str_type, &datetime) < 0 ? -1 : 0;
+        H5Aclose(attr);
+    }
+
+    H5Tclose(str_type);
+    H5Dclose(dset);
+    H5Fclose(file);
+    return ret;
+}
+
+int main(int argc, char *argv[]) {
+    const char *hdf5_file = NULL;
+    const char *output_file = NULL;
+    uint32_t mesh1_filter[MAX_MESH1_FILTER];
+    size_t num_mesh1_filter = 0;
+    double bbox[4];
+    int has_bbox = 0;
+    long chunk_mesh = HDF5_MESH_CHUNK;
+    long memory_mb = DEFAULT_MEMORY_MB;
+    int verbose = 0;
+    int opt;
+
+    static struct option long_options[] = {
+        {"file",       required_argument, 0, 'f'},
+        {"output",     required_argument, 0, 'o'},
+        {"mesh1",      required_argument, 0, 'm'},
+        {"bbox",       required_argument, 0, 'b'},
+        {"chunk-mesh", required_argument, 0, 'c'},
+        {"memory",     required_argument, 0, 'M'},
+        {"verbose",    no_argument,       0, 'v'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "f:o:m:b:c:M:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                hdf5_file = optarg;
+                break;
+            case 'o':
+                output_file = optarg;
+                break;
+            case 'm':
+                if (parse_mesh1_list(optarg, mesh1_filter, MAX_MESH1_FILTER, &num_mesh1_filter) < 0) {
+                    fprintf(stderr, "Error: Invalid 1st mesh list\n");
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (parse_bbox(optarg, bbox) < 0) {
+                    fprintf(stderr, "Error: Invalid bounding box, expected lat0,lon0,lat1,lon1\n");
+                    return 1;
+                }
+                has_bbox = 1;
+                break;
+            case 'c':
+                chunk_mesh = atol(optarg);
+                break;
+            case 'M':
+                memory_mb = atol(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (!hdf5_file || !output_file) {
+        fprintf(stderr, "Error: Source file (-f) and output file (-o) are required\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if ((num_mesh1_filter > 0) == has_bbox) {
+        fprintf(stderr, "Error: Specify exactly one of -m and -b\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (chunk_mesh < 1 || memory_mb < 1) {
+        fprintf(stderr, "Error: Chunk width and memory budget must be positive\n");
+        return 1;
+    }
+
+    struct h5mobaku *src = NULL;
+    if (h5mobaku_open(hdf5_file, &src) != 0) {
+        fprintf(stderr, "Error: Failed to open HDF5 file: %s\n", hdf5_file);
+        return 1;
+    }
+
+    h5r_metadata_t meta;
+    h5r_get_metadata(src->h5r_ctx, &meta);
+    if (meta.rows == 0 || meta.cols == 0) {
+        fprintf(stderr, "Error: Source dataset is empty\n");
+        h5mobaku_close(src);
+        return 1;
+    }
+
+    // Column order of the source: its stored list, or the compiled-in one for old files
+    uint32_t *stored_ids = NULL;
+    const uint32_t *src_ids = meshid_list;
+    if (meta.has_meshid_list) {
+        size_t count = 0;
+        if (h5r_read_meshid_list(src->h5r_ctx, &stored_ids, &count) < 0 || count != meta.cols) {
+            fprintf(stderr, "Error: Failed to read meshid_list of %s\n", hdf5_file);
+            free(stored_ids);
+            h5mobaku_close(src);
+            return 1;
+        }
+        src_ids = stored_ids;
+    } else if (meta.cols != meshid_list_size) {
+        fprintf(stderr, "Error: Dataset has %lu mesh columns but no meshid_list\n", (unsigned long)meta.cols);
+        h5mobaku_close(src);
+        return 1;
+    }
+
+    uint8_t *selected = calloc(meta.cols, 1);
+    int ret = selected ? 0 : -1;
+    if (ret == 0 && num_mesh1_filter > 0) {
+        ret = select_mesh1(src, src_ids, mesh1_filter, num_mesh1_filter, selected);
+    } else if (ret == 0) {
+        select_bbox(src_ids, meta.cols, bbox, selected);
+    }
+
+    size_t nblk = 0, width = 0;
+    uint32_t *out_ids = NULL;
+    h5r_block_t *blocks = ret == 0 ? build_blocks(selected, src_ids, meta.cols, &nblk, &out_ids, &width) : NULL;
+    free(selected);
+    free(stored_ids);
+    if (!blocks) {
+        h5mobaku_close(src);
+        return 1;
+    }
+
+    // Keep the chunk size in bytes of the source and trade width for time: a narrow
+    // file gets longer chunks, rounded to whole source chunks where possible
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    const uint64_t crows = meta.crows ? meta.crows : HDF5_DATETIME_CHUNK;
+    const uint64_t chunk_elems = crows * (meta.ccols ? meta.ccols : HDF5_MESH_CHUNK);
+    config.chunk_mesh_size = (size_t)chunk_mesh < width ? (size_t)chunk_mesh : width;
+    uint64_t chunk_time = chunk_elems / config.chunk_mesh_size;
+    if (chunk_time >= crows) chunk_time = chunk_time / crows * crows;
+    config.chunk_time_size = chunk_time > 0 ? chunk_time : 1;
+    config.initial_time_points = meta.rows;
+
+    struct h5mobaku *dst = NULL;
+    if (h5mobaku_create_with_meshes(output_file, &config, out_ids, width, &dst) != 0) {
+        fprintf(stderr, "Error: Failed to create output file: %s\n", output_file);
+        free(out_ids);
+        free(blocks);
+        h5mobaku_close(src);
+        return 1;
+    }
+    free(out_ids);
+
+    // Bands are whole output chunks sized to the memory budget. If one chunk-row of the
+    // selection is over budget, bands are one chunk-row tall and copied in groups of whole
+    // chunk columns, next to a one-chunk staging tile
+    const uint64_t budget = (uint64_t)memory_mb * 1024 * 1024;
+    const uint64_t chunk_rows = config.chunk_time_size < meta.rows ? config.chunk_time_size : meta.rows;
+    uint64_t band_rows, group_width = width;
+    if (chunk_rows * width * sizeof(int32_t) <= budget) {
+        band_rows = budget / (width * sizeof(int32_t)) / config.chunk_time_size * config.chunk_time_size;
+        if (band_rows < chunk_rows) band_rows = chunk_rows;
+        if (band_rows > meta.rows) band_rows = meta.rows;
+    } else {
+        const uint64_t tile_bytes = chunk_rows * config.chunk_mesh_size * sizeof(int32_t);
+        band_rows = chunk_rows;
+        group_width = tile_bytes < budget ? (budget - tile_bytes) / (chunk_rows * sizeof(int32_t)) : 0;
+        group_width = group_width / config.chunk_mesh_size * config.chunk_mesh_size;
+        if (group_width == 0) {
+            fprintf(stderr, "Error: Memory budget of %ld MiB is below two output chunks (%lu KiB each); "
+                            "raise -M or lower -c\n", memory_mb, (unsigned long)(tile_bytes / 1024));
+            free(blocks);
+            h5mobaku_close(dst);
+            h5mobaku_close(src);
+            unlink(output_file);
+            return 1;
+        }
+    }
+
+    if (verbose) {
+        fprintf(stderr, "Extracting %zu meshes in %zu column runs, chunk %zux%zu, %lu rows x %lu meshes per band\n",
+                width, nblk, config.chunk_time_size, config.chunk_mesh_size, (unsigned long)band_rows,
+                (unsigned long)group_width);
+    }
+
+    TIC(extract);
+    int failed = copy_bands(src, dst, blocks, nblk, width, meta.rows, band_rows, group_width,
+                            config.chunk_mesh_size, verbose) < 0;
+    TOC(extract);
+
+    if (!failed && h5mobaku_flush(dst) != 0) failed = 1;
+    if (verbose) fprintf(stderr, "\n");
+
+    free(blocks);
+    h5mobaku_close(dst);
+
+    if (!failed && copy_start_datetime(output_file, src->start_datetime_str ? src->start_datetime_str
+                                                                             : REFERENCE_MOBAKU_DATETIME) < 0) {
+        fprintf(stderr, "Error: Failed to set start_datetime of %s\n", output_file);
+        failed = 1;
+    }
+    h5mobaku_close(src);
+
+    if (failed) {
+        unlink(output_file);
+        return 1;
+    }
+    if (verbose) fprintf(stderr, "Wrote %zu meshes to %s\n", width, output_file);
+    return 0;
+}
@@ -1,15 +1,83 @@
 //
 // Created by ryuzot on 25/06/04.
 //
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <getopt.h>
 #include <time.h>
+#include <errno.h>
+#include <unistd.h>
 #include "h5mobaku_ops.h"
 #include "meshid_ops.h"
+#include "h5m_output.h"
 
 #define MAX_DATE_LEN 20
+#define BATCH_BLOCK_MAX_VALUES (32u * 1024 * 1024)  // Result cells planned and held per block
+#define BATCH_BLOCK_MAX_QUERIES 65536
+
+typedef enum {
+    BATCH_FORMAT_CSV,
+    BATCH_FORMAT_NDJSON,
+    BATCH_FORMAT_RAW
+} batch_format_t;
+
+typedef enum {
+    BATCH_AGG_NONE,
+    BATCH_AGG_SUM,
+    BATCH_AGG_MIN,
+    BATCH_AGG_MAX
+} batch_agg_t;
+
+static const char *batch_agg_names[] = {"none", "sum", "min", "max"};
+
+// Raw batch output frames every query, failed ones included, with this header (host byte order)
+// followed by `length` bytes of payload: num_series series of num_times values each
+typedef enum {
+    BATCH_RAW_NONE = 0,      // Failed query, no payload
+    BATCH_RAW_UINT32 = 1,    // One uint32 series per listed mesh
+    BATCH_RAW_INT64 = 2      // One int64 aggregate series
+} batch_raw_type_t;
+
+typedef struct {
+    uint32_t query;          // Query number
+    uint16_t status;         // 0 ok, 1 failed
+    uint16_t type;           // batch_raw_type_t
+    uint32_t num_series;
+    uint32_t num_times;
+    uint64_t length;
+} batch_raw_frame_t;
+
+typedef struct {
+    size_t query_no;         // Position in the input stream
+    uint32_t *mesh_ids;
+    size_t num_meshes;
+    int start_idx;
+    int end_idx;
+    batch_agg_t agg;
+    size_t group;            // Read group this query is served from
+    size_t *cols;            // Column of each mesh in the group result
+    int failed;
+} batch_query_t;
+
+// Queries sharing a time range are answered by one multi-mesh read
+typedef struct {
+    int start_idx;
+    int end_idx;
+    uint32_t *mesh_ids;      // Sorted, deduplicated union of the queries' meshes
+    size_t num_meshes;
+    int32_t *data;           // data[t * num_meshes + m]
+} batch_group_t;
+
+typedef struct {
+    struct h5mobaku *ctx;
+    cmph_t *hash;
+    batch_format_t format;
+    h5m_output_t *out;
+    size_t num_queries;
+    size_t num_errors;
+} batch_state_t;
 
 static void print_usage(const char *prog_name) {
     fprintf(stderr, "Usage: %s -f <hdf5_file> -m <mesh_id> [-t <datetime>] [-s <start_datetime> -e <end_datetime>] [-r]\n", prog_name);
@@ -20,7 +88,13 @@ static void print_usage(const char *prog_name) {
     fprintf(stderr, "  -s, --start <datetime>   Start datetime for range query\n");
     fprintf(stderr, "  -e, --end <datetime>     End datetime for range query\n");
     fprintf(stderr, "  -r, --raw                Output raw uint32 byte stream (for piping; test by piping to 'od -An -t u4' for human)\n");
+    fprintf(stderr, "  -b, --batch <file|->     Read queries from a file or stdin (see below)\n");
+    fprintf(stderr, "  -o, --format <fmt>       Batch output format: csv (default), ndjson or raw\n");
     fprintf(stderr, "  -h, --help               Show this help message\n");
+    fprintf(stderr, "\nBatch query lines (one per line, '#' starts a comment):\n");
+    fprintf(stderr, "  <mesh_id>[;<mesh_id>...],<datetime>[,<end_datetime>][,sum|min|max]\n");
+    fprintf(stderr, "  Aggregates combine the listed meshes for each hour.\n");
+    fprintf(stderr, "  Raw output frames each query with a 24-byte header (query, status, type, series, hours, length).\n");
     fprintf(stderr, "\nExamples:\n");
     fprintf(stderr, "  Single time query:\n");
     fprintf(stderr, "    %s -f data.h5 -m 533946395 -t \"2016-01-01 12:00:00\"\n", prog_name);
@@ -28,38 +102,511 @@ static void print_usage(const char *prog_name) {
     fprintf(stderr, "    %s -f data.h5 -m 533946395 -s \"2016-01-01 00:00:00\" -e \"2016-01-01 23:00:00\"\n", prog_name);
     fprintf(stderr, "  Raw output for piping:\n");
     fprintf(stderr, "    %s -f data.h5 -m 533946395 -s \"2016-01-01 00:00:00\" -e \"2016-01-01 01:00:00\" -r | external_analysis_program \n", prog_name);
+    fprintf(stderr, "  Batch queries from stdin as NDJSON:\n");
+    fprintf(stderr, "    printf '533946395;533946396,2016-01-01 00:00:00,2016-01-01 23:00:00,sum\\n' | %s -f data.h5 -b - -o ndjson\n", prog_name);
+}
+
+// 2016-01-01 00:00:00 local time, the origin of meshid_get_time_index_from_datetime
+static time_t reference_time(void) {
+    struct tm tm = {0};
+    tm.tm_year = 2016 - 1900;
+    tm.tm_mday = 1;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+#define TABLE_RULE "+------------+---------------------+------------+\n"
+
+static void print_table_header(h5m_output_t *out) {
+    h5m_output_put_str(out, "\n" TABLE_RULE "| Mesh ID    | Datetime            | Population |\n" TABLE_RULE);
+}
+
+static void print_table_row_single(h5m_output_t *out, uint32_t mesh_id, const char *datetime, int32_t population) {
+    char line[96];
+    int len = snprintf(line, sizeof(line), "| %-10u | %-19s | %10d |\n", mesh_id, datetime, population);
+    h5m_output_write(out, line, (size_t)len);
+}
+
+static void print_table_row_range(h5m_output_t *out, uint32_t mesh_id, const h5m_datetime_cursor_t *datetime,
+                                  int32_t population) {
+    h5m_output_put_str(out, "| ");
+    h5m_output_put_int64_padded(out, mesh_id, 10, 1);
+    h5m_output_put_str(out, " | ");
+    h5m_output_put_datetime(out, datetime);
+    h5m_output_put_str(out, " | ");
+    h5m_output_put_int64_padded(out, population, 10, 0);
+    h5m_output_put_str(out, " |\n");
+}
+
+static void print_table_footer_single(h5m_output_t *out) {
+    h5m_output_put_str(out, TABLE_RULE);
+}
+
+static void print_table_footer_range(h5m_output_t *out, int count) {
+    h5m_output_put_str(out, TABLE_RULE "| Total records: ");
+    h5m_output_put_int64_padded(out, count, 30, 1);
+    h5m_output_put_str(out, " |\n" TABLE_RULE);
+}
+
+/* ===============================================
+ *  Batch mode
+ * =============================================== */
+
+// Hours since the file's start datetime, same rule as the *_at_time library functions
+static int batch_datetime_to_index(struct h5mobaku *ctx, const char *datetime_str) {
+    struct tm tm = {0};
+    const char *end = strptime(datetime_str, "%Y-%m-%d %H:%M:%S", &tm);
+    if (end == NULL || *end != '\0') return -1;
+    time_t t = mktime(&tm);
+    if (t == (time_t)-1) return -1;
+    int index = (int)(difftime(t, ctx->start_datetime) / 3600.0);
+    return index < 0 ? -1 : index;
+}
+
+static void batch_cursor_at(struct h5mobaku *ctx, int time_index, h5m_datetime_cursor_t *cursor) {
+    h5m_datetime_cursor_init(cursor, ctx->start_datetime + (time_t)time_index * 3600);
+}
+
+static char *trim(char *str) {
+    while (*str == ' ' || *str == '\t') str++;
+    char *end = str + strlen(str);
+    while (end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+    *end = '\0';
+    return str;
+}
+
+static batch_agg_t parse_agg(const char *str) {
+    for (int i = BATCH_AGG_SUM; i <= BATCH_AGG_MAX; i++) {
+        if (strcmp(str, batch_agg_names[i]) == 0) return (batch_agg_t)i;
+    }
+    return BATCH_AGG_NONE;
+}
+
+// Returns 0 on success, -1 for a malformed line
+static int parse_batch_line(batch_state_t *st, char *line, batch_query_t *q) {
+    char *fields[4];
+    int nfields = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(line, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+        if (nfields == 4) return -1;
+        fields[nfields++] = trim(tok);
+    }
+    if (nfields < 2) return -1;
+
+    memset(q, 0, sizeof(*q));
+    if (nfields >= 3 && parse_agg(fields[nfields - 1]) != BATCH_AGG_NONE) {
+        q->agg = parse_agg(fields[--nfields]);
+    }
+    if (nfields > 3) return -1;
+
+    q->start_idx = batch_datetime_to_index(st->ctx, fields[1]);
+    q->end_idx = nfields == 3 ? batch_datetime_to_index(st->ctx, fields[2]) : q->start_idx;
+    if (q->start_idx < 0 || q->end_idx < q->start_idx) return -1;
+
+    size_t cap = 1;
+    for (const char *p = fields[0]; *p; p++) if (*p == ';') cap++;
+    q->mesh_ids = malloc(cap * sizeof(uint32_t));
+    if (!q->mesh_ids) return -1;
+    char *msave = NULL;
+    for (char *tok = strtok_r(fields[0], ";", &msave); tok; tok = strtok_r(NULL, ";", &msave)) {
+        char *endptr;
+        errno = 0;
+        unsigned long id = strtoul(trim(tok), &endptr, 10);
+        if (errno || *endptr != '\0' || id == 0 || id > UINT32_MAX) {
+            free(q->mesh_ids);
+            q->mesh_ids = NULL;
+            return -1;
+        }
+        q->mesh_ids[q->num_meshes++] = (uint32_t)id;
+    }
+    if (q->num_meshes == 0) {
+        free(q->mesh_ids);
+        q->mesh_ids = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int compare_uint32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return (x > y) - (x < y);
+}
+
+static const batch_query_t *g_sort_queries;
+
+static int compare_query_range(const void *a, const void *b) {
+    const batch_query_t *x = &g_sort_queries[*(const size_t*)a];
+    const batch_query_t *y = &g_sort_queries[*(const size_t*)b];
+    if (x->start_idx != y->start_idx) return x->start_idx < y->start_idx ? -1 : 1;
+    if (x->end_idx != y->end_idx) return x->end_idx < y->end_idx ? -1 : 1;
+    return 0;
+}
+
+static int is_known_mesh(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id) {
+    uint32_t idx = h5mobaku_mesh_index(ctx->h5r_ctx, hash, mesh_id);
+    if (idx == MESHID_NOT_FOUND) return 0;
+    // A file-specific table is exact; the compiled-in hash maps unknown IDs to arbitrary slots
+    return h5r_get_mesh_dict(ctx->h5r_ctx) != NULL || meshid_list[idx] == mesh_id;
+}
+
+static void emit_csv_header(h5m_output_t *out) {
+    h5m_output_put_str(out, "query,mesh_id,datetime,population\n");
+}
+
+static void emit_ndjson_prefix(h5m_output_t *out, size_t query_no) {
+    h5m_output_put_str(out, "{\"query\":");
+    h5m_output_put_uint64(out, query_no);
+}
+
+static void emit_ndjson_start(h5m_output_t *out, const h5m_datetime_cursor_t *cursor) {
+    h5m_output_put_str(out, ",\"start\":\"");
+    h5m_output_put_datetime(out, cursor);
+    h5m_output_put_str(out, "\",\"values\":[");
+}
+
+static void emit_raw_frame(h5m_output_t *out, size_t query_no, batch_raw_type_t type, size_t num_series,
+                           size_t num_times, size_t value_size) {
+    const batch_raw_frame_t frame = {
+        .query = (uint32_t)query_no,
+        .status = type == BATCH_RAW_NONE,
+        .type = (uint16_t)type,
+        .num_series = (uint32_t)num_series,
+        .num_times = (uint32_t)num_times,
+        .length = (uint64_t)num_series * num_times * value_size,
+    };
+    h5m_output_write(out, &frame, sizeof(frame));
 }
 
-static void print_table_header_single() {
-    printf("\n");
-    printf("+------------+---------------------+------------+\n");
-    printf("| Mesh ID    | Datetime            | Population |\n");
-    printf("+------------+---------------------+------------+\n");
+// Failed queries are counted, and still framed in raw and NDJSON output so readers stay aligned
+static void emit_failure(batch_state_t *st, size_t query_no) {
+    st->num_errors++;
+    if (st->format == BATCH_FORMAT_RAW) {
+        emit_raw_frame(st->out, query_no, BATCH_RAW_NONE, 0, 0, 0);
+    } else if (st->format == BATCH_FORMAT_NDJSON) {
+        emit_ndjson_prefix(st->out, query_no);
+        h5m_output_put_str(st->out, ",\"error\":true}\n");
+    }
 }
 
-static void print_table_row_single(uint32_t mesh_id, const char *datetime, int32_t population) {
-    printf("| %-10u | %-19s | %10d |\n", mesh_id, datetime, population);
+static void emit_query(batch_state_t *st, const batch_query_t *q, const batch_group_t *g) {
+    const size_t num_times = (size_t)(q->end_idx - q->start_idx + 1);
+    h5m_output_t *out = st->out;
+    h5m_datetime_cursor_t cursor;
+
+    if (q->agg != BATCH_AGG_NONE) {
+        int64_t *values = malloc(num_times * sizeof(int64_t));
+        if (!values) {
+            fprintf(stderr, "Error: query %zu: memory allocation failed\n", q->query_no);
+            emit_failure(st, q->query_no);
+            return;
+        }
+        for (size_t t = 0; t < num_times; t++) {
+            const int32_t *row = g->data + t * g->num_meshes;
+            int64_t acc = row[q->cols[0]];
+            for (size_t m = 1; m < q->num_meshes; m++) {
+                int32_t v = row[q->cols[m]];
+                if (q->agg == BATCH_AGG_SUM) acc += v;
+                else if (q->agg == BATCH_AGG_MIN && v < acc) acc = v;
+                else if (q->agg == BATCH_AGG_MAX && v > acc) acc = v;
+            }
+            values[t] = acc;
+        }
+
+        batch_cursor_at(st->ctx, q->start_idx, &cursor);
+        switch (st->format) {
+            case BATCH_FORMAT_RAW:
+                emit_raw_frame(out, q->query_no, BATCH_RAW_INT64, 1, num_times, sizeof(int64_t));
+                h5m_output_write(out, values, num_times * sizeof(int64_t));
+                break;
+            case BATCH_FORMAT_CSV:
+                for (size_t t = 0; t < num_times; t++) {
+                    h5m_output_put_uint64(out, q->query_no);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_str(out, batch_agg_names[q->agg]);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_datetime(out, &cursor);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_int64(out, values[t]);
+                    h5m_output_put_char(out, '\n');
+                    h5m_datetime_cursor_advance(&cursor);
+                }
+                break;
+            case BATCH_FORMAT_NDJSON:
+                emit_ndjson_prefix(out, q->query_no);
+                h5m_output_put_str(out, ",\"agg\":\"");
+                h5m_output_put_str(out, batch_agg_names[q->agg]);
+                h5m_output_put_str(out, "\",\"mesh_ids\":[");
+                for (size_t m = 0; m < q->num_meshes; m++) {
+                    if (m) h5m_output_put_char(out, ',');
+                    h5m_output_put_uint64(out, q->mesh_ids[m]);
+                }
+                h5m_output_put_char(out, ']');
+                emit_ndjson_start(out, &cursor);
+                for (size_t t = 0; t < num_times; t++) {
+                    if (t) h5m_output_put_char(out, ',');
+                    h5m_output_put_int64(out, values[t]);
+                }
+                h5m_output_put_str(out, "]}\n");
+                break;
+        }
+        free(values);
+        return;
+    }
+
+    // One series per mesh, in the order the meshes were listed
+    if (st->format == BATCH_FORMAT_RAW) {
+        emit_raw_frame(out, q->query_no, BATCH_RAW_UINT32, q->num_meshes, num_times, sizeof(uint32_t));
+    }
+    for (size_t m = 0; m < q->num_meshes; m++) {
+        const int32_t *col = g->data + q->cols[m];
+        batch_cursor_at(st->ctx, q->start_idx, &cursor);
+        switch (st->format) {
+            case BATCH_FORMAT_RAW:
+                if (g->num_meshes == 1) {
+                    h5m_output_write(out, col, num_times * sizeof(int32_t));
+                    break;
+                }
+                for (size_t t = 0; t < num_times; t++) {
+                    uint32_t raw_value = (uint32_t)col[t * g->num_meshes];
+                    h5m_output_write(out, &raw_value, sizeof(uint32_t));
+                }
+                break;
+            case BATCH_FORMAT_CSV:
+                for (size_t t = 0; t < num_times; t++) {
+                    h5m_output_put_uint64(out, q->query_no);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_uint64(out, q->mesh_ids[m]);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_datetime(out, &cursor);
+                    h5m_output_put_char(out, ',');
+                    h5m_output_put_int64(out, col[t * g->num_meshes]);
+                    h5m_output_put_char(out, '\n');
+                    h5m_datetime_cursor_advance(&cursor);
+                }
+                break;
+            case BATCH_FORMAT_NDJSON:
+                emit_ndjson_prefix(out, q->query_no);
+                h5m_output_put_str(out, ",\"mesh_id\":");
+                h5m_output_put_uint64(out, q->mesh_ids[m]);
+                emit_ndjson_start(out, &cursor);
+                for (size_t t = 0; t < num_times; t++) {
+                    if (t) h5m_output_put_char(out, ',');
+                    h5m_output_put_int64(out, col[t * g->num_meshes]);
+                }
+                h5m_output_put_str(out, "]}\n");
+                break;
+        }
+    }
 }
 
-static void print_table_footer_single() {
-    printf("+------------+---------------------+------------+\n");
+// Plan a block of queries into per-range groups, read each group once and emit in input order
+static void run_batch_block(batch_state_t *st, batch_query_t *queries, size_t nq) {
+    size_t *order = malloc(nq * sizeof(size_t));
+    batch_group_t *groups = calloc(nq, sizeof(batch_group_t));
+    if (!order || !groups) {
+        fprintf(stderr, "Error: Memory allocation failed for batch plan\n");
+        st->num_errors += nq;
+        free(order);
+        free(groups);
+        return;
+    }
+    for (size_t i = 0; i < nq; i++) order[i] = i;
+    g_sort_queries = queries;
+    qsort(order, nq, sizeof(size_t), compare_query_range);
+
+    size_t ngroups = 0;
+    for (size_t i = 0; i < nq;) {
+        size_t j = i;
+        size_t total = 0;
+        while (j < nq && compare_query_range(&order[i], &order[j]) == 0) {
+            total += queries[order[j]].num_meshes;
+            j++;
+        }
+
+        batch_group_t *g = &groups[ngroups];
+        g->start_idx = queries[order[i]].start_idx;
+        g->end_idx = queries[order[i]].end_idx;
+        g->mesh_ids = malloc(total * sizeof(uint32_t));
+        for (size_t k = i; k < j; k++) {
+            batch_query_t *q = &queries[order[k]];
+            q->group = ngroups;
+            if (!g->mesh_ids) {
+                q->failed = 1;
+                continue;
+            }
+            for (size_t m = 0; m < q->num_meshes; m++) {
+                if (!is_known_mesh(st->ctx, st->hash, q->mesh_ids[m])) {
+                    fprintf(stderr, "Error: query %zu: mesh ID %u not found\n", q->query_no, q->mesh_ids[m]);
+                    q->failed = 1;
+                    break;
+                }
+            }
+            if (q->failed) continue;
+            memcpy(g->mesh_ids + g->num_meshes, q->mesh_ids, q->num_meshes * sizeof(uint32_t));
+            g->num_meshes += q->num_meshes;
+        }
+
+        if (g->num_meshes > 0) {
+            qsort(g->mesh_ids, g->num_meshes, sizeof(uint32_t), compare_uint32);
+            size_t u = 1;
+            for (size_t m = 1; m < g->num_meshes; m++) {
+                if (g->mesh_ids[m] != g->mesh_ids[u - 1]) g->mesh_ids[u++] = g->mesh_ids[m];
+            }
+            g->num_meshes = u;
+            g->data = h5mobaku_read_multi_mesh_time_series(st->ctx->h5r_ctx, st->hash, g->mesh_ids, g->num_meshes,
+                                                           g->start_idx, g->end_idx);
+        }
+
+        for (size_t k = i; k < j; k++) {
+            batch_query_t *q = &queries[order[k]];
+            if (q->failed) continue;
+            if (!g->data) {
+                fprintf(stderr, "Error: query %zu: failed to read population data\n", q->query_no);
+                q->failed = 1;
+                continue;
+            }
+            q->cols = malloc(q->num_meshes * sizeof(size_t));
+            if (!q->cols) {
+                q->failed = 1;
+                continue;
+            }
+            for (size_t m = 0; m < q->num_meshes; m++) {
+                const uint32_t *hit = bsearch(&q->mesh_ids[m], g->mesh_ids, g->num_meshes,
+                                              sizeof(uint32_t), compare_uint32);
+                q->cols[m] = (size_t)(hit - g->mesh_ids);
+            }
+        }
+        ngroups++;
+        i = j;
+    }
+
+    for (size_t i = 0; i < nq; i++) {
+        if (queries[i].failed) {
+            emit_failure(st, queries[i].query_no);
+            continue;
+        }
+        emit_query(st, &queries[i], &groups[queries[i].group]);
+    }
+
+    for (size_t i = 0; i < ngroups; i++) {
+        free(groups[i].mesh_ids);
+        h5mobaku_free_data(groups[i].data);
+    }
+    free(groups);
+    free(order);
 }
 
-static void print_table_header_range() {
-    printf("\n");
-    printf("+------------+---------------------+------------+\n");
-    printf("| Mesh ID    | Datetime            | Population |\n");
-    printf("+------------+---------------------+------------+\n");
+static void free_batch_queries(batch_query_t *queries, size_t nq) {
+    for (size_t i = 0; i < nq; i++) {
+        free(queries[i].mesh_ids);
+        free(queries[i].cols);
+    }
 }
 
-static void print_table_row_range(uint32_t mesh_id, const char *datetime, int32_t population) {
-    printf("| %-10u | %-19s | %10d |\n", mesh_id, datetime, population);
+// Stream queries from `input`, planning them in blocks bounded by BATCH_BLOCK_MAX_VALUES
+static int run_batch(batch_state_t *st, FILE *input) {
+    batch_query_t *queries = malloc(BATCH_BLOCK_MAX_QUERIES * sizeof(batch_query_t));
+    if (!queries) {
+        fprintf(stderr, "Error: Memory allocation failed for batch queries\n");
+        return -1;
+    }
+
+    if (st->format == BATCH_FORMAT_CSV) emit_csv_header(st->out);
+
+    size_t nq = 0, block_values = 0, line_no = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    while (getline(&line, &line_cap, input) != -1) {
+        line_no++;
+        char *text = trim(line);
+        if (*text == '\0' || *text == '#') continue;
+
+        // Malformed lines keep their query number and fail in place
+        batch_query_t q;
+        if (parse_batch_line(st, text, &q) < 0) {
+            fprintf(stderr, "Error: line %zu: invalid query\n", line_no);
+            memset(&q, 0, sizeof(q));
+            q.failed = 1;
+        }
+        q.query_no = st->num_queries++;
+
+        size_t values = q.num_meshes * (size_t)(q.end_idx - q.start_idx + 1);
+        if (nq > 0 && (nq == BATCH_BLOCK_MAX_QUERIES || block_values + values > BATCH_BLOCK_MAX_VALUES)) {
+            run_batch_block(st, queries, nq);
+            free_batch_queries(queries, nq);
+            nq = 0;
+            block_values = 0;
+        }
+        queries[nq++] = q;
+        block_values += values;
+    }
+    if (nq > 0) {
+        run_batch_block(st, queries, nq);
+        free_batch_queries(queries, nq);
+    }
+
+    free(line);
+    free(queries);
+    return 0;
 }
 
-static void print_table_footer_range(int count) {
-    printf("+------------+---------------------+------------+\n");
-    printf("| Total records: %-30d |\n", count);
-    printf("+------------+---------------------+------------+\n");
+static int run_batch_mode(const char *hdf5_file, const char *batch_input, const char *format_name, int raw_output) {
+    batch_state_t st = {.format = raw_output ? BATCH_FORMAT_RAW : BATCH_FORMAT_CSV};
+    if (format_name) {
+        if (strcmp(format_name, "csv") == 0) st.format = BATCH_FORMAT_CSV;
+        else if (strcmp(format_name, "ndjson") == 0) st.format = BATCH_FORMAT_NDJSON;
+        else if (strcmp(format_name, "raw") == 0) st.format = BATCH_FORMAT_RAW;
+        else {
+            fprintf(stderr, "Error: Unknown output format '%s'\n", format_name);
+            return 1;
+        }
+    }
+    if (!hdf5_file) {
+        fprintf(stderr, "Error: Missing required argument -f\n");
+        return 1;
+    }
+
+    FILE *input = strcmp(batch_input, "-") == 0 ? stdin : fopen(batch_input, "r");
+    if (!input) {
+        fprintf(stderr, "Error: Cannot open batch file %s: %s\n", batch_input, strerror(errno));
+        return 1;
+    }
+
+    if (h5mobaku_open(hdf5_file, &st.ctx) != 0) {
+        fprintf(stderr, "Error: Failed to open HDF5 file: %s\n", hdf5_file);
+        if (input != stdin) fclose(input);
+        return 1;
+    }
+    st.hash = meshid_prepare_search();
+    if (!st.hash) {
+        fprintf(stderr, "Error: Failed to prepare mesh ID search\n");
+        h5mobaku_close(st.ctx);
+        if (input != stdin) fclose(input);
+        return 1;
+    }
+
+    h5m_output_t out;
+    if (h5m_output_init(&out, STDOUT_FILENO, 0, st.format == BATCH_FORMAT_RAW ? H5M_OUTPUT_VMSPLICE : 0) != 0) {
+        cmph_destroy(st.hash);
+        h5mobaku_close(st.ctx);
+        if (input != stdin) fclose(input);
+        return 1;
+    }
+    st.out = &out;
+
+    int ret = run_batch(&st, input);
+    if (h5m_output_close(&out) != 0) {
+        fprintf(stderr, "Error: Failed to write output: %s\n", strerror(errno));
+        ret = -1;
+    }
+    if (st.num_errors > 0) {
+        fprintf(stderr, "%zu queries failed\n", st.num_errors);
+    }
+
+    cmph_destroy(st.hash);
+    h5mobaku_close(st.ctx);
+    if (input != stdin) fclose(input);
+    return (ret < 0 || st.num_errors > 0) ? 1 : 0;
 }
 
 int main(int argc, char *argv[]) {
@@ -69,6 +616,8 @@ int main(int argc, char *argv[]) {
     char *start_time = NULL;
     char *end_time = NULL;
     int raw_output = 0;
+    const char *batch_input = NULL;
+    const char *format_name = NULL;
     int opt;
     
     static struct option long_options[] = {
@@ -78,11 +627,13 @@ int main(int argc, char *argv[]) {
         {"start", required_argument, 0, 's'},
         {"end",   required_argument, 0, 'e'},
         {"raw",   no_argument,       0, 'r'},
+        {"batch", required_argument, 0, 'b'},
+        {"format", required_argument, 0, 'o'},
         {"help",  no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
     
-    while ((opt = getopt_long(argc, argv, "f:m:t:s:e:rh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "f:m:t:s:e:rb:o:h", long_options, NULL)) != -1) {
         switch (opt) {
             case 'f':
                 hdf5_file = optarg;
@@ -102,6 +653,12 @@ int main(int argc, char *argv[]) {
             case 'r':
                 raw_output = 1;
                 break;
+            case 'b':
+                batch_input = optarg;
+                break;
+            case 'o':
+                format_name = optarg;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -111,6 +668,10 @@ int main(int argc, char *argv[]) {
         }
     }
     
+    if (batch_input) {
+        return run_batch_mode(hdf5_file, batch_input, format_name, raw_output);
+    }
+
     // Validate required arguments
     if (!hdf5_file || mesh_id == 0) {
         fprintf(stderr, "Error: Missing required arguments\n");
@@ -154,7 +715,7 @@ int main(int argc, char *argv[]) {
     }
     
     // Verify mesh ID exists
-    uint32_t mesh_index = meshid_search_id(hash, mesh_id);
+    uint32_t mesh_index = h5mobaku_mesh_index(ctx->h5r_ctx, hash, mesh_id);
     if (mesh_index == MESHID_NOT_FOUND) {
         fprintf(stderr, "Error: Mesh ID %u not found\n", mesh_id);
         cmph_destroy(hash);
@@ -162,22 +723,32 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // All results go through one buffered writer; raw streams into a pipe use vmsplice
+    h5m_output_t out;
+    if (h5m_output_init(&out, STDOUT_FILENO, 0, raw_output ? H5M_OUTPUT_VMSPLICE : 0) != 0) {
+        cmph_destroy(hash);
+        h5mobaku_close(ctx);
+        return 1;
+    }
+
     // Perform query
+    int status = 0;
     if (single_time) {
         // Single time query
         int32_t population = h5mobaku_read_population_single_at_time(ctx, hash, mesh_id, single_time);
         
         if (population < 0) {
             fprintf(stderr, "Error: Failed to read population data\n");
+            status = 1;
         } else {
             if (raw_output) {
                 // Output raw uint32 value (Note: population is int32_t, but we cast to uint32_t for output)
                 uint32_t raw_value = (uint32_t)population;
-                fwrite(&raw_value, sizeof(uint32_t), 1, stdout);
+                h5m_output_write(&out, &raw_value, sizeof(uint32_t));
             } else {
-                print_table_header_single();
-                print_table_row_single(mesh_id, single_time, population);
-                print_table_footer_single();
+                print_table_header(&out);
+                print_table_row_single(&out, mesh_id, single_time, population);
+                print_table_footer_single(&out);
             }
         }
     } else {
@@ -186,6 +757,7 @@ int main(int argc, char *argv[]) {
         
         if (!time_series) {
             fprintf(stderr, "Error: Failed to read time series data\n");
+            status = 1;
         } else {
             // Calculate time indices
             int start_idx = meshid_get_time_index_from_datetime(start_time);
@@ -193,28 +765,25 @@ int main(int argc, char *argv[]) {
             
             if (start_idx < 0 || end_idx < 0 || start_idx > end_idx) {
                 fprintf(stderr, "Error: Invalid time range\n");
+                status = 1;
             } else {
                 int count = end_idx - start_idx + 1;
                 
                 if (raw_output) {
-                    // Output raw uint32 values as byte stream
-                    for (int i = 0; i < count; i++) {
-                        uint32_t raw_value = (uint32_t)time_series[i];
-                        fwrite(&raw_value, sizeof(uint32_t), 1, stdout);
-                    }
+                    // Output raw uint32 values as byte stream (int32 and uint32 share the bit pattern)
+                    h5m_output_write(&out, time_series, (size_t)count * sizeof(uint32_t));
                 } else {
-                    print_table_header_range();
+                    print_table_header(&out);
                     
-                    // Print each time point
+                    // Print each time point; the calendar cursor steps one hour per row
+                    h5m_datetime_cursor_t datetime;
+                    h5m_datetime_cursor_init(&datetime, reference_time() + (time_t)start_idx * 3600);
                     for (int i = 0; i < count; i++) {
-                        char *datetime = meshid_get_datetime_from_time_index(start_idx + i);
-                        if (datetime) {
-                            print_table_row_range(mesh_id, datetime, time_series[i]);
-                            free(datetime);
-                        }
+                        print_table_row_range(&out, mesh_id, &datetime, time_series[i]);
+                        h5m_datetime_cursor_advance(&datetime);
                     }
                     
-                    print_table_footer_range(count);
+                    print_table_footer_range(&out, count);
                 }
             }
             
@@ -223,8 +792,12 @@ int main(int argc, char *argv[]) {
     }
     
     // Cleanup
+    if (h5m_output_close(&out) != 0) {
+        fprintf(stderr, "Error: Failed to write output: %s\n", strerror(errno));
+        status = 1;
+    }
     cmph_destroy(hash);
     h5mobaku_close(ctx);
     
-    return 0;
+    return status;
 }
\ No newline at end of file
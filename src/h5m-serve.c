@@ -0,0 +1,817 @@
+//
+// h5m-serve: resident query server over a Unix domain socket
+//
+// Keeps the HDF5 files, the mesh ID hash and the HDF5 chunk caches open and
+// answers framed binary requests (see h5m_protocol.h). An epoll loop accepts
+// connections and splits the byte stream into frames; a worker pool executes
+// the queries and queues the responses on the connection. Sockets are never
+// waited on while a lock is held: responses go out as far as the socket takes
+// them and the event loop sends the rest when it becomes writable.
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "h5m_protocol.h"
+#include "fifioq.h"
+
+#define H5M_MAX_SLOTS 16
+#define DEFAULT_SOCKET_PATH "/tmp/h5m-serve.sock"
+#define DEFAULT_WORKERS 4
+#define DEFAULT_MAX_INFLIGHT 64
+#define DEFAULT_SEND_TIMEOUT 30                      // Seconds a client may leave responses unread
+#define OUTPUT_HIGH_WATER (64u * 1024 * 1024)       // Queued response bytes that pause reading
+#define MAX_EVENTS 64
+#define MAX_IOV 64
+#define READ_CHUNK 65536
+
+// A queued response: header and payload, partly sent
+typedef struct response {
+    struct response *next;
+    h5m_frame_header_t hdr;
+    void *payload;
+    size_t len;                    // Header + payload bytes
+    size_t sent;
+} response_t;
+
+typedef struct connection {
+    int fd;
+    atomic_int refs;               // Event loop + in-flight jobs
+    uint8_t *rbuf;                 // Event loop only
+    size_t rlen;
+    size_t rcap;
+    struct connection *prev, *next;
+
+    pthread_mutex_t out_mutex;     // Guards the fields below; never held across a blocking call
+    response_t *out_head, *out_tail;
+    size_t out_bytes;              // Unsent bytes queued
+    size_t inflight;               // Requests dispatched and not yet answered
+    int64_t last_progress_ms;      // Last time the queue was empty or the socket took bytes
+    uint32_t events;               // Current epoll interest
+    int paused;                    // Dispatch stopped at the in-flight or output limit
+    int eof;                       // Peer finished sending; close once everything is answered
+    int closed;                    // Removed from epoll
+    int failed;                    // Send error; the event loop closes the connection
+} connection_t;
+
+typedef struct {
+    connection_t *conn;
+    h5m_frame_header_t hdr;
+    uint8_t *payload;
+} job_t;
+
+typedef struct {
+    struct h5mobaku *files[H5M_MAX_SLOTS];
+    size_t file_rows[H5M_MAX_SLOTS];
+    size_t file_cols[H5M_MAX_SLOTS];
+    size_t num_slots;
+    cmph_t *hash;
+    pthread_mutex_t h5_mutex;      // HDF5 is not thread-safe; library calls are serialized
+    FIFOQueue jobs;
+    int epfd;
+    int wake_fd;                   // eventfd: a paused or failed connection needs the event loop
+    connection_t *conns;           // Event loop only
+    size_t max_inflight;
+    int64_t send_timeout_ms;
+    int verbose;
+} server_t;
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void handle_signal(int sig) {
+    (void)sig;
+    g_stop = 1;
+}
+
+static void print_usage(const char *prog_name) {
+    fprintf(stderr, "Usage: %s -f <hdf5_file> [-f <hdf5_file> ...] [-s <socket_path>] [-j <workers>]\n", prog_name);
+    fprintf(stderr, "\nOptions:\n");
+    fprintf(stderr, "  -f, --file <path>        HDF5 file to serve; repeat for more slots (slot 0, 1, ...)\n");
+    fprintf(stderr, "  -s, --socket <path>      Unix socket path (default: %s)\n", DEFAULT_SOCKET_PATH);
+    fprintf(stderr, "  -j, --workers <n>        Worker threads (default: %d)\n", DEFAULT_WORKERS);
+    fprintf(stderr, "  -q, --max-inflight <n>   Pipelined requests per connection before reading pauses (default: %d)\n",
+            DEFAULT_MAX_INFLIGHT);
+    fprintf(stderr, "  -T, --send-timeout <s>   Drop clients that leave responses unread this long (default: %d)\n",
+            DEFAULT_SEND_TIMEOUT);
+    fprintf(stderr, "  -v, --verbose            Log connections\n");
+    fprintf(stderr, "  -h, --help               Show this help message\n");
+    fprintf(stderr, "\nExample:\n");
+    fprintf(stderr, "  %s -f 2016_2023.h5 -f 2024.h5 -s /run/h5m.sock -j 8\n", prog_name);
+}
+
+static int64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static connection_t *conn_new(int fd) {
+    connection_t *conn = calloc(1, sizeof(connection_t));
+    if (!conn) return NULL;
+    conn->fd = fd;
+    atomic_init(&conn->refs, 1);
+    pthread_mutex_init(&conn->out_mutex, NULL);
+    conn->events = EPOLLIN | EPOLLRDHUP;
+    return conn;
+}
+
+static void conn_release(connection_t *conn) {
+    if (atomic_fetch_sub(&conn->refs, 1) != 1) return;
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->out_mutex);
+    for (response_t *r = conn->out_head, *next; r; r = next) {
+        next = r->next;
+        h5mobaku_free_data((int32_t*)r->payload);
+        free(r);
+    }
+    free(conn->rbuf);
+    free(conn);
+}
+
+static void wake_event_loop(server_t *srv) {
+    uint64_t one = 1;
+    ssize_t n = write(srv->wake_fd, &one, sizeof(one));
+    (void)n;
+}
+
+// Send as much of the queue as the socket takes without waiting. out_mutex held.
+static int conn_flush(connection_t *conn) {
+    while (conn->out_head) {
+        struct iovec iov[MAX_IOV];
+        int iovcnt = 0;
+        for (response_t *r = conn->out_head; r && iovcnt + 2 <= MAX_IOV; r = r->next) {
+            const size_t hdr_len = sizeof(r->hdr);
+            if (r->sent < hdr_len) {
+                iov[iovcnt++] = (struct iovec){(uint8_t*)&r->hdr + r->sent, hdr_len - r->sent};
+                if (r->len > hdr_len) iov[iovcnt++] = (struct iovec){r->payload, r->len - hdr_len};
+            } else {
+                iov[iovcnt++] = (struct iovec){(uint8_t*)r->payload + (r->sent - hdr_len), r->len - r->sent};
+            }
+        }
+
+        ssize_t n = writev(conn->fd, iov, iovcnt);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+            return -1;
+        }
+        conn->out_bytes -= (size_t)n;
+        conn->last_progress_ms = now_ms();
+        while (n > 0) {
+            response_t *r = conn->out_head;
+            const size_t take = r->len - r->sent < (size_t)n ? r->len - r->sent : (size_t)n;
+            r->sent += take;
+            n -= (ssize_t)take;
+            if (r->sent < r->len) break;
+            conn->out_head = r->next;
+            if (!conn->out_head) conn->out_tail = NULL;
+            h5mobaku_free_data((int32_t*)r->payload);
+            free(r);
+        }
+    }
+    return 0;
+}
+
+// Keep the epoll interest in step with the connection state. out_mutex held.
+static void conn_update_events(server_t *srv, connection_t *conn) {
+    uint32_t events = 0;
+    if (!conn->paused && !conn->eof) events |= EPOLLIN | EPOLLRDHUP;
+    if (conn->out_head) events |= EPOLLOUT;
+    if (conn->closed || events == conn->events) return;
+    struct epoll_event ev = {.events = events, .data.ptr = conn};
+    if (epoll_ctl(srv->epfd, EPOLL_CTL_MOD, conn->fd, &ev) == 0) conn->events = events;
+}
+
+static int conn_over_limits(const server_t *srv, const connection_t *conn) {
+    return conn->inflight >= srv->max_inflight || conn->out_bytes >= OUTPUT_HIGH_WATER;
+}
+
+static int conn_finished(const connection_t *conn) {
+    return conn->eof && conn->inflight == 0 && !conn->out_head;
+}
+
+// Queue a response and send what the socket takes now. The payload (released with
+// h5mobaku_free_data, which also takes plain malloc buffers) belongs to the queue from here on.
+static void send_response(server_t *srv, connection_t *conn, uint32_t request_id, uint16_t status,
+                          void *payload, size_t payload_len) {
+    response_t *r = malloc(sizeof(response_t));
+    if (!r) {
+        h5mobaku_free_data((int32_t*)payload);
+        payload = NULL;
+        payload_len = 0;
+    }
+
+    pthread_mutex_lock(&conn->out_mutex);
+    if (!r) {
+        // Without memory for the response the stream would lose a frame
+        conn->failed = 1;
+    } else {
+        r->next = NULL;
+        r->hdr = (h5m_frame_header_t){
+            .magic = H5M_RESPONSE_MAGIC,
+            .version = H5M_PROTOCOL_VERSION,
+            .code = status,
+            .request_id = request_id,
+            .payload_len = (uint32_t)payload_len,
+        };
+        r->payload = payload;
+        r->len = sizeof(r->hdr) + payload_len;
+        r->sent = 0;
+        if (!conn->out_head) conn->last_progress_ms = now_ms();
+        if (conn->out_tail) conn->out_tail->next = r;
+        else conn->out_head = r;
+        conn->out_tail = r;
+        conn->out_bytes += r->len;
+        if (conn_flush(conn) < 0) conn->failed = 1;
+    }
+    const int failed = conn->failed;
+    conn_update_events(srv, conn);
+    pthread_mutex_unlock(&conn->out_mutex);
+
+    // Peer is gone; let the event loop tear the connection down
+    if (failed) wake_event_loop(srv);
+}
+
+// Validate a request carrying a trailing mesh ID list and return a pointer to it
+static const uint32_t *trailing_mesh_ids(const job_t *job, size_t fixed_len, uint32_t num_meshes) {
+    if (num_meshes == 0 || job->hdr.payload_len != fixed_len + (size_t)num_meshes * sizeof(uint32_t)) {
+        return NULL;
+    }
+    return (const uint32_t*)(job->payload + fixed_len);
+}
+
+static int check_slot_range(const server_t *srv, uint16_t slot, int32_t start, int32_t end) {
+    if (slot >= srv->num_slots) return H5M_STATUS_BAD_SLOT;
+    if (start < 0 || end < start || (size_t)end >= srv->file_rows[slot]) return H5M_STATUS_READ_ERROR;
+    return H5M_STATUS_OK;
+}
+
+static void aggregate_rows(const int32_t *data, size_t num_times, size_t num_meshes,
+                           uint16_t agg, int64_t *out) {
+    for (size_t t = 0; t < num_times; t++) {
+        const int32_t *row = data + t * num_meshes;
+        int64_t acc = row[0];
+        switch (agg) {
+            case H5M_AGG_SUM:
+                for (size_t m = 1; m < num_meshes; m++) acc += row[m];
+                break;
+            case H5M_AGG_MIN:
+                for (size_t m = 1; m < num_meshes; m++) if (row[m] < acc) acc = row[m];
+                break;
+            case H5M_AGG_MAX:
+                for (size_t m = 1; m < num_meshes; m++) if (row[m] > acc) acc = row[m];
+                break;
+        }
+        out[t] = acc;
+    }
+}
+
+static void handle_job(server_t *srv, job_t *job) {
+    const uint32_t rid = job->hdr.request_id;
+    const uint32_t len = job->hdr.payload_len;
+    int status = H5M_STATUS_OK;
+    void *resp = NULL;
+    size_t resp_len = 0;
+
+    switch (job->hdr.code) {
+        case H5M_OP_PING:
+            break;
+
+        case H5M_OP_SINGLE: {
+            h5m_req_single_t req;
+            if (len != sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            status = check_slot_range(srv, req.slot, req.time_index, req.time_index);
+            if (status != H5M_STATUS_OK) break;
+
+            pthread_mutex_lock(&srv->h5_mutex);
+            int32_t value = h5mobaku_read_population_single(srv->files[req.slot]->h5r_ctx, srv->hash,
+                                                            req.mesh_id, req.time_index);
+            pthread_mutex_unlock(&srv->h5_mutex);
+            if (value < 0) { status = H5M_STATUS_READ_ERROR; break; }
+
+            int32_t *out = malloc(sizeof(int32_t));
+            if (!out) { status = H5M_STATUS_INTERNAL; break; }
+            *out = value;
+            resp = out;
+            resp_len = sizeof(int32_t);
+            break;
+        }
+
+        case H5M_OP_MULTI: {
+            h5m_req_multi_t req;
+            if (len < sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            const uint32_t *ids = trailing_mesh_ids(job, sizeof(req), req.num_meshes);
+            if (!ids) { status = H5M_STATUS_BAD_REQUEST; break; }
+            status = check_slot_range(srv, req.slot, req.time_index, req.time_index);
+            if (status != H5M_STATUS_OK) break;
+
+            pthread_mutex_lock(&srv->h5_mutex);
+            resp = h5mobaku_read_population_multi(srv->files[req.slot]->h5r_ctx, srv->hash,
+                                                  (uint32_t*)ids, req.num_meshes, req.time_index);
+            pthread_mutex_unlock(&srv->h5_mutex);
+            if (!resp) { status = H5M_STATUS_READ_ERROR; break; }
+            resp_len = (size_t)req.num_meshes * sizeof(int32_t);
+            break;
+        }
+
+        case H5M_OP_SERIES: {
+            h5m_req_series_t req;
+            if (len != sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            status = check_slot_range(srv, req.slot, req.start_time_index, req.end_time_index);
+            if (status != H5M_STATUS_OK) break;
+
+            pthread_mutex_lock(&srv->h5_mutex);
+            resp = h5mobaku_read_population_time_series(srv->files[req.slot]->h5r_ctx, srv->hash, req.mesh_id,
+                                                        req.start_time_index, req.end_time_index);
+            pthread_mutex_unlock(&srv->h5_mutex);
+            if (!resp) { status = H5M_STATUS_READ_ERROR; break; }
+            resp_len = (size_t)(req.end_time_index - req.start_time_index + 1) * sizeof(int32_t);
+            break;
+        }
+
+        case H5M_OP_MULTI_SERIES: {
+            h5m_req_multi_series_t req;
+            if (len < sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            const uint32_t *ids = trailing_mesh_ids(job, sizeof(req), req.num_meshes);
+            if (!ids) { status = H5M_STATUS_BAD_REQUEST; break; }
+            status = check_slot_range(srv, req.slot, req.start_time_index, req.end_time_index);
+            if (status != H5M_STATUS_OK) break;
+
+            const size_t num_times = (size_t)(req.end_time_index - req.start_time_index + 1);
+            if (num_times * req.num_meshes * sizeof(int32_t) > H5M_MAX_RESPONSE_PAYLOAD) {
+                status = H5M_STATUS_TOO_LARGE;
+                break;
+            }
+
+            pthread_mutex_lock(&srv->h5_mutex);
+            resp = h5mobaku_read_multi_mesh_time_series(srv->files[req.slot]->h5r_ctx, srv->hash,
+                                                        (uint32_t*)ids, req.num_meshes,
+                                                        req.start_time_index, req.end_time_index);
+            pthread_mutex_unlock(&srv->h5_mutex);
+            if (!resp) { status = H5M_STATUS_READ_ERROR; break; }
+            resp_len = num_times * req.num_meshes * sizeof(int32_t);
+            break;
+        }
+
+        case H5M_OP_AGGREGATE: {
+            h5m_req_aggregate_t req;
+            if (len < sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            const uint32_t *ids = trailing_mesh_ids(job, sizeof(req), req.num_meshes);
+            if (!ids || req.agg > H5M_AGG_MAX) { status = H5M_STATUS_BAD_REQUEST; break; }
+            status = check_slot_range(srv, req.slot, req.start_time_index, req.end_time_index);
+            if (status != H5M_STATUS_OK) break;
+
+            const size_t num_times = (size_t)(req.end_time_index - req.start_time_index + 1);
+            if (num_times * req.num_meshes * sizeof(int32_t) > H5M_MAX_RESPONSE_PAYLOAD) {
+                status = H5M_STATUS_TOO_LARGE;
+                break;
+            }
+
+            pthread_mutex_lock(&srv->h5_mutex);
+            int32_t *data = h5mobaku_read_multi_mesh_time_series(srv->files[req.slot]->h5r_ctx, srv->hash,
+                                                                 (uint32_t*)ids, req.num_meshes,
+                                                                 req.start_time_index, req.end_time_index);
+            pthread_mutex_unlock(&srv->h5_mutex);
+            if (!data) { status = H5M_STATUS_READ_ERROR; break; }
+
+            // Reduce outside the HDF5 lock
+            int64_t *out = malloc(num_times * sizeof(int64_t));
+            if (!out) {
+                h5mobaku_free_data(data);
+                status = H5M_STATUS_INTERNAL;
+                break;
+            }
+            aggregate_rows(data, num_times, req.num_meshes, req.agg, out);
+            h5mobaku_free_data(data);
+            resp = out;
+            resp_len = num_times * sizeof(int64_t);
+            break;
+        }
+
+        case H5M_OP_INFO: {
+            h5m_req_info_t req;
+            if (len != sizeof(req)) { status = H5M_STATUS_BAD_REQUEST; break; }
+            memcpy(&req, job->payload, sizeof(req));
+            if (req.slot >= srv->num_slots) { status = H5M_STATUS_BAD_SLOT; break; }
+
+            h5m_resp_info_t *info = calloc(1, sizeof(h5m_resp_info_t));
+            if (!info) { status = H5M_STATUS_INTERNAL; break; }
+            info->time_points = srv->file_rows[req.slot];
+            info->mesh_count = srv->file_cols[req.slot];
+            info->start_datetime = (int64_t)srv->files[req.slot]->start_datetime;
+            info->num_slots = (uint32_t)srv->num_slots;
+            resp = info;
+            resp_len = sizeof(h5m_resp_info_t);
+            break;
+        }
+
+        default:
+            status = H5M_STATUS_BAD_REQUEST;
+            break;
+    }
+
+    if (status != H5M_STATUS_OK) {
+        h5mobaku_free_data((int32_t*)resp);
+        resp = NULL;
+        resp_len = 0;
+    }
+    send_response(srv, job->conn, rid, (uint16_t)status, resp, resp_len);
+}
+
+static void *worker_thread_func(void *arg) {
+    server_t *srv = (server_t*)arg;
+    for (;;) {
+        job_t *job = (job_t*)dequeue(&srv->jobs);
+        if (!job) break;  // Shutdown sentinel
+
+        handle_job(srv, job);
+
+        // A connection paused at its limits resumes once it is back under them
+        connection_t *conn = job->conn;
+        pthread_mutex_lock(&conn->out_mutex);
+        conn->inflight--;
+        const int wake = (conn->paused && !conn_over_limits(srv, conn)) || conn_finished(conn);
+        pthread_mutex_unlock(&conn->out_mutex);
+        if (wake) wake_event_loop(srv);
+        conn_release(conn);
+        free(job->payload);
+        free(job);
+    }
+    return NULL;
+}
+
+// Split buffered bytes into frames and queue them, pausing the connection at its in-flight or
+// output limit. Returns -1 if the stream is corrupt.
+static int dispatch_frames(server_t *srv, connection_t *conn) {
+    size_t pos = 0;
+    while (conn->rlen - pos >= sizeof(h5m_frame_header_t)) {
+        h5m_frame_header_t hdr;
+        memcpy(&hdr, conn->rbuf + pos, sizeof(hdr));
+        if (hdr.magic != H5M_REQUEST_MAGIC || hdr.version != H5M_PROTOCOL_VERSION ||
+            hdr.payload_len > H5M_MAX_REQUEST_PAYLOAD) {
+            send_response(srv, conn, hdr.request_id, H5M_STATUS_BAD_REQUEST, NULL, 0);
+            return -1;
+        }
+        if (conn->rlen - pos < sizeof(hdr) + hdr.payload_len) break;
+
+        pthread_mutex_lock(&conn->out_mutex);
+        conn->paused = conn_over_limits(srv, conn);
+        if (!conn->paused) conn->inflight++;
+        conn_update_events(srv, conn);
+        const int paused = conn->paused;
+        pthread_mutex_unlock(&conn->out_mutex);
+        if (paused) break;
+
+        job_t *job = malloc(sizeof(job_t));
+        uint8_t *payload = hdr.payload_len ? malloc(hdr.payload_len) : NULL;
+        if (!job || (hdr.payload_len && !payload)) {
+            free(job);
+            free(payload);
+            send_response(srv, conn, hdr.request_id, H5M_STATUS_INTERNAL, NULL, 0);
+            return -1;
+        }
+        memcpy(payload, conn->rbuf + pos + sizeof(hdr), hdr.payload_len);
+        job->conn = conn;
+        job->hdr = hdr;
+        job->payload = payload;
+        atomic_fetch_add(&conn->refs, 1);
+        enqueue(&srv->jobs, job);
+
+        pos += sizeof(hdr) + hdr.payload_len;
+    }
+
+    if (pos > 0) {
+        memmove(conn->rbuf, conn->rbuf + pos, conn->rlen - pos);
+        conn->rlen -= pos;
+    }
+    return 0;
+}
+
+// Drain the socket. Returns -1 when the connection should be closed.
+static int read_connection(server_t *srv, connection_t *conn) {
+    for (;;) {
+        if (conn->rcap - conn->rlen < READ_CHUNK) {
+            size_t new_cap = conn->rcap ? conn->rcap * 2 : READ_CHUNK * 2;
+            uint8_t *tmp = realloc(conn->rbuf, new_cap);
+            if (!tmp) return -1;
+            conn->rbuf = tmp;
+            conn->rcap = new_cap;
+        }
+
+        ssize_t n = read(conn->fd, conn->rbuf + conn->rlen, conn->rcap - conn->rlen);
+        if (n > 0) {
+            conn->rlen += (size_t)n;
+            if (dispatch_frames(srv, conn) < 0) return -1;
+            // A paused connection is read again once its requests have been answered
+            pthread_mutex_lock(&conn->out_mutex);
+            const int paused = conn->paused;
+            pthread_mutex_unlock(&conn->out_mutex);
+            if (paused) return 0;
+            continue;
+        }
+        if (n == 0) {
+            // Half-closed: answer what was asked before closing
+            pthread_mutex_lock(&conn->out_mutex);
+            conn->eof = 1;
+            conn_update_events(srv, conn);
+            const int finished = conn_finished(conn);
+            pthread_mutex_unlock(&conn->out_mutex);
+            return finished ? -1 : 0;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+}
+
+static int create_listen_socket(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Error: socket");
+        return -1;
+    }
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, SOMAXCONN) < 0) {
+        fprintf(stderr, "Error: Cannot listen on %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void close_connection(server_t *srv, connection_t *conn) {
+    if (srv->verbose) fprintf(stderr, "Closed connection (fd %d)\n", conn->fd);
+    if (conn->prev) conn->prev->next = conn->next;
+    else srv->conns = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+
+    pthread_mutex_lock(&conn->out_mutex);
+    conn->closed = 1;
+    if (!conn->failed) conn_flush(conn);   // Last chance for an error response
+    pthread_mutex_unlock(&conn->out_mutex);
+    epoll_ctl(srv->epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+    shutdown(conn->fd, SHUT_RDWR);
+    conn_release(conn);  // In-flight jobs keep the connection alive until answered
+}
+
+// Drop failed and stalled clients and resume paused ones that are back under their limits
+static void sweep_connections(server_t *srv) {
+    const int64_t now = now_ms();
+    for (connection_t *conn = srv->conns, *next; conn; conn = next) {
+        next = conn->next;
+        pthread_mutex_lock(&conn->out_mutex);
+        const int drop = conn->failed || conn_finished(conn) ||
+                         (conn->out_head && now - conn->last_progress_ms > srv->send_timeout_ms);
+        const int resume = !drop && conn->paused && !conn_over_limits(srv, conn);
+        if (resume) {
+            conn->paused = 0;
+            conn_update_events(srv, conn);
+        }
+        pthread_mutex_unlock(&conn->out_mutex);
+
+        if (drop) {
+            if (srv->verbose && conn->out_head && !conn->failed) fprintf(stderr, "Client stalled (fd %d)\n", conn->fd);
+            close_connection(srv, conn);
+        } else if (resume && (dispatch_frames(srv, conn) < 0 || read_connection(srv, conn) < 0)) {
+            close_connection(srv, conn);
+        }
+    }
+}
+
+static void run_event_loop(server_t *srv, int listen_fd) {
+    struct epoll_event ev = {.events = EPOLLIN, .data.ptr = NULL};
+    epoll_ctl(srv->epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+    struct epoll_event wev = {.events = EPOLLIN, .data.ptr = srv};
+    epoll_ctl(srv->epfd, EPOLL_CTL_ADD, srv->wake_fd, &wev);
+
+    struct epoll_event events[MAX_EVENTS];
+    int64_t last_sweep = now_ms();
+    while (!g_stop) {
+        int n = epoll_wait(srv->epfd, events, MAX_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("Error: epoll_wait");
+            break;
+        }
+
+        int sweep = now_ms() - last_sweep >= 1000;
+        for (int i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            if (ptr == srv) {
+                uint64_t count;
+                ssize_t r = read(srv->wake_fd, &count, sizeof(count));
+                (void)r;
+                sweep = 1;
+                continue;
+            }
+            if (!ptr) {
+                int cfd;
+                while ((cfd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                    connection_t *c = conn_new(cfd);
+                    if (!c) {
+                        close(cfd);
+                        continue;
+                    }
+                    struct epoll_event cev = {.events = c->events, .data.ptr = c};
+                    if (epoll_ctl(srv->epfd, EPOLL_CTL_ADD, cfd, &cev) < 0) {
+                        conn_release(c);
+                        continue;
+                    }
+                    c->next = srv->conns;
+                    if (srv->conns) srv->conns->prev = c;
+                    srv->conns = c;
+                    if (srv->verbose) fprintf(stderr, "Accepted connection (fd %d)\n", cfd);
+                }
+                continue;
+            }
+
+            connection_t *conn = (connection_t*)ptr;
+            int close_conn = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+            if (!close_conn && (events[i].events & EPOLLOUT)) {
+                pthread_mutex_lock(&conn->out_mutex);
+                if (conn_flush(conn) < 0) conn->failed = 1;
+                close_conn = conn->failed;
+                conn_update_events(srv, conn);
+                pthread_mutex_unlock(&conn->out_mutex);
+                sweep = 1;   // Draining may bring a paused connection under its output limit
+            }
+            if (!close_conn && (events[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                close_conn = read_connection(srv, conn) < 0;
+            }
+            if (close_conn) close_connection(srv, conn);
+        }
+
+        if (sweep) {
+            sweep_connections(srv);
+            last_sweep = now_ms();
+        }
+    }
+    while (srv->conns) close_connection(srv, srv->conns);
+}
+
+int main(int argc, char *argv[]) {
+    const char *files[H5M_MAX_SLOTS];
+    size_t num_files = 0;
+    const char *socket_path = DEFAULT_SOCKET_PATH;
+    int num_workers = DEFAULT_WORKERS;
+    int max_inflight = DEFAULT_MAX_INFLIGHT;
+    int send_timeout = DEFAULT_SEND_TIMEOUT;
+    int verbose = 0;
+    int opt;
+
+    static struct option long_options[] = {
+        {"file",    required_argument, 0, 'f'},
+        {"socket",  required_argument, 0, 's'},
+        {"workers", required_argument, 0, 'j'},
+        {"max-inflight", required_argument, 0, 'q'},
+        {"send-timeout", required_argument, 0, 'T'},
+        {"verbose", no_argument,       0, 'v'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    while ((opt = getopt_long(argc, argv, "f:s:j:q:T:vh", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'f':
+                if (num_files >= H5M_MAX_SLOTS) {
+                    fprintf(stderr, "Error: At most %d files can be served\n", H5M_MAX_SLOTS);
+                    return 1;
+                }
+                files[num_files++] = optarg;
+                break;
+            case 's':
+                socket_path = optarg;
+                break;
+            case 'j':
+                num_workers = atoi(optarg);
+                break;
+            case 'q':
+                max_inflight = atoi(optarg);
+                break;
+            case 'T':
+                send_timeout = atoi(optarg);
+                break;
+            case 'v':
+                verbose = 1;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (num_files == 0) {
+        fprintf(stderr, "Error: At least one HDF5 file (-f) is required\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (num_workers < 1) num_workers = 1;
+    if (max_inflight < 1) max_inflight = 1;
+    if (send_timeout < 1) send_timeout = 1;
+
+    server_t srv = {
+        .epfd = -1,
+        .wake_fd = -1,
+        .max_inflight = (size_t)max_inflight,
+        .send_timeout_ms = (int64_t)send_timeout * 1000,
+        .verbose = verbose,
+    };
+    pthread_mutex_init(&srv.h5_mutex, NULL);
+    init_queue(&srv.jobs);
+
+    int ret = 1;
+    int listen_fd = -1;
+    pthread_t *workers = NULL;
+    int started = 0;
+
+    srv.hash = meshid_prepare_search();
+    if (!srv.hash) goto cleanup;
+
+    for (size_t i = 0; i < num_files; i++) {
+        if (h5mobaku_open(files[i], &srv.files[i]) != 0) {
+            fprintf(stderr, "Error: Failed to open HDF5 file: %s\n", files[i]);
+            goto cleanup;
+        }
+        srv.num_slots++;
+        h5r_get_dimensions(srv.files[i]->h5r_ctx, &srv.file_rows[i], &srv.file_cols[i]);
+        if (verbose) {
+            fprintf(stderr, "Slot %zu: %s (%zu x %zu, start %s)\n", i, files[i],
+                    srv.file_rows[i], srv.file_cols[i], srv.files[i]->start_datetime_str);
+        }
+    }
+
+    struct sigaction sa = {.sa_handler = handle_signal};
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    listen_fd = create_listen_socket(socket_path);
+    if (listen_fd < 0) goto cleanup;
+    srv.epfd = epoll_create1(EPOLL_CLOEXEC);
+    srv.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (srv.epfd < 0 || srv.wake_fd < 0) {
+        perror("Error: epoll/eventfd");
+        goto cleanup;
+    }
+
+    workers = malloc((size_t)num_workers * sizeof(pthread_t));
+    if (!workers) goto cleanup;
+    for (; started < num_workers; started++) {
+        if (pthread_create(&workers[started], NULL, worker_thread_func, &srv) != 0) break;
+    }
+    if (started == 0) {
+        fprintf(stderr, "Error: Failed to start worker threads\n");
+        goto cleanup;
+    }
+
+    fprintf(stderr, "Listening on %s with %d workers\n", socket_path, started);
+    run_event_loop(&srv, listen_fd);
+    ret = 0;
+
+cleanup:
+    for (int i = 0; i < started; i++) enqueue(&srv.jobs, NULL);
+    for (int i = 0; i < started; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    if (srv.epfd >= 0) close(srv.epfd);
+    if (srv.wake_fd >= 0) close(srv.wake_fd);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(socket_path);
+    }
+    for (size_t i = 0; i < srv.num_slots; i++) h5mobaku_close(srv.files[i]);
+    if (srv.hash) cmph_destroy(srv.hash);
+    pthread_mutex_destroy(&srv.h5_mutex);
+    return ret;
+}
@@ -0,0 +1,293 @@
+//
+// Buffered output engine for CLI tools
+//
+
+#define _GNU_SOURCE
+#include "h5m_output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#define VMSPLICE_PIPE_SIZE (1u << 20)
+
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+size_t h5m_format_uint64(char *dst, uint64_t value) {
+    char tmp[H5M_INT64_MAX_LEN];
+    char *p = tmp + sizeof(tmp);
+
+    // Two digits per step from the back
+    while (value >= 100) {
+        unsigned idx = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    }
+    if (value >= 10) {
+        unsigned idx = (unsigned)value * 2;
+        *--p = digit_pairs[idx + 1];
+        *--p = digit_pairs[idx];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    size_t len = (size_t)(tmp + sizeof(tmp) - p);
+    memcpy(dst, p, len);
+    return len;
+}
+
+size_t h5m_format_int64(char *dst, int64_t value) {
+    if (value < 0) {
+        *dst = '-';
+        return 1 + h5m_format_uint64(dst + 1, (uint64_t)0 - (uint64_t)value);
+    }
+    return h5m_format_uint64(dst, (uint64_t)value);
+}
+
+void h5m_output_put_int64_padded(h5m_output_t *out, int64_t value, int width, int left_align) {
+    char digits[H5M_INT64_MAX_LEN + 1];
+    size_t len = h5m_format_int64(digits, value);
+    if (width > 64) width = 64;
+    size_t pad = width > 0 && (size_t)width > len ? (size_t)width - len : 0;
+
+    char *p = h5m_output_reserve(out, len + pad);
+    if (!p) return;
+    if (left_align) {
+        memcpy(p, digits, len);
+        memset(p + len, ' ', pad);
+    } else {
+        memset(p, ' ', pad);
+        memcpy(p + pad, digits, len);
+    }
+    out->len += len + pad;
+}
+
+static int write_fully(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int vmsplice_fully(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        struct iovec iov = {.iov_base = (void*)data, .iov_len = len};
+        ssize_t n = vmsplice(fd, &iov, 1, SPLICE_F_GIFT);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// vmsplice mode gifts each full block to the pipe. The reader may splice or tee those pages onward
+// and keep referencing them long after the pipe has drained, so a spliced block is never written
+// again: it is unmapped (the pipe's page references keep the contents alive) and the next block
+// is a fresh mapping. Partial blocks are written with write(2), which copies.
+static size_t setup_vmsplice(int fd) {
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISFIFO(st.st_mode)) return 0;
+    // Unprivileged processes may be capped below this; keep whatever size we get
+    (void)fcntl(fd, F_SETPIPE_SZ, VMSPLICE_PIPE_SIZE);
+    int size = fcntl(fd, F_GETPIPE_SZ);
+    return size > 0 ? (size_t)size : 0;
+}
+
+static char *map_block(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static void release_block(h5m_output_t *out, char *block) {
+    if (out->mapped) munmap(block, out->block_size);
+    else free(block);
+}
+
+int h5m_output_init(h5m_output_t *out, int fd, size_t buffer_size, unsigned flags) {
+    if (!out || fd < 0) return -1;
+    memset(out, 0, sizeof(*out));
+    out->fd = fd;
+    out->flags = flags;
+
+    size_t cap = buffer_size ? buffer_size : H5M_OUTPUT_DEFAULT_BUFFER;
+    if (cap < H5M_OUTPUT_SLACK) cap = H5M_OUTPUT_SLACK;
+    if (flags & H5M_OUTPUT_VMSPLICE) {
+        size_t pipe_size = setup_vmsplice(fd);
+        if (pipe_size > 0) {
+            out->use_vmsplice = 1;
+            cap = pipe_size;
+        }
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t align = page > 0 ? (size_t)page : 4096;
+    out->block_size = (cap + H5M_OUTPUT_SLACK + align - 1) / align * align;
+    out->mapped = out->use_vmsplice;
+    void *mem = NULL;
+    if (out->mapped) mem = map_block(out->block_size);
+    else if (posix_memalign(&mem, align, out->block_size) != 0) mem = NULL;
+    if (!mem) {
+        fprintf(stderr, "Error: Memory allocation failed for output buffer\n");
+        return -1;
+    }
+    out->buf = mem;
+    out->cap = cap;
+    return 0;
+}
+
+int h5m_output_drain(h5m_output_t *out) {
+    if (out->error) return -1;
+    if (out->len < out->cap) return 0;
+
+    const size_t tail = out->len - out->cap;
+    char *next = out->buf;
+    int ret;
+    if (out->use_vmsplice) {
+        // The fresh block is taken first, so a failed mapping leaves the full one to write(2)
+        next = map_block(out->block_size);
+        ret = next ? vmsplice_fully(out->fd, out->buf, out->cap) : -1;
+        if (ret < 0 && (!next || errno == EINVAL || errno == ENOSYS)) {
+            out->use_vmsplice = 0;
+            if (next) munmap(next, out->block_size);
+            next = out->buf;
+            ret = write_fully(out->fd, out->buf, out->cap);
+        }
+    } else {
+        ret = write_fully(out->fd, out->buf, out->cap);
+    }
+    if (ret < 0) {
+        if (next != out->buf) munmap(next, out->block_size);
+        out->error = 1;
+        out->len = 0;
+        return -1;
+    }
+
+    if (next != out->buf) {
+        memcpy(next, out->buf + out->cap, tail);
+        munmap(out->buf, out->block_size);
+    } else {
+        memmove(next, out->buf + out->cap, tail);
+    }
+    out->buf = next;
+    out->len = tail;
+    return 0;
+}
+
+int h5m_output_flush(h5m_output_t *out) {
+    if (out->error) return -1;
+    if (h5m_output_drain(out) < 0) return -1;
+    if (out->len == 0) return 0;
+
+    // Partial block: copy it out so the block stays ours to refill
+    int ret = write_fully(out->fd, out->buf, out->len);
+    out->len = 0;
+    if (ret < 0) {
+        out->error = 1;
+        return -1;
+    }
+    return 0;
+}
+
+int h5m_output_write(h5m_output_t *out, const void *data, size_t len) {
+    if (out->error) return -1;
+    if (len >= out->cap) {
+        // Caller-owned block: write(2), since vmsplice would alias memory we don't control
+        if (h5m_output_flush(out) < 0) return -1;
+        if (write_fully(out->fd, data, len) < 0) {
+            out->error = 1;
+            return -1;
+        }
+        return 0;
+    }
+
+    const char *src = data;
+    while (len > 0) {
+        if (out->len >= out->cap && h5m_output_drain(out) < 0) return -1;
+        size_t n = out->cap - out->len;
+        if (n > len) n = len;
+        memcpy(out->buf + out->len, src, n);
+        out->len += n;
+        src += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int h5m_output_close(h5m_output_t *out) {
+    if (!out || !out->buf) return -1;
+    int ret = h5m_output_flush(out);
+    release_block(out, out->buf);
+    out->buf = NULL;
+    return (ret < 0 || out->error) ? -1 : 0;
+}
+
+static int days_in_month(int year, int month) {
+    static const int days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && ((year % 4 == 0 && year % 100 != 0) || year % 400 == 0)) return 29;
+    return days[month - 1];
+}
+
+void h5m_datetime_cursor_init(h5m_datetime_cursor_t *cursor, time_t t) {
+    struct tm tm;
+    localtime_r(&t, &tm);
+    cursor->year = tm.tm_year + 1900;
+    cursor->month = tm.tm_mon + 1;
+    cursor->day = tm.tm_mday;
+    cursor->hour = tm.tm_hour;
+    cursor->minute = tm.tm_min;
+    cursor->second = tm.tm_sec;
+}
+
+void h5m_datetime_cursor_advance(h5m_datetime_cursor_t *cursor) {
+    if (++cursor->hour < 24) return;
+    cursor->hour = 0;
+    if (++cursor->day <= days_in_month(cursor->year, cursor->month)) return;
+    cursor->day = 1;
+    if (++cursor->month <= 12) return;
+    cursor->month = 1;
+    cursor->year++;
+}
+
+static inline void put2(char *dst, int value) {
+    dst[0] = digit_pairs[value * 2];
+    dst[1] = digit_pairs[value * 2 + 1];
+}
+
+void h5m_datetime_cursor_format(const h5m_datetime_cursor_t *cursor, char *dst) {
+    put2(dst, cursor->year / 100);
+    put2(dst + 2, cursor->year % 100);
+    dst[4] = '-';
+    put2(dst + 5, cursor->month);
+    dst[7] = '-';
+    put2(dst + 8, cursor->day);
+    dst[10] = ' ';
+    put2(dst + 11, cursor->hour);
+    dst[13] = ':';
+    put2(dst + 14, cursor->minute);
+    dst[16] = ':';
+    put2(dst + 17, cursor->second);
+}
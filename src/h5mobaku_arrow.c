@@ -0,0 +1,262 @@
+//
+// Apache Arrow C Data Interface export of h5mobaku query results
+//
+
+#include "h5mobaku_arrow.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARROW_MAX_BUFFERS 2
+#define ARROW_MAX_CHILDREN 3
+
+// Private data for an exported array: the buffers it owns and its children
+typedef struct {
+    const void *buffers[ARROW_MAX_BUFFERS];
+    void *owned[ARROW_MAX_BUFFERS];
+    int owned_by_h5mobaku[ARROW_MAX_BUFFERS]; // release through h5mobaku_free_data()
+    struct ArrowArray *children[ARROW_MAX_CHILDREN];
+} arrow_array_private_t;
+
+// Private data for an exported schema
+typedef struct {
+    struct ArrowSchema *children[ARROW_MAX_CHILDREN];
+} arrow_schema_private_t;
+
+static void release_array(struct ArrowArray *array) {
+    if (!array || !array->release) return;
+
+    arrow_array_private_t *priv = (arrow_array_private_t*)array->private_data;
+    for (int64_t i = 0; i < array->n_children; i++) {
+        struct ArrowArray *child = array->children[i];
+        if (child) {
+            if (child->release) child->release(child);
+            free(child);
+        }
+    }
+    if (array->dictionary) {
+        if (array->dictionary->release) array->dictionary->release(array->dictionary);
+        free(array->dictionary);
+    }
+    if (priv) {
+        for (int i = 0; i < ARROW_MAX_BUFFERS; i++) {
+            if (!priv->owned[i]) continue;
+            if (priv->owned_by_h5mobaku[i]) {
+                h5mobaku_free_data((int32_t*)priv->owned[i]);
+            } else {
+                free(priv->owned[i]);
+            }
+        }
+        free(priv);
+    }
+    array->release = NULL;
+}
+
+static void release_schema(struct ArrowSchema *schema) {
+    if (!schema || !schema->release) return;
+
+    for (int64_t i = 0; i < schema->n_children; i++) {
+        struct ArrowSchema *child = schema->children[i];
+        if (child) {
+            if (child->release) child->release(child);
+            free(child);
+        }
+    }
+    if (schema->dictionary) {
+        if (schema->dictionary->release) schema->dictionary->release(schema->dictionary);
+        free(schema->dictionary);
+    }
+    free(schema->private_data);
+    schema->release = NULL;
+}
+
+// Initialize a primitive (validity + values) array around `values`
+static void init_primitive_array(struct ArrowArray *array, arrow_array_private_t *priv,
+                                 int64_t length, void *values, int owned_by_h5mobaku) {
+    priv->buffers[0] = NULL;  // No validity bitmap: all values are present
+    priv->buffers[1] = values;
+    priv->owned[1] = values;
+    priv->owned_by_h5mobaku[1] = owned_by_h5mobaku;
+
+    memset(array, 0, sizeof(*array));
+    array->length = length;
+    array->n_buffers = 2;
+    array->buffers = priv->buffers;
+    array->release = release_array;
+    array->private_data = priv;
+}
+
+static int init_schema(struct ArrowSchema *schema, const char *format, const char *name, int64_t n_children) {
+    arrow_schema_private_t *priv = calloc(1, sizeof(arrow_schema_private_t));
+    if (!priv) return -1;
+
+    memset(schema, 0, sizeof(*schema));
+    schema->format = format;
+    schema->name = name;
+    schema->n_children = n_children;
+    schema->children = n_children > 0 ? priv->children : NULL;
+    schema->release = release_schema;
+    schema->private_data = priv;
+    return 0;
+}
+
+static struct ArrowArray *new_child_array(void) {
+    return calloc(1, sizeof(struct ArrowArray));
+}
+
+static struct ArrowSchema *new_child_schema(void) {
+    return calloc(1, sizeof(struct ArrowSchema));
+}
+
+static int build_schema(struct ArrowSchema *schema, int dict_mesh_ids) {
+    if (init_schema(schema, "+s", "", 3) < 0) return -1;
+
+    arrow_schema_private_t *priv = (arrow_schema_private_t*)schema->private_data;
+    for (int i = 0; i < 3; i++) {
+        priv->children[i] = new_child_schema();
+        if (!priv->children[i]) {
+            release_schema(schema);
+            return -1;
+        }
+    }
+
+    int ok = 0;
+    if (dict_mesh_ids) {
+        ok |= init_schema(priv->children[0], "i", "mesh_id", 0);
+        if (ok == 0) {
+            priv->children[0]->dictionary = new_child_schema();
+            if (!priv->children[0]->dictionary ||
+                init_schema(priv->children[0]->dictionary, "I", "", 0) < 0) {
+                ok = -1;
+            }
+        }
+    } else {
+        ok |= init_schema(priv->children[0], "I", "mesh_id", 0);
+    }
+    ok |= init_schema(priv->children[1], "tss:Asia/Tokyo", "timestamp", 0);
+    ok |= init_schema(priv->children[2], "i", "population", 0);
+
+    if (ok != 0) {
+        release_schema(schema);
+        return -1;
+    }
+    return 0;
+}
+
+int h5mobaku_arrow_export_time_mesh(int32_t *data, const uint32_t *mesh_ids, size_t num_meshes,
+                                    int start_time_index, size_t num_times, time_t start_datetime,
+                                    unsigned flags, struct ArrowArray *out_array, struct ArrowSchema *out_schema) {
+    if (!data || !mesh_ids || num_meshes == 0 || num_times == 0 ||
+        start_time_index < 0 || !out_array || !out_schema) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_arrow_export_time_mesh\n");
+        return -1;
+    }
+
+    const int dict_mesh_ids = (flags & H5MOBAKU_ARROW_DICT_MESH_IDS) != 0;
+    const size_t total = num_times * num_meshes;
+
+    // Mesh ID column (plain values or dictionary indices) and timestamp column
+    void *mesh_col = malloc(total * (dict_mesh_ids ? sizeof(int32_t) : sizeof(uint32_t)));
+    int64_t *ts_col = malloc(total * sizeof(int64_t));
+    uint32_t *dict_values = dict_mesh_ids ? malloc(num_meshes * sizeof(uint32_t)) : NULL;
+    if (!mesh_col || !ts_col || (dict_mesh_ids && !dict_values)) {
+        fprintf(stderr, "Error: Memory allocation failed for Arrow export columns\n");
+        free(mesh_col);
+        free(ts_col);
+        free(dict_values);
+        return -1;
+    }
+
+    for (size_t t = 0; t < num_times; t++) {
+        const int64_t ts = (int64_t)start_datetime + ((int64_t)start_time_index + (int64_t)t) * 3600;
+        int64_t *ts_row = ts_col + t * num_meshes;
+        for (size_t m = 0; m < num_meshes; m++) {
+            ts_row[m] = ts;
+        }
+        if (dict_mesh_ids) {
+            int32_t *idx_row = (int32_t*)mesh_col + t * num_meshes;
+            for (size_t m = 0; m < num_meshes; m++) {
+                idx_row[m] = (int32_t)m;
+            }
+        } else {
+            memcpy((uint32_t*)mesh_col + t * num_meshes, mesh_ids, num_meshes * sizeof(uint32_t));
+        }
+    }
+    if (dict_mesh_ids) {
+        memcpy(dict_values, mesh_ids, num_meshes * sizeof(uint32_t));
+    }
+
+    // Allocate every node up front so that wiring them together cannot fail
+    struct ArrowArray *children[3] = {new_child_array(), new_child_array(), new_child_array()};
+    struct ArrowArray *dictionary = dict_mesh_ids ? new_child_array() : NULL;
+    arrow_array_private_t *privs[5] = {0};
+    const int num_privs = dict_mesh_ids ? 5 : 4;
+    int alloc_ok = children[0] && children[1] && children[2] && (!dict_mesh_ids || dictionary);
+    for (int i = 0; i < num_privs; i++) {
+        privs[i] = calloc(1, sizeof(arrow_array_private_t));
+        if (!privs[i]) alloc_ok = 0;
+    }
+    if (!alloc_ok) {
+        fprintf(stderr, "Error: Memory allocation failed for Arrow export structures\n");
+        for (int i = 0; i < 3; i++) free(children[i]);
+        for (int i = 0; i < num_privs; i++) free(privs[i]);
+        free(dictionary);
+        free(mesh_col);
+        free(ts_col);
+        free(dict_values);
+        return -1;
+    }
+
+    init_primitive_array(children[0], privs[1], (int64_t)total, mesh_col, 0);
+    init_primitive_array(children[1], privs[2], (int64_t)total, ts_col, 0);
+    init_primitive_array(children[2], privs[3], (int64_t)total, data, 1);
+    if (dict_mesh_ids) {
+        init_primitive_array(dictionary, privs[4], (int64_t)num_meshes, dict_values, 0);
+        children[0]->dictionary = dictionary;
+    }
+
+    // Struct parent has only a (null) validity buffer
+    arrow_array_private_t *priv = privs[0];
+    priv->buffers[0] = NULL;
+    for (int i = 0; i < 3; i++) priv->children[i] = children[i];
+    memset(out_array, 0, sizeof(*out_array));
+    out_array->length = (int64_t)total;
+    out_array->n_buffers = 1;
+    out_array->n_children = 3;
+    out_array->buffers = priv->buffers;
+    out_array->children = priv->children;
+    out_array->release = release_array;
+    out_array->private_data = priv;
+
+    if (build_schema(out_schema, dict_mesh_ids) < 0) {
+        fprintf(stderr, "Error: Failed to build Arrow schema\n");
+        // Detach the population buffer so the caller keeps ownership
+        privs[3]->owned[1] = NULL;
+        release_array(out_array);
+        return -1;
+    }
+
+    return 0;
+}
+
+int h5mobaku_read_multi_mesh_time_series_arrow(struct h5mobaku *ctx, cmph_t *hash,
+                                               uint32_t *mesh_ids, size_t num_meshes,
+                                               int start_time_index, int end_time_index, unsigned flags,
+                                               struct ArrowArray *out_array, struct ArrowSchema *out_schema) {
+    if (!ctx || !ctx->h5r_ctx) {
+        fprintf(stderr, "Error: Invalid h5mobaku context\n");
+        return -1;
+    }
+
+    int32_t *data = h5mobaku_read_multi_mesh_time_series(ctx->h5r_ctx, hash, mesh_ids, num_meshes,
+                                                         start_time_index, end_time_index);
+    if (!data) return -1;
+
+    size_t num_times = (size_t)(end_time_index - start_time_index + 1);
+    if (h5mobaku_arrow_export_time_mesh(data, mesh_ids, num_meshes, start_time_index, num_times,
+                                        ctx->start_datetime, flags, out_array, out_schema) < 0) {
+        h5mobaku_free_data(data);
+        return -1;
+    }
+    return 0;
+}
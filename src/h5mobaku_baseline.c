@@ -0,0 +1,272 @@
+//
+// Hour-of-week baseline profiles and anomaly scoring
+//
+
+#include "h5mobaku_baseline.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BASELINE_STRIP_CELLS ((size_t)16 * 1024 * 1024)   // Hours x meshes read per strip when building
+#define ANOMALY_BAND_CELLS ((size_t)4 * 1024 * 1024)      // Default hours x meshes scored per tile
+#define ANOMALY_MIN_STRIP 1024                            // Meshes per tile before hours are cut instead
+#define MAD_TO_SIGMA 1.4826                               // MAD of a normal distribution is 0.6745 sigma
+#define SMALL_SORT 32
+
+int h5mobaku_parse_baseline_method(const char *name, h5mobaku_baseline_method_t *method) {
+    if (!name || !method) return -1;
+    if (strcmp(name, "mean") == 0) *method = H5MOBAKU_BASELINE_MEAN;
+    else if (strcmp(name, "median") == 0) *method = H5MOBAKU_BASELINE_MEDIAN;
+    else return -1;
+    return 0;
+}
+
+int h5mobaku_parse_score(const char *name, h5mobaku_score_t *score) {
+    if (!name || !score) return -1;
+    if (strcmp(name, "z") == 0) *score = H5MOBAKU_SCORE_Z;
+    else if (strcmp(name, "ratio") == 0) *score = H5MOBAKU_SCORE_RATIO;
+    else return -1;
+    return 0;
+}
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Samples per slot are few (one per week), so insertion sort wins below SMALL_SORT
+static void sort_samples(double *v, size_t n) {
+    if (n > SMALL_SORT) {
+        qsort(v, n, sizeof(double), compare_double);
+        return;
+    }
+    for (size_t i = 1; i < n; i++) {
+        const double x = v[i];
+        size_t j = i;
+        for (; j > 0 && v[j - 1] > x; j--) v[j] = v[j - 1];
+        v[j] = x;
+    }
+}
+
+static double sorted_median(const double *v, size_t n) {
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Profile of one strip: rows are weeks * 168 consecutive hours starting at slot `slot`, and out
+// receives center[168][width] followed by spread[168][width]
+static void strip_profile(const int32_t *strip, size_t weeks, size_t width, size_t slot,
+                          h5mobaku_baseline_method_t method, double *work, float *out) {
+    float *center = out, *spread = out + H5R_HOURS_PER_WEEK * width;
+    for (size_t h = 0; h < H5R_HOURS_PER_WEEK; h++) {
+        const size_t s = (slot + h) % H5R_HOURS_PER_WEEK;
+        float *cen = center + s * width, *spr = spread + s * width;
+        if (method == H5MOBAKU_BASELINE_MEAN) {
+            double *sum = work, *sumsq = work + width;
+            memset(work, 0, 2 * width * sizeof(double));
+            for (size_t w = 0; w < weeks; w++) {
+                const int32_t *x = strip + (w * H5R_HOURS_PER_WEEK + h) * width;
+                for (size_t c = 0; c < width; c++) {
+                    sum[c] += x[c];
+                    sumsq[c] += (double)x[c] * x[c];
+                }
+            }
+            for (size_t c = 0; c < width; c++) {
+                const double mean = sum[c] / weeks, var = sumsq[c] / weeks - mean * mean;
+                cen[c] = (float)mean;
+                spr[c] = (float)(var > 0.0 ? sqrt(var) : 0.0);
+            }
+            continue;
+        }
+        for (size_t c = 0; c < width; c++) {
+            for (size_t w = 0; w < weeks; w++) work[w] = strip[(w * H5R_HOURS_PER_WEEK + h) * width + c];
+            sort_samples(work, weeks);
+            const double median = sorted_median(work, weeks);
+            for (size_t w = 0; w < weeks; w++) work[w] = fabs(work[w] - median);
+            sort_samples(work, weeks);
+            cen[c] = (float)median;
+            spr[c] = (float)(MAD_TO_SIGMA * sorted_median(work, weeks));
+        }
+    }
+}
+
+int h5mobaku_build_baseline(struct h5mobaku *ctx, const h5mobaku_baseline_spec_t *spec) {
+    if (!ctx || !ctx->h5r_ctx || !spec || spec->weeks == 0 ||
+        (spec->method != H5MOBAKU_BASELINE_MEAN && spec->method != H5MOBAKU_BASELINE_MEDIAN)) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_build_baseline\n");
+        return -1;
+    }
+    h5r_metadata_t meta;
+    if (h5r_get_metadata(ctx->h5r_ctx, &meta) < 0) return -1;
+    const uint64_t end = spec->end_time < 0 ? meta.rows - 1 : (uint64_t)spec->end_time;
+    if (meta.rows == 0 || end >= meta.rows || end + 1 < H5R_HOURS_PER_WEEK) {
+        fprintf(stderr, "Error: Baseline needs at least one whole week ending within the file\n");
+        return -1;
+    }
+    const size_t weeks = (end + 1) / H5R_HOURS_PER_WEEK < spec->weeks ? (end + 1) / H5R_HOURS_PER_WEEK : spec->weeks;
+    const uint64_t start = end + 1 - weeks * H5R_HOURS_PER_WEEK, nrows = weeks * H5R_HOURS_PER_WEEK;
+
+    // Hour of the week (Monday 00:00 = 0) of row 0
+    struct tm tm;
+    if (!localtime_r(&ctx->start_datetime, &tm)) return -1;
+    const h5r_baseline_info_t info = {
+        .start = start,
+        .end = end,
+        .slot0 = (uint64_t)((tm.tm_wday + 6) % 7) * 24 + (uint64_t)tm.tm_hour,
+        .method = (uint64_t)spec->method,
+    };
+
+    // Strips of whole chunk columns, as wide as the cell budget allows
+    const uint64_t ccols = meta.ccols > 0 ? meta.ccols : 1;
+    uint64_t width = BASELINE_STRIP_CELLS / nrows / ccols * ccols;
+    if (width < ccols) width = ccols;
+    if (width > meta.cols) width = meta.cols;
+
+    int32_t *strip = malloc((size_t)nrows * width * sizeof(int32_t));
+    float *profile = malloc(2 * H5R_HOURS_PER_WEEK * width * sizeof(float));
+    double *work = malloc((weeks > 2 * width ? weeks : 2 * width) * sizeof(double));
+    if (!strip || !profile || !work) {
+        fprintf(stderr, "Error: Memory allocation failed for baseline buffers\n");
+        free(strip);
+        free(profile);
+        free(work);
+        return -1;
+    }
+
+    int ret = h5r_create_baseline(ctx->h5r_ctx, &info);
+    for (uint64_t col0 = 0; ret == 0 && col0 < meta.cols; col0 += width) {
+        const uint64_t n = meta.cols - col0 < width ? meta.cols - col0 : width;
+        const h5r_block_t block = {.dcol0 = col0, .mcol0 = 0, .ncols = n};
+        if (h5r_read_blocks_union(ctx->h5r_ctx, start, nrows, &block, 1, strip, n) < 0) {
+            fprintf(stderr, "Error: Failed to read meshes %lu-%lu for baseline\n", (unsigned long)col0,
+                    (unsigned long)(col0 + n - 1));
+            ret = -1;
+            break;
+        }
+        strip_profile(strip, weeks, n, (start + info.slot0) % H5R_HOURS_PER_WEEK, spec->method, work, profile);
+        ret = h5r_write_baseline(ctx->h5r_ctx, col0, n, profile);
+    }
+    if (ret < 0) fprintf(stderr, "Error: Failed to build baseline\n");
+
+    free(strip);
+    free(profile);
+    free(work);
+    return ret;
+}
+
+int h5mobaku_baseline_info(struct h5r *h5_ctx, h5r_baseline_info_t *info) {
+    if (!h5_ctx || !info) return -1;
+    return h5r_read_baseline(h5_ctx, info, NULL, 0, NULL);
+}
+
+int h5mobaku_anomaly_stream(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                            int start_time, int end_time, const h5mobaku_anomaly_spec_t *spec,
+                            h5mobaku_anomaly_sink_t sink, void *user) {
+    h5r_metadata_t meta;
+    if (!h5_ctx || !spec || !sink || start_time < 0 || end_time < start_time || !(spec->min_divisor > 0.0) ||
+        (spec->score != H5MOBAKU_SCORE_Z && spec->score != H5MOBAKU_SCORE_RATIO) ||
+        (mesh_ids && (!hash || num_meshes == 0)) || h5r_get_metadata(h5_ctx, &meta) < 0 ||
+        (uint64_t)end_time >= meta.rows) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_anomaly_stream\n");
+        return -1;
+    }
+    h5r_baseline_info_t info;
+    if (h5r_read_baseline(h5_ctx, &info, NULL, 0, NULL) < 0) {
+        fprintf(stderr, "Error: File has no baseline (see h5mobaku_build_baseline)\n");
+        return -1;
+    }
+
+    const size_t m = mesh_ids ? num_meshes : (size_t)meta.cols;
+    const size_t hours = (size_t)(end_time - start_time + 1);
+    const size_t cells = spec->band_cells > 0 ? spec->band_cells : ANOMALY_BAND_CELLS;
+
+    // Tiles keep every hour for as many meshes as fit; past ANOMALY_MIN_STRIP meshes the hours are
+    // cut instead. Whole-file strips follow the chunk columns.
+    size_t width = m;
+    if (m * hours > cells) {
+        width = cells / hours;
+        if (width < ANOMALY_MIN_STRIP) width = ANOMALY_MIN_STRIP;
+        if (!mesh_ids && meta.ccols > 0 && width > meta.ccols) width = width / meta.ccols * meta.ccols;
+        if (width > m) width = m;
+    }
+    size_t band = cells / width;
+    if (band < 1) band = 1;
+    if (band > hours) band = hours;
+
+    uint64_t *cols = malloc(m * sizeof(uint64_t));
+    uint64_t *rows = malloc(band * sizeof(uint64_t));
+    float *base = malloc(2 * H5R_HOURS_PER_WEEK * width * sizeof(float));
+    int32_t *values = malloc(band * width * sizeof(int32_t));
+    double *scores = malloc(band * width * sizeof(double));
+    int ret = -1;
+    if (!cols || !rows || !base || !values || !scores) {
+        fprintf(stderr, "Error: Memory allocation failed for anomaly scoring buffers\n");
+        goto out;
+    }
+    if (h5mobaku_mesh_columns(h5_ctx, hash, mesh_ids, m, cols) < 0) goto out;
+
+    const double floor = spec->min_divisor;
+    for (size_t m0 = 0; m0 < m; m0 += width) {
+        const size_t w = m - m0 < width ? m - m0 : width;
+        if (h5r_read_baseline(h5_ctx, NULL, cols + m0, w, base) < 0) {
+            fprintf(stderr, "Error: Failed to read baseline\n");
+            goto out;
+        }
+        for (size_t t0 = 0; t0 < hours; t0 += band) {
+            const size_t n = hours - t0 < band ? hours - t0 : band;
+            for (size_t i = 0; i < n; i++) rows[i] = (uint64_t)start_time + t0 + i;
+            if (h5r_read_columns_range(h5_ctx, rows, n, cols + m0, w, values) < 0) {
+                fprintf(stderr, "Error: Failed to read hours %lu-%lu for anomaly scoring\n", (unsigned long)rows[0],
+                        (unsigned long)rows[n - 1]);
+                goto out;
+            }
+            for (size_t i = 0; i < n; i++) {
+                const size_t s = (rows[i] + info.slot0) % H5R_HOURS_PER_WEEK;
+                const float *cen = base + s * w, *spr = base + (H5R_HOURS_PER_WEEK + s) * w;
+                const int32_t *x = values + i * w;
+                double *o = scores + i * w;
+                if (spec->score == H5MOBAKU_SCORE_Z) {
+                    for (size_t c = 0; c < w; c++) o[c] = (x[c] - (double)cen[c]) / fmax((double)spr[c], floor);
+                } else {
+                    for (size_t c = 0; c < w; c++) o[c] = x[c] / fmax((double)cen[c], floor);
+                }
+            }
+            if (sink(user, start_time + (int)t0, n, m0, w, scores) != 0) goto out;
+        }
+    }
+    ret = 0;
+
+out:
+    free(cols);
+    free(rows);
+    free(base);
+    free(values);
+    free(scores);
+    return ret;
+}
+
+double* h5mobaku_read_anomaly(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                              int start_time, int end_time, const h5mobaku_anomaly_spec_t *spec) {
+    size_t time_points = 0, mesh_count = 0;
+    if (!mesh_ids && h5r_get_dimensions(h5_ctx, &time_points, &mesh_count) == 0) num_meshes = mesh_count;
+    if (num_meshes == 0 || start_time < 0 || end_time < start_time) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_anomaly\n");
+        return NULL;
+    }
+    h5mobaku_collect_t collect = {
+        .data = malloc((size_t)(end_time - start_time + 1) * num_meshes * sizeof(double)),
+        .start_time = start_time,
+        .num_meshes = num_meshes,
+    };
+    if (!collect.data) {
+        fprintf(stderr, "Error: Memory allocation failed for anomaly scores\n");
+        return NULL;
+    }
+    if (h5mobaku_anomaly_stream(h5_ctx, hash, mesh_ids, num_meshes, start_time, end_time, spec,
+                                h5mobaku_collect_sink, &collect) < 0) {
+        free(collect.data);
+        return NULL;
+    }
+    return collect.data;
+}
@@ -0,0 +1,323 @@
+//
+// Demographic breakdown dataset
+//
+
+#include "h5mobaku_breakdown.h"
+#include <hdf5.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CATEGORY_FIELDS 3
+#define CATEGORY_CHUNK 64               // Rows per chunk of breakdown_categories
+#define BREAKDOWN_CACHE_BYTES (32 * 1024 * 1024)
+
+struct h5mobaku_breakdown {
+    hid_t file, dset, cat_dset;
+    hsize_t rows, cols, ncat;           // Current extent of population_breakdown
+    int writable;
+    h5mobaku_category_t *categories;
+    size_t capacity;
+};
+
+static int create_datasets(hid_t file, const h5mobaku_breakdown_config_t *config) {
+    // Mesh columns follow population_data
+    hid_t pop = H5Dopen2(file, "population_data", H5P_DEFAULT);
+    if (pop < 0) {
+        fprintf(stderr, "Error: population_data not found; breakdown needs its mesh columns\n");
+        return -1;
+    }
+    hid_t pop_space = H5Dget_space(pop);
+    hsize_t pop_dims[2] = {0, 0};
+    int rank = H5Sget_simple_extent_dims(pop_space, pop_dims, NULL);
+    H5Sclose(pop_space);
+    H5Dclose(pop);
+    if (rank != 2 || pop_dims[1] == 0) {
+        fprintf(stderr, "Error: Unexpected population_data shape\n");
+        return -1;
+    }
+
+    // Starts with no time points and no categories; both grow as data is stored
+    hsize_t dims[3] = {0, pop_dims[1], 0};
+    hsize_t maxdims[3] = {H5S_UNLIMITED, pop_dims[1], H5S_UNLIMITED};
+    hsize_t chunk[3] = {config->chunk_time_size, 1, config->chunk_categories};
+    hid_t space = H5Screate_simple(3, dims, maxdims);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 3, chunk);
+    if (config->compression_level > 0) {
+        H5Pset_deflate(dcpl, config->compression_level);
+    }
+    int32_t fill_value = 0;
+    H5Pset_fill_value(dcpl, H5T_NATIVE_INT32, &fill_value);
+    hid_t dset = H5Dcreate2(file, H5MOBAKU_BREAKDOWN_DATASET, H5T_NATIVE_INT32, space,
+                            H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    if (dset < 0) {
+        fprintf(stderr, "Error: Failed to create %s\n", H5MOBAKU_BREAKDOWN_DATASET);
+        return -1;
+    }
+    H5Dclose(dset);
+
+    hsize_t cat_dims[2] = {0, CATEGORY_FIELDS};
+    hsize_t cat_maxdims[2] = {H5S_UNLIMITED, CATEGORY_FIELDS};
+    hsize_t cat_chunk[2] = {CATEGORY_CHUNK, CATEGORY_FIELDS};
+    space = H5Screate_simple(2, cat_dims, cat_maxdims);
+    dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 2, cat_chunk);
+    dset = H5Dcreate2(file, H5MOBAKU_BREAKDOWN_CATEGORIES, H5T_NATIVE_INT32, space,
+                      H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    if (dset < 0) {
+        fprintf(stderr, "Error: Failed to create %s\n", H5MOBAKU_BREAKDOWN_CATEGORIES);
+        return -1;
+    }
+    H5Dclose(dset);
+    return 0;
+}
+
+static int load_categories(h5mobaku_breakdown_t *bd) {
+    hid_t space = H5Dget_space(bd->cat_dset);
+    hsize_t dims[2] = {0, 0};
+    int rank = H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+    if (rank != 2 || dims[1] != CATEGORY_FIELDS || dims[0] != bd->ncat) {
+        fprintf(stderr, "Error: %s does not match %s\n", H5MOBAKU_BREAKDOWN_CATEGORIES, H5MOBAKU_BREAKDOWN_DATASET);
+        return -1;
+    }
+    bd->capacity = dims[0] > 16 ? dims[0] : 16;
+    bd->categories = malloc(bd->capacity * sizeof(h5mobaku_category_t));
+    if (!bd->categories) {
+        fprintf(stderr, "Error: Memory allocation failed for breakdown categories\n");
+        return -1;
+    }
+    if (dims[0] > 0 &&
+        H5Dread(bd->cat_dset, H5T_NATIVE_INT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, bd->categories) < 0) {
+        fprintf(stderr, "Error: Failed to read %s\n", H5MOBAKU_BREAKDOWN_CATEGORIES);
+        return -1;
+    }
+    return 0;
+}
+
+int h5mobaku_breakdown_exists(const char *path) {
+    if (!path) return -1;
+    hid_t file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file < 0) return -1;
+    int exists = H5Lexists(file, H5MOBAKU_BREAKDOWN_DATASET, H5P_DEFAULT) > 0;
+    H5Fclose(file);
+    return exists;
+}
+
+int h5mobaku_breakdown_open(const char *path, int writable, const h5mobaku_breakdown_config_t *config,
+                            h5mobaku_breakdown_t **out) {
+    if (!path || !out) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_breakdown_open\n");
+        return -1;
+    }
+    h5mobaku_breakdown_config_t actual_config = H5MOBAKU_BREAKDOWN_DEFAULT_CONFIG;
+    if (config) actual_config = *config;
+    if (actual_config.chunk_time_size == 0 || actual_config.chunk_categories == 0) {
+        fprintf(stderr, "Error: Breakdown chunk dimensions must be positive\n");
+        return -1;
+    }
+
+    h5mobaku_breakdown_t *bd = calloc(1, sizeof(*bd));
+    if (!bd) {
+        fprintf(stderr, "Error: Memory allocation failed for breakdown context\n");
+        return -1;
+    }
+    bd->dset = bd->cat_dset = -1;
+    bd->writable = writable;
+
+    bd->file = H5Fopen(path, writable ? H5F_ACC_RDWR : H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (bd->file < 0) {
+        fprintf(stderr, "Error: Failed to open %s\n", path);
+        free(bd);
+        return -1;
+    }
+
+    if (H5Lexists(bd->file, H5MOBAKU_BREAKDOWN_DATASET, H5P_DEFAULT) <= 0) {
+        if (!writable) {
+            fprintf(stderr, "Error: %s has no %s dataset\n", path, H5MOBAKU_BREAKDOWN_DATASET);
+            h5mobaku_breakdown_close(bd);
+            return -1;
+        }
+        if (create_datasets(bd->file, &actual_config) < 0) {
+            h5mobaku_breakdown_close(bd);
+            return -1;
+        }
+    }
+
+    // A chunk holds a whole time band of one mesh; keep a few of them cached for read-modify-write
+    hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    H5Pset_chunk_cache(dapl, 10007, BREAKDOWN_CACHE_BYTES, 0.75);
+    bd->dset = H5Dopen2(bd->file, H5MOBAKU_BREAKDOWN_DATASET, dapl);
+    H5Pclose(dapl);
+    bd->cat_dset = H5Dopen2(bd->file, H5MOBAKU_BREAKDOWN_CATEGORIES, H5P_DEFAULT);
+    if (bd->dset < 0 || bd->cat_dset < 0) {
+        fprintf(stderr, "Error: Failed to open breakdown datasets in %s\n", path);
+        h5mobaku_breakdown_close(bd);
+        return -1;
+    }
+
+    hid_t space = H5Dget_space(bd->dset);
+    hsize_t dims[3] = {0, 0, 0};
+    int rank = H5Sget_simple_extent_dims(space, dims, NULL);
+    H5Sclose(space);
+    if (rank != 3) {
+        fprintf(stderr, "Error: %s must be 3-dimensional\n", H5MOBAKU_BREAKDOWN_DATASET);
+        h5mobaku_breakdown_close(bd);
+        return -1;
+    }
+    bd->rows = dims[0];
+    bd->cols = dims[1];
+    bd->ncat = dims[2];
+
+    if (load_categories(bd) < 0) {
+        h5mobaku_breakdown_close(bd);
+        return -1;
+    }
+
+    *out = bd;
+    return 0;
+}
+
+void h5mobaku_breakdown_close(h5mobaku_breakdown_t *bd) {
+    if (!bd) return;
+    if (bd->cat_dset >= 0) H5Dclose(bd->cat_dset);
+    if (bd->dset >= 0) H5Dclose(bd->dset);
+    if (bd->file >= 0) H5Fclose(bd->file);
+    free(bd->categories);
+    free(bd);
+}
+
+int h5mobaku_breakdown_get_dimensions(const h5mobaku_breakdown_t *bd, size_t *time_points, size_t *mesh_count) {
+    if (!bd) return -1;
+    if (time_points) *time_points = (size_t)bd->rows;
+    if (mesh_count) *mesh_count = (size_t)bd->cols;
+    return 0;
+}
+
+const h5mobaku_category_t *h5mobaku_breakdown_categories(const h5mobaku_breakdown_t *bd, size_t *count) {
+    if (!bd) return NULL;
+    if (count) *count = (size_t)bd->ncat;
+    return bd->categories;
+}
+
+int h5mobaku_breakdown_find_category(const h5mobaku_breakdown_t *bd, h5mobaku_category_t category) {
+    if (!bd) return -1;
+    // A handful of categories per file; a linear scan beats any index
+    for (size_t i = 0; i < bd->ncat; i++) {
+        const h5mobaku_category_t *c = &bd->categories[i];
+        if (c->residence == category.residence && c->age == category.age && c->gender == category.gender) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+int h5mobaku_breakdown_add_category(h5mobaku_breakdown_t *bd, h5mobaku_category_t category) {
+    int index = h5mobaku_breakdown_find_category(bd, category);
+    if (index >= 0 || !bd) return index;
+    if (!bd->writable) {
+        fprintf(stderr, "Error: Breakdown opened read-only\n");
+        return -1;
+    }
+
+    if (bd->ncat == bd->capacity) {
+        size_t new_capacity = bd->capacity * 2;
+        h5mobaku_category_t *grown = realloc(bd->categories, new_capacity * sizeof(h5mobaku_category_t));
+        if (!grown) {
+            fprintf(stderr, "Error: Memory allocation failed for breakdown categories\n");
+            return -1;
+        }
+        bd->categories = grown;
+        bd->capacity = new_capacity;
+    }
+
+    // Append the row to the table, then widen the data; new category columns read as 0
+    hsize_t row = bd->ncat;
+    hsize_t cat_dims[2] = {row + 1, CATEGORY_FIELDS};
+    hsize_t dims[3] = {bd->rows, bd->cols, row + 1};
+    if (H5Dset_extent(bd->cat_dset, cat_dims) < 0) {
+        fprintf(stderr, "Error: Failed to extend %s\n", H5MOBAKU_BREAKDOWN_CATEGORIES);
+        return -1;
+    }
+    hid_t fsp = H5Dget_space(bd->cat_dset);
+    H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row, 0}, NULL, (hsize_t[]){1, CATEGORY_FIELDS}, NULL);
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){CATEGORY_FIELDS}, NULL);
+    herr_t status = H5Dwrite(bd->cat_dset, H5T_NATIVE_INT32, msp, fsp, H5P_DEFAULT, &category);
+    H5Sclose(msp);
+    H5Sclose(fsp);
+    if (status < 0 || H5Dset_extent(bd->dset, dims) < 0) {
+        fprintf(stderr, "Error: Failed to add breakdown category\n");
+        return -1;
+    }
+
+    bd->categories[bd->ncat++] = category;
+    return (int)row;
+}
+
+int h5mobaku_breakdown_read(h5mobaku_breakdown_t *bd, uint64_t col, uint64_t row0, uint64_t nrows, int32_t *values) {
+    if (!bd || !values || col >= bd->cols || nrows == 0) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_breakdown_read\n");
+        return -1;
+    }
+    if (bd->ncat == 0) return 0;
+
+    // Time points not stored yet are zero like the fill value
+    uint64_t stored = row0 < bd->rows ? bd->rows - row0 : 0;
+    if (stored > nrows) stored = nrows;
+    if (stored < nrows) {
+        memset(values + stored * bd->ncat, 0, (nrows - stored) * bd->ncat * sizeof(int32_t));
+    }
+    if (stored == 0) return 0;
+
+    hid_t fsp = H5Dget_space(bd->dset);
+    H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row0, col, 0}, NULL,
+                        (hsize_t[]){stored, 1, bd->ncat}, NULL);
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){stored * bd->ncat}, NULL);
+    herr_t status = H5Dread(bd->dset, H5T_NATIVE_INT32, msp, fsp, H5P_DEFAULT, values);
+    H5Sclose(msp);
+    H5Sclose(fsp);
+    return status < 0 ? -1 : 0;
+}
+
+int h5mobaku_breakdown_write(h5mobaku_breakdown_t *bd, uint64_t col, uint64_t row0, uint64_t nrows, const int32_t *values) {
+    if (!bd || !values || col >= bd->cols || nrows == 0) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_breakdown_write\n");
+        return -1;
+    }
+    if (!bd->writable) {
+        fprintf(stderr, "Error: Breakdown opened read-only\n");
+        return -1;
+    }
+    if (bd->ncat == 0) {
+        fprintf(stderr, "Error: No breakdown categories defined\n");
+        return -1;
+    }
+
+    if (row0 + nrows > bd->rows) {
+        hsize_t dims[3] = {row0 + nrows, bd->cols, bd->ncat};
+        if (H5Dset_extent(bd->dset, dims) < 0) {
+            fprintf(stderr, "Error: Failed to extend %s\n", H5MOBAKU_BREAKDOWN_DATASET);
+            return -1;
+        }
+        bd->rows = dims[0];
+    }
+
+    hid_t fsp = H5Dget_space(bd->dset);
+    H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row0, col, 0}, NULL,
+                        (hsize_t[]){nrows, 1, bd->ncat}, NULL);
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){nrows * bd->ncat}, NULL);
+    herr_t status = H5Dwrite(bd->dset, H5T_NATIVE_INT32, msp, fsp, H5P_DEFAULT, values);
+    H5Sclose(msp);
+    H5Sclose(fsp);
+    return status < 0 ? -1 : 0;
+}
+
+int h5mobaku_breakdown_flush(h5mobaku_breakdown_t *bd) {
+    if (!bd) return -1;
+    return H5Fflush(bd->file, H5F_SCOPE_LOCAL) < 0 ? -1 : 0;
+}
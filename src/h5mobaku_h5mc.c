@@ -0,0 +1,186 @@
+//
+// Reader for the .h5mc partition files written by h5m-export
+//
+
+#include "h5mobaku_h5mc.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define H5MC_FOOTER_TAIL_BYTES 12   // u64 footer_offset followed by the magic
+
+// Bounds-checked little-endian cursor over the file contents
+typedef struct {
+    const uint8_t *p, *end;
+} h5mc_cursor_t;
+
+static int get_u16le(h5mc_cursor_t *c, uint16_t *v) {
+    if (c->end - c->p < 2) return -1;
+    *v = (uint16_t)(c->p[0] | c->p[1] << 8);
+    c->p += 2;
+    return 0;
+}
+
+static int get_u32le(h5mc_cursor_t *c, uint32_t *v) {
+    if (c->end - c->p < 4) return -1;
+    *v = 0;
+    for (int i = 0; i < 4; i++) *v |= (uint32_t)c->p[i] << (8 * i);
+    c->p += 4;
+    return 0;
+}
+
+static int get_u64le(h5mc_cursor_t *c, uint64_t *v) {
+    if (c->end - c->p < 8) return -1;
+    *v = 0;
+    for (int i = 0; i < 8; i++) *v |= (uint64_t)c->p[i] << (8 * i);
+    c->p += 8;
+    return 0;
+}
+
+static int get_zigzag(h5mc_cursor_t *c, int64_t *v) {
+    uint64_t u = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (c->p >= c->end) return -1;
+        const uint8_t b = *c->p++;
+        u |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *v = (int64_t)(u >> 1) ^ -(int64_t)(u & 1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// Decode the row group at c into columns col0.. of out; returns the number of meshes or -1
+static int64_t read_row_group(h5mc_cursor_t c, h5mobaku_h5mc_t *out, uint32_t col0) {
+    uint32_t ncols, dict_bytes;
+    if (get_u32le(&c, &ncols) < 0 || get_u32le(&c, &dict_bytes) < 0 || ncols > out->num_meshes - col0 ||
+        (size_t)(c.end - c.p) < dict_bytes) {
+        return -1;
+    }
+
+    h5mc_cursor_t dict = {c.p, c.p + dict_bytes};
+    int64_t id = 0;
+    for (uint32_t m = 0; m < ncols; m++) {
+        int64_t delta;
+        if (get_zigzag(&dict, &delta) < 0) return -1;
+        id += delta;
+        if (id < 0 || id > UINT32_MAX) return -1;
+        out->mesh_ids[col0 + m] = (uint32_t)id;
+    }
+    c.p += dict_bytes;
+
+    h5mc_cursor_t lengths = {c.p, c.p};
+    if ((size_t)(c.end - c.p) / 4 < ncols) return -1;
+    lengths.end = c.p += (size_t)ncols * 4;
+    for (uint32_t m = 0; m < ncols; m++) {
+        uint32_t len;
+        get_u32le(&lengths, &len);
+        if ((size_t)(c.end - c.p) < len) return -1;
+        h5mc_cursor_t series = {c.p, c.p + len};
+        int32_t *dst = out->values + (size_t)(col0 + m) * out->num_times;
+        int64_t value = 0;
+        for (uint32_t t = 0; t < out->num_times; t++) {
+            int64_t delta;
+            if (get_zigzag(&series, &delta) < 0) return -1;
+            value += delta;
+            dst[t] = (int32_t)value;
+        }
+        if (series.p != series.end) return -1;
+        c.p += len;
+    }
+    return ncols;
+}
+
+static int decode_h5mc(const uint8_t *data, size_t size, h5mobaku_h5mc_t *out) {
+    h5mc_cursor_t c = {data, data + size};
+    uint16_t version, flags;
+    uint32_t year, mesh1;
+    uint64_t start_epoch;
+    if (size < H5MC_HEADER_BYTES + 4 + H5MC_FOOTER_TAIL_BYTES || memcmp(data, H5MC_MAGIC, 4) != 0 ||
+        memcmp(data + size - 4, H5MC_MAGIC, 4) != 0) {
+        return -1;
+    }
+    c.p += 4;
+    get_u16le(&c, &version);
+    get_u16le(&c, &flags);
+    get_u32le(&c, &year);
+    get_u32le(&c, &mesh1);
+    get_u64le(&c, &start_epoch);
+    get_u32le(&c, &out->num_times);
+    get_u32le(&c, &out->num_meshes);
+    // Every value takes at least one byte, which also bounds the allocation below
+    if (version != H5MC_VERSION || (uint64_t)out->num_meshes * out->num_times > size) return -1;
+    out->year = (int32_t)year;
+    out->mesh1 = mesh1;
+    out->start_epoch = (int64_t)start_epoch;
+
+    uint64_t footer_offset;
+    h5mc_cursor_t tail = {data + size - H5MC_FOOTER_TAIL_BYTES, data + size};
+    get_u64le(&tail, &footer_offset);
+    if (footer_offset < H5MC_HEADER_BYTES || footer_offset > size - H5MC_FOOTER_TAIL_BYTES - 4) return -1;
+    h5mc_cursor_t footer = {data + footer_offset, data + size - H5MC_FOOTER_TAIL_BYTES};
+    uint32_t num_row_groups;
+    get_u32le(&footer, &num_row_groups);
+    if ((size_t)(footer.end - footer.p) != (size_t)num_row_groups * 8) return -1;
+
+    out->mesh_ids = malloc(((size_t)out->num_meshes + 1) * sizeof(uint32_t));
+    out->values = malloc(((size_t)out->num_meshes * out->num_times + 1) * sizeof(int32_t));
+    if (!out->mesh_ids || !out->values) {
+        fprintf(stderr, "Error: Memory allocation failed for h5mc contents\n");
+        return -1;
+    }
+
+    uint32_t col = 0;
+    for (uint32_t r = 0; r < num_row_groups; r++) {
+        uint64_t offset;
+        get_u64le(&footer, &offset);
+        if (offset < H5MC_HEADER_BYTES || offset >= footer_offset) return -1;
+        const int64_t n = read_row_group((h5mc_cursor_t){data + offset, data + footer_offset}, out, col);
+        if (n < 0) return -1;
+        col += (uint32_t)n;
+    }
+    return col == out->num_meshes ? 0 : -1;
+}
+
+int h5mobaku_read_h5mc(const char *path, h5mobaku_h5mc_t *out) {
+    if (!path || !out) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_h5mc\n");
+        return -1;
+    }
+    memset(out, 0, sizeof(*out));
+
+    FILE *fp = fopen(path, "rb");
+    if (!fp) {
+        fprintf(stderr, "Error: Cannot open %s\n", path);
+        return -1;
+    }
+    uint8_t *data = NULL;
+    long size = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) size = ftell(fp);
+    if (size >= 0 && fseek(fp, 0, SEEK_SET) == 0) data = malloc((size_t)size + 1);
+    const int read_ok = data && fread(data, 1, (size_t)size, fp) == (size_t)size;
+    fclose(fp);
+    if (!read_ok) {
+        fprintf(stderr, "Error: Failed to read %s\n", path);
+        free(data);
+        return -1;
+    }
+
+    const int ret = decode_h5mc(data, (size_t)size, out);
+    free(data);
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s is not a valid h5mc file\n", path);
+        h5mobaku_h5mc_free(out);
+        return -1;
+    }
+    return 0;
+}
+
+void h5mobaku_h5mc_free(h5mobaku_h5mc_t *h5mc) {
+    if (!h5mc) return;
+    free(h5mc->mesh_ids);
+    free(h5mc->values);
+    h5mc->mesh_ids = NULL;
+    h5mc->values = NULL;
+}
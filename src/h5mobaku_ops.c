@@ -9,6 +9,13 @@
 #include <stdlib.h>
 #include <hdf5.h>
 #include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "env_utils.h"
+#include "mesh_dict.h"
+#include "large_buffer.h"
 
 // Helper functions for common operations
 static int validate_h5mobaku_context(struct h5mobaku *ctx) {
@@ -35,9 +42,9 @@ static int validate_basic_params(struct h5r *h5_ctx, cmph_t *hash) {
     return 0;
 }
 
-static uint64_t get_mesh_index(cmph_t *hash, uint32_t mesh_id) {
-    uint32_t mesh_index = meshid_search_id(hash, mesh_id);
-    if (mesh_index == MESHID_NOT_FOUND || mesh_index >= MOBAKU_MESH_COUNT) {
+static uint64_t get_mesh_index(struct h5r *h5_ctx, cmph_t *hash, uint32_t mesh_id) {
+    uint32_t mesh_index = h5mobaku_mesh_index(h5_ctx, hash, mesh_id);
+    if (mesh_index == MESHID_NOT_FOUND) {
         return UINT64_MAX; // Error indicator
     }
     return (uint64_t)mesh_index;
@@ -51,17 +58,271 @@ static void* safe_malloc(size_t size, const char *description) {
     return ptr;
 }
 
+// Results at least this large are first-touched in parallel, interleaved over the NUMA nodes
+#define LARGE_RESULT_BYTES ((size_t)64 * 1024 * 1024)
+
+// Result buffer released by h5mobaku_free_data
+static int32_t* alloc_result(size_t count, const char *description) {
+    const size_t bytes = count * sizeof(int32_t);
+    if (bytes >= LARGE_RESULT_BYTES) {
+        int32_t *buf = (int32_t*)large_buffer_alloc(bytes, NULL);
+        if (buf) return buf;
+    }
+    return (int32_t*)safe_malloc(bytes, description);
+}
+
 static void cleanup_multi_arrays(uint64_t *mesh_indices, int32_t *results) {
     if (mesh_indices) free(mesh_indices);
     if (results) free(results);
 }
 
+// Parse the start_datetime attribute collected by h5r into the wrapper
+static int set_start_datetime(struct h5mobaku *ctx, const char *value) {
+    if (!value || value[0] == '\0') {
+        fprintf(stderr, "Error: start_datetime attribute not found in HDF5 file\n");
+        return -1;
+    }
+    ctx->start_datetime_str = strdup(value);
+    if (!ctx->start_datetime_str) {
+        fprintf(stderr, "Error: Memory allocation failed for start_datetime_str\n");
+        return -1;
+    }
+
+    // Parse the datetime string to time_t
+    struct tm tm = {0};
+    if (strptime(ctx->start_datetime_str, "%Y-%m-%d %H:%M:%S", &tm) != NULL) {
+        ctx->start_datetime = mktime(&tm);
+    } else if (strptime(ctx->start_datetime_str, "%Y-%m-%dT%H:%M:%S", &tm) != NULL) {
+        ctx->start_datetime = mktime(&tm);
+    } else {
+        fprintf(stderr, "Error: Failed to parse start_datetime string '%s'\n", ctx->start_datetime_str);
+        free(ctx->start_datetime_str);
+        ctx->start_datetime_str = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* ===============================================
+ *  Metadata cache
+ *  Fixed-size entries in one file, at most one per data file (device and inode);
+ *  an entry is valid while the data file keeps the same size and mtime. Writers
+ *  replace a file's entry and drop the oldest entries beyond the cap, under flock.
+ * =============================================== */
+
+#define METADATA_CACHE_MAGIC 0x4D4D3548u  // "H5MM"
+#define METADATA_CACHE_VERSION 1
+#define METADATA_CACHE_MAX_ENTRIES 256
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t dev;
+    uint64_t ino;
+    int64_t size;
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    h5r_metadata_t meta;
+} metadata_cache_entry_t;
+
+static void metadata_cache_key(const struct stat *st, metadata_cache_entry_t *entry) {
+    memset(entry, 0, sizeof(*entry));
+    entry->magic = METADATA_CACHE_MAGIC;
+    entry->version = METADATA_CACHE_VERSION;
+    entry->dev = (uint64_t)st->st_dev;
+    entry->ino = (uint64_t)st->st_ino;
+    entry->size = (int64_t)st->st_size;
+    entry->mtime_sec = (int64_t)st->st_mtim.tv_sec;
+    entry->mtime_nsec = (int64_t)st->st_mtim.tv_nsec;
+}
+
+static int metadata_cache_same_file(const metadata_cache_entry_t *a, const metadata_cache_entry_t *b) {
+    return a->magic == b->magic && a->version == b->version && a->dev == b->dev && a->ino == b->ino;
+}
+
+// Whole entries of a locked cache file (one spare slot for the caller); NULL when it holds none
+static metadata_cache_entry_t *metadata_cache_read(int fd, size_t *count) {
+    *count = 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(metadata_cache_entry_t)) return NULL;
+    size_t n = (size_t)st.st_size / sizeof(metadata_cache_entry_t);
+    metadata_cache_entry_t *entries = malloc((n + 1) * sizeof(metadata_cache_entry_t));
+    if (!entries) return NULL;
+    ssize_t got = pread(fd, entries, n * sizeof(metadata_cache_entry_t), 0);
+    if (got < 0) {
+        free(entries);
+        return NULL;
+    }
+    *count = (size_t)got / sizeof(metadata_cache_entry_t);
+    return entries;
+}
+
+static int metadata_cache_lookup(const char *cache_path, const metadata_cache_entry_t *key, h5r_metadata_t *meta) {
+    int fd = open(cache_path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    flock(fd, LOCK_SH);
+    size_t count = 0;
+    metadata_cache_entry_t *entries = metadata_cache_read(fd, &count);
+    close(fd);
+
+    int found = 0;
+    for (size_t i = 0; i < count && !found; i++) {
+        const metadata_cache_entry_t *entry = &entries[i];
+        if (metadata_cache_same_file(entry, key) && entry->size == key->size &&
+            entry->mtime_sec == key->mtime_sec && entry->mtime_nsec == key->mtime_nsec) {
+            *meta = entry->meta;
+            found = 1;
+        }
+    }
+    free(entries);
+    if (found) meta->start_datetime[sizeof(meta->start_datetime) - 1] = '\0';
+    return found ? 0 : -1;
+}
+
+// Best effort: a cache that cannot be written only costs the next open a metadata read.
+// The file's previous entry (a stale size or mtime) is replaced, and the oldest entries go
+// once the cache holds METADATA_CACHE_MAX_ENTRIES.
+static void metadata_cache_store(const char *cache_path, const metadata_cache_entry_t *entry) {
+    int fd = open(cache_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    if (flock(fd, LOCK_EX) != 0) {
+        close(fd);
+        return;
+    }
+    size_t count = 0;
+    metadata_cache_entry_t *entries = metadata_cache_read(fd, &count);
+    if (!entries) {
+        entries = malloc(sizeof(metadata_cache_entry_t));
+        count = 0;
+    }
+    if (entries) {
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (entries[i].magic != METADATA_CACHE_MAGIC || entries[i].version != METADATA_CACHE_VERSION ||
+                metadata_cache_same_file(&entries[i], entry)) {
+                continue;
+            }
+            entries[kept++] = entries[i];
+        }
+        const size_t first = kept >= METADATA_CACHE_MAX_ENTRIES ? kept - (METADATA_CACHE_MAX_ENTRIES - 1) : 0;
+        entries[kept++] = *entry;
+        const size_t bytes = (kept - first) * sizeof(metadata_cache_entry_t);
+        if (pwrite(fd, entries + first, bytes, 0) == (ssize_t)bytes) {
+            (void)ftruncate(fd, (off_t)bytes);
+        }
+        free(entries);
+    }
+    close(fd);
+}
+
+uint32_t h5mobaku_mesh_index(struct h5r *h5_ctx, cmph_t *hash, uint32_t mesh_id) {
+    // Files whose meshid_list differs from the compiled-in one carry their own table
+    const mesh_dict_t *dict = h5r_get_mesh_dict(h5_ctx);
+    if (dict) {
+        return mesh_dict_lookup(dict, mesh_id);
+    }
+    uint32_t mesh_index = meshid_search_id(hash, mesh_id);
+    if (mesh_index >= MOBAKU_MESH_COUNT) {
+        return MESHID_NOT_FOUND;
+    }
+    return mesh_index;
+}
+
+int h5mobaku_mesh_columns(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                          uint64_t *cols) {
+    for (size_t i = 0; i < num_meshes; i++) {
+        if (!mesh_ids) {
+            cols[i] = i;
+            continue;
+        }
+        uint32_t col = h5mobaku_mesh_index(h5_ctx, hash, mesh_ids[i]);
+        if (col == MESHID_NOT_FOUND) {
+            fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_ids[i]);
+            return -1;
+        }
+        cols[i] = col;
+    }
+    return 0;
+}
+
+int h5mobaku_collect_sink(void *user, int first_time, size_t num_times, size_t first_mesh, size_t num_meshes,
+                          const double *values) {
+    h5mobaku_collect_t *collect = (h5mobaku_collect_t *)user;
+    for (size_t t = 0; t < num_times; t++) {
+        memcpy(collect->data + ((size_t)(first_time - collect->start_time) + t) * collect->num_meshes + first_mesh,
+               values + t * num_meshes, num_meshes * sizeof(double));
+    }
+    return 0;
+}
+
+int h5mobaku_verify_meshid_list(struct h5mobaku *ctx) {
+    if (validate_h5mobaku_context(ctx) < 0) return -1;
+
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    if (!meta.has_meshid_list) {
+        // Files without a stored list were written against the compiled-in one
+        if (meta.cols != meshid_list_size) {
+            fprintf(stderr, "Error: population_data has %llu columns but no meshid_list\n",
+                    (unsigned long long)meta.cols);
+            return -1;
+        }
+        return 0;
+    }
+
+    uint32_t *ids = NULL;
+    size_t count = 0;
+    if (h5r_read_meshid_list(ctx->h5r_ctx, &ids, &count) < 0) {
+        fprintf(stderr, "Error: Failed to read meshid_list from HDF5 file\n");
+        return -1;
+    }
+    if (count != meta.cols) {
+        fprintf(stderr, "Error: meshid_list has %zu entries but population_data has %llu columns\n",
+                count, (unsigned long long)meta.cols);
+        free(ids);
+        return -1;
+    }
+
+    if (count == meshid_list_size && mesh_list_equal(ids, meshid_list, count)) {
+        free(ids);
+        h5r_set_mesh_dict(ctx->h5r_ctx, NULL);
+        return 0;
+    }
+
+    mesh_dict_t *dict = mesh_dict_create(ids, count);
+    free(ids);
+    if (!dict) {
+        fprintf(stderr, "Error: Failed to build mesh lookup table from meshid_list\n");
+        return -1;
+    }
+    h5r_set_mesh_dict(ctx->h5r_ctx, dict);
+    return 1;
+}
+
+// Files whose width differs from the compiled-in mesh set always need their own lookup table
+static int attach_file_mesh_dict(struct h5mobaku *ctx, int verify) {
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    if (!verify && meta.cols == meshid_list_size) return 0;
+    return h5mobaku_verify_meshid_list(ctx) < 0 ? -1 : 0;
+}
+
 // Initialize h5mobaku wrapper
 int h5mobaku_open(const char *path, struct h5mobaku **out) {
+    h5mobaku_open_config_t config = H5MOBAKU_OPEN_DEFAULT_CONFIG;
+    config.metadata_cache = get_env_value("H5MOBAKU_METADATA_CACHE", NULL);
+    const char *verify = get_env_value("H5MOBAKU_VERIFY_MESHID_LIST", "0");
+    config.verify_meshid_list = strcmp(verify, "0") != 0 && verify[0] != '\0';
+    return h5mobaku_open_with_config(path, &config, out);
+}
+
+int h5mobaku_open_with_config(const char *path, const h5mobaku_open_config_t *config, struct h5mobaku **out) {
     if (!path || !out) {
         fprintf(stderr, "Error: Invalid parameters in h5mobaku_open\n");
         return -1;
     }
+    const char *cache_path = config && config->metadata_cache && config->metadata_cache[0]
+                             ? config->metadata_cache : NULL;
     
     struct h5mobaku *ctx = calloc(1, sizeof(struct h5mobaku));
     if (!ctx) {
@@ -69,93 +330,51 @@ int h5mobaku_open(const char *path, struct h5mobaku **out) {
         return -1;
     }
     
-    // Open the underlying h5r context
-    int ret = h5r_open(path, &ctx->h5r_ctx);
-    if (ret < 0) {
-        free(ctx);
-        return -1;
+    // Look the file up in the metadata cache before touching HDF5
+    metadata_cache_entry_t entry;
+    h5r_metadata_t cached;
+    int have_key = 0, hit = 0;
+    if (cache_path) {
+        struct stat st;
+        if (stat(path, &st) == 0) {
+            metadata_cache_key(&st, &entry);
+            have_key = 1;
+            hit = metadata_cache_lookup(cache_path, &entry, &cached) == 0;
+        }
     }
     
-    // Read the start_datetime attribute from the HDF5 file
-    hid_t file_id = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
-    if (file_id < 0) {
-        h5r_close(ctx->h5r_ctx);
+    // Open the underlying h5r context; all metadata comes from this single open
+    int ret = h5r_open_with_metadata(path, hit ? &cached : NULL, &ctx->h5r_ctx);
+    if (ret < 0) {
         free(ctx);
         return -1;
     }
     
-    hid_t dset_id = H5Dopen2(file_id, "population_data", H5P_DEFAULT);
-    if (dset_id < 0) {
-        H5Fclose(file_id);
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    if (set_start_datetime(ctx, meta.start_datetime) < 0) {
         h5r_close(ctx->h5r_ctx);
         free(ctx);
         return -1;
     }
     
-    // Read the start_datetime attribute
-    hid_t attr_id = H5Aopen(dset_id, "start_datetime", H5P_DEFAULT);
-    if (attr_id < 0) {
-        fprintf(stderr, "Error: start_datetime attribute not found in HDF5 file\n");
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
+    if (attach_file_mesh_dict(ctx, config && config->verify_meshid_list) < 0) {
+        h5mobaku_close(ctx);
         return -1;
     }
     
-    hid_t atype_mem = H5Tcopy(H5T_C_S1);
-    H5Tset_size(atype_mem, H5T_VARIABLE);
-    H5Tset_cset(atype_mem, H5T_CSET_UTF8);
-
-    char *attr_value = NULL;
-    herr_t status = H5Aread(attr_id, atype_mem, &attr_value);
-    if (status < 0) {
-        fprintf(stderr, "Error: Failed to read start_datetime attribute\n");
-        free(attr_value);
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-    ctx->start_datetime_str = strdup(attr_value);
-    H5free_memory(attr_value);
-    if (!ctx->start_datetime_str) {
-        fprintf(stderr, "Error: Memory allocation failed for start_datetime_str\n");
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
+    if (have_key && !hit) {
+        entry.meta = meta;
+        metadata_cache_store(cache_path, &entry);
     }
-    // Parse the datetime string to time_t
-    struct tm tm = {0};
-    if (strptime(ctx->start_datetime_str, "%Y-%m-%d %H:%M:%S", &tm) != NULL) {
-        ctx->start_datetime = mktime(&tm);
-    } else if (strptime(ctx->start_datetime_str, "%Y-%m-%dT%H:%M:%S", &tm) != NULL) {
-        ctx->start_datetime = mktime(&tm);
-    } else {
-        fprintf(stderr, "Error: Failed to parse start_datetime string '%s'\n", ctx->start_datetime_str);
-        free(ctx->start_datetime_str);
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
+    
+    ctx->path = strdup(path);
+    if (!ctx->path) {
+        fprintf(stderr, "Error: Memory allocation failed for h5mobaku path\n");
+        h5mobaku_close(ctx);
         return -1;
     }
     
-    H5Tclose(atype_mem);
-    H5Aclose(attr_id);
-    
-    H5Dclose(dset_id);
-    H5Fclose(file_id);
-    
     *out = ctx;
     return 0;
 }
@@ -172,6 +391,8 @@ void h5mobaku_close(struct h5mobaku *ctx) {
         free(ctx->start_datetime_str);
     }
     
+    h5mobaku_breakdown_close(ctx->breakdown);
+    free(ctx->path);
     free(ctx);
 }
 
@@ -240,7 +461,7 @@ int32_t h5mobaku_read_population_single(struct h5r *h5_ctx, cmph_t *hash, uint32
         return -1;
     }
     
-    uint64_t mesh_index = get_mesh_index(hash, mesh_id);
+    uint64_t mesh_index = get_mesh_index(h5_ctx, hash, mesh_id);
     if (mesh_index == UINT64_MAX) {
         fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_id);
         return -1;
@@ -274,7 +495,7 @@ int32_t* h5mobaku_read_population_multi(struct h5r *h5_ctx, cmph_t *hash, uint32
     
     // Convert mesh IDs to indices
     for (size_t i = 0; i < num_meshes; i++) {
-        mesh_indices[i] = get_mesh_index(hash, mesh_ids[i]);
+        mesh_indices[i] = get_mesh_index(h5_ctx, hash, mesh_ids[i]);
         if (mesh_indices[i] == UINT64_MAX) {
             fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_ids[i]);
             cleanup_multi_arrays(mesh_indices, results);
@@ -300,7 +521,7 @@ int32_t* h5mobaku_read_population_time_series(struct h5r *h5_ctx, cmph_t *hash,
         return NULL;
     }
     
-    uint64_t mesh_index = get_mesh_index(hash, mesh_id);
+    uint64_t mesh_index = get_mesh_index(h5_ctx, hash, mesh_id);
     if (mesh_index == UINT64_MAX) {
         fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_id);
         return NULL;
@@ -322,6 +543,75 @@ int32_t* h5mobaku_read_population_time_series(struct h5r *h5_ctx, cmph_t *hash,
     return time_series;
 }
 
+// Open the breakdown dataset on first use; read-only for files opened read-only
+static h5mobaku_breakdown_t *get_breakdown(struct h5mobaku *ctx) {
+    if (validate_h5mobaku_context(ctx) < 0) return NULL;
+    if (!ctx->breakdown && ctx->path) {
+        h5mobaku_breakdown_open(ctx->path, 0, NULL, &ctx->breakdown);
+    }
+    return ctx->breakdown;
+}
+
+const h5mobaku_category_t *h5mobaku_get_breakdown_categories(struct h5mobaku *ctx, size_t *count) {
+    h5mobaku_breakdown_t *bd = get_breakdown(ctx);
+    if (!bd) return NULL;
+    return h5mobaku_breakdown_categories(bd, count);
+}
+
+int32_t* h5mobaku_read_breakdown_time_series(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id,
+                                             int start_time_index, int end_time_index, size_t *num_categories) {
+    if (validate_h5mobaku_context(ctx) < 0 || !hash || start_time_index < 0 ||
+        end_time_index < start_time_index || !num_categories) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_breakdown_time_series\n");
+        return NULL;
+    }
+    h5mobaku_breakdown_t *bd = get_breakdown(ctx);
+    if (!bd) return NULL;
+    
+    uint64_t mesh_index = get_mesh_index(ctx->h5r_ctx, hash, mesh_id);
+    if (mesh_index == UINT64_MAX) {
+        fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_id);
+        return NULL;
+    }
+    
+    size_t ncat = 0;
+    h5mobaku_breakdown_categories(bd, &ncat);
+    size_t num_times = (size_t)(end_time_index - start_time_index) + 1;
+    // One extra element keeps the allocation non-empty for files without categories
+    int32_t *data = (int32_t*)safe_malloc((num_times * ncat + 1) * sizeof(int32_t), "breakdown time series");
+    if (!data) return NULL;
+    
+    // One contiguous run per chunk: the mesh's categories are innermost
+    if (h5mobaku_breakdown_read(bd, mesh_index, (uint64_t)start_time_index, num_times, data) < 0) {
+        fprintf(stderr, "Error: Failed to read breakdown from %d to %d for mesh %u\n",
+                start_time_index, end_time_index, mesh_id);
+        free(data);
+        return NULL;
+    }
+    
+    *num_categories = ncat;
+    return data;
+}
+
+int32_t h5mobaku_read_breakdown_single(struct h5mobaku *ctx, cmph_t *hash, uint32_t mesh_id, int time_index,
+                                       h5mobaku_category_t category) {
+    h5mobaku_breakdown_t *bd = get_breakdown(ctx);
+    if (!bd) return -1;
+    int cat = h5mobaku_breakdown_find_category(bd, category);
+    if (cat < 0) {
+        fprintf(stderr, "Error: Breakdown category (%d, %d, %d) not in file\n",
+                category.residence, category.age, category.gender);
+        return -1;
+    }
+    
+    size_t ncat = 0;
+    int32_t *row = h5mobaku_read_breakdown_time_series(ctx, hash, mesh_id, time_index, time_index, &ncat);
+    if (!row) return -1;
+    int32_t value = row[cat];
+    free(row);
+    return value;
+}
+
 /* ---------------------------------------------------------------- */
 
 int32_t *
@@ -347,7 +637,7 @@ h5mobaku_read_multi_mesh_time_series(struct h5r  *h5_ctx,
     uint64_t *dcols = safe_malloc(num_meshes * sizeof(uint64_t), "dcols");
     if (!dcols) return NULL;
     for (size_t i = 0; i < num_meshes; ++i) {
-        dcols[i] = get_mesh_index(hash, mesh_ids[i]);
+        dcols[i] = get_mesh_index(h5_ctx, hash, mesh_ids[i]);
         if (dcols[i] == UINT64_MAX) { free(dcols); return NULL; }
     }
     TOC(map_ids);
@@ -374,7 +664,7 @@ h5mobaku_read_multi_mesh_time_series(struct h5r  *h5_ctx,
     if (nblk > NBLK_THRESHOLD) {
         /* ---- UNION hyperslab route ---- */
         TIC(union_total);
-        buf = safe_malloc(total_elems * sizeof(int32_t), "result");
+        buf = alloc_result(total_elems, "result");
         if (!buf) { free(dcols); free(blks); return NULL; }
 
         TIC(h5_union_read);
@@ -386,13 +676,13 @@ h5mobaku_read_multi_mesh_time_series(struct h5r  *h5_ctx,
                                        /* dst_stride */ num_meshes);
         TOC(h5_union_read);
 
-        if (rv < 0) { free(dcols); free(blks); free(buf); return NULL; }
+        if (rv < 0) { free(dcols); free(blks); h5mobaku_free_data(buf); return NULL; }
         TOC(union_total);
     }
     else {
         /* ---- Fallback route ---- */
         TIC(fallback_total);
-        buf = safe_malloc(total_elems * sizeof(int32_t), "result");
+        buf = alloc_result(total_elems, "result");
         if (!buf) { free(dcols); free(blks); return NULL; }
 
         TIC(per_column_reads);
@@ -404,7 +694,7 @@ h5mobaku_read_multi_mesh_time_series(struct h5r  *h5_ctx,
                                 start_time_index, end_time_index);
             TOC(single_read);
 
-            if (!col) { free(dcols); free(blks); free(buf); return NULL; }
+            if (!col) { free(dcols); free(blks); h5mobaku_free_data(buf); return NULL; }
 
             /* Row-wise copy (stride = num_meshes) */
             TIC(strided_copy);
@@ -425,9 +715,111 @@ h5mobaku_read_multi_mesh_time_series(struct h5r  *h5_ctx,
 }
 
 
+// Read periodic hours for one or more meshes: data[(k * block + b) * num_meshes + mesh_idx]
+int32_t* h5mobaku_read_population_pattern(struct h5r *h5_ctx, cmph_t *hash, uint32_t *mesh_ids, size_t num_meshes,
+                                          const h5r_time_pattern_t *pattern) {
+    const uint64_t nrows = h5r_pattern_rows(pattern);
+    if (validate_basic_params(h5_ctx, hash) < 0 || !mesh_ids || num_meshes == 0 || nrows == 0) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_population_pattern\n");
+        return NULL;
+    }
+
+    uint64_t *mesh_indices = (uint64_t*)safe_malloc(num_meshes * sizeof(uint64_t), "mesh indices");
+    if (!mesh_indices) return NULL;
+    for (size_t i = 0; i < num_meshes; i++) {
+        mesh_indices[i] = get_mesh_index(h5_ctx, hash, mesh_ids[i]);
+        if (mesh_indices[i] == UINT64_MAX) {
+            fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_ids[i]);
+            free(mesh_indices);
+            return NULL;
+        }
+    }
+
+    int32_t *results = alloc_result(nrows * num_meshes, "pattern data");
+    if (!results) {
+        free(mesh_indices);
+        return NULL;
+    }
+    if (h5r_read_pattern(h5_ctx, pattern, mesh_indices, num_meshes, results) < 0) {
+        fprintf(stderr, "Error: Failed to read %llu hours every %llu from time %llu\n",
+                (unsigned long long)pattern->block, (unsigned long long)pattern->stride,
+                (unsigned long long)pattern->start);
+        free(mesh_indices);
+        h5mobaku_free_data(results);
+        return NULL;
+    }
+
+    free(mesh_indices);
+    return results;
+}
+
+// Build a pattern whose first selected hour is first_datetime_str
+int h5mobaku_time_pattern_at(struct h5mobaku *ctx, const char *first_datetime_str, uint64_t stride, uint64_t block,
+                             uint64_t count, h5r_time_pattern_t *pattern) {
+    if (validate_h5mobaku_context(ctx) < 0 || !pattern) return -1;
+
+    int start = datetime_to_index(ctx, first_datetime_str);
+    if (start < 0) return -1;
+
+    *pattern = (h5r_time_pattern_t){.start = (uint64_t)start, .stride = stride, .block = block, .count = count};
+    if (h5r_pattern_rows(pattern) == 0) {
+        fprintf(stderr, "Error: Invalid time pattern (stride %llu, block %llu, count %llu)\n",
+                (unsigned long long)stride, (unsigned long long)block, (unsigned long long)count);
+        return -1;
+    }
+    return 0;
+}
+
+// Read arbitrary (time index, mesh) points into out[i]; each chunk is visited once
+int h5mobaku_read_points(struct h5r *h5_ctx, cmph_t *hash, const int *time_indices, const uint32_t *mesh_ids,
+                         size_t n, int32_t *out) {
+    if (validate_basic_params(h5_ctx, hash) < 0 || !time_indices || !mesh_ids || !out || n == 0) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_points\n");
+        return -1;
+    }
+
+    uint64_t *rows = (uint64_t*)safe_malloc(n * sizeof(uint64_t), "point rows");
+    uint64_t *cols = (uint64_t*)safe_malloc(n * sizeof(uint64_t), "point columns");
+    if (!rows || !cols) {
+        free(rows);
+        free(cols);
+        return -1;
+    }
+
+    // Sampled points often repeat a mesh back to back; reuse the previous lookup
+    uint32_t last_id = 0;
+    uint64_t last_index = UINT64_MAX;
+    for (size_t i = 0; i < n; i++) {
+        if (time_indices[i] < 0) {
+            fprintf(stderr, "Error: Invalid time index %d at point %zu\n", time_indices[i], i);
+            free(rows);
+            free(cols);
+            return -1;
+        }
+        if (last_index == UINT64_MAX || mesh_ids[i] != last_id) {
+            last_id = mesh_ids[i];
+            last_index = get_mesh_index(h5_ctx, hash, last_id);
+            if (last_index == UINT64_MAX) {
+                fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", last_id);
+                free(rows);
+                free(cols);
+                return -1;
+            }
+        }
+        rows[i] = (uint64_t)time_indices[i];
+        cols[i] = last_index;
+    }
+
+    int ret = h5r_read_points(h5_ctx, rows, cols, n, out);
+    if (ret < 0) fprintf(stderr, "Error: Failed to read %zu points from HDF5 file\n", n);
+    free(rows);
+    free(cols);
+    return ret;
+}
+
 // Free allocated memory
 void h5mobaku_free_data(int32_t *data) {
-    free(data);
+    if (large_buffer_free(data) < 0) free(data);
 }
 
 
@@ -579,98 +971,33 @@ int h5mobaku_open_readwrite(const char *path, struct h5mobaku **out) {
         return -1;
     }
     
-    // Read the start_datetime attribute from the HDF5 file
-    hid_t file_id = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
-    if (file_id < 0) {
-        fprintf(stderr, "Error: Failed to open HDF5 file for reading start_datetime attribute\n");
+    // start_datetime was collected along with the rest of the metadata
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    if (set_start_datetime(ctx, meta.start_datetime) < 0) {
         h5r_close(ctx->h5r_ctx);
         free(ctx);
         return -1;
     }
-    
-    hid_t dset_id = H5Dopen2(file_id, "population_data", H5P_DEFAULT);
-    if (dset_id < 0) {
-        fprintf(stderr, "Error: population_data dataset not found in HDF5 file\n");
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
+    if (attach_file_mesh_dict(ctx, 0) < 0) {
+        h5mobaku_close(ctx);
         return -1;
     }
     
-    hid_t attr_id = H5Aopen(dset_id, "start_datetime", H5P_DEFAULT);
-    if (attr_id < 0) {
-        fprintf(stderr, "Error: start_datetime attribute not found in HDF5 file\n");
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-
-    
-    hid_t atype_mem = H5Tcopy(H5T_C_S1);
-    H5Tset_size(atype_mem, H5T_VARIABLE);
-    H5Tset_cset(atype_mem, H5T_CSET_UTF8);
-
-    char *attr_value = NULL;
-    herr_t status = H5Aread(attr_id, atype_mem, &attr_value);
-    if (status < 0) {
-        fprintf(stderr, "Error: Failed to read start_datetime attribute\n");
-        free(attr_value);
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-    ctx->start_datetime_str = strdup(attr_value);
-    H5free_memory(attr_value);
-    if (!ctx->start_datetime_str) {
-        fprintf(stderr, "Error: Memory allocation failed for start_datetime_str\n");
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-    
-    // Parse the datetime string to time_t
-    struct tm tm = {0};
-    if (strptime(ctx->start_datetime_str, "%Y-%m-%d %H:%M:%S", &tm) != NULL) {
-        ctx->start_datetime = mktime(&tm);
-    } else if (strptime(ctx->start_datetime_str, "%Y-%m-%dT%H:%M:%S", &tm) != NULL) {
-        ctx->start_datetime = mktime(&tm);
-    } else {
-        fprintf(stderr, "Error: Failed to parse start_datetime string '%s'\n", ctx->start_datetime_str);
-        free(ctx->start_datetime_str);
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
-        H5Dclose(dset_id);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
+    ctx->path = strdup(path);
+    if (!ctx->path) {
+        fprintf(stderr, "Error: Memory allocation failed for h5mobaku path\n");
+        h5mobaku_close(ctx);
         return -1;
     }
     
-    H5Tclose(atype_mem);
-    H5Aclose(attr_id);
-    H5Dclose(dset_id);
-    H5Fclose(file_id);
-    
     *out = ctx;
     return 0;
 }
 
-// Extended version of h5mobaku_create with configurable dataset name
-int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, const h5r_writer_config_t* config, struct h5mobaku **out) {
-    if (!path || !dataset_name || !out) {
-        fprintf(stderr, "Error: Invalid parameters in h5mobaku_create_with_dataset\n");
-        return -1;
-    }
+// Create a population file whose columns are mesh_ids[0..num_meshes); the list is stored as meshid_list
+static int create_population_file(const char *path, const char *dataset_name, const h5r_writer_config_t* config,
+                                  const uint32_t *mesh_ids, size_t num_meshes) {
     
     // Use default config if none provided
     h5r_writer_config_t actual_config;
@@ -699,8 +1026,8 @@ int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, con
     }
     
     // Create dataspace
-    hsize_t dims[2] = {actual_config.initial_time_points, MOBAKU_MESH_COUNT};
-    hsize_t maxdims[2] = {H5S_UNLIMITED, MOBAKU_MESH_COUNT};
+    hsize_t dims[2] = {actual_config.initial_time_points, num_meshes};
+    hsize_t maxdims[2] = {H5S_UNLIMITED, num_meshes};
     hid_t dataspace_id = H5Screate_simple(2, dims, maxdims);
     
     if (dataspace_id < 0) {
@@ -711,8 +1038,9 @@ int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, con
     // Create dataset creation property list
     hid_t dcpl_id = H5Pcreate(H5P_DATASET_CREATE);
     
-    // Set chunk size
-    hsize_t chunk_dims[2] = {actual_config.chunk_time_size, actual_config.chunk_mesh_size};
+    // Set chunk size (never wider than the file)
+    hsize_t chunk_mesh = actual_config.chunk_mesh_size < num_meshes ? actual_config.chunk_mesh_size : num_meshes;
+    hsize_t chunk_dims[2] = {actual_config.chunk_time_size, chunk_mesh};
     H5Pset_chunk(dcpl_id, 2, chunk_dims);
     
     // Set compression if requested
@@ -737,23 +1065,23 @@ int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, con
     }
     
     // Create meshid_list metadata dataset
-    hsize_t meshid_list_dims[1] = {MOBAKU_MESH_COUNT};
+    hsize_t meshid_list_dims[1] = {num_meshes};
     hid_t meshid_list_space_id = H5Screate_simple(1, meshid_list_dims, NULL);
     if (meshid_list_space_id >= 0) {
         hid_t meshid_list_dataset_id = H5Dcreate(file, "meshid_list", H5T_NATIVE_UINT32, 
                                                 meshid_list_space_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
         if (meshid_list_dataset_id >= 0) {
-            // Write the mesh ID list from meshid_ops.h extern array
-            H5Dwrite(meshid_list_dataset_id, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, meshid_list);
+            // Column order of this file
+            H5Dwrite(meshid_list_dataset_id, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, mesh_ids);
             H5Dclose(meshid_list_dataset_id);
         }
         H5Sclose(meshid_list_space_id);
     }
     
-    // Create cmph_data dataset
+    // Create cmph_data dataset (the compiled-in hash only describes the full mesh list)
     size_t mph_size = (size_t)(_binary_meshid_mobaku_mph_end - _binary_meshid_mobaku_mph_start);
     hsize_t cmph_data_dims[1] = {mph_size};
-    hid_t cmph_data_space_id = H5Screate_simple(1, cmph_data_dims, NULL);
+    hid_t cmph_data_space_id = mesh_ids == meshid_list ? H5Screate_simple(1, cmph_data_dims, NULL) : -1;
     if (cmph_data_space_id >= 0) {
         hid_t cmph_data_dataset_id = H5Dcreate(file, "cmph_data", H5T_NATIVE_UINT8, 
                                               cmph_data_space_id, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
@@ -786,11 +1114,45 @@ int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, con
     H5Pclose(dcpl_id);
     H5Sclose(dataspace_id);
     H5Fclose(file);
+    return 0;
+}
+
+// Extended version of h5mobaku_create with configurable dataset name
+int h5mobaku_create_with_dataset(const char *path, const char *dataset_name, const h5r_writer_config_t* config, struct h5mobaku **out) {
+    if (!path || !dataset_name || !out) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_create_with_dataset\n");
+        return -1;
+    }
+    if (create_population_file(path, dataset_name, config, meshid_list, MOBAKU_MESH_COUNT) < 0) {
+        return -1;
+    }
     
     // Now open the file for read/write using h5mobaku_open_readwrite_with_dataset
     return h5mobaku_open_readwrite_with_dataset(path, dataset_name, out);
 }
 
+int h5mobaku_create_with_meshes(const char *path, const h5r_writer_config_t* config,
+                                const uint32_t *mesh_ids, size_t num_meshes, struct h5mobaku **out) {
+    if (!path || !mesh_ids || num_meshes == 0 || num_meshes >= MESHID_NOT_FOUND || !out) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_create_with_meshes\n");
+        return -1;
+    }
+    
+    // Every column needs a distinct, non-zero mesh ID for the lookup table
+    mesh_dict_t *dict = mesh_dict_create(mesh_ids, num_meshes);
+    size_t distinct = mesh_dict_size(dict);
+    mesh_dict_destroy(dict);
+    if (distinct != num_meshes) {
+        fprintf(stderr, "Error: Mesh list for %s contains duplicate or zero IDs\n", path);
+        return -1;
+    }
+    
+    if (create_population_file(path, "population_data", config, mesh_ids, num_meshes) < 0) {
+        return -1;
+    }
+    return h5mobaku_open_readwrite(path, out);
+}
+
 // Extended version of h5mobaku_open_readwrite with configurable dataset name
 int h5mobaku_open_readwrite_with_dataset(const char *path, const char *dataset_name, struct h5mobaku **out) {
     if (!path || !dataset_name || !out) {
@@ -811,95 +1173,31 @@ int h5mobaku_open_readwrite_with_dataset(const char *path, const char *dataset_n
         return -1;
     }
     
-    // Open the file to read start_datetime attribute
-    hid_t file_id = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
-    if (file_id < 0) {
-        fprintf(stderr, "Error: Cannot open HDF5 file for attribute reading: %s\n", path);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-    
-    // Try to open the dataset and read start_datetime attribute
-    hid_t dset_id = H5Dopen2(file_id, dataset_name, H5P_DEFAULT);
-    if (dset_id < 0) {
-        fprintf(stderr, "Error: %s dataset not found in file: %s\n", dataset_name, path);
-        H5Fclose(file_id);
-        h5r_close(ctx->h5r_ctx);
-        free(ctx);
-        return -1;
-    }
-    
-    // Read start_datetime attribute if it exists
-    if (H5Aexists(dset_id, "start_datetime") > 0) {
-        // Read the start_datetime attribute
-        hid_t attr_id = H5Aopen(dset_id, "start_datetime", H5P_DEFAULT);
-        if (attr_id < 0) {
-            fprintf(stderr, "Error: start_datetime attribute not found in HDF5 file\n");
-            H5Dclose(dset_id);
-            H5Fclose(file_id);
+    // start_datetime was collected along with the rest of the metadata
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    if (meta.start_datetime[0] != '\0') {
+        if (set_start_datetime(ctx, meta.start_datetime) < 0) {
             h5r_close(ctx->h5r_ctx);
             free(ctx);
             return -1;
         }
-
-        hid_t atype_mem = H5Tcopy(H5T_C_S1);
-        H5Tset_size(atype_mem, H5T_VARIABLE);
-        H5Tset_cset(atype_mem, H5T_CSET_UTF8);
-
-        char *attr_value = NULL;
-        herr_t status = H5Aread(attr_id, atype_mem, &attr_value);
-        if (status < 0) {
-            fprintf(stderr, "Error: Failed to read start_datetime attribute\n");
-            free(attr_value);
-            H5Tclose(atype_mem);
-            H5Aclose(attr_id);
-            H5Dclose(dset_id);
-            H5Fclose(file_id);
-            h5r_close(ctx->h5r_ctx);
-            free(ctx);
-            return -1;
-        }
-        ctx->start_datetime_str = strdup(attr_value);
-        H5free_memory(attr_value);
-        if (!ctx->start_datetime_str) {
-            fprintf(stderr, "Error: Memory allocation failed for start_datetime_str\n");
-            H5Tclose(atype_mem);
-            H5Aclose(attr_id);
-            H5Dclose(dset_id);
-            H5Fclose(file_id);
-            h5r_close(ctx->h5r_ctx);
-            free(ctx);
-            return -1;
-        }
-        // Parse the datetime string to time_t
-        struct tm tm = {0};
-        if (strptime(ctx->start_datetime_str, "%Y-%m-%d %H:%M:%S", &tm) != NULL) {
-            ctx->start_datetime = mktime(&tm);
-        } else if (strptime(ctx->start_datetime_str, "%Y-%m-%dT%H:%M:%S", &tm) != NULL) {
-            ctx->start_datetime = mktime(&tm);
-        } else {
-            fprintf(stderr, "Error: Failed to parse start_datetime string '%s'\n", ctx->start_datetime_str);
-            free(ctx->start_datetime_str);
-            H5Tclose(atype_mem);
-            H5Aclose(attr_id);
-            H5Dclose(dset_id);
-            H5Fclose(file_id);
-            h5r_close(ctx->h5r_ctx);
-            free(ctx);
-            return -1;
-        }
-
-        H5Tclose(atype_mem);
-        H5Aclose(attr_id);
     } else {
         // No start_datetime attribute found, use default
         ctx->start_datetime = 0;
         ctx->start_datetime_str = strdup("2016-01-01 00:00:00");
     }
+    if (attach_file_mesh_dict(ctx, 0) < 0) {
+        h5mobaku_close(ctx);
+        return -1;
+    }
     
-    H5Dclose(dset_id);
-    H5Fclose(file_id);
+    ctx->path = strdup(path);
+    if (!ctx->path) {
+        fprintf(stderr, "Error: Memory allocation failed for h5mobaku path\n");
+        h5mobaku_close(ctx);
+        return -1;
+    }
     
     *out = ctx;
     return 0;
@@ -929,7 +1227,7 @@ int h5mobaku_write_population_single(struct h5r *h5_ctx, cmph_t *hash, uint32_t
         return -1;
     }
     
-    uint64_t mesh_index = get_mesh_index(hash, mesh_id);
+    uint64_t mesh_index = get_mesh_index(h5_ctx, hash, mesh_id);
     if (mesh_index == UINT64_MAX) {
         fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_id);
         return -1;
@@ -955,7 +1253,7 @@ int h5mobaku_write_population_multi(struct h5r *h5_ctx, cmph_t *hash, uint32_t *
     
     // Convert mesh IDs to indices
     for (size_t i = 0; i < num_meshes; i++) {
-        mesh_indices[i] = get_mesh_index(hash, mesh_ids[i]);
+        mesh_indices[i] = get_mesh_index(h5_ctx, hash, mesh_ids[i]);
         if (mesh_indices[i] == UINT64_MAX) {
             fprintf(stderr, "Error: Mesh ID %u not found or invalid\n", mesh_ids[i]);
             free(mesh_indices);
@@ -0,0 +1,108 @@
+//
+// Period-over-period comparison of a mesh set
+//
+
+#include "h5mobaku_period.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PERIOD_STRIP_CELLS ((size_t)16 * 1024 * 1024)   // Hours x meshes read per strip
+
+// Reduce rows [row0, row0 + nrows) of a strip (width meshes per row) into acc
+static void reduce_window(const int32_t *grid, size_t row0, size_t nrows, size_t width, h5mobaku_reducer_t reducer,
+                          double *acc) {
+    const int32_t *x = grid + row0 * width;
+    if (reducer == H5MOBAKU_REDUCE_MAX) {
+        for (size_t c = 0; c < width; c++) acc[c] = x[c];
+        for (size_t r = 1; r < nrows; r++) {
+            const int32_t *row = x + r * width;
+            for (size_t c = 0; c < width; c++) acc[c] = row[c] > acc[c] ? row[c] : acc[c];
+        }
+        return;
+    }
+    memset(acc, 0, width * sizeof(double));
+    for (size_t r = 0; r < nrows; r++) {
+        const int32_t *row = x + r * width;
+        for (size_t c = 0; c < width; c++) acc[c] += row[c];
+    }
+    if (reducer == H5MOBAKU_REDUCE_MEAN) {
+        for (size_t c = 0; c < width; c++) acc[c] /= (double)nrows;
+    }
+}
+
+int h5mobaku_compare_periods(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                             h5mobaku_window_t base, h5mobaku_window_t current, h5mobaku_reducer_t reducer,
+                             h5mobaku_period_change_t *out) {
+    h5r_metadata_t meta;
+    if (!h5_ctx || !out || (mesh_ids && (!hash || num_meshes == 0)) || h5r_get_metadata(h5_ctx, &meta) < 0 ||
+        base.start_time < 0 || base.end_time < base.start_time || (uint64_t)base.end_time >= meta.rows ||
+        current.start_time < 0 || current.end_time < current.start_time || (uint64_t)current.end_time >= meta.rows ||
+        reducer < H5MOBAKU_REDUCE_SUM || reducer > H5MOBAKU_REDUCE_MAX) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_compare_periods\n");
+        return -1;
+    }
+
+    // Rows of both windows in time order, once each: one run when they overlap or touch, else two
+    const h5mobaku_window_t *lo = base.start_time <= current.start_time ? &base : &current;
+    const h5mobaku_window_t *hi = lo == &base ? &current : &base;
+    const int merged = hi->start_time <= lo->end_time + 1;
+    const size_t lo_len = (size_t)(lo->end_time - lo->start_time + 1);
+    const size_t hi_len = (size_t)(hi->end_time - hi->start_time + 1);
+    const size_t nrows = merged ? (size_t)((hi->end_time > lo->end_time ? hi->end_time : lo->end_time) -
+                                           lo->start_time + 1)
+                                : lo_len + hi_len;
+    // Row of the strip holding the first hour of each window
+    const size_t hi_row = merged ? (size_t)(hi->start_time - lo->start_time) : lo_len;
+    const size_t base_row = lo == &base ? 0 : hi_row, current_row = lo == &current ? 0 : hi_row;
+    const size_t base_len = (size_t)(base.end_time - base.start_time + 1);
+    const size_t current_len = (size_t)(current.end_time - current.start_time + 1);
+
+    const size_t m = mesh_ids ? num_meshes : (size_t)meta.cols;
+    size_t width = PERIOD_STRIP_CELLS / nrows;
+    if (!mesh_ids && meta.ccols > 0 && width > meta.ccols) width = width / meta.ccols * meta.ccols;
+    if (width < 1) width = 1;
+    if (width > m) width = m;
+
+    uint64_t *rows = malloc(nrows * sizeof(uint64_t));
+    uint64_t *cols = malloc(m * sizeof(uint64_t));
+    int32_t *grid = malloc(nrows * width * sizeof(int32_t));
+    double *acc = malloc(2 * width * sizeof(double));
+    int ret = -1;
+    if (!rows || !cols || !grid || !acc) {
+        fprintf(stderr, "Error: Memory allocation failed for period comparison buffers\n");
+        goto out;
+    }
+    for (size_t i = 0; i < nrows; i++) {
+        rows[i] = merged || i < lo_len ? (uint64_t)lo->start_time + i : (uint64_t)hi->start_time + (i - lo_len);
+    }
+    if (h5mobaku_mesh_columns(h5_ctx, hash, mesh_ids, m, cols) < 0) goto out;
+
+    for (size_t m0 = 0; m0 < m; m0 += width) {
+        const size_t w = m - m0 < width ? m - m0 : width;
+        if (h5r_read_columns_range(h5_ctx, rows, nrows, cols + m0, w, grid) < 0) {
+            fprintf(stderr, "Error: Failed to read meshes for period comparison\n");
+            goto out;
+        }
+        double *b = acc, *c = acc + width;
+        reduce_window(grid, base_row, base_len, w, reducer, b);
+        reduce_window(grid, current_row, current_len, w, reducer, c);
+        for (size_t i = 0; i < w; i++) {
+            out[m0 + i] = (h5mobaku_period_change_t){
+                .base = b[i],
+                .current = c[i],
+                .delta = c[i] - b[i],
+                .ratio = b[i] != 0.0 ? c[i] / b[i] : NAN,
+            };
+        }
+    }
+    ret = 0;
+
+out:
+    free(rows);
+    free(cols);
+    free(grid);
+    free(acc);
+    return ret;
+}
@@ -0,0 +1,216 @@
+//
+// Rolling-window statistics over hourly series of a mesh set
+//
+
+#include "h5mobaku_rolling.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROLLING_BAND_CELLS ((size_t)4 * 1024 * 1024)   // Hours x meshes held per strip
+
+int h5mobaku_parse_rolling_op(const char *name, h5mobaku_rolling_op_t *op) {
+    if (!name || !op) return -1;
+    if (strcmp(name, "sum") == 0) *op = H5MOBAKU_ROLL_SUM;
+    else if (strcmp(name, "mean") == 0) *op = H5MOBAKU_ROLL_MEAN;
+    else if (strcmp(name, "min") == 0) *op = H5MOBAKU_ROLL_MIN;
+    else if (strcmp(name, "max") == 0) *op = H5MOBAKU_ROLL_MAX;
+    else if (strcmp(name, "ewma") == 0) *op = H5MOBAKU_ROLL_EWMA;
+    else return -1;
+    return 0;
+}
+
+// Sliding minimum or maximum over rows 0..total-1 of win (van Herk / Gil-Werman): blocks of
+// `window` rows aligned at row 0 get a running scan from each end, and a window [a, i] is then
+// max(suffix[a], prefix[i]). Rows before `from` are history and produce no output.
+static void sliding_extreme(const int32_t *win, size_t total, size_t from, size_t m, size_t window, int is_max,
+                            int32_t *prefix, int32_t *suffix, double *out) {
+    for (size_t i = 0; i < total; i++) {
+        int32_t *p = prefix + i * m;
+        const int32_t *x = win + i * m;
+        if (i % window == 0) {
+            memcpy(p, x, m * sizeof(int32_t));
+        } else if (is_max) {
+            for (size_t c = 0; c < m; c++) p[c] = x[c] > p[c - m] ? x[c] : p[c - m];
+        } else {
+            for (size_t c = 0; c < m; c++) p[c] = x[c] < p[c - m] ? x[c] : p[c - m];
+        }
+    }
+    for (size_t i = total; i-- > 0;) {
+        int32_t *s = suffix + i * m;
+        const int32_t *x = win + i * m;
+        if ((i + 1) % window == 0 || i == total - 1) {
+            memcpy(s, x, m * sizeof(int32_t));
+        } else if (is_max) {
+            for (size_t c = 0; c < m; c++) s[c] = x[c] > s[c + m] ? x[c] : s[c + m];
+        } else {
+            for (size_t c = 0; c < m; c++) s[c] = x[c] < s[c + m] ? x[c] : s[c + m];
+        }
+    }
+    for (size_t i = from; i < total; i++) {
+        double *o = out + (i - from) * m;
+        const int32_t *p = prefix + i * m;
+        if (i + 1 < window) {
+            // Window cut short at the start of the file: all of it lies in the first block
+            for (size_t c = 0; c < m; c++) o[c] = p[c];
+            continue;
+        }
+        const int32_t *s = suffix + (i + 1 - window) * m;
+        if (is_max) {
+            for (size_t c = 0; c < m; c++) o[c] = s[c] > p[c] ? s[c] : p[c];
+        } else {
+            for (size_t c = 0; c < m; c++) o[c] = s[c] < p[c] ? s[c] : p[c];
+        }
+    }
+}
+
+int h5mobaku_rolling_stream(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                            int start_time, int end_time, const h5mobaku_rolling_spec_t *spec,
+                            h5mobaku_rolling_sink_t sink, void *user) {
+    h5r_metadata_t meta;
+    if (!h5_ctx || (mesh_ids && (!hash || num_meshes == 0)) || !spec || !sink || start_time < 0 ||
+        end_time < start_time || spec->window == 0 || spec->op < H5MOBAKU_ROLL_SUM || spec->op > H5MOBAKU_ROLL_EWMA ||
+        (spec->op == H5MOBAKU_ROLL_EWMA && !(spec->alpha > 0.0 && spec->alpha <= 1.0)) ||
+        h5r_get_metadata(h5_ctx, &meta) < 0 || (!mesh_ids && meta.cols == 0)) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_rolling_stream\n");
+        return -1;
+    }
+
+    const size_t m = mesh_ids ? num_meshes : (size_t)meta.cols, window = spec->window;
+    const uint64_t first_read = (uint64_t)start_time + 1 > window ? (uint64_t)start_time + 1 - window : 0;
+    const size_t hours = (size_t)((uint64_t)end_time - first_read + 1);
+    const size_t cells = spec->band_cells > 0 ? spec->band_cells : ROLLING_BAND_CELLS;
+
+    // Strips of meshes run their whole time range before the next, so each chunk is decoded once.
+    // A strip is as wide as the cell budget allows for every hour; whole-file strips follow the
+    // chunk columns, and only strips narrower than that are cut into bands of hours.
+    size_t width = m;
+    if (m * hours > cells) {
+        width = cells / hours;
+        if (!mesh_ids && meta.ccols > 0) width = width > meta.ccols ? width / meta.ccols * meta.ccols : meta.ccols;
+        if (width < 1) width = 1;
+        if (width > m) width = m;
+    }
+    size_t band = spec->band_hours > 0 ? spec->band_hours : cells / width;
+    if (band < 1) band = 1;
+    if (band > hours) band = hours;
+    const size_t cap = window + band;   // Carried rows (at most window) followed by one band
+
+    uint64_t *cols = malloc(m * sizeof(uint64_t));
+    uint64_t *rows = malloc(band * sizeof(uint64_t));
+    int32_t *win = malloc(cap * width * sizeof(int32_t));
+    double *out = malloc(band * width * sizeof(double));
+    const int extreme = spec->op == H5MOBAKU_ROLL_MIN || spec->op == H5MOBAKU_ROLL_MAX;
+    int32_t *prefix = extreme ? malloc(cap * width * sizeof(int32_t)) : NULL;
+    int32_t *suffix = extreme ? malloc(cap * width * sizeof(int32_t)) : NULL;
+    int64_t *sums = spec->op == H5MOBAKU_ROLL_SUM || spec->op == H5MOBAKU_ROLL_MEAN ? malloc(width * sizeof(int64_t)) : NULL;
+    double *ewma = spec->op == H5MOBAKU_ROLL_EWMA ? malloc(width * sizeof(double)) : NULL;
+    int ret = -1;
+    if (!cols || !rows || !win || !out || (extreme && (!prefix || !suffix)) || (!extreme && !sums && !ewma)) {
+        fprintf(stderr, "Error: Memory allocation failed for rolling window buffers\n");
+        goto out;
+    }
+
+    if (h5mobaku_mesh_columns(h5_ctx, hash, mesh_ids, m, cols) < 0) goto out;
+
+    for (size_t m0 = 0; m0 < m; m0 += width) {
+        const size_t w = m - m0 < width ? m - m0 : width;
+        if (sums) memset(sums, 0, w * sizeof(int64_t));
+
+        size_t carry = 0;
+        for (uint64_t row = first_read; row <= (uint64_t)end_time;) {
+            const size_t n = (uint64_t)end_time - row + 1 < band ? (size_t)((uint64_t)end_time - row + 1) : band;
+            for (size_t i = 0; i < n; i++) rows[i] = row + i;
+            if (h5r_read_columns_range(h5_ctx, rows, n, cols + m0, w, win + carry * w) < 0) {
+                fprintf(stderr, "Error: Failed to read hours %lu-%lu for rolling window\n", (unsigned long)row,
+                        (unsigned long)(row + n - 1));
+                goto out;
+            }
+
+            // Rows of win are hours base.., the band starts at index carry; outputs begin at start_time
+            const size_t total = carry + n;
+            const uint64_t base = row - carry;
+            size_t from = row >= (uint64_t)start_time ? carry : carry + (size_t)((uint64_t)start_time - row);
+            if (from > total) from = total;     // Band entirely in the warm-up
+            const size_t nout = total - from;
+
+            if (extreme) {
+                sliding_extreme(win, total, from, w, window, spec->op == H5MOBAKU_ROLL_MAX, prefix, suffix, out);
+            } else {
+                for (size_t i = carry; i < total; i++) {
+                    const uint64_t t = base + i;
+                    const int32_t *x = win + i * w;
+                    double *o = i >= from ? out + (i - from) * w : NULL;
+                    if (ewma) {
+                        if (t == first_read) {
+                            for (size_t c = 0; c < w; c++) ewma[c] = x[c];
+                        } else {
+                            const double a = spec->alpha, b = 1.0 - spec->alpha;
+                            for (size_t c = 0; c < w; c++) ewma[c] = a * x[c] + b * ewma[c];
+                        }
+                        if (o) memcpy(o, ewma, w * sizeof(double));
+                        continue;
+                    }
+                    for (size_t c = 0; c < w; c++) sums[c] += x[c];
+                    // The hour leaving the window is still in win once window hours have been read
+                    if (t >= first_read + window) {
+                        const int32_t *old = win + (i - window) * w;
+                        for (size_t c = 0; c < w; c++) sums[c] -= old[c];
+                    }
+                    if (!o) continue;
+                    if (spec->op == H5MOBAKU_ROLL_SUM) {
+                        for (size_t c = 0; c < w; c++) o[c] = (double)sums[c];
+                    } else {
+                        const double count = (double)(t - first_read + 1 < window ? t - first_read + 1 : window);
+                        for (size_t c = 0; c < w; c++) o[c] = (double)sums[c] / count;
+                    }
+                }
+            }
+
+            if (nout > 0 && sink(user, (int)(base + from), nout, m0, w, out) != 0) goto out;
+
+            // Keep the last window hours for the next band
+            const size_t keep = total < window ? total : window;
+            memmove(win, win + (total - keep) * w, keep * w * sizeof(int32_t));
+            carry = keep;
+            row += n;
+        }
+    }
+    ret = 0;
+
+out:
+    free(cols);
+    free(rows);
+    free(win);
+    free(out);
+    free(prefix);
+    free(suffix);
+    free(sums);
+    free(ewma);
+    return ret;
+}
+
+double* h5mobaku_read_rolling(struct h5r *h5_ctx, cmph_t *hash, const uint32_t *mesh_ids, size_t num_meshes,
+                              int start_time, int end_time, const h5mobaku_rolling_spec_t *spec) {
+    size_t time_points = 0, mesh_count = 0;
+    if (!mesh_ids && h5r_get_dimensions(h5_ctx, &time_points, &mesh_count) == 0) num_meshes = mesh_count;
+    if (num_meshes == 0 || start_time < 0 || end_time < start_time) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_read_rolling\n");
+        return NULL;
+    }
+    h5mobaku_collect_t collect = {
+        .data = malloc((size_t)(end_time - start_time + 1) * num_meshes * sizeof(double)),
+        .start_time = start_time,
+        .num_meshes = num_meshes,
+    };
+    if (!collect.data) {
+        fprintf(stderr, "Error: Memory allocation failed for rolling window result\n");
+        return NULL;
+    }
+    if (h5mobaku_rolling_stream(h5_ctx, hash, mesh_ids, num_meshes, start_time, end_time, spec,
+                                h5mobaku_collect_sink, &collect) < 0) {
+        free(collect.data);
+        return NULL;
+    }
+    return collect.data;
+}
@@ -0,0 +1,409 @@
+//
+// Top-K meshes by population over a time range
+//
+
+#include "h5mobaku_topk.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define FIRST_MESH_DIVISOR 100000
+#define TOPK_BATCH_CELLS ((uint64_t)4 * 1024 * 1024)   // Cells read per batch
+#define TOPK_MAX_BATCH_BANDS 1024                       // Hyperslab blocks per batch
+
+// One chunk-wide column band and the most any of its meshes can reach
+typedef struct {
+    uint64_t band;
+    double bound;
+} topk_band_t;
+
+typedef struct {
+    struct h5r *h5;
+    pthread_mutex_t h5_mutex;       // HDF5 is not thread-safe; library calls are serialized
+
+    const uint8_t *selected;        // Per column, NULL when every column counts
+    const uint32_t *col_ids;
+    uint64_t cols, ccols;
+    uint64_t row0, nrows;
+    h5mobaku_reducer_t reducer;
+    size_t k;
+
+    const topk_band_t *bands;       // Highest bound first when pruning, column order otherwise
+    size_t num_bands;
+    size_t batch_bands;
+    int prune;
+
+    size_t next_band;
+    double threshold;               // Largest K-th value any worker holds; a lower bound of the answer
+    int have_threshold;
+    pthread_mutex_t task_mutex;
+    int failed;
+} topk_ctx_t;
+
+typedef struct {
+    topk_ctx_t *tk;
+    h5mobaku_topk_entry_t *heap;    // Min-heap: the root is the weakest entry kept
+    size_t size;
+} topk_worker_t;
+
+int h5mobaku_parse_reducer(const char *name, h5mobaku_reducer_t *reducer) {
+    if (!name || !reducer) return -1;
+    if (strcmp(name, "sum") == 0) *reducer = H5MOBAKU_REDUCE_SUM;
+    else if (strcmp(name, "mean") == 0) *reducer = H5MOBAKU_REDUCE_MEAN;
+    else if (strcmp(name, "max") == 0) *reducer = H5MOBAKU_REDUCE_MAX;
+    else return -1;
+    return 0;
+}
+
+// a ranks below b: smaller value, or the same value and a larger mesh ID
+static int entry_weaker(const h5mobaku_topk_entry_t *a, const h5mobaku_topk_entry_t *b) {
+    if (a->value != b->value) return a->value < b->value;
+    return a->mesh_id > b->mesh_id;
+}
+
+static void heap_push(topk_worker_t *w, size_t k, h5mobaku_topk_entry_t e) {
+    h5mobaku_topk_entry_t *h = w->heap;
+    size_t i;
+    if (w->size < k) {
+        i = w->size++;
+        while (i > 0 && entry_weaker(&e, &h[(i - 1) / 2])) {
+            h[i] = h[(i - 1) / 2];
+            i = (i - 1) / 2;
+        }
+        h[i] = e;
+        return;
+    }
+    if (!entry_weaker(&h[0], &e)) return;
+    i = 0;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= k) break;
+        if (child + 1 < k && entry_weaker(&h[child + 1], &h[child])) child++;
+        if (!entry_weaker(&h[child], &e)) break;
+        h[i] = h[child];
+        i = child;
+    }
+    h[i] = e;
+}
+
+static int entry_rank_compare(const void *a, const void *b) {
+    const h5mobaku_topk_entry_t *ea = (const h5mobaku_topk_entry_t *)a, *eb = (const h5mobaku_topk_entry_t *)b;
+    if (entry_weaker(eb, ea)) return -1;
+    if (entry_weaker(ea, eb)) return 1;
+    return 0;
+}
+
+static int band_bound_compare(const void *a, const void *b) {
+    const topk_band_t *ba = (const topk_band_t *)a, *bb = (const topk_band_t *)b;
+    if (ba->bound != bb->bound) return ba->bound < bb->bound ? 1 : -1;
+    return (ba->band > bb->band) - (ba->band < bb->band);
+}
+
+static int uint64_compare(const void *a, const void *b) {
+    const uint64_t va = *(const uint64_t *)a, vb = *(const uint64_t *)b;
+    return (va > vb) - (va < vb);
+}
+
+// Claim the next batch of bands, dropping those that cannot beat the threshold.
+// Returns the number of bands written to out (sorted by column), 0 when done.
+static size_t claim_batch(topk_ctx_t *tk, uint64_t *out) {
+    size_t n = 0;
+    pthread_mutex_lock(&tk->task_mutex);
+    while (n == 0 && !tk->failed && tk->next_band < tk->num_bands) {
+        const size_t end = tk->next_band + tk->batch_bands < tk->num_bands ? tk->next_band + tk->batch_bands
+                                                                           : tk->num_bands;
+        for (size_t i = tk->next_band; i < end; i++) {
+            // Bands are in bound order: once one falls short, every later one does
+            if (tk->prune && tk->have_threshold && tk->bands[i].bound < tk->threshold) {
+                tk->next_band = tk->num_bands;
+                break;
+            }
+            out[n++] = tk->bands[i].band;
+            tk->next_band = i + 1;
+        }
+    }
+    pthread_mutex_unlock(&tk->task_mutex);
+    qsort(out, n, sizeof(uint64_t), uint64_compare);
+    return n;
+}
+
+static void *topk_worker(void *arg) {
+    topk_worker_t *w = (topk_worker_t *)arg;
+    topk_ctx_t *tk = w->tk;
+
+    uint64_t *batch = malloc(tk->batch_bands * sizeof(uint64_t));
+    h5r_block_t *blocks = malloc(tk->batch_bands * sizeof(h5r_block_t));
+    const size_t max_width = tk->batch_bands * tk->ccols;
+    int32_t *buf = malloc(tk->nrows * max_width * sizeof(int32_t));
+    int64_t *acc = malloc(max_width * sizeof(int64_t));
+    if (!batch || !blocks || !buf || !acc) {
+        pthread_mutex_lock(&tk->task_mutex);
+        tk->failed = 1;
+        pthread_mutex_unlock(&tk->task_mutex);
+    }
+
+    size_t n;
+    while (batch && blocks && buf && acc && (n = claim_batch(tk, batch)) > 0) {
+        // Adjacent bands read as one block; memory columns follow file order
+        size_t nblk = 0, width = 0;
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t dcol0 = batch[i] * tk->ccols;
+            const uint64_t ncols = tk->cols - dcol0 < tk->ccols ? tk->cols - dcol0 : tk->ccols;
+            if (nblk > 0 && blocks[nblk - 1].dcol0 + blocks[nblk - 1].ncols == dcol0) {
+                blocks[nblk - 1].ncols += ncols;
+            } else {
+                blocks[nblk++] = (h5r_block_t){.dcol0 = dcol0, .mcol0 = width, .ncols = ncols};
+            }
+            width += ncols;
+        }
+
+        pthread_mutex_lock(&tk->h5_mutex);
+        int rv = h5r_read_blocks_union(tk->h5, tk->row0, tk->nrows, blocks, nblk, buf, width);
+        pthread_mutex_unlock(&tk->h5_mutex);
+        if (rv < 0) {
+            fprintf(stderr, "Error: Failed to read %zu column bands for top-k\n", n);
+            pthread_mutex_lock(&tk->task_mutex);
+            tk->failed = 1;
+            pthread_mutex_unlock(&tk->task_mutex);
+            break;
+        }
+
+        // Reduce down the rows with the columns innermost
+        if (tk->reducer == H5MOBAKU_REDUCE_MAX) {
+            for (size_t c = 0; c < width; c++) acc[c] = buf[c];
+            for (uint64_t r = 1; r < tk->nrows; r++) {
+                const int32_t *row = buf + r * width;
+                for (size_t c = 0; c < width; c++) acc[c] = row[c] > acc[c] ? row[c] : acc[c];
+            }
+        } else {
+            memset(acc, 0, width * sizeof(int64_t));
+            for (uint64_t r = 0; r < tk->nrows; r++) {
+                const int32_t *row = buf + r * width;
+                for (size_t c = 0; c < width; c++) acc[c] += row[c];
+            }
+        }
+
+        const double divisor = tk->reducer == H5MOBAKU_REDUCE_MEAN ? (double)tk->nrows : 1.0;
+        for (size_t b = 0; b < nblk; b++) {
+            for (uint64_t j = 0; j < blocks[b].ncols; j++) {
+                const uint64_t col = blocks[b].dcol0 + j;
+                if (tk->selected && !tk->selected[col]) continue;
+                h5mobaku_topk_entry_t e = {.mesh_id = tk->col_ids[col],
+                                           .value = (double)acc[blocks[b].mcol0 + j] / divisor};
+                heap_push(w, tk->k, e);
+            }
+        }
+
+        if (w->size == tk->k) {
+            pthread_mutex_lock(&tk->task_mutex);
+            if (!tk->have_threshold || w->heap[0].value > tk->threshold) {
+                tk->threshold = w->heap[0].value;
+                tk->have_threshold = 1;
+            }
+            pthread_mutex_unlock(&tk->task_mutex);
+        }
+    }
+
+    free(batch);
+    free(blocks);
+    free(buf);
+    free(acc);
+    return NULL;
+}
+
+// Columns to rank: the file's own meshid_list when it has one, else the compiled-in list
+static uint32_t *column_ids(struct h5r *h5, const h5r_metadata_t *meta, int *owned) {
+    *owned = 0;
+    if (meta->has_meshid_list) {
+        uint32_t *ids = NULL;
+        size_t count = 0;
+        if (h5r_read_meshid_list(h5, &ids, &count) == 0 && count == meta->cols) {
+            *owned = 1;
+            return ids;
+        }
+        free(ids);
+        return NULL;
+    }
+    return meta->cols == meshid_list_size ? (uint32_t *)meshid_list : NULL;
+}
+
+// Upper bound of the reduced value of any mesh in each band from the chunk maxima
+static void band_bounds(topk_band_t *bands, size_t num_bands, const int32_t *max, uint64_t nmesh, uint64_t crows,
+                        uint64_t row0, uint64_t nrows, h5mobaku_reducer_t reducer) {
+    const uint64_t tc0 = row0 / crows, tc1 = (row0 + nrows - 1) / crows;
+    for (size_t i = 0; i < num_bands; i++) {
+        double bound = 0.0;
+        for (uint64_t tc = tc0; tc <= tc1; tc++) {
+            const int32_t m = max[tc * nmesh + bands[i].band];
+            if (reducer == H5MOBAKU_REDUCE_MAX) {
+                if (tc == tc0 || m > bound) bound = m;
+            } else {
+                const uint64_t lo = tc * crows > row0 ? tc * crows : row0;
+                const uint64_t hi = (tc + 1) * crows < row0 + nrows ? (tc + 1) * crows : row0 + nrows;
+                bound += (double)m * (double)(hi - lo);
+            }
+        }
+        bands[i].bound = reducer == H5MOBAKU_REDUCE_MEAN ? bound / (double)nrows : bound;
+    }
+}
+
+int h5mobaku_top_k(struct h5mobaku *ctx, size_t k, int start_time, int end_time, h5mobaku_reducer_t reducer,
+                   const h5mobaku_topk_config_t *config, h5mobaku_topk_entry_t *out, size_t *count) {
+    h5mobaku_topk_config_t defaults = H5MOBAKU_TOPK_DEFAULT_CONFIG;
+    if (!config) config = &defaults;
+    if (!ctx || !ctx->h5r_ctx || !out || !count || k == 0 || start_time < 0 || end_time < start_time ||
+        reducer < H5MOBAKU_REDUCE_SUM || reducer > H5MOBAKU_REDUCE_MAX) {
+        fprintf(stderr, "Error: Invalid parameters in h5mobaku_top_k\n");
+        return -1;
+    }
+    *count = 0;
+
+    h5r_metadata_t meta;
+    if (h5r_get_metadata(ctx->h5r_ctx, &meta) < 0 || (uint64_t)end_time >= meta.rows) {
+        fprintf(stderr, "Error: Time range %d-%d is outside the file\n", start_time, end_time);
+        return -1;
+    }
+    const uint64_t crows = meta.crows > 0 ? meta.crows : 1;
+    const uint64_t ccols = meta.ccols > 0 ? meta.ccols : meta.cols;
+
+    int owned_ids = 0;
+    uint32_t *col_ids = column_ids(ctx->h5r_ctx, &meta, &owned_ids);
+    if (!col_ids) {
+        fprintf(stderr, "Error: Cannot determine the mesh IDs of the file's columns\n");
+        return -1;
+    }
+
+    uint8_t *selected = NULL;
+    if (config->mesh1 && config->num_mesh1 > 0) {
+        selected = calloc(meta.cols, 1);
+        if (!selected) goto fail_ids;
+        for (uint64_t c = 0; c < meta.cols; c++) {
+            const uint32_t mesh1 = col_ids[c] / FIRST_MESH_DIVISOR;
+            for (size_t i = 0; i < config->num_mesh1; i++) {
+                if (config->mesh1[i] == mesh1) {
+                    selected[c] = 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Bands holding at least one mesh of the region
+    const uint64_t ncc = (meta.cols + ccols - 1) / ccols;
+    topk_band_t *bands = malloc(ncc * sizeof(topk_band_t));
+    if (!bands) goto fail_selected;
+    size_t num_bands = 0;
+    for (uint64_t b = 0; b < ncc; b++) {
+        int any = !selected;
+        for (uint64_t c = b * ccols; !any && c < meta.cols && c < (b + 1) * ccols; c++) any = selected[c];
+        if (any) bands[num_bands++] = (topk_band_t){.band = b, .bound = 0.0};
+    }
+
+    const uint64_t row0 = (uint64_t)start_time, nrows = (uint64_t)(end_time - start_time + 1);
+    int prune = 0;
+    if (config->use_chunk_max) {
+        int32_t *max = NULL;
+        uint64_t ntime = 0, nmesh = 0;
+        if (h5r_read_chunk_max(ctx->h5r_ctx, &max, &ntime, &nmesh) == 0 && nmesh == ncc) {
+            band_bounds(bands, num_bands, max, nmesh, crows, row0, nrows, reducer);
+            qsort(bands, num_bands, sizeof(topk_band_t), band_bound_compare);
+            prune = 1;
+        }
+        free(max);
+    }
+
+    uint64_t batch_bands = TOPK_BATCH_CELLS / (nrows * ccols);
+    if (batch_bands < 1) batch_bands = 1;
+    if (batch_bands > TOPK_MAX_BATCH_BANDS) batch_bands = TOPK_MAX_BATCH_BANDS;
+
+    long num_threads = config->threads > 0 ? config->threads : sysconf(_SC_NPROCESSORS_ONLN);
+    const size_t num_batches = (num_bands + batch_bands - 1) / batch_bands;
+    if ((size_t)num_threads > num_batches) num_threads = (long)num_batches;
+    if (num_threads < 1) num_threads = 1;
+
+    topk_ctx_t tk = {
+        .h5 = ctx->h5r_ctx,
+        .selected = selected,
+        .col_ids = col_ids,
+        .cols = meta.cols,
+        .ccols = ccols,
+        .row0 = row0,
+        .nrows = nrows,
+        .reducer = reducer,
+        .k = k,
+        .bands = bands,
+        .num_bands = num_bands,
+        .batch_bands = (size_t)batch_bands,
+        .prune = prune,
+    };
+    pthread_mutex_init(&tk.h5_mutex, NULL);
+    pthread_mutex_init(&tk.task_mutex, NULL);
+
+    topk_worker_t *workers = calloc((size_t)num_threads, sizeof(topk_worker_t));
+    pthread_t *threads = malloc((size_t)num_threads * sizeof(pthread_t));
+    long started = 0;
+    if (workers && threads) {
+        for (; started < num_threads; started++) {
+            workers[started].tk = &tk;
+            workers[started].heap = malloc(k * sizeof(h5mobaku_topk_entry_t));
+            if (!workers[started].heap) break;
+            if (pthread_create(&threads[started], NULL, topk_worker, &workers[started]) != 0) {
+                free(workers[started].heap);
+                break;
+            }
+        }
+    }
+    if (started == 0 && num_bands > 0) {
+        fprintf(stderr, "Error: Failed to start top-k threads\n");
+        tk.failed = 1;
+    }
+    for (long i = 0; i < started; i++) pthread_join(threads[i], NULL);
+
+    // Merge the per-thread heaps
+    size_t total = 0;
+    for (long i = 0; i < started; i++) total += workers[i].size;
+    h5mobaku_topk_entry_t *all = total > 0 ? malloc(total * sizeof(h5mobaku_topk_entry_t)) : NULL;
+    if (total > 0 && !all) tk.failed = 1;
+    if (!tk.failed) {
+        size_t n = 0;
+        for (long i = 0; i < started; i++) {
+            memcpy(all + n, workers[i].heap, workers[i].size * sizeof(h5mobaku_topk_entry_t));
+            n += workers[i].size;
+        }
+        qsort(all, total, sizeof(h5mobaku_topk_entry_t), entry_rank_compare);
+        *count = total < k ? total : k;
+        memcpy(out, all, *count * sizeof(h5mobaku_topk_entry_t));
+    }
+
+    free(all);
+    for (long i = 0; i < started; i++) free(workers[i].heap);
+    free(workers);
+    free(threads);
+    pthread_mutex_destroy(&tk.h5_mutex);
+    pthread_mutex_destroy(&tk.task_mutex);
+    free(bands);
+    free(selected);
+    if (owned_ids) free(col_ids);
+    return tk.failed ? -1 : 0;
+
+fail_selected:
+    free(selected);
+fail_ids:
+    if (owned_ids) free(col_ids);
+    fprintf(stderr, "Error: Memory allocation failed for top-k\n");
+    return -1;
+}
+
+int h5mobaku_build_chunk_max(const char *path) {
+    struct h5r *h5 = NULL;
+    if (!path || h5r_open_readwrite(path, &h5) != 0) {
+        fprintf(stderr, "Error: Cannot open %s for writing\n", path ? path : "(null)");
+        return -1;
+    }
+    int ret = h5r_build_chunk_max(h5);
+    if (ret < 0) fprintf(stderr, "Error: Failed to build chunk_max in %s\n", path);
+    h5r_close(h5);
+    return ret;
+}
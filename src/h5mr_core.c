@@ -3,28 +3,19 @@
 //
 #define _GNU_SOURCE
 #include "H5MR/h5mr.h"
+#include "mesh_dict.h"
 #include <hdf5.h>
 #include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 
-// Define to enable io_uring support (comment out to disable)
-#define USE_IO_URING
-
-#ifdef USE_IO_URING
-#include <liburing.h>
-#define QD 32           /* Queue depth (sufficient for row-based operations) */
-#endif
-
 #define ALIGN 4096
 
+/* Above this many hyperslab rectangles a read gathers cells from whole chunks instead */
+#define H5R_MAX_SELECTION_BLOCKS 4096
+
 struct h5r {
-    int fd;                     /* HDF5 file descriptor */
-#ifdef USE_IO_URING
-    struct io_uring ring;       /* io_uring instance */
-    int io_uring_enabled;       /* Whether io_uring is actually available */
-#endif
     hid_t file, dset;
     hsize_t rows, cols;
     hsize_t crows, ccols;
@@ -33,6 +24,9 @@ struct h5r {
     hid_t dcpl_id;              /* Dataset creation property list */
     int is_writable;            /* Whether file is open for writing */
     h5r_writer_config_t config; /* Writer configuration */
+    h5r_metadata_t meta;        /* Collected once at open */
+    mesh_dict_t *mesh_dict;     /* File-specific column lookup, NULL when the compiled-in list applies */
+    int chunk_max_dropped;      /* chunk_max already removed by a write through this context */
 };
 
 
@@ -41,88 +35,65 @@ static void *aligned_alloc4k(size_t n)
 {
     void *p; posix_memalign(&p, ALIGN, n); return p;
 }
-#ifdef USE_IO_URING
-// Open file with io_uring support
-static int h5r_open_io_uring(const char *path, struct h5r *ctx) {
-    // Open file with O_DIRECT for bypassing page cache
-    ctx->fd = open(path, O_RDONLY | O_DIRECT);
-    if (ctx->fd < 0) {
-        // Fallback to normal open if O_DIRECT fails
-        ctx->fd = open(path, O_RDONLY);
-        if (ctx->fd < 0) {
-            return -1;
-        }
-    }
-    
-    // Initialize io_uring
-    ctx->io_uring_enabled = 0;
-    if (io_uring_queue_init(QD, &ctx->ring, IORING_SETUP_SQPOLL) == 0) {
-        ctx->io_uring_enabled = 1;
-    } else if (io_uring_queue_init(QD, &ctx->ring, 0) == 0) {
-        // Initialize in normal mode if SQPOLL fails
-        ctx->io_uring_enabled = 1;
+
+/* Collect everything later queries need while the dataset is already open */
+static int h5r_load_metadata(struct h5r *ctx)
+{
+    h5r_metadata_t *meta = &ctx->meta;
+    memset(meta, 0, sizeof(*meta));
+
+    hid_t sp = H5Dget_space(ctx->dset);
+    hsize_t dims[2] = {0, 0};
+    if (sp < 0 || H5Sget_simple_extent_dims(sp, dims, NULL) != 2) {
+        if (sp >= 0) H5Sclose(sp);
+        return -1;
     }
-    // Don't treat io_uring init failure as error, fallback to standard I/O
-    
-    return 0;
-}
+    H5Sclose(sp);
+    meta->rows = dims[0];
+    meta->cols = dims[1];
 
-// Cleanup io_uring resources
-static void h5r_cleanup_io_uring(struct h5r *ctx) {
-    if (ctx->io_uring_enabled) {
-        io_uring_queue_exit(&ctx->ring);
+    hid_t dcpl = ctx->dcpl_id >= 0 ? ctx->dcpl_id : H5Dget_create_plist(ctx->dset);
+    meta->layout = (int32_t)H5Pget_layout(dcpl);
+    if (meta->layout == H5D_CHUNKED && H5Pget_chunk(dcpl, 2, dims) == 2) {
+        meta->crows = dims[0];
+        meta->ccols = dims[1];
+    } else {
+        // Default values for non-chunked datasets
+        meta->crows = 1;
+        meta->ccols = meta->cols;
     }
-    if (ctx->fd >= 0) close(ctx->fd);
-}
-#endif
+    if (dcpl != ctx->dcpl_id) H5Pclose(dcpl);
 
-// Open file with standard I/O
-static int h5r_open_standard(const char *path, struct h5r *ctx) {
-    // Use standard file descriptor
-    ctx->fd = open(path, O_RDONLY);
-    if (ctx->fd < 0) {
-        return -1;
+    meta->has_meshid_list = H5Lexists(ctx->file, "meshid_list", H5P_DEFAULT) > 0;
+
+    if (H5Aexists(ctx->dset, "start_datetime") > 0) {
+        hid_t attr = H5Aopen(ctx->dset, "start_datetime", H5P_DEFAULT);
+        hid_t atype = H5Tcopy(H5T_C_S1);
+        H5Tset_size(atype, H5T_VARIABLE);
+        H5Tset_cset(atype, H5T_CSET_UTF8);
+        char *value = NULL;
+        if (attr >= 0 && H5Aread(attr, atype, &value) >= 0 && value) {
+            strncpy(meta->start_datetime, value, sizeof(meta->start_datetime) - 1);
+            H5free_memory(value);
+        }
+        H5Tclose(atype);
+        if (attr >= 0) H5Aclose(attr);
     }
     return 0;
 }
 
-// Cleanup standard I/O resources
-static void h5r_cleanup_standard(struct h5r *ctx) {
-    if (ctx->fd >= 0) close(ctx->fd);
-}
-
-int h5r_open(const char *path, struct h5r **out)
+int h5r_open_with_metadata(const char *path, const h5r_metadata_t *cached, struct h5r **out)
 {
+    if (!path || !out) return -1;
     struct h5r *ctx = calloc(1, sizeof(*ctx));
     if (!ctx) return -1;
-    
-    // Initialize file descriptor and io_uring
-#ifdef USE_IO_URING
-    if (h5r_open_io_uring(path, ctx) < 0) {
-        // Fallback to standard version if io_uring fails
-        if (h5r_open_standard(path, ctx) < 0) {
-            free(ctx);
-            return -1;
-        }
-    }
-#else
-    if (h5r_open_standard(path, ctx) < 0) {
-        free(ctx);
-        return -1;
-    }
-#endif
+
+    ctx->dataspace_id = -1;  // Not used for read-only mode
+    ctx->dcpl_id = -1;       // Not used for read-only mode
 
     /* HDF5 read-only */
-    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
-    ctx->file = H5Fopen(path, H5F_ACC_RDONLY, fapl);
-    H5Pclose(fapl);
-    
+    ctx->file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
     if (ctx->file < 0) {
-#ifdef USE_IO_URING
-        h5r_cleanup_io_uring(ctx);
-#else
-        h5r_cleanup_standard(ctx);
-#endif
         free(ctx);
         return -1;
     }
@@ -133,45 +104,86 @@ int h5r_open(const char *path, struct h5r **out)
                        /* nbytes */ 32 * 1024 * 1024,
                        /* w0     */ 0.75);
     ctx->dset = H5Dopen2(ctx->file, "population_data", dapl);
-    H5Pclose(dapl);    if (ctx->dset < 0) {
+    H5Pclose(dapl);
+    if (ctx->dset < 0) {
         H5Fclose(ctx->file);
-#ifdef USE_IO_URING
-        h5r_cleanup_io_uring(ctx);
-#else
-        h5r_cleanup_standard(ctx);
-#endif
         free(ctx);
         return -1;
     }
-    
-    hid_t sp = H5Dget_space(ctx->dset);
-    hsize_t dims[2];
-    H5Sget_simple_extent_dims(sp, dims, NULL);
-    ctx->rows = dims[0];
-    ctx->cols = dims[1];
 
-    /* Get chunk dimensions */
-    hid_t dcpl = H5Dget_create_plist(ctx->dset);
-    int ndims = H5Pget_chunk(dcpl, 2, dims);
-    if (ndims > 0) {
-        ctx->crows = dims[0];
-        ctx->ccols = dims[1];
-    } else {
-        // Default values for non-chunked datasets
-        ctx->crows = 1;
-        ctx->ccols = ctx->cols;
+    if (cached) {
+        ctx->meta = *cached;
+    } else if (h5r_load_metadata(ctx) < 0) {
+        h5r_close(ctx);
+        return -1;
     }
-    H5Pclose(dcpl);
-    H5Sclose(sp);
 
+    ctx->rows = ctx->meta.rows;
+    ctx->cols = ctx->meta.cols;
+    ctx->crows = ctx->meta.crows;
+    ctx->ccols = ctx->meta.ccols;
     ctx->base = H5Dget_offset(ctx->dset);
-    ctx->dataspace_id = -1;  // Not used for read-only mode
-    ctx->dcpl_id = -1;       // Not used for read-only mode
     ctx->is_writable = 0;    // Read-only
     *out = ctx;
     return 0;
 }
 
+int h5r_open(const char *path, struct h5r **out)
+{
+    return h5r_open_with_metadata(path, NULL, out);
+}
+
+int h5r_get_metadata(struct h5r *ctx, h5r_metadata_t *meta)
+{
+    if (!ctx || !meta) return -1;
+    *meta = ctx->meta;
+    meta->rows = ctx->rows;  // Tracks h5r_extend_time_dimension
+    meta->cols = ctx->cols;
+    return 0;
+}
+
+int h5r_read_meshid_list(struct h5r *ctx, uint32_t **ids, size_t *count)
+{
+    if (!ctx || !ids || !count) return -1;
+    *ids = NULL;
+    *count = 0;
+
+    hid_t dset = H5Dopen2(ctx->file, "meshid_list", H5P_DEFAULT);
+    if (dset < 0) return -1;
+    hid_t sp = H5Dget_space(dset);
+    hsize_t n = 0;
+    if (sp < 0 || H5Sget_simple_extent_ndims(sp) != 1 || H5Sget_simple_extent_dims(sp, &n, NULL) != 1 || n == 0) {
+        if (sp >= 0) H5Sclose(sp);
+        H5Dclose(dset);
+        return -1;
+    }
+    H5Sclose(sp);
+
+    uint32_t *buf = malloc((size_t)n * sizeof(uint32_t));
+    if (!buf || H5Dread(dset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0) {
+        free(buf);
+        H5Dclose(dset);
+        return -1;
+    }
+    H5Dclose(dset);
+
+    *ids = buf;
+    *count = (size_t)n;
+    return 0;
+}
+
+void h5r_set_mesh_dict(struct h5r *ctx, struct mesh_dict *dict)
+{
+    if (!ctx) return;
+    mesh_dict_destroy(ctx->mesh_dict);
+    ctx->mesh_dict = dict;
+}
+
+const struct mesh_dict *h5r_get_mesh_dict(struct h5r *ctx)
+{
+    return ctx ? ctx->mesh_dict : NULL;
+}
+
 int h5r_read_cell(struct h5r *ctx, uint64_t row, uint64_t col, int32_t *value)
 {
     /* Read single cell */
@@ -204,42 +216,6 @@ static int read_contiguous_cells(struct h5r *ctx, uint64_t row, uint64_t start_c
     return ret;
 }
 
-static int read_chunked_cells(struct h5r *ctx, uint64_t row, uint64_t *cols, size_t ncols, int32_t *values) {
-    /* Optimized read using H5Sselect_elements() */
-    hid_t fsp = H5Dget_space(ctx->dset);
-    
-    // Create 2D coordinate array (row, col) pairs
-    hsize_t *coords = (hsize_t*)malloc(ncols * 2 * sizeof(hsize_t));
-    if (!coords) {
-        H5Sclose(fsp);
-        return -1;
-    }
-    
-    // Set coordinates
-    for (size_t i = 0; i < ncols; i++) {
-        coords[i * 2] = row;         // row coordinate
-        coords[i * 2 + 1] = cols[i]; // column coordinate
-    }
-    
-    // Select all elements at once with H5Sselect_elements()
-    herr_t status = H5Sselect_elements(fsp, H5S_SELECT_SET, ncols, coords);
-    free(coords);
-    
-    if (status < 0) {
-        H5Sclose(fsp);
-        return -1;
-    }
-    
-    // Create memory space
-    hid_t msp = H5Screate_simple(1, (hsize_t[]){ncols}, NULL);
-    
-    // Read data
-    int ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, values);
-    
-    H5Sclose(msp); H5Sclose(fsp);
-    return ret;
-}
-
 int h5r_read_cells(struct h5r *ctx, uint64_t row, uint64_t *cols, size_t ncols, int32_t *values)
 {
     if (!ctx || !cols || !values || ncols == 0) return -1;
@@ -254,8 +230,8 @@ int h5r_read_cells(struct h5r *ctx, uint64_t row, uint64_t *cols, size_t ncols,
         return read_contiguous_cells(ctx, row, cols[0], ncols, values);
     }
     
-    /* Use chunk-optimized read for non-contiguous columns */
-    return read_chunked_cells(ctx, row, cols, ncols, values);
+    /* Non-contiguous columns: runs of columns as a hyperslab union */
+    return h5r_read_columns_range(ctx, &row, 1, cols, ncols, values);
 }
 
 int h5r_read_column_range(struct h5r *ctx, uint64_t start_row, uint64_t end_row, uint64_t col, int32_t *values)
@@ -281,6 +257,121 @@ int h5r_read_column_range(struct h5r *ctx, uint64_t start_row, uint64_t end_row,
     return ret;
 }
 
+/* Sorted, deduplicated copy of an index list; slot[i] is the position of idx[i] in it */
+typedef struct {
+    uint64_t value;
+    size_t pos;
+} index_entry_t;
+
+static int index_entry_compare(const void *a, const void *b)
+{
+    const index_entry_t *ea = (const index_entry_t *)a, *eb = (const index_entry_t *)b;
+    if (ea->value != eb->value) return (ea->value > eb->value) - (ea->value < eb->value);
+    return (ea->pos > eb->pos) - (ea->pos < eb->pos);
+}
+
+static int sort_unique(const uint64_t *idx, size_t n, uint64_t *uniq, size_t *nuniq, size_t *slot)
+{
+    index_entry_t *entries = malloc(n * sizeof(index_entry_t));
+    if (!entries) return -1;
+    for (size_t i = 0; i < n; i++) entries[i] = (index_entry_t){idx[i], i};
+    qsort(entries, n, sizeof(index_entry_t), index_entry_compare);
+
+    size_t u = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (u == 0 || uniq[u - 1] != entries[i].value) uniq[u++] = entries[i].value;
+        slot[entries[i].pos] = u - 1;
+    }
+    free(entries);
+    *nuniq = u;
+    return 0;
+}
+
+static size_t count_runs(const uint64_t *uniq, size_t n)
+{
+    size_t runs = n > 0;
+    for (size_t i = 1; i < n; i++) runs += uniq[i] != uniq[i - 1] + 1;
+    return runs;
+}
+
+/* Union of (row run x column run) rectangles; the file selection is visited row-major, which
+ * is exactly the order of the dense nur x nuc grid */
+static int read_grid_hyperslabs(struct h5r *ctx, const uint64_t *urows, size_t nur, const uint64_t *ucols, size_t nuc,
+                                int32_t *grid)
+{
+    hid_t fsp = H5Dget_space(ctx->dset);
+    if (fsp < 0) return -1;
+
+    H5S_seloper_t op = H5S_SELECT_SET;
+    for (size_t r = 0; r < nur;) {
+        size_t r_end = r + 1;
+        while (r_end < nur && urows[r_end] == urows[r_end - 1] + 1) r_end++;
+        for (size_t c = 0; c < nuc;) {
+            size_t c_end = c + 1;
+            while (c_end < nuc && ucols[c_end] == ucols[c_end - 1] + 1) c_end++;
+            if (H5Sselect_hyperslab(fsp, op, (hsize_t[]){urows[r], ucols[c]}, NULL,
+                                    (hsize_t[]){r_end - r, c_end - c}, NULL) < 0) {
+                H5Sclose(fsp);
+                return -1;
+            }
+            op = H5S_SELECT_OR;
+            c = c_end;
+        }
+        r = r_end;
+    }
+
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){(hsize_t)nur * nuc}, NULL);
+    int ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, grid);
+    H5Sclose(msp); H5Sclose(fsp);
+    return ret;
+}
+
+/* Fragmented requests: read the requested bounding box of each chunk touched and gather the
+ * cells in memory, so the selection never grows with the number of runs */
+static int read_grid_chunks(struct h5r *ctx, const uint64_t *urows, size_t nur, const uint64_t *ucols, size_t nuc,
+                            int32_t *grid)
+{
+    const uint64_t crows = ctx->crows > 0 ? ctx->crows : 1;
+    const uint64_t ccols = ctx->ccols > 0 ? ctx->ccols : ctx->cols;
+    int32_t *tile = malloc((size_t)crows * ccols * sizeof(int32_t));
+    hid_t fsp = H5Dget_space(ctx->dset);
+    if (!tile || fsp < 0) {
+        free(tile);
+        if (fsp >= 0) H5Sclose(fsp);
+        return -1;
+    }
+
+    int ret = 0;
+    for (size_t r = 0; r < nur && ret >= 0;) {
+        size_t r_end = r + 1;
+        while (r_end < nur && urows[r_end] / crows == urows[r] / crows) r_end++;
+        const uint64_t row0 = urows[r], height = urows[r_end - 1] - row0 + 1;
+
+        for (size_t c = 0; c < nuc && ret >= 0;) {
+            size_t c_end = c + 1;
+            while (c_end < nuc && ucols[c_end] / ccols == ucols[c] / ccols) c_end++;
+            const uint64_t col0 = ucols[c], width = ucols[c_end - 1] - col0 + 1;
+
+            hid_t msp = H5Screate_simple(1, (hsize_t[]){height * width}, NULL);
+            ret = H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row0, col0}, NULL,
+                                      (hsize_t[]){height, width}, NULL);
+            if (ret >= 0) ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, tile);
+            H5Sclose(msp);
+
+            for (size_t i = r; ret >= 0 && i < r_end; i++) {
+                const int32_t *src = tile + (urows[i] - row0) * width;
+                for (size_t j = c; j < c_end; j++) grid[i * nuc + j] = src[ucols[j] - col0];
+            }
+            c = c_end;
+        }
+        r = r_end;
+    }
+
+    H5Sclose(fsp);
+    free(tile);
+    return ret < 0 ? -1 : 0;
+}
+
 int h5r_read_columns_range(struct h5r *ctx, uint64_t *rows, size_t nrows, uint64_t *cols, size_t ncols, int32_t *values)
 {
     /* Optimized read for multiple meshes x multiple time series
@@ -288,48 +379,204 @@ int h5r_read_columns_range(struct h5r *ctx, uint64_t *rows, size_t nrows, uint64
      * cols: mesh index array (ncols elements) 
      * values: output array (nrows × ncols)
      * Output layout: values[row_idx * ncols + col_idx]
+     * Rows and columns may be unsorted or repeated; they are read once each, as runs.
      */
     if (!ctx || !rows || !cols || !values || nrows == 0 || ncols == 0) return -1;
-    
-    hid_t fsp = H5Dget_space(ctx->dset);
-    size_t total_elements = nrows * ncols;
-    
-    // Create 2D coordinate array
-    hsize_t *coords = (hsize_t*)malloc(total_elements * 2 * sizeof(hsize_t));
-    if (!coords) {
-        H5Sclose(fsp);
-        return -1;
+
+    uint64_t *urows = malloc(nrows * sizeof(uint64_t));
+    uint64_t *ucols = malloc(ncols * sizeof(uint64_t));
+    size_t *rslot = malloc(nrows * sizeof(size_t));
+    size_t *cslot = malloc(ncols * sizeof(size_t));
+    size_t nur = 0, nuc = 0;
+    int ret = -1;
+    if (!urows || !ucols || !rslot || !cslot || sort_unique(rows, nrows, urows, &nur, rslot) < 0 ||
+        sort_unique(cols, ncols, ucols, &nuc, cslot) < 0) {
+        goto out;
     }
-    
-    // Set coordinates for all (row, col) pairs
-    size_t coord_idx = 0;
-    for (size_t r = 0; r < nrows; r++) {
-        for (size_t c = 0; c < ncols; c++) {
-            coords[coord_idx * 2] = rows[r];      // time index
-            coords[coord_idx * 2 + 1] = cols[c];  // mesh index
-            coord_idx++;
+    if (urows[nur - 1] >= ctx->rows || ucols[nuc - 1] >= ctx->cols) goto out;
+
+    /* Already sorted and unique: the grid is the output itself */
+    int32_t *grid = values;
+    if (nur != nrows || nuc != ncols || memcmp(urows, rows, nrows * sizeof(uint64_t)) != 0 ||
+        memcmp(ucols, cols, ncols * sizeof(uint64_t)) != 0) {
+        grid = malloc(nur * nuc * sizeof(int32_t));
+        if (!grid) goto out;
+    }
+
+    const size_t blocks = count_runs(urows, nur) * count_runs(ucols, nuc);
+    ret = blocks <= H5R_MAX_SELECTION_BLOCKS ? read_grid_hyperslabs(ctx, urows, nur, ucols, nuc, grid)
+                                             : read_grid_chunks(ctx, urows, nur, ucols, nuc, grid);
+
+    if (grid != values) {
+        if (ret >= 0) {
+            for (size_t r = 0; r < nrows; r++) {
+                const int32_t *src = grid + rslot[r] * nuc;
+                for (size_t c = 0; c < ncols; c++) values[r * ncols + c] = src[cslot[c]];
+            }
         }
+        free(grid);
     }
-    
-    // Select all elements at once with H5Sselect_elements()
-    herr_t status = H5Sselect_elements(fsp, H5S_SELECT_SET, total_elements, coords);
-    free(coords);
-    
-    if (status < 0) {
-        H5Sclose(fsp);
-        return -1;
+
+out:
+    free(urows); free(ucols); free(rslot); free(cslot);
+    return ret < 0 ? -1 : 0;
+}
+
+
+/* One regular hyperslab (start, stride, count, block) per column run; each covers the same rows,
+ * so the union is still visited row-major in pattern order */
+static int read_pattern_hyperslabs(struct h5r *ctx, const h5r_time_pattern_t *pattern, const uint64_t *ucols,
+                                   size_t nuc, int32_t *grid)
+{
+    hid_t fsp = H5Dget_space(ctx->dset);
+    if (fsp < 0) return -1;
+
+    for (size_t c = 0; c < nuc;) {
+        size_t c_end = c + 1;
+        while (c_end < nuc && ucols[c_end] == ucols[c_end - 1] + 1) c_end++;
+        if (H5Sselect_hyperslab(fsp, c == 0 ? H5S_SELECT_SET : H5S_SELECT_OR,
+                                (hsize_t[]){pattern->start, ucols[c]}, (hsize_t[]){pattern->stride, 1},
+                                (hsize_t[]){pattern->count, 1}, (hsize_t[]){pattern->block, c_end - c}) < 0) {
+            H5Sclose(fsp);
+            return -1;
+        }
+        c = c_end;
     }
-    
-    // Create memory space (as 1D array)
-    hid_t msp = H5Screate_simple(1, (hsize_t[]){total_elements}, NULL);
-    
-    // Read data
-    int ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, values);
-    
+
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){(hsize_t)(pattern->count * pattern->block) * nuc}, NULL);
+    int ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, grid);
     H5Sclose(msp); H5Sclose(fsp);
     return ret;
 }
 
+uint64_t h5r_pattern_rows(const h5r_time_pattern_t *pattern)
+{
+    if (!pattern || pattern->block == 0 || pattern->count == 0) return 0;
+    if (pattern->count > 1 && pattern->stride < pattern->block) return 0;
+    return pattern->count * pattern->block;
+}
+
+int h5r_read_pattern(struct h5r *ctx, const h5r_time_pattern_t *pattern, uint64_t *cols, size_t ncols,
+                     int32_t *values)
+{
+    /* Periodic rows (block hours every stride hours, count times) x columns
+     * Output layout: values[(k * block + b) * ncols + col_idx]
+     */
+    const uint64_t nrows = h5r_pattern_rows(pattern);
+    if (!ctx || !cols || !values || ncols == 0 || nrows == 0) return -1;
+    h5r_time_pattern_t p = *pattern;
+    if (p.count == 1) p.stride = p.block;
+    if (p.start + (p.count - 1) * p.stride + p.block > ctx->rows) return -1;
+
+    uint64_t *ucols = malloc(ncols * sizeof(uint64_t));
+    size_t *cslot = malloc(ncols * sizeof(size_t));
+    size_t nuc = 0;
+    int ret = -1;
+    if (!ucols || !cslot || sort_unique(cols, ncols, ucols, &nuc, cslot) < 0) goto out;
+    if (ucols[nuc - 1] >= ctx->cols) goto out;
+
+    if (count_runs(ucols, nuc) * p.count > H5R_MAX_SELECTION_BLOCKS) {
+        /* Too many rectangles for a selection: list the rows and let the chunk gather take them */
+        uint64_t *rows = malloc(nrows * sizeof(uint64_t));
+        if (!rows) goto out;
+        for (uint64_t k = 0, i = 0; k < p.count; k++) {
+            for (uint64_t b = 0; b < p.block; b++) rows[i++] = p.start + k * p.stride + b;
+        }
+        ret = h5r_read_columns_range(ctx, rows, nrows, cols, ncols, values);
+        free(rows);
+        goto out;
+    }
+
+    int32_t *grid = values;
+    if (nuc != ncols || memcmp(ucols, cols, ncols * sizeof(uint64_t)) != 0) {
+        grid = malloc(nrows * nuc * sizeof(int32_t));
+        if (!grid) goto out;
+    }
+    ret = read_pattern_hyperslabs(ctx, &p, ucols, nuc, grid);
+    if (grid != values) {
+        if (ret >= 0) {
+            for (uint64_t r = 0; r < nrows; r++) {
+                for (size_t c = 0; c < ncols; c++) values[r * ncols + c] = grid[r * nuc + cslot[c]];
+            }
+        }
+        free(grid);
+    }
+
+out:
+    free(ucols); free(cslot);
+    return ret < 0 ? -1 : 0;
+}
+
+
+/* Point and the chunk it lives in, for visiting each chunk once */
+typedef struct {
+    uint64_t chunk;
+    size_t pos;
+} point_entry_t;
+
+static int point_entry_compare(const void *a, const void *b)
+{
+    const point_entry_t *pa = (const point_entry_t *)a, *pb = (const point_entry_t *)b;
+    if (pa->chunk != pb->chunk) return (pa->chunk > pb->chunk) - (pa->chunk < pb->chunk);
+    return (pa->pos > pb->pos) - (pa->pos < pb->pos);
+}
+
+int h5r_read_points(struct h5r *ctx, const uint64_t *rows, const uint64_t *cols, size_t n, int32_t *values)
+{
+    /* Arbitrary (row, col) points: sorted by chunk, each chunk's bounding box of requested
+     * points read once, values scattered back to input order */
+    if (!ctx || !rows || !cols || !values || n == 0) return -1;
+
+    const uint64_t crows = ctx->crows > 0 ? ctx->crows : 1;
+    const uint64_t ccols = ctx->ccols > 0 ? ctx->ccols : ctx->cols;
+    const uint64_t chunks_per_row = (ctx->cols + ccols - 1) / ccols;
+    point_entry_t *entries = malloc(n * sizeof(point_entry_t));
+    int32_t *tile = malloc((size_t)crows * ccols * sizeof(int32_t));
+    hid_t fsp = -1;
+    int ret = -1;
+    if (!entries || !tile) goto out;
+
+    for (size_t i = 0; i < n; i++) {
+        if (rows[i] >= ctx->rows || cols[i] >= ctx->cols) goto out;
+        entries[i] = (point_entry_t){rows[i] / crows * chunks_per_row + cols[i] / ccols, i};
+    }
+    qsort(entries, n, sizeof(point_entry_t), point_entry_compare);
+
+    fsp = H5Dget_space(ctx->dset);
+    if (fsp < 0) goto out;
+    ret = 0;
+    for (size_t i = 0; i < n && ret >= 0;) {
+        size_t end = i + 1;
+        uint64_t row0 = rows[entries[i].pos], row1 = row0, col0 = cols[entries[i].pos], col1 = col0;
+        for (; end < n && entries[end].chunk == entries[i].chunk; end++) {
+            const uint64_t r = rows[entries[end].pos], c = cols[entries[end].pos];
+            if (r < row0) row0 = r;
+            if (r > row1) row1 = r;
+            if (c < col0) col0 = c;
+            if (c > col1) col1 = c;
+        }
+        const uint64_t height = row1 - row0 + 1, width = col1 - col0 + 1;
+
+        hid_t msp = H5Screate_simple(1, (hsize_t[]){height * width}, NULL);
+        ret = H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row0, col0}, NULL,
+                                  (hsize_t[]){height, width}, NULL);
+        if (ret >= 0) ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, tile);
+        H5Sclose(msp);
+
+        for (size_t k = i; ret >= 0 && k < end; k++) {
+            const size_t pos = entries[k].pos;
+            values[pos] = tile[(rows[pos] - row0) * width + (cols[pos] - col0)];
+        }
+        i = end;
+    }
+
+out:
+    if (fsp >= 0) H5Sclose(fsp);
+    free(entries);
+    free(tile);
+    return ret < 0 ? -1 : 0;
+}
+
 
 /* Read multiple blocks sharing the same row range (row0 to row0+nrows-1)
  * in a single H5Dread call and store in dst.
@@ -394,12 +641,7 @@ void h5r_close(struct h5r *ctx)
     if (ctx->dcpl_id >= 0) H5Pclose(ctx->dcpl_id);
     if (ctx->file >= 0) H5Fclose(ctx->file);
 
-#ifdef USE_IO_URING
-    h5r_cleanup_io_uring(ctx);
-#else
-    h5r_cleanup_standard(ctx);
-#endif
-
+    mesh_dict_destroy(ctx->mesh_dict);
     free(ctx);
 }
 
@@ -407,6 +649,17 @@ void h5r_close(struct h5r *ctx)
  *  Writing Functions (adapted from h5_writer_ops.c)
  * =============================================== */
 
+#define CHUNK_MAX_DATASET "chunk_max"
+
+/* Any write may raise a chunk maximum, so the first write through a context drops chunk_max
+ * (top-k then scans without pruning until h5r_build_chunk_max is run again) */
+static void drop_chunk_max(struct h5r *ctx)
+{
+    if (ctx->chunk_max_dropped) return;
+    if (H5Lexists(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT) > 0) H5Ldelete(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT);
+    ctx->chunk_max_dropped = 1;
+}
+
 int h5r_open_readwrite(const char *path, struct h5r **out) {
     if (!path || !out) return -1;
     
@@ -446,8 +699,13 @@ int h5r_open_readwrite(const char *path, struct h5r **out) {
     ctx->dcpl_id = H5Dget_create_plist(ctx->dset);
     
     // Initialize other fields
-    ctx->fd = -1;
     ctx->base = H5Dget_offset(ctx->dset);
+    if (h5r_load_metadata(ctx) < 0) {
+        h5r_close(ctx);
+        return -1;
+    }
+    ctx->crows = ctx->meta.crows;
+    ctx->ccols = ctx->meta.ccols;
     
     *out = ctx;
     return 0;
@@ -492,8 +750,13 @@ int h5r_open_readwrite_with_dataset(const char *path, const char *dataset_name,
     ctx->dcpl_id = H5Dget_create_plist(ctx->dset);
     
     // Initialize other fields
-    ctx->fd = -1;
     ctx->base = H5Dget_offset(ctx->dset);
+    if (h5r_load_metadata(ctx) < 0) {
+        h5r_close(ctx);
+        return -1;
+    }
+    ctx->crows = ctx->meta.crows;
+    ctx->ccols = ctx->meta.ccols;
     
     *out = ctx;
     return 0;
@@ -512,6 +775,7 @@ int h5r_extend_time_dimension(struct h5r *ctx, size_t new_time_points) {
     H5Sclose(ctx->dataspace_id);
     ctx->dataspace_id = H5Dget_space(ctx->dset);
     ctx->rows = new_time_points;
+    ctx->meta.rows = new_time_points;
     
     return 0;
 }
@@ -520,6 +784,7 @@ int h5r_write_cell(struct h5r *ctx, uint64_t row, uint64_t col, int32_t value) {
     if (!ctx || !ctx->is_writable || row >= ctx->rows || col >= ctx->cols) {
         return -1;
     }
+    drop_chunk_max(ctx);
     
     // Select single element in file
     hsize_t coords[2] = {row, col};
@@ -544,6 +809,7 @@ int h5r_write_cells(struct h5r *ctx, uint64_t row, const uint64_t *cols, const i
     for (size_t i = 0; i < ncols; i++) {
         if (cols[i] >= ctx->cols) return -1;
     }
+    drop_chunk_max(ctx);
     
     // Create coordinate array for H5Sselect_elements
     hsize_t* coords = malloc(ncols * 2 * sizeof(hsize_t));
@@ -572,6 +838,7 @@ int h5r_write_cells(struct h5r *ctx, uint64_t row, const uint64_t *cols, const i
 
 int h5r_write_bulk_buffer(struct h5r *ctx, const int32_t *buffer, size_t time_points, size_t mesh_count, size_t start_time_idx) {
     if (!ctx || !ctx->is_writable || !buffer) return -1;
+    drop_chunk_max(ctx);
     
     // Extend dataset if necessary to accommodate the write at start_time_idx
     size_t needed_time_points = start_time_idx + time_points;
@@ -607,6 +874,47 @@ int h5r_write_bulk_buffer(struct h5r *ctx, const int32_t *buffer, size_t time_po
     return (status < 0) ? -1 : 0;
 }
 
+int h5r_write_chunk(struct h5r *ctx, uint64_t row0, uint64_t col0, uint64_t nrows, const int32_t *tile) {
+    if (!ctx || !ctx->is_writable || !tile || ctx->meta.layout != H5D_CHUNKED) return -1;
+    if (col0 >= ctx->cols || nrows == 0 || nrows > ctx->crows) return -1;
+    drop_chunk_max(ctx);
+    
+    if (row0 + nrows > ctx->rows) {
+        if (h5r_extend_time_dimension(ctx, row0 + nrows) < 0) {
+            return -1;
+        }
+    }
+    
+    // A whole, aligned, unfiltered chunk is stored as-is, skipping selection and gather
+    if (nrows == ctx->crows && row0 % ctx->crows == 0 && col0 % ctx->ccols == 0 &&
+        H5Pget_nfilters(ctx->dcpl_id) == 0) {
+        hsize_t offset[2] = {row0, col0};
+        size_t nbytes = (size_t)(ctx->crows * ctx->ccols) * sizeof(int32_t);
+        return H5Dwrite_chunk(ctx->dset, H5P_DEFAULT, 0, offset, nbytes, tile) < 0 ? -1 : 1;
+    }
+    
+    // Partial or misaligned tiles go through a hyperslab write of the valid part
+    hsize_t ncols = col0 + ctx->ccols <= ctx->cols ? ctx->ccols : ctx->cols - col0;
+    hsize_t mem_dims[2] = {nrows, ctx->ccols};
+    hid_t mem_space = H5Screate_simple(2, mem_dims, NULL);
+    if (mem_space < 0) {
+        return -1;
+    }
+    
+    hsize_t mem_start[2] = {0, 0};
+    hsize_t file_start[2] = {row0, col0};
+    hsize_t count[2] = {nrows, ncols};
+    if (H5Sselect_hyperslab(mem_space, H5S_SELECT_SET, mem_start, NULL, count, NULL) < 0 ||
+        H5Sselect_hyperslab(ctx->dataspace_id, H5S_SELECT_SET, file_start, NULL, count, NULL) < 0) {
+        H5Sclose(mem_space);
+        return -1;
+    }
+    
+    herr_t status = H5Dwrite(ctx->dset, H5T_NATIVE_INT, mem_space, ctx->dataspace_id, H5P_DEFAULT, tile);
+    H5Sclose(mem_space);
+    return (status < 0) ? -1 : 0;
+}
+
 int h5r_flush(struct h5r *ctx) {
     if (!ctx || !ctx->is_writable) return -1;
     
@@ -621,4 +929,252 @@ int h5r_get_dimensions(struct h5r *ctx, size_t *time_points, size_t *mesh_count)
     if (mesh_count) *mesh_count = ctx->cols;
     
     return 0;
-}
\ No newline at end of file
+}
+/* ===============================================
+ *  Per-chunk maxima (chunk_max)
+ * =============================================== */
+
+#define CHUNK_MAX_ROWS_ATTR "rows"
+/* Columns of population_data scanned per strip, by bytes of one full chunk-row strip */
+#define CHUNK_MAX_STRIP_BYTES ((size_t)256 * 1024 * 1024)
+
+int h5r_build_chunk_max(struct h5r *ctx)
+{
+    if (!ctx || !ctx->is_writable) return -1;
+
+    const uint64_t crows = ctx->crows > 0 ? ctx->crows : 1;
+    const uint64_t ccols = ctx->ccols > 0 ? ctx->ccols : ctx->cols;
+    const uint64_t ntc = (ctx->rows + crows - 1) / crows, ncc = (ctx->cols + ccols - 1) / ccols;
+    if (ntc == 0 || ncc == 0) return -1;
+
+    uint64_t strip_cols = CHUNK_MAX_STRIP_BYTES / (crows * sizeof(int32_t)) / ccols * ccols;
+    if (strip_cols < ccols) strip_cols = ccols;
+    if (strip_cols > ctx->cols) strip_cols = ctx->cols;
+    int32_t *strip = malloc((size_t)crows * strip_cols * sizeof(int32_t));
+    int32_t *max = malloc((size_t)ntc * ncc * sizeof(int32_t));
+    hid_t fsp = H5Dget_space(ctx->dset);
+    int ret = (strip && max && fsp >= 0) ? 0 : -1;
+
+    for (uint64_t tc = 0; tc < ntc && ret >= 0; tc++) {
+        const uint64_t row0 = tc * crows;
+        const uint64_t height = ctx->rows - row0 < crows ? ctx->rows - row0 : crows;
+        for (uint64_t col0 = 0; col0 < ctx->cols && ret >= 0; col0 += strip_cols) {
+            const uint64_t width = ctx->cols - col0 < strip_cols ? ctx->cols - col0 : strip_cols;
+            hid_t msp = H5Screate_simple(1, (hsize_t[]){height * width}, NULL);
+            ret = H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){row0, col0}, NULL,
+                                      (hsize_t[]){height, width}, NULL);
+            if (ret >= 0) ret = H5Dread(ctx->dset, H5T_NATIVE_INT, msp, fsp, H5P_DEFAULT, strip);
+            H5Sclose(msp);
+            if (ret < 0) break;
+
+            int32_t *out = max + tc * ncc + col0 / ccols;
+            for (uint64_t c = 0; c < width; c += ccols) out[c / ccols] = INT32_MIN;
+            for (uint64_t r = 0; r < height; r++) {
+                const int32_t *src = strip + r * width;
+                for (uint64_t c = 0; c < width; c++) {
+                    if (src[c] > out[c / ccols]) out[c / ccols] = src[c];
+                }
+            }
+        }
+    }
+    if (fsp >= 0) H5Sclose(fsp);
+    free(strip);
+
+    if (ret >= 0) {
+        if (H5Lexists(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT) > 0) H5Ldelete(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT);
+        hid_t space = H5Screate_simple(2, (hsize_t[]){ntc, ncc}, NULL);
+        hid_t dset = H5Dcreate2(ctx->file, CHUNK_MAX_DATASET, H5T_STD_I32LE, space, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        ret = dset >= 0 ? H5Dwrite(dset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, max) : -1;
+
+        // Rows covered, so maxima from before an extension are not trusted
+        hid_t aspace = H5Screate(H5S_SCALAR);
+        hid_t attr = ret >= 0 ? H5Acreate2(dset, CHUNK_MAX_ROWS_ATTR, H5T_STD_U64LE, aspace, H5P_DEFAULT, H5P_DEFAULT) : -1;
+        uint64_t rows = ctx->rows;
+        if (attr < 0 || H5Awrite(attr, H5T_NATIVE_UINT64, &rows) < 0) ret = -1;
+        if (attr >= 0) H5Aclose(attr);
+        H5Sclose(aspace);
+        if (dset >= 0) H5Dclose(dset);
+        H5Sclose(space);
+        ctx->chunk_max_dropped = 0;   /* Later writes through this context drop it again */
+    }
+    free(max);
+    return ret < 0 ? -1 : 0;
+}
+
+int h5r_read_chunk_max(struct h5r *ctx, int32_t **max, uint64_t *ntime, uint64_t *nmesh)
+{
+    if (!ctx || !max || !ntime || !nmesh) return -1;
+    *max = NULL;
+    if (H5Lexists(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT) <= 0) return -1;
+
+    const uint64_t crows = ctx->crows > 0 ? ctx->crows : 1;
+    const uint64_t ccols = ctx->ccols > 0 ? ctx->ccols : ctx->cols;
+    const uint64_t ntc = (ctx->rows + crows - 1) / crows, ncc = (ctx->cols + ccols - 1) / ccols;
+
+    hid_t dset = H5Dopen2(ctx->file, CHUNK_MAX_DATASET, H5P_DEFAULT);
+    if (dset < 0) return -1;
+    hid_t sp = H5Dget_space(dset);
+    hsize_t dims[2] = {0, 0};
+    uint64_t rows = 0;
+    int ok = sp >= 0 && H5Sget_simple_extent_ndims(sp) == 2 && H5Sget_simple_extent_dims(sp, dims, NULL) == 2 &&
+             dims[0] == ntc && dims[1] == ncc;
+    if (sp >= 0) H5Sclose(sp);
+    if (ok && H5Aexists(dset, CHUNK_MAX_ROWS_ATTR) > 0) {
+        hid_t attr = H5Aopen(dset, CHUNK_MAX_ROWS_ATTR, H5P_DEFAULT);
+        ok = attr >= 0 && H5Aread(attr, H5T_NATIVE_UINT64, &rows) >= 0 && rows == ctx->rows;
+        if (attr >= 0) H5Aclose(attr);
+    } else {
+        ok = 0;
+    }
+
+    int32_t *buf = ok ? malloc((size_t)ntc * ncc * sizeof(int32_t)) : NULL;
+    if (!buf || H5Dread(dset, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, buf) < 0) {
+        free(buf);
+        H5Dclose(dset);
+        return -1;
+    }
+    H5Dclose(dset);
+
+    *max = buf;
+    *ntime = ntc;
+    *nmesh = ncc;
+    return 0;
+}
+
+/* ===============================================
+ *  Hour-of-week baseline (baseline)
+ * =============================================== */
+
+#define BASELINE_DATASET "baseline"
+#define BASELINE_CHUNK_COLS 64
+
+static int write_u64_attr(hid_t dset, const char *name, uint64_t value)
+{
+    hid_t aspace = H5Screate(H5S_SCALAR);
+    hid_t attr = H5Acreate2(dset, name, H5T_STD_U64LE, aspace, H5P_DEFAULT, H5P_DEFAULT);
+    int ret = attr >= 0 && H5Awrite(attr, H5T_NATIVE_UINT64, &value) >= 0 ? 0 : -1;
+    if (attr >= 0) H5Aclose(attr);
+    H5Sclose(aspace);
+    return ret;
+}
+
+static int read_u64_attr(hid_t dset, const char *name, uint64_t *value)
+{
+    if (H5Aexists(dset, name) <= 0) return -1;
+    hid_t attr = H5Aopen(dset, name, H5P_DEFAULT);
+    int ret = attr >= 0 && H5Aread(attr, H5T_NATIVE_UINT64, value) >= 0 ? 0 : -1;
+    if (attr >= 0) H5Aclose(attr);
+    return ret;
+}
+
+int h5r_create_baseline(struct h5r *ctx, const h5r_baseline_info_t *info)
+{
+    if (!ctx || !ctx->is_writable || !info || ctx->cols == 0) return -1;
+    if (H5Lexists(ctx->file, BASELINE_DATASET, H5P_DEFAULT) > 0) H5Ldelete(ctx->file, BASELINE_DATASET, H5P_DEFAULT);
+
+    const hsize_t dims[3] = {2, H5R_HOURS_PER_WEEK, ctx->cols};
+    const hsize_t chunk[3] = {2, H5R_HOURS_PER_WEEK, ctx->cols < BASELINE_CHUNK_COLS ? ctx->cols : BASELINE_CHUNK_COLS};
+    hid_t space = H5Screate_simple(3, dims, NULL);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 3, chunk);
+    hid_t dset = H5Dcreate2(ctx->file, BASELINE_DATASET, H5T_IEEE_F32LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    int ret = dset >= 0 ? 0 : -1;
+    if (ret == 0) ret = write_u64_attr(dset, "start", info->start);
+    if (ret == 0) ret = write_u64_attr(dset, "end", info->end);
+    if (ret == 0) ret = write_u64_attr(dset, "slot0", info->slot0);
+    if (ret == 0) ret = write_u64_attr(dset, "method", info->method);
+    if (dset >= 0) H5Dclose(dset);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    return ret;
+}
+
+int h5r_write_baseline(struct h5r *ctx, uint64_t col0, uint64_t ncols, const float *values)
+{
+    if (!ctx || !ctx->is_writable || !values || ncols == 0 || col0 + ncols > ctx->cols) return -1;
+    hid_t dset = H5Dopen2(ctx->file, BASELINE_DATASET, H5P_DEFAULT);
+    if (dset < 0) return -1;
+    hid_t fsp = H5Dget_space(dset);
+    hid_t msp = H5Screate_simple(1, (hsize_t[]){2 * H5R_HOURS_PER_WEEK * ncols}, NULL);
+    int ret = H5Sselect_hyperslab(fsp, H5S_SELECT_SET, (hsize_t[]){0, 0, col0}, NULL,
+                                  (hsize_t[]){2, H5R_HOURS_PER_WEEK, ncols}, NULL);
+    if (ret >= 0) ret = H5Dwrite(dset, H5T_NATIVE_FLOAT, msp, fsp, H5P_DEFAULT, values);
+    H5Sclose(msp);
+    H5Sclose(fsp);
+    H5Dclose(dset);
+    return ret < 0 ? -1 : 0;
+}
+
+int h5r_read_baseline(struct h5r *ctx, h5r_baseline_info_t *info, const uint64_t *cols, size_t ncols, float *values)
+{
+    if (!ctx || H5Lexists(ctx->file, BASELINE_DATASET, H5P_DEFAULT) <= 0) return -1;
+    hid_t dset = H5Dopen2(ctx->file, BASELINE_DATASET, H5P_DEFAULT);
+    if (dset < 0) return -1;
+
+    h5r_baseline_info_t meta = {0};
+    hid_t fsp = H5Dget_space(dset);
+    hsize_t dims[3] = {0, 0, 0};
+    int ret = fsp >= 0 && H5Sget_simple_extent_ndims(fsp) == 3 && H5Sget_simple_extent_dims(fsp, dims, NULL) == 3 &&
+              dims[0] == 2 && dims[1] == H5R_HOURS_PER_WEEK && dims[2] == ctx->cols ? 0 : -1;
+    if (ret == 0) ret = read_u64_attr(dset, "start", &meta.start);
+    if (ret == 0) ret = read_u64_attr(dset, "end", &meta.end);
+    if (ret == 0) ret = read_u64_attr(dset, "slot0", &meta.slot0);
+    if (ret == 0) ret = read_u64_attr(dset, "method", &meta.method);
+    if (ret == 0 && info) *info = meta;
+    if (ret < 0 || !cols || ncols == 0) {
+        if (fsp >= 0) H5Sclose(fsp);
+        H5Dclose(dset);
+        return ret;
+    }
+
+    /* Columns are read sorted and deduplicated, a bounded number of runs per selection, and
+     * scattered back to the order asked for */
+    uint64_t *ucols = malloc(ncols * sizeof(uint64_t));
+    size_t *slot = malloc(ncols * sizeof(size_t));
+    float *dense = NULL;
+    size_t nuc = 0;
+    if (!ucols || !slot || sort_unique(cols, ncols, ucols, &nuc, slot) < 0 || ucols[nuc - 1] >= ctx->cols) ret = -1;
+    if (ret == 0) dense = malloc(2 * H5R_HOURS_PER_WEEK * nuc * sizeof(float));
+    if (!dense) ret = -1;
+
+    size_t *batch_of = malloc(2 * nuc * sizeof(size_t));   /* [first, end) of the batch holding each unique column */
+    if (!batch_of) ret = -1;
+    for (size_t u0 = 0; ret == 0 && u0 < nuc;) {
+        size_t u1 = u0 + 1, runs = 1;
+        while (u1 < nuc) {
+            if (ucols[u1] != ucols[u1 - 1] + 1 && runs++ == H5R_MAX_SELECTION_BLOCKS) break;
+            u1++;
+        }
+        H5S_seloper_t op = H5S_SELECT_SET;
+        for (size_t c = u0; c < u1 && ret == 0;) {
+            size_t c_end = c + 1;
+            while (c_end < u1 && ucols[c_end] == ucols[c_end - 1] + 1) c_end++;
+            if (H5Sselect_hyperslab(fsp, op, (hsize_t[]){0, 0, ucols[c]}, NULL,
+                                    (hsize_t[]){2, H5R_HOURS_PER_WEEK, c_end - c}, NULL) < 0) ret = -1;
+            op = H5S_SELECT_OR;
+            c = c_end;
+        }
+        /* The selection is visited as [2][168][batch], so each batch lands as one dense block */
+        hid_t msp = H5Screate_simple(1, (hsize_t[]){2 * H5R_HOURS_PER_WEEK * (u1 - u0)}, NULL);
+        if (ret == 0 && H5Dread(dset, H5T_NATIVE_FLOAT, msp, fsp, H5P_DEFAULT, dense + 2 * H5R_HOURS_PER_WEEK * u0) < 0) ret = -1;
+        H5Sclose(msp);
+        for (size_t u = u0; u < u1; u++) {
+            batch_of[2 * u] = u0;
+            batch_of[2 * u + 1] = u1;
+        }
+        u0 = u1;
+    }
+
+    for (size_t i = 0; ret == 0 && i < ncols; i++) {
+        const size_t u = slot[i], u0 = batch_of[2 * u], width = batch_of[2 * u + 1] - u0;
+        const float *batch = dense + 2 * H5R_HOURS_PER_WEEK * u0;
+        for (size_t k = 0; k < 2 * H5R_HOURS_PER_WEEK; k++) values[k * ncols + i] = batch[k * width + (u - u0)];
+    }
+    free(batch_of);
+    free(dense);
+    free(slot);
+    free(ucols);
+    H5Sclose(fsp);
+    H5Dclose(dset);
+    return ret;
+}
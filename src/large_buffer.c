@@ -0,0 +1,241 @@
+//
+// Parallel first-touch allocation of large buffers
+//
+
+#define _GNU_SOURCE
+#include "large_buffer.h"
+#include "cpu_topology.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define BLOCK_BYTES ((size_t)2 * 1024 * 1024)       // Huge page size, the unit of placement
+#define BYTES_PER_THREAD ((size_t)16 * 1024 * 1024) // Smaller buffers use fewer threads
+#define TOUCH_STRIDE 4096
+#define MAX_NODES 64
+
+typedef enum { OP_TOUCH, OP_ZERO } block_op_t;
+
+// Blocks start, start + stride, ... below end, handled by one thread on one node
+typedef struct {
+    char *base;
+    size_t size;
+    size_t start, stride, end;
+    block_op_t op;
+    int node;
+    const cpu_topology_t *topo;
+} block_job_t;
+
+// Registry of live buffers: munmap needs the mapping size, and zeroing reuses the placement
+typedef struct {
+    void *ptr;
+    size_t size;
+    size_t map_size;
+    large_buffer_config_t config;
+} buffer_entry_t;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static buffer_entry_t *registry;
+static size_t registry_count, registry_capacity;
+
+static void *block_worker(void *arg) {
+    const block_job_t *job = (const block_job_t *)arg;
+    if (job->topo && job->node >= 0) cpu_topology_bind_thread(job->topo, pthread_self(), job->node);
+
+    for (size_t b = job->start; b < job->end; b += job->stride) {
+        char *p = job->base + b * BLOCK_BYTES;
+        size_t n = job->size - b * BLOCK_BYTES;
+        if (n > BLOCK_BYTES) n = BLOCK_BYTES;
+        if (job->op == OP_ZERO) {
+            memset(p, 0, n);
+        } else {
+            // Fresh anonymous pages read as zero; one write per page faults it in on this node
+            for (size_t off = 0; off < n; off += TOUCH_STRIDE) ((volatile char *)p)[off] = 0;
+        }
+    }
+    return NULL;
+}
+
+static int total_threads(const large_buffer_config_t *config, const cpu_topology_t *topo, size_t size) {
+    int threads = config->threads > 0 ? config->threads : cpu_topology_num_cpus(topo);
+    size_t by_size = size / BYTES_PER_THREAD + 1;
+    if ((size_t)threads > by_size) threads = (int)by_size;
+    return threads < 1 ? 1 : threads;
+}
+
+// Split the blocks over threads per node as the placement asks, then run and join them
+static int run_blocks(char *base, size_t size, const large_buffer_config_t *config, block_op_t op) {
+    cpu_topology_t *topo = cpu_topology_detect();
+    const int num_nodes = topo ? cpu_topology_num_nodes(topo) : 1;
+    const int num_cpus = topo ? cpu_topology_num_cpus(topo) : 1;
+    const size_t num_blocks = (size + BLOCK_BYTES - 1) / BLOCK_BYTES;
+    const int threads = total_threads(config, topo, size);
+
+    int first_node = 0, last_node = num_nodes - 1;
+    if (config->placement == LARGE_BUFFER_NODE) {
+        first_node = last_node = config->node >= 0 && config->node < num_nodes ? config->node : 0;
+    }
+
+    // Threads per node follow each node's share of the CPUs (all of them for a single node)
+    if (last_node >= MAX_NODES) last_node = MAX_NODES - 1;
+    int per_node[MAX_NODES] = {0};
+    int num_jobs = 0;
+    for (int n = first_node; n <= last_node; n++) {
+        int t = first_node == last_node ? threads
+              : (int)((long)threads * cpu_topology_node_cpus(topo, n) / (num_cpus > 0 ? num_cpus : 1));
+        per_node[n] = t < 1 ? 1 : t;
+        num_jobs += per_node[n];
+    }
+
+    block_job_t *jobs = calloc((size_t)num_jobs, sizeof(block_job_t));
+    pthread_t *tids = calloc((size_t)num_jobs, sizeof(pthread_t));
+    int *started = calloc((size_t)num_jobs, sizeof(int));
+    if (!jobs || !tids || !started) {
+        free(jobs);
+        free(tids);
+        free(started);
+        cpu_topology_destroy(topo);
+        return -1;
+    }
+
+    const int spread = last_node - first_node + 1;
+    int j = 0;
+    for (int n = first_node; n <= last_node; n++) {
+        // Contiguous share of the node: its slice (partition) or everything (single node)
+        size_t lo = 0, hi = num_blocks;
+        if (config->placement == LARGE_BUFFER_PARTITION) {
+            lo = num_blocks * (size_t)(n - first_node) / (size_t)spread;
+            hi = num_blocks * (size_t)(n - first_node + 1) / (size_t)spread;
+        }
+        for (int t = 0; t < per_node[n]; t++, j++) {
+            block_job_t *job = &jobs[j];
+            job->base = base;
+            job->size = size;
+            job->op = op;
+            job->node = topo ? n : -1;
+            job->topo = topo;
+            if (config->placement == LARGE_BUFFER_INTERLEAVE) {
+                // Block b belongs to node b % nodes; the node's threads take turns over its blocks
+                job->start = (size_t)(n - first_node) + (size_t)spread * (size_t)t;
+                job->stride = (size_t)spread * (size_t)per_node[n];
+                job->end = num_blocks;
+            } else {
+                job->start = lo + (hi - lo) * (size_t)t / (size_t)per_node[n];
+                job->end = lo + (hi - lo) * (size_t)(t + 1) / (size_t)per_node[n];
+                job->stride = 1;
+            }
+        }
+    }
+
+    // The calling thread does the first job itself; a job whose thread cannot start runs inline too
+    for (j = 1; j < num_jobs; j++) {
+        started[j] = pthread_create(&tids[j], NULL, block_worker, &jobs[j]) == 0;
+    }
+    if (num_jobs > 0) {
+        block_job_t self = jobs[0];
+        self.node = -1;     // Do not leave the caller pinned
+        if (jobs[0].node >= 0) cpu_topology_bind_thread(topo, pthread_self(), jobs[0].node);
+        block_worker(&self);
+        if (jobs[0].node >= 0) cpu_topology_bind_thread(topo, pthread_self(), -1);
+    }
+    for (j = 1; j < num_jobs; j++) {
+        if (started[j]) pthread_join(tids[j], NULL);
+        else block_worker(&jobs[j]);
+    }
+
+    free(jobs);
+    free(tids);
+    free(started);
+    cpu_topology_destroy(topo);
+    return 0;
+}
+
+static void *map_pages(size_t size, int huge_pages, size_t *map_size) {
+    // Reserved huge pages fail up front when the pool is short (no MAP_NORESERVE, so no SIGBUS later)
+    if (huge_pages && size >= BLOCK_BYTES) {
+        size_t rounded = (size + BLOCK_BYTES - 1) / BLOCK_BYTES * BLOCK_BYTES;
+        void *p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *map_size = rounded;
+            return p;
+        }
+    }
+
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t rounded = (size + page - 1) / page * page;
+    void *p = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    // Transparent huge pages where the kernel allows them; normal pages otherwise
+    if (huge_pages) madvise(p, rounded, MADV_HUGEPAGE);
+    *map_size = rounded;
+    return p;
+}
+
+static int registry_add(const buffer_entry_t *entry) {
+    pthread_mutex_lock(&registry_mutex);
+    if (registry_count == registry_capacity) {
+        size_t new_capacity = registry_capacity ? registry_capacity * 2 : 16;
+        buffer_entry_t *grown = realloc(registry, new_capacity * sizeof(buffer_entry_t));
+        if (!grown) {
+            pthread_mutex_unlock(&registry_mutex);
+            return -1;
+        }
+        registry = grown;
+        registry_capacity = new_capacity;
+    }
+    registry[registry_count++] = *entry;
+    pthread_mutex_unlock(&registry_mutex);
+    return 0;
+}
+
+// Copy of the entry for ptr; with remove set it is also taken out of the registry
+static int registry_find(const void *ptr, buffer_entry_t *entry, int remove) {
+    int found = 0;
+    pthread_mutex_lock(&registry_mutex);
+    for (size_t i = 0; i < registry_count; i++) {
+        if (registry[i].ptr == ptr) {
+            *entry = registry[i];
+            if (remove) registry[i] = registry[--registry_count];
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return found;
+}
+
+void *large_buffer_alloc(size_t size, const large_buffer_config_t *config) {
+    if (size == 0) return NULL;
+    large_buffer_config_t actual_config = LARGE_BUFFER_DEFAULT_CONFIG;
+    if (config) actual_config = *config;
+
+    buffer_entry_t entry = {.size = size, .config = actual_config};
+    entry.ptr = map_pages(size, actual_config.huge_pages, &entry.map_size);
+    if (!entry.ptr) {
+        fprintf(stderr, "Error: Failed to map %zu bytes for large buffer\n", size);
+        return NULL;
+    }
+    if (run_blocks(entry.ptr, size, &actual_config, OP_TOUCH) < 0 || registry_add(&entry) < 0) {
+        fprintf(stderr, "Error: Failed to initialize large buffer\n");
+        munmap(entry.ptr, entry.map_size);
+        return NULL;
+    }
+    return entry.ptr;
+}
+
+int large_buffer_zero(void *buf) {
+    buffer_entry_t entry;
+    if (!buf || !registry_find(buf, &entry, 0)) return -1;
+    return run_blocks(buf, entry.size, &entry.config, OP_ZERO);
+}
+
+int large_buffer_free(void *buf) {
+    buffer_entry_t entry;
+    if (!buf || !registry_find(buf, &entry, 1)) return -1;
+    munmap(entry.ptr, entry.map_size);
+    return 0;
+}
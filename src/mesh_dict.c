@@ -0,0 +1,134 @@
+//
+// File-specific mesh ID lookup table
+//
+
+#include "mesh_dict.h"
+#include "meshid_ops.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// SIMD optimization includes
+#ifdef __AVX512F__
+#include <immintrin.h>
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define MESH_DICT_EMPTY 0u          // Mesh IDs are 9-digit, so 0 never occurs as a key
+#define COMPARE_BLOCK 4096          // Elements compared between early-exit checks
+
+// Open addressing with linear probing; keys and columns in one slot for a single cache miss
+typedef struct {
+    uint32_t key;
+    uint32_t col;
+} mesh_dict_slot_t;
+
+struct mesh_dict {
+    mesh_dict_slot_t *slots;
+    uint32_t mask;
+    int shift;
+    size_t count;
+};
+
+static inline uint32_t mesh_dict_slot(const mesh_dict_t *dict, uint32_t key) {
+    return (uint32_t)(((uint64_t)key * 0x9E3779B97F4A7C15ull) >> dict->shift) & dict->mask;
+}
+
+mesh_dict_t *mesh_dict_create(const uint32_t *ids, size_t count) {
+    if (!ids || count == 0 || count >= UINT32_MAX / 2) return NULL;
+
+    mesh_dict_t *dict = calloc(1, sizeof(*dict));
+    if (!dict) {
+        fprintf(stderr, "Error: Memory allocation failed for mesh dictionary\n");
+        return NULL;
+    }
+
+    // Load factor at most 1/2
+    int bits = 1;
+    while (((size_t)1 << bits) < count * 2) bits++;
+    dict->mask = (uint32_t)(((uint64_t)1 << bits) - 1);
+    dict->shift = 64 - bits;
+    dict->slots = calloc((size_t)dict->mask + 1, sizeof(mesh_dict_slot_t));
+    if (!dict->slots) {
+        fprintf(stderr, "Error: Memory allocation failed for mesh dictionary slots\n");
+        free(dict);
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        if (ids[i] == MESH_DICT_EMPTY) continue;
+        uint32_t s = mesh_dict_slot(dict, ids[i]);
+        while (dict->slots[s].key != MESH_DICT_EMPTY && dict->slots[s].key != ids[i]) {
+            s = (s + 1) & dict->mask;
+        }
+        // The first occurrence of a duplicated ID wins
+        if (dict->slots[s].key == MESH_DICT_EMPTY) {
+            dict->slots[s].key = ids[i];
+            dict->slots[s].col = (uint32_t)i;
+            dict->count++;
+        }
+    }
+    return dict;
+}
+
+void mesh_dict_destroy(mesh_dict_t *dict) {
+    if (!dict) return;
+    free(dict->slots);
+    free(dict);
+}
+
+uint32_t mesh_dict_lookup(const mesh_dict_t *dict, uint32_t mesh_id) {
+    if (!dict || mesh_id == MESH_DICT_EMPTY) return MESHID_NOT_FOUND;
+    uint32_t s = mesh_dict_slot(dict, mesh_id);
+    while (dict->slots[s].key != MESH_DICT_EMPTY) {
+        if (dict->slots[s].key == mesh_id) return dict->slots[s].col;
+        s = (s + 1) & dict->mask;
+    }
+    return MESHID_NOT_FOUND;
+}
+
+size_t mesh_dict_size(const mesh_dict_t *dict) {
+    return dict ? dict->count : 0;
+}
+
+int mesh_list_equal(const uint32_t *a, const uint32_t *b, size_t count) {
+    size_t pos = 0;
+
+    // OR together the XOR of each block and stop at the first block that differs
+    while (pos < count) {
+        size_t end = pos + COMPARE_BLOCK < count ? pos + COMPARE_BLOCK : count;
+        uint32_t diff = 0;
+#ifdef __AVX512F__
+        __m512i acc = _mm512_setzero_si512();
+        for (; pos + 16 <= end; pos += 16) {
+            __m512i va = _mm512_loadu_si512((const void*)(a + pos));
+            __m512i vb = _mm512_loadu_si512((const void*)(b + pos));
+            acc = _mm512_or_si512(acc, _mm512_xor_si512(va, vb));
+        }
+        diff |= _mm512_test_epi32_mask(acc, acc) != 0;
+#elif defined(__AVX2__)
+        __m256i acc = _mm256_setzero_si256();
+        for (; pos + 8 <= end; pos += 8) {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + pos));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(b + pos));
+            acc = _mm256_or_si256(acc, _mm256_xor_si256(va, vb));
+        }
+        diff |= !_mm256_testz_si256(acc, acc);
+#elif defined(__SSE2__)
+        __m128i acc = _mm_setzero_si128();
+        for (; pos + 4 <= end; pos += 4) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + pos));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + pos));
+            acc = _mm_or_si128(acc, _mm_xor_si128(va, vb));
+        }
+        diff |= _mm_movemask_epi8(_mm_cmpeq_epi32(acc, _mm_setzero_si128())) != 0xFFFF;
+#endif
+        // Remaining elements with scalar processing
+        for (; pos < end; pos++) diff |= a[pos] ^ b[pos];
+        if (diff) return 0;
+    }
+    return 1;
+}
@@ -103,6 +103,32 @@ char * meshid_get_datetime_from_time_index(int time_index) {
     return datetime_str;
 }
 
+// Days since 1970-01-01 of a proleptic Gregorian date
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = (unsigned)(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+int meshid_get_time_index_of_year(int year) {
+    int64_t jst_sec = days_from_civil(year, 1, 1) * 86400 - JST_OFFSET_SEC;
+    return (int)((jst_sec - (int64_t)REFERENCE_MOBAKU_TIME) / 3600);
+}
+
+int meshid_get_hours_in_year(int year) {
+    return meshid_get_time_index_of_year(year + 1) - meshid_get_time_index_of_year(year);
+}
+
+int meshid_get_year_from_time_index(int time_index) {
+    time_t jst = REFERENCE_MOBAKU_TIME + (time_t)time_index * 3600 + JST_OFFSET_SEC;
+    struct tm tm;
+    gmtime_r(&jst, &tm);
+    return tm.tm_year + 1900;
+}
+
 void meshid_uint_to_str(unsigned int num, char *str) {
     int i = 0;
 
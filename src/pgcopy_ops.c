@@ -0,0 +1,399 @@
+//
+// PostgreSQL binary COPY reader
+//
+
+#include "pgcopy_ops.h"
+#include "meshid_ops.h"
+#include <dirent.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PGCOPY_SIGNATURE "PGCOPY\n\377\r\n"     // 11 bytes with the terminating NUL
+#define PGCOPY_SIGNATURE_LEN 11
+#define PGCOPY_FLAG_OIDS (1u << 16)
+#define MAX_FIELDS 7
+#define POSTGRES_EPOCH_DAYS 10957               // 1970-01-01 to 2000-01-01
+
+struct pgcopy_reader {
+    const unsigned char* map;
+    size_t map_size;
+    const unsigned char* pos;
+    const unsigned char* end;       // End of this reader's tuples (the whole file, or a part)
+    const unsigned char* tuples;    // First tuple of the file
+    bool whole_file;                // Ends at the trailer rather than at end
+    bool has_oids;
+    size_t fixed_width;             // Parts: every tuple must be this wide
+    size_t tuple_number;
+    // Rows are usually grouped by time, so the last decoded timestamp is kept
+    uint64_t last_timestamp;
+    bool have_last_timestamp;
+    uint32_t last_date;
+    uint16_t last_time;
+};
+
+typedef struct {
+    const unsigned char* data;      // NULL for SQL NULL
+    int32_t len;
+} field_t;
+
+static inline uint16_t read_be16(const unsigned char* p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return be16toh(v);
+}
+
+static inline uint32_t read_be32(const unsigned char* p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return be32toh(v);
+}
+
+static inline uint64_t read_be64(const unsigned char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return be64toh(v);
+}
+
+// Map a file and check its header; *data_start is the first tuple
+static int map_file(const char* filename, const unsigned char** map, size_t* size, size_t* data_start, bool* has_oids) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < PGCOPY_SIGNATURE_LEN + 8) {
+        close(fd);
+        return -1;
+    }
+    void* p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    const unsigned char* bytes = (const unsigned char*)p;
+    uint32_t flags = read_be32(bytes + PGCOPY_SIGNATURE_LEN);
+    uint32_t ext_len = read_be32(bytes + PGCOPY_SIGNATURE_LEN + 4);
+    size_t start = PGCOPY_SIGNATURE_LEN + 8 + (size_t)ext_len;
+    if (memcmp(bytes, PGCOPY_SIGNATURE, PGCOPY_SIGNATURE_LEN) != 0 || start > (size_t)st.st_size) {
+        munmap(p, (size_t)st.st_size);
+        return -1;
+    }
+    *map = bytes;
+    *size = (size_t)st.st_size;
+    *data_start = start;
+    *has_oids = (flags & PGCOPY_FLAG_OIDS) != 0;
+    return 0;
+}
+
+// Split a tuple into its fields. Returns the bytes it occupies, 0 for the trailer, -1 if malformed.
+static long split_tuple(const unsigned char* p, const unsigned char* end, bool has_oids, field_t* fields, int* nfields) {
+    const unsigned char* start = p;
+    if (end - p < 2) return -1;
+    int16_t count = (int16_t)read_be16(p);
+    p += 2;
+    if (count == -1) return 0;
+    if (count < 1 || count > MAX_FIELDS) return -1;
+
+    // The OID, when present, comes first and is not part of the field count
+    for (int i = has_oids ? -1 : 0; i < count; i++) {
+        if (end - p < 4) return -1;
+        int32_t len = (int32_t)read_be32(p);
+        p += 4;
+        if (len > 0 && end - p < len) return -1;
+        if (i >= 0) fields[i] = (field_t){len >= 0 ? p : NULL, len};
+        if (len > 0) p += len;
+    }
+    *nfields = count;
+    return (long)(p - start);
+}
+
+static int int_value(const field_t* field, int64_t* out) {
+    if (!field->data) return -1;
+    switch (field->len) {
+        case 2: *out = (int16_t)read_be16(field->data); return 0;
+        case 4: *out = (int32_t)read_be32(field->data); return 0;
+        case 8: *out = (int64_t)read_be64(field->data); return 0;
+        default: return -1;
+    }
+}
+
+static int optional_int(const field_t* field, int32_t* out) {
+    int64_t v;
+    if (!field->data) {
+        *out = -1;
+        return 0;
+    }
+    if (int_value(field, &v) < 0) return -1;
+    *out = (int32_t)v;
+    return 0;
+}
+
+// Calendar date and HHMM of a JST wall-clock Unix time
+static void split_wall_clock(time_t wall, uint32_t* date, uint16_t* hhmm) {
+    struct tm tm;
+    gmtime_r(&wall, &tm);
+    *date = (uint32_t)((tm.tm_year + 1900) * 10000 + (tm.tm_mon + 1) * 100 + tm.tm_mday);
+    *hhmm = (uint16_t)(tm.tm_hour * 100 + tm.tm_min);
+}
+
+static int decode_timestamp(pgcopy_reader_t* reader, const field_t* field, csv_row_t* row) {
+    if (!field->data || field->len != 8) return -1;
+    uint64_t raw = read_be64(field->data);
+    if (!reader->have_last_timestamp || raw != reader->last_timestamp) {
+        time_t t = meshid_pg_bin_timestamp_to_jst((const char*)field->data, field->len);
+        split_wall_clock(t + JST_OFFSET_SEC, &reader->last_date, &reader->last_time);
+        reader->last_timestamp = raw;
+        reader->have_last_timestamp = true;
+    }
+    row->date = reader->last_date;
+    row->time = reader->last_time;
+    return 0;
+}
+
+// date: PostgreSQL date (days since 2000-01-01) or integer YYYYMMDD; time: PostgreSQL time
+// (microseconds since midnight) or integer HHMM
+static int decode_date_time(const field_t* date, const field_t* time_field, csv_row_t* row) {
+    int64_t d, t;
+    if (int_value(date, &d) < 0 || int_value(time_field, &t) < 0) return -1;
+    if (date->len == 4 && d < 10000101) {
+        uint16_t unused;
+        split_wall_clock((time_t)(d + POSTGRES_EPOCH_DAYS) * 86400, &row->date, &unused);
+    } else {
+        row->date = (uint32_t)d;
+    }
+    if (time_field->len == 8 && t >= 2400) {
+        int64_t minutes = t / 60000000;
+        row->time = (uint16_t)((minutes / 60) * 100 + minutes % 60);
+    } else {
+        row->time = (uint16_t)t;
+    }
+    return 0;
+}
+
+static int decode_row(pgcopy_reader_t* reader, const field_t* f, int nfields, csv_row_t* row) {
+    int64_t area, population;
+    switch (nfields) {
+        case 7:
+            if (decode_date_time(&f[0], &f[1], row) < 0 || int_value(&f[2], &area) < 0 ||
+                optional_int(&f[3], &row->residence) < 0 || optional_int(&f[4], &row->age) < 0 ||
+                optional_int(&f[5], &row->gender) < 0 || int_value(&f[6], &population) < 0) return -1;
+            break;
+        case 6:
+            if (decode_timestamp(reader, &f[0], row) < 0 || int_value(&f[1], &area) < 0 ||
+                optional_int(&f[2], &row->residence) < 0 || optional_int(&f[3], &row->age) < 0 ||
+                optional_int(&f[4], &row->gender) < 0 || int_value(&f[5], &population) < 0) return -1;
+            break;
+        case 3:
+            if (decode_timestamp(reader, &f[0], row) < 0 || int_value(&f[1], &area) < 0 ||
+                int_value(&f[2], &population) < 0) return -1;
+            row->residence = row->age = row->gender = -1;
+            break;
+        default:
+            return -1;
+    }
+    if (area < 0) return -1;
+    row->area = (uint64_t)area;
+    row->population = (int32_t)population;
+    return 0;
+}
+
+int pgcopy_is_pgcopy(const char* filename) {
+    FILE* fp = fopen(filename, "rb");
+    if (!fp) return 0;
+    char signature[PGCOPY_SIGNATURE_LEN];
+    int match = fread(signature, sizeof(signature), 1, fp) == 1 &&
+                memcmp(signature, PGCOPY_SIGNATURE, PGCOPY_SIGNATURE_LEN) == 0;
+    fclose(fp);
+    return match;
+}
+
+// Tuple width and count when every tuple between data_start and the trailer has the width of the
+// first one; 0 otherwise. With check_all unset only the first tuple and the file size are looked at,
+// for ranges the caller took from a checked count.
+static size_t fixed_tuple_width(const unsigned char* map, size_t size, size_t data_start, bool has_oids,
+                                bool check_all, size_t* num_tuples) {
+    if (size < data_start + 2 || read_be16(map + size - 2) != 0xFFFF) return 0;
+    const unsigned char* end = map + size - 2;
+    const size_t body = size - 2 - data_start;
+    field_t fields[MAX_FIELDS];
+    int nfields;
+    long width = split_tuple(map + data_start, end, has_oids, fields, &nfields);
+    if (width <= 0 || body % (size_t)width != 0) return 0;
+    // A variable-length field can still add up to a multiple of the width
+    for (const unsigned char* p = map + data_start + width; check_all && p < end; p += width) {
+        if (split_tuple(p, end, has_oids, fields, &nfields) != width) return 0;
+    }
+    *num_tuples = body / (size_t)width;
+    return (size_t)width;
+}
+
+// Map a file into a reader positioned on its first tuple
+static pgcopy_reader_t* open_file(const char* filename) {
+    const unsigned char* map;
+    size_t size, data_start;
+    bool has_oids;
+    if (map_file(filename, &map, &size, &data_start, &has_oids) < 0) {
+        fprintf(stderr, "Error: %s is not a readable PGCOPY file\n", filename);
+        return NULL;
+    }
+
+    pgcopy_reader_t* reader = calloc(1, sizeof(pgcopy_reader_t));
+    if (!reader) {
+        munmap((void*)map, size);
+        return NULL;
+    }
+    reader->map = map;
+    reader->map_size = size;
+    reader->has_oids = has_oids;
+    reader->tuples = map + data_start;
+    reader->pos = reader->tuples;
+    reader->end = map + size;
+    reader->whole_file = true;
+    return reader;
+}
+
+// Narrow a reader to tuples [first, end) of a fixed-width file, or [part/num_parts, (part+1)/num_parts)
+// of them when num_parts > 0
+static pgcopy_reader_t* narrow(pgcopy_reader_t* reader, const char* filename, size_t first, size_t end,
+                               int part, int num_parts) {
+    size_t num_tuples = 0;
+    size_t width = fixed_tuple_width(reader->map, reader->map_size, (size_t)(reader->tuples - reader->map),
+                                     reader->has_oids, false, &num_tuples);
+    if (num_parts > 0 && part >= 0 && part < num_parts) {
+        first = num_tuples * (size_t)part / (size_t)num_parts;
+        end = num_tuples * (size_t)(part + 1) / (size_t)num_parts;
+    }
+    if (width == 0 || (num_parts > 0 && (part < 0 || part >= num_parts)) || first > end || end > num_tuples) {
+        fprintf(stderr, "Error: %s cannot be read in parts\n", filename);
+        pgcopy_close(reader);
+        return NULL;
+    }
+    reader->pos = reader->tuples + first * width;
+    reader->end = reader->tuples + end * width;
+    reader->whole_file = false;
+    reader->fixed_width = width;
+    return reader;
+}
+
+pgcopy_reader_t* pgcopy_open(const char* filename) {
+    return open_file(filename);
+}
+
+pgcopy_reader_t* pgcopy_open_part(const char* filename, int part, int num_parts) {
+    pgcopy_reader_t* reader = open_file(filename);
+    if (!reader || num_parts <= 1) return reader;
+    return narrow(reader, filename, 0, 0, part, num_parts);
+}
+
+pgcopy_reader_t* pgcopy_open_tuples(const char* filename, size_t first, size_t end) {
+    pgcopy_reader_t* reader = open_file(filename);
+    return reader ? narrow(reader, filename, first, end, 0, 0) : NULL;
+}
+
+size_t pgcopy_count_tuples(const char* filename, size_t* width) {
+    const unsigned char* map;
+    size_t size, data_start;
+    bool has_oids;
+    *width = 0;
+    if (map_file(filename, &map, &size, &data_start, &has_oids) < 0) return 0;
+    size_t num_tuples = 0;
+    *width = fixed_tuple_width(map, size, data_start, has_oids, true, &num_tuples);
+    munmap((void*)map, size);
+    return *width > 0 ? num_tuples : 0;
+}
+
+int pgcopy_count_parts(const char* filename, int max_parts, size_t min_part_bytes) {
+    if (max_parts <= 1) return 1;
+    const unsigned char* map;
+    size_t size, data_start;
+    bool has_oids;
+    if (map_file(filename, &map, &size, &data_start, &has_oids) < 0) return 1;
+
+    size_t num_tuples = 0;
+    size_t width = fixed_tuple_width(map, size, data_start, has_oids, true, &num_tuples);
+    size_t parts = 1;
+    if (width > 0) {
+        parts = (size_t)max_parts;
+        if (min_part_bytes > 0 && parts > (num_tuples * width) / min_part_bytes) parts = (num_tuples * width) / min_part_bytes;
+        if (parts > num_tuples) parts = num_tuples;
+        if (parts < 1) parts = 1;
+    }
+    munmap((void*)map, size);
+    return (int)parts;
+}
+
+int pgcopy_read_row(pgcopy_reader_t* reader, csv_row_t* row) {
+    if (!reader || !row) return -1;
+    if (!reader->whole_file && reader->pos == reader->end) return 1;
+
+    field_t fields[MAX_FIELDS];
+    int nfields = 0;
+    long width = split_tuple(reader->pos, reader->end, reader->has_oids, fields, &nfields);
+    if (width == 0 && reader->whole_file) {
+        reader->pos = reader->end;
+        return 1;
+    }
+    if (width <= 0 || (reader->fixed_width && (size_t)width != reader->fixed_width)) return -1;
+    reader->pos += width;
+    reader->tuple_number++;
+    return decode_row(reader, fields, nfields, row) == 0 ? 0 : -1;
+}
+
+int pgcopy_read_row_at(pgcopy_reader_t* reader, size_t tuple, csv_row_t* row) {
+    if (!reader || !row || !reader->fixed_width) return -1;
+    if (tuple >= (size_t)(reader->map + reader->map_size - reader->tuples) / reader->fixed_width) return -1;
+    const unsigned char* p = reader->tuples + tuple * reader->fixed_width;
+
+    field_t fields[MAX_FIELDS];
+    int nfields = 0;
+    long width = split_tuple(p, reader->map + reader->map_size, reader->has_oids, fields, &nfields);
+    if (width <= 0 || (size_t)width != reader->fixed_width) return -1;
+    return decode_row(reader, fields, nfields, row) == 0 ? 0 : -1;
+}
+
+size_t pgcopy_get_tuple_number(const pgcopy_reader_t* reader) {
+    return reader ? reader->tuple_number : 0;
+}
+
+void pgcopy_close(pgcopy_reader_t* reader) {
+    if (!reader) return;
+    munmap((void*)reader->map, reader->map_size);
+    free(reader);
+}
+
+void pgcopy_find_files(const char* dir_path, char*** files, size_t* count, size_t* capacity) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) return;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        char full_path[1024];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(full_path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            pgcopy_find_files(full_path, files, count, capacity);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || !pgcopy_is_pgcopy(full_path)) continue;
+        if (*count >= *capacity) {
+            size_t new_capacity = *capacity ? *capacity * 2 : 16;
+            char** grown = realloc(*files, new_capacity * sizeof(char*));
+            if (!grown) break;
+            *files = grown;
+            *capacity = new_capacity;
+        }
+        (*files)[*count] = strdup(full_path);
+        if ((*files)[*count]) (*count)++;
+    }
+    closedir(dir);
+}
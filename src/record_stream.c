@@ -0,0 +1,276 @@
+//
+// Pre-parsed population record files
+//
+
+#include "record_stream.h"
+#include "meshid_ops.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BYTE_ORDER_MARK 0x01020304u
+#define WRITE_BATCH 65536
+
+_Static_assert(sizeof(record_stream_header_t) == 64, "record stream header must stay 64 bytes");
+_Static_assert(sizeof(record_stream_record_t) == 20, "record stream records must stay 20 bytes");
+
+// A record and its arrival order, so sorting keeps rows for one cell in CSV order
+typedef struct {
+    record_stream_record_t record;
+    uint32_t seq;
+} pending_record_t;
+
+struct record_stream_writer {
+    char *path;
+    uint32_t chunk_rows, chunk_cols;
+    pending_record_t *records;
+    size_t count, capacity;
+};
+
+struct record_stream {
+    void *map;
+    size_t map_size;
+    const record_stream_header_t *header;
+    const record_stream_record_t *records;
+};
+
+record_stream_writer_t *record_stream_writer_create(const char *path, uint32_t chunk_rows, uint32_t chunk_cols) {
+    if (!path) return NULL;
+    record_stream_writer_t *writer = calloc(1, sizeof(*writer));
+    if (!writer) return NULL;
+    writer->path = strdup(path);
+    if (!writer->path) {
+        free(writer);
+        return NULL;
+    }
+    writer->chunk_rows = chunk_rows > 0 ? chunk_rows : 1;
+    writer->chunk_cols = chunk_cols > 0 ? chunk_cols : 1;
+    return writer;
+}
+
+int record_stream_writer_add(record_stream_writer_t *writer, uint32_t time_index, uint32_t mesh_index,
+                             int32_t population, int32_t residence, int32_t age, int32_t gender) {
+    if (!writer || age < INT16_MIN || age > INT16_MAX || gender < INT16_MIN || gender > INT16_MAX) return -1;
+    if (writer->count == writer->capacity) {
+        size_t new_capacity = writer->capacity ? writer->capacity * 2 : 4096;
+        pending_record_t *grown = realloc(writer->records, new_capacity * sizeof(pending_record_t));
+        if (!grown) return -1;
+        writer->records = grown;
+        writer->capacity = new_capacity;
+    }
+    writer->records[writer->count] = (pending_record_t){
+        {time_index, mesh_index, population, residence, (int16_t)age, (int16_t)gender}, (uint32_t)writer->count
+    };
+    writer->count++;
+    return 0;
+}
+
+// Chunk shape for the comparator (qsort has no context argument)
+static _Thread_local uint32_t sort_chunk_rows, sort_chunk_cols;
+
+static int pending_compare(const void *a, const void *b) {
+    const pending_record_t *pa = (const pending_record_t *)a;
+    const pending_record_t *pb = (const pending_record_t *)b;
+    const uint32_t ta = pa->record.time_index / sort_chunk_rows, tb = pb->record.time_index / sort_chunk_rows;
+    if (ta != tb) return (ta > tb) - (ta < tb);
+    const uint32_t ca = pa->record.mesh_index / sort_chunk_cols, cb = pb->record.mesh_index / sort_chunk_cols;
+    if (ca != cb) return (ca > cb) - (ca < cb);
+    if (pa->record.time_index != pb->record.time_index) {
+        return (pa->record.time_index > pb->record.time_index) - (pa->record.time_index < pb->record.time_index);
+    }
+    if (pa->record.mesh_index != pb->record.mesh_index) {
+        return (pa->record.mesh_index > pb->record.mesh_index) - (pa->record.mesh_index < pb->record.mesh_index);
+    }
+    return (pa->seq > pb->seq) - (pa->seq < pb->seq);
+}
+
+void record_stream_writer_discard(record_stream_writer_t *writer) {
+    if (!writer) return;
+    free(writer->records);
+    free(writer->path);
+    free(writer);
+}
+
+int record_stream_writer_close(record_stream_writer_t *writer) {
+    if (!writer) return -1;
+
+    sort_chunk_rows = writer->chunk_rows;
+    sort_chunk_cols = writer->chunk_cols;
+    qsort(writer->records, writer->count, sizeof(pending_record_t), pending_compare);
+
+    record_stream_header_t header = {0};
+    memcpy(header.magic, RECORD_STREAM_MAGIC, sizeof(header.magic));
+    header.version = RECORD_STREAM_VERSION;
+    header.byte_order = BYTE_ORDER_MARK;
+    header.record_size = sizeof(record_stream_record_t);
+    header.mesh_count = MOBAKU_MESH_COUNT;
+    header.count = writer->count;
+    header.chunk_rows = writer->chunk_rows;
+    header.chunk_cols = writer->chunk_cols;
+    if (writer->count > 0) {
+        header.min_time = header.max_time = writer->records[0].record.time_index;
+        for (size_t i = 1; i < writer->count; i++) {
+            uint32_t t = writer->records[i].record.time_index;
+            if (t < header.min_time) header.min_time = t;
+            if (t > header.max_time) header.max_time = t;
+        }
+    }
+
+    size_t tmp_len = strlen(writer->path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    record_stream_record_t *batch = malloc(WRITE_BATCH * sizeof(record_stream_record_t));
+    FILE *fp = tmp_path ? (snprintf(tmp_path, tmp_len, "%s.tmp", writer->path), fopen(tmp_path, "wb")) : NULL;
+    if (!fp || !batch) {
+        fprintf(stderr, "Error: Cannot write record file %s\n", writer->path);
+        if (fp) fclose(fp);
+        free(tmp_path);
+        free(batch);
+        record_stream_writer_discard(writer);
+        return -1;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (size_t i = 0; ok && i < writer->count; i += WRITE_BATCH) {
+        size_t n = writer->count - i < WRITE_BATCH ? writer->count - i : WRITE_BATCH;
+        for (size_t k = 0; k < n; k++) batch[k] = writer->records[i + k].record;
+        ok = fwrite(batch, sizeof(record_stream_record_t), n, fp) == n;
+    }
+    ok = (fclose(fp) == 0) && ok;
+    if (ok && rename(tmp_path, writer->path) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write record file %s\n", writer->path);
+        unlink(tmp_path);
+    }
+
+    free(tmp_path);
+    free(batch);
+    record_stream_writer_discard(writer);
+    return ok ? 0 : -1;
+}
+
+record_stream_t *record_stream_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open record file %s\n", path);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(record_stream_header_t)) {
+        fprintf(stderr, "Error: Record file %s is truncated\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map record file %s\n", path);
+        return NULL;
+    }
+    // Records are consumed front to back exactly once
+    madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    const record_stream_header_t *header = (const record_stream_header_t *)map;
+    const char *problem = NULL;
+    if (memcmp(header->magic, RECORD_STREAM_MAGIC, sizeof(header->magic)) != 0) {
+        problem = "is not a record file";
+    } else if (header->byte_order != BYTE_ORDER_MARK) {
+        problem = "was written with another byte order";
+    } else if (header->version != RECORD_STREAM_VERSION || header->record_size != sizeof(record_stream_record_t)) {
+        problem = "has an unsupported version";
+    } else if (header->mesh_count != MOBAKU_MESH_COUNT) {
+        problem = "uses a different mesh list";
+    } else if (header->count != ((size_t)st.st_size - sizeof(record_stream_header_t)) / sizeof(record_stream_record_t) ||
+               ((size_t)st.st_size - sizeof(record_stream_header_t)) % sizeof(record_stream_record_t) != 0) {
+        problem = "is truncated";
+    }
+    record_stream_t *stream = problem ? NULL : malloc(sizeof(*stream));
+    if (!stream) {
+        fprintf(stderr, "Error: Record file %s %s\n", path, problem ? problem : "cannot be opened");
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+
+    stream->map = map;
+    stream->map_size = (size_t)st.st_size;
+    stream->header = header;
+    stream->records = (const record_stream_record_t *)((const char *)map + sizeof(record_stream_header_t));
+    return stream;
+}
+
+const record_stream_header_t *record_stream_header(const record_stream_t *stream) {
+    return stream ? stream->header : NULL;
+}
+
+const record_stream_record_t *record_stream_records(const record_stream_t *stream, size_t *count) {
+    if (!stream) return NULL;
+    if (count) *count = (size_t)stream->header->count;
+    return stream->records;
+}
+
+void record_stream_close(record_stream_t *stream) {
+    if (!stream) return;
+    munmap(stream->map, stream->map_size);
+    free(stream);
+}
+
+int record_stream_is_stream(const char *path) {
+    FILE *fp = fopen(path, "rb");
+    if (!fp) return 0;
+    char magic[8];
+    int match = fread(magic, sizeof(magic), 1, fp) == 1 && memcmp(magic, RECORD_STREAM_MAGIC, sizeof(magic)) == 0;
+    fclose(fp);
+    return match;
+}
+
+char *record_stream_path_for(const char *dir, const char *csv_path) {
+    if (!dir || !csv_path) return NULL;
+    const char *name = strrchr(csv_path, '/');
+    name = name ? name + 1 : csv_path;
+    size_t name_len = strlen(name);
+    if (name_len > 4 && strcmp(name + name_len - 4, ".csv") == 0) name_len -= 4;
+
+    size_t len = strlen(dir) + 1 + name_len + strlen(RECORD_STREAM_EXTENSION) + 1;
+    char *path = malloc(len);
+    if (path) snprintf(path, len, "%s/%.*s%s", dir, (int)name_len, name, RECORD_STREAM_EXTENSION);
+    return path;
+}
+
+void record_stream_find_files(const char *dir_path, char ***files, size_t *count, size_t *capacity) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) return;
+
+    const size_t ext_len = strlen(RECORD_STREAM_EXTENSION);
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+
+        char full_path[1024];
+        snprintf(full_path, sizeof(full_path), "%s/%s", dir_path, entry->d_name);
+        struct stat st;
+        if (stat(full_path, &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            record_stream_find_files(full_path, files, count, capacity);
+            continue;
+        }
+        size_t len = strlen(entry->d_name);
+        if (!S_ISREG(st.st_mode) || len <= ext_len || strcmp(entry->d_name + len - ext_len, RECORD_STREAM_EXTENSION) != 0) {
+            continue;
+        }
+        if (*count >= *capacity) {
+            size_t new_capacity = *capacity ? *capacity * 2 : 16;
+            char **grown = realloc(*files, new_capacity * sizeof(char *));
+            if (!grown) break;
+            *files = grown;
+            *capacity = new_capacity;
+        }
+        (*files)[*count] = strdup(full_path);
+        if ((*files)[*count]) (*count)++;
+    }
+    closedir(dir);
+}
@@ -12,6 +12,7 @@
 #include <sys/stat.h>
 #include <time.h>
 #include "csv_to_h5_converter.h"
+#include "cpu_topology.h"
 #include "H5MR/h5mr.h"
 #include "h5mobaku_ops.h"
 #include "meshid_ops.h"
@@ -467,9 +468,442 @@ void test_write_to_sparse_regions() {
     printf("Sparse region write test passed!\n");
 }
 
+void test_subset_conversion() {
+    printf("Testing CSV conversion into a subset file...\n");
+    
+    const char* test_csv = "test_subset_00000.csv";
+    const uint32_t outside_mesh = meshid_list[5000];
+    FILE* fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0100,362257341,-1,-1,-1,100\n");
+    fprintf(fp, "20160101,0100,362257342,-1,-1,-1,200\n");
+    fprintf(fp, "20160101,0100,%u,-1,-1,-1,999\n", outside_mesh);
+    fprintf(fp, "20160101,0200,362257342,-1,-1,-1,250\n");
+    fclose(fp);
+    
+    // Column order need not follow the compiled-in list
+    const uint32_t subset[] = {362257342, 362257341};
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = "test_subset.h5";
+    config.mesh_ids = subset;
+    config.num_meshes = 2;
+    
+    csv_to_h5_stats_t stats;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.unique_meshes == 2);
+    
+    struct h5mobaku* ctx;
+    assert(h5mobaku_open("test_subset.h5", &ctx) == 0);
+    size_t time_points, mesh_count;
+    h5r_get_dimensions(ctx->h5r_ctx, &time_points, &mesh_count);
+    assert(mesh_count == 2);
+    
+    cmph_t* hash = meshid_prepare_search();
+    assert(hash != NULL);
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, 362257342) == 0);
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, outside_mesh) == MESHID_NOT_FOUND);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, 362257341, 1) == 100);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, 362257342, 1) == 200);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, 362257342, 2) == 250);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, outside_mesh, 1) < 0);
+    
+    cmph_destroy(hash);
+    h5mobaku_close(ctx);
+    unlink(test_csv);
+    unlink("test_subset.h5");
+    printf("Subset conversion test passed\n");
+}
+
+void test_bulk_chunk_tiles() {
+    printf("Testing bulk write through chunk-major tiles...\n");
+    
+    // 40 columns: two full 16-wide tiles and a partial edge tile
+    enum { NUM_BULK_MESHES = 40 };
+    uint32_t subset[NUM_BULK_MESHES];
+    for (int i = 0; i < NUM_BULK_MESHES; i++) subset[i] = meshid_list[100 + i];
+    
+    // 2016 starts on a chunk boundary and fills whole chunks (direct chunk writes)
+    const char* test_csv = "test_bulk_tiles_00000.csv";
+    FILE* fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0000,%u,-1,-1,-1,11\n", subset[0]);
+    fprintf(fp, "20160101,0100,%u,-1,-1,-1,12\n", subset[17]);
+    fprintf(fp, "20160615,1300,%u,-1,-1,-1,13\n", subset[39]);
+    fprintf(fp, "20161231,2300,%u,-1,-1,-1,14\n", subset[32]);
+    fclose(fp);
+    
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = "test_bulk_tiles.h5";
+    config.use_bulk_write = 1;
+    config.mesh_ids = subset;
+    config.num_meshes = NUM_BULK_MESHES;
+    csv_to_h5_stats_t stats;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.total_rows_processed == 4);
+    assert(stats.direct_chunks == 3);
+    
+    // A value just past 2017 must survive the padded last tile of that year
+    struct h5mobaku* ctx;
+    assert(h5mobaku_open_readwrite("test_bulk_tiles.h5", &ctx) == 0);
+    const int first_2017 = 8784, first_2018 = 8784 + 8760;
+    assert(h5r_write_cell(ctx->h5r_ctx, first_2018, 5, 99) == 0);
+    h5mobaku_close(ctx);
+    
+    // 2017 has 8760 hours, so its tiles are partial and go through hyperslab writes
+    fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20170101,0000,%u,-1,-1,-1,21\n", subset[5]);
+    fprintf(fp, "20171231,2300,%u,-1,-1,-1,22\n", subset[39]);
+    fclose(fp);
+    config.create_new = 0;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.direct_chunks == 0);
+    
+    assert(h5mobaku_open("test_bulk_tiles.h5", &ctx) == 0);
+    cmph_t* hash = meshid_prepare_search();
+    assert(hash != NULL);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[0], 0) == 11);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[17], 1) == 12);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[39], (31 + 29 + 31 + 30 + 31 + 14) * 24 + 13) == 13);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[32], 8783) == 14);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[1], 1) == 0);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[5], first_2017) == 21);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[39], first_2018 - 1) == 22);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[5], first_2018) == 99);
+    
+    cmph_destroy(hash);
+    h5mobaku_close(ctx);
+    unlink(test_csv);
+    unlink("test_bulk_tiles.h5");
+    printf("Bulk chunk tile test passed\n");
+}
+
+void test_bulk_unaligned_year() {
+    printf("Testing bulk write of a year starting inside a chunk...\n");
+    
+    // Week-long chunks: 2017 starts 48 hours into one (8784 % 168), so its staging bands are
+    // shifted onto the chunk grid and every whole week between the ends is a direct chunk write
+    enum { NUM_BULK_MESHES = 40, WEEK = 168 };
+    uint32_t subset[NUM_BULK_MESHES];
+    for (int i = 0; i < NUM_BULK_MESHES; i++) subset[i] = meshid_list[200 + i];
+    h5r_writer_config_t writer_config = H5R_WRITER_DEFAULT_CONFIG;
+    writer_config.initial_time_points = 8784;
+    writer_config.chunk_time_size = WEEK;
+    struct h5mobaku* ctx;
+    assert(h5mobaku_create_with_meshes("test_bulk_unaligned.h5", &writer_config, subset, NUM_BULK_MESHES, &ctx) == 0);
+    const int first_2017 = 8784;
+    // Shares its chunk with the start of 2017 and must survive the partial first band
+    assert(h5r_write_cell(ctx->h5r_ctx, first_2017 - 1, 7, 77) == 0);
+    h5mobaku_close(ctx);
+    
+    const char* test_csv = "test_bulk_unaligned_00000.csv";
+    FILE* fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20170101,0000,%u,-1,-1,-1,31\n", subset[7]);
+    fprintf(fp, "20170105,2300,%u,-1,-1,-1,32\n", subset[20]);
+    fprintf(fp, "20170106,0000,%u,-1,-1,-1,33\n", subset[20]);
+    fprintf(fp, "20170704,1200,%u,-1,-1,-1,34\n", subset[39]);
+    fprintf(fp, "20171231,2300,%u,-1,-1,-1,35\n", subset[0]);
+    fclose(fp);
+    
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = "test_bulk_unaligned.h5";
+    config.create_new = 0;
+    config.use_bulk_write = 1;
+    csv_to_h5_stats_t stats;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.total_rows_processed == 5 && stats.errors == 0);
+    // 120 hours before the first boundary, then (8760 - 120) / 168 = 51 whole weeks, 3 tiles across
+    assert(stats.direct_chunks == 51 * 3);
+    
+    assert(h5mobaku_open("test_bulk_unaligned.h5", &ctx) == 0);
+    cmph_t* hash = meshid_prepare_search();
+    assert(hash != NULL);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[7], first_2017 - 1) == 77);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[7], first_2017) == 31);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[20], first_2017 + 119) == 32);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[20], first_2017 + 120) == 33);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[39], first_2017 + 184 * 24 + 12) == 34);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[0], first_2017 + 8759) == 35);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[21], first_2017 + 120) == 0);
+    cmph_destroy(hash);
+    h5mobaku_close(ctx);
+    
+    unlink(test_csv);
+    unlink("test_bulk_unaligned.h5");
+    printf("Unaligned bulk year test passed\n");
+}
+
+void test_bulk_multi_year() {
+    printf("Testing multi-year bulk conversion in one run...\n");
+    
+    enum { NUM_BULK_MESHES = 20 };
+    uint32_t subset[NUM_BULK_MESHES];
+    for (int i = 0; i < NUM_BULK_MESHES; i++) subset[i] = meshid_list[300 + i];
+    
+    // Input order does not follow the years; the 2017 file also carries stray 2019 rows and the
+    // 2018 file one for a cell next to a stored 2016 row (same chunk, so it goes through one chunk write)
+    const char* files[] = {"test_bulk_2018_00000.csv", "test_bulk_2016_00000.csv", "test_bulk_2017_00000.csv"};
+    FILE* fp = fopen(files[0], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20180101,0000,%u,-1,-1,-1,180\n", subset[3]);
+    fprintf(fp, "20161231,2300,%u,-1,-1,-1,162\n", subset[18]);
+    fclose(fp);
+    fp = fopen(files[1], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0000,%u,-1,-1,-1,160\n", subset[1]);
+    fprintf(fp, "20161231,2300,%u,-1,-1,-1,161\n", subset[19]);
+    fclose(fp);
+    fp = fopen(files[2], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20170301,0500,%u,-1,-1,-1,170\n", subset[2]);
+    fprintf(fp, "20190101,0000,%u,-1,-1,-1,190\n", subset[4]);
+    fprintf(fp, "20190101,0100,%u,-1,-1,-1,191\n", subset[5]);
+    fclose(fp);
+    
+    const int first_2017 = 8784, first_2018 = first_2017 + 8760, first_2019 = first_2018 + 8760;
+    for (int buffers = 1; buffers <= 2; buffers++) {
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = "test_bulk_years.h5";
+        config.use_bulk_write = 1;
+        config.bulk_year_buffers = buffers;
+        config.mesh_ids = subset;
+        config.num_meshes = NUM_BULK_MESHES;
+        csv_to_h5_stats_t stats;
+        assert(csv_to_h5_convert_files(files, 3, &config, &stats) == 0);
+        assert(stats.total_rows_processed == 7);
+        assert(stats.errors == 0);
+        
+        struct h5mobaku* ctx;
+        assert(h5mobaku_open("test_bulk_years.h5", &ctx) == 0);
+        cmph_t* hash = meshid_prepare_search();
+        assert(hash != NULL);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[1], 0) == 160);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[19], first_2017 - 1) == 161);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[2], first_2017 + (31 + 28) * 24 + 5) == 170);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[3], first_2018) == 180);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[4], first_2019) == 190);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[5], first_2019 + 1) == 191);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[4], first_2019 + 1) == 0);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[18], first_2017 - 1) == 162);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[1], first_2017) == 0);
+        cmph_destroy(hash);
+        h5mobaku_close(ctx);
+        unlink("test_bulk_years.h5");
+    }
+    
+    for (int i = 0; i < 3; i++) unlink(files[i]);
+    printf("Multi-year bulk conversion test passed\n");
+}
+
+void test_merge_policies() {
+    printf("Testing merge policies for breakdown rows...\n");
+    
+    const uint32_t subset[] = {meshid_list[400], meshid_list[401]};
+    const char* test_csv = "test_merge_00000.csv";
+    FILE* fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0300,%u,1,20,1,10\n", subset[0]);
+    fprintf(fp, "20160101,0300,%u,1,30,2,25\n", subset[0]);
+    fprintf(fp, "20160101,0300,%u,2,40,1,5\n", subset[0]);
+    fprintf(fp, "20160101,0400,%u,1,20,1,7\n", subset[1]);
+    fclose(fp);
+    
+    csv_to_h5_merge_policy_t policy;
+    assert(csv_to_h5_parse_merge_policy("sum", &policy) == 0 && policy == CSV_TO_H5_MERGE_SUM);
+    assert(csv_to_h5_parse_merge_policy("average", &policy) != 0);
+    
+    // {policy, expected} for incremental and bulk mode alike; one reader thread keeps row order
+    const struct { csv_to_h5_merge_policy_t policy; int32_t expected; } cases[] = {
+        {CSV_TO_H5_MERGE_OVERWRITE, 5},
+        {CSV_TO_H5_MERGE_SUM, 40},
+        {CSV_TO_H5_MERGE_MAX, 25},
+    };
+    for (int bulk = 0; bulk <= 1; bulk++) {
+        for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+            csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+            config.output_h5_file = "test_merge.h5";
+            config.use_bulk_write = bulk;
+            config.mesh_ids = subset;
+            config.num_meshes = 2;
+            config.merge_policy = cases[c].policy;
+            csv_to_h5_stats_t stats;
+            assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+            assert(stats.total_rows_processed == 4);
+            
+            struct h5mobaku* ctx;
+            assert(h5mobaku_open("test_merge.h5", &ctx) == 0);
+            cmph_t* hash = meshid_prepare_search();
+            assert(hash != NULL);
+            assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[0], 3) == cases[c].expected);
+            assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[1], 4) == 7);
+            cmph_destroy(hash);
+            h5mobaku_close(ctx);
+            unlink("test_merge.h5");
+        }
+    }
+    
+    // Sums past the int32 range saturate instead of wrapping
+    fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0300,%u,-1,-1,-1,2000000000\n", subset[0]);
+    fprintf(fp, "20160101,0300,%u,-1,-1,-1,2000000000\n", subset[0]);
+    fclose(fp);
+    for (int bulk = 0; bulk <= 1; bulk++) {
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = "test_merge.h5";
+        config.use_bulk_write = bulk;
+        config.mesh_ids = subset;
+        config.num_meshes = 2;
+        config.merge_policy = CSV_TO_H5_MERGE_SUM;
+        assert(csv_to_h5_convert_file(test_csv, &config, NULL) == 0);
+        struct h5mobaku* ctx;
+        assert(h5mobaku_open("test_merge.h5", &ctx) == 0);
+        cmph_t* hash = meshid_prepare_search();
+        assert(hash != NULL);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[0], 3) == INT32_MAX);
+        cmph_destroy(hash);
+        h5mobaku_close(ctx);
+        unlink("test_merge.h5");
+    }
+    
+    // Incremental sum over more rows for one cell than a consumer batch takes, then an append
+    // whose rows replace the stored cell before adding up
+    enum { REPEATS = 3000 };
+    fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    for (int i = 0; i < REPEATS; i++) {
+        fprintf(fp, "20160101,0300,%u,-1,-1,-1,1\n", subset[0]);
+        fprintf(fp, "20160101,%02d00,%u,-1,-1,-1,2\n", i % 24, subset[1]);
+    }
+    fclose(fp);
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = "test_merge.h5";
+    config.mesh_ids = subset;
+    config.num_meshes = 2;
+    config.merge_policy = CSV_TO_H5_MERGE_SUM;
+    csv_to_h5_stats_t stats;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.total_rows_processed == 2 * REPEATS && stats.errors == 0);
+    
+    fp = fopen(test_csv, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0300,%u,-1,-1,-1,4\n", subset[0]);
+    fprintf(fp, "20160101,0300,%u,-1,-1,-1,5\n", subset[0]);
+    fprintf(fp, "20160101,0500,%u,-1,-1,-1,6\n", subset[1]);
+    fprintf(fp, "20160101,0500,%u,-1,-1,-1,1\n", subset[1]);
+    fclose(fp);
+    config.create_new = 0;
+    assert(csv_to_h5_convert_file(test_csv, &config, &stats) == 0);
+    assert(stats.errors == 0);
+    
+    struct h5mobaku* ctx;
+    assert(h5mobaku_open("test_merge.h5", &ctx) == 0);
+    cmph_t* hash = meshid_prepare_search();
+    assert(hash != NULL);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[0], 3) == 9);
+    for (int h = 0; h < 24; h++) {
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[1], h) ==
+               (h == 5 ? 7 : 2 * (REPEATS / 24 + (h < REPEATS % 24))));
+    }
+    cmph_destroy(hash);
+    h5mobaku_close(ctx);
+    unlink("test_merge.h5");
+    
+    unlink(test_csv);
+    printf("Merge policy test passed\n");
+}
+
+void test_reader_pool() {
+    printf("Testing reader pool sizing and pinning...\n");
+    
+    cpu_topology_t* topo = cpu_topology_detect();
+    assert(topo != NULL);
+    int node_total = 0;
+    for (int n = 0; n < cpu_topology_num_nodes(topo); n++) node_total += cpu_topology_node_cpus(topo, n);
+    assert(cpu_topology_num_cpus(topo) >= 1 && node_total == cpu_topology_num_cpus(topo));
+    assert(cpu_topology_bind_thread(topo, pthread_self(), 0) == 0);
+    assert(cpu_topology_bind_thread(topo, pthread_self(), -1) == 0);
+    cpu_topology_destroy(topo);
+    
+    // Files of very different sizes, more rows than the consumer queue holds
+    enum { NUM_FILES = 6, NUM_MESHES = 24 };
+    uint32_t subset[NUM_MESHES];
+    for (int m = 0; m < NUM_MESHES; m++) subset[m] = meshid_list[900 + m];
+    const char* files[NUM_FILES];
+    char names[NUM_FILES][64];
+    size_t expected_rows = 0;
+    for (int f = 0; f < NUM_FILES; f++) {
+        snprintf(names[f], sizeof(names[f]), "test_pool_%d_00000.csv", f);
+        files[f] = names[f];
+        FILE* fp = fopen(names[f], "w");
+        assert(fp != NULL);
+        fprintf(fp, "date,time,area,residence,age,gender,population\n");
+        int days = f == 0 ? 20 : 1;
+        for (int d = 0; d < days; d++) {
+            for (int h = 0; h < 24; h++) {
+                for (int m = 0; m < NUM_MESHES; m++) {
+                    if (m % NUM_FILES != f) continue;
+                    fprintf(fp, "201601%02d,%02d00,%u,-1,-1,-1,%d\n", d + 1, h, subset[m], d * 24 + h + m * 1000);
+                    expected_rows++;
+                }
+            }
+        }
+        fclose(fp);
+    }
+    
+    for (int pin = 0; pin <= 1; pin++) {
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = "test_pool.h5";
+        config.mesh_ids = subset;
+        config.num_meshes = NUM_MESHES;
+        config.reader_threads = pin ? 0 : 4;
+        config.pin_threads = pin;
+        csv_to_h5_stats_t stats;
+        assert(csv_to_h5_convert_files(files, NUM_FILES, &config, &stats) == 0);
+        assert(stats.total_rows_processed == expected_rows);
+        assert(stats.errors == 0);
+        
+        struct h5mobaku* ctx;
+        assert(h5mobaku_open("test_pool.h5", &ctx) == 0);
+        cmph_t* hash = meshid_prepare_search();
+        assert(hash != NULL);
+        for (int m = 0; m < NUM_MESHES; m++) {
+            int days = m % NUM_FILES == 0 ? 20 : 1;
+            int32_t* series = h5mobaku_read_population_time_series(ctx->h5r_ctx, hash, subset[m], 0, days * 24 - 1);
+            assert(series != NULL);
+            for (int t = 0; t < days * 24; t++) assert(series[t] == t + m * 1000);
+            h5mobaku_free_data(series);
+        }
+        cmph_destroy(hash);
+        h5mobaku_close(ctx);
+        unlink("test_pool.h5");
+    }
+    
+    for (int f = 0; f < NUM_FILES; f++) unlink(names[f]);
+    printf("Reader pool test passed\n");
+}
+
 int main() {
     printf("Starting CSV to H5 tests...\n");
     test_csv_conversion();
+    test_subset_conversion();
+    test_bulk_chunk_tiles();
+    test_bulk_unaligned_year();
+    test_bulk_multi_year();
+    test_merge_policies();
+    test_reader_pool();
     test_append_mode();
     test_write_to_sparse_regions();
     test_multi_producer_csv_to_h5();
@@ -0,0 +1,22 @@
+//
+// Shared fixtures for tests that build their own subset files
+//
+
+#include <assert.h>
+#include "test_fixture.h"
+#include "h5mobaku_ops.h"
+
+void write_test_file(const char *path, cmph_t *hash, uint32_t *meshes, size_t num_meshes,
+                     const int32_t *values, size_t num_hours, size_t chunk_time_size, size_t chunk_mesh_size) {
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    config.initial_time_points = num_hours;
+    config.chunk_time_size = chunk_time_size;
+    config.chunk_mesh_size = chunk_mesh_size;
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_create_with_meshes(path, &config, meshes, num_meshes, &ctx) == 0);
+    for (size_t h = 0; h < num_hours; h++) {
+        assert(h5mobaku_write_population_multi(ctx->h5r_ctx, hash, meshes, values + h * num_meshes, num_meshes, (int)h) == 0);
+    }
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+}
@@ -0,0 +1,16 @@
+//
+// Shared fixtures for tests that build their own subset files
+//
+
+#ifndef TEST_FIXTURE_H
+#define TEST_FIXTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cmph.h>
+
+// Creates a subset file over meshes and writes values[h * num_meshes + m] for every hour
+void write_test_file(const char *path, cmph_t *hash, uint32_t *meshes, size_t num_meshes,
+                     const int32_t *values, size_t num_hours, size_t chunk_time_size, size_t chunk_mesh_size);
+
+#endif //TEST_FIXTURE_H
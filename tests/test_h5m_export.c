@@ -0,0 +1,161 @@
+//
+// Round-trip test for h5m-export partitions read back with h5mobaku_read_h5mc
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/wait.h>
+#include "h5mobaku_ops.h"
+#include "h5mobaku_h5mc.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5m_export.h5"
+#define TEST_OUTPUT_DIR "test_h5m_export_out"
+#define NUM_TEST_MESHES 10
+#define NUM_TEST_TIMES (8784 + 48)   // All of 2016 and two days of 2017
+
+// Columns of two 1st meshes, interleaved so each 1st mesh spans several column runs
+static const int mesh_order[NUM_TEST_MESHES] = {0, 1, 2, 6, 7, 3, 4, 5, 8, 9};
+static uint32_t file_ids[NUM_TEST_MESHES];
+static uint32_t mesh1_a, mesh1_b;
+
+static int32_t expected_value(int col, int t) {
+    // Signed and jumping, so the zigzag deltas take several varint widths
+    return (int32_t)((t * 7919 + col * 104729) % 200003) - 100000;
+}
+
+// A non-national file with its own mesh list and chunks narrower than the defaults
+static void create_test_file(void) {
+    size_t first_b = 4242;
+    mesh1_a = meshid_list[first_b] / 100000;
+    while (meshid_list[first_b] / 100000 == mesh1_a) first_b++;
+    mesh1_b = meshid_list[first_b] / 100000;
+    for (int c = 0; c < NUM_TEST_MESHES; c++) {
+        const int k = mesh_order[c];
+        file_ids[c] = k < 6 ? meshid_list[4242 - 5 + k] : meshid_list[first_b + k - 6];
+    }
+    for (int k = 0; k < 6; k++) assert(meshid_list[4242 - 5 + k] / 100000 == mesh1_a);
+    for (int k = 0; k < 4; k++) assert(meshid_list[first_b + k] / 100000 == mesh1_b);
+
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    config.initial_time_points = NUM_TEST_TIMES;
+    config.chunk_time_size = 1024;
+    config.chunk_mesh_size = 4;
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_create_with_meshes(TEST_H5_FILE, &config, file_ids, NUM_TEST_MESHES, &ctx) == 0);
+    int32_t *buffer = malloc((size_t)NUM_TEST_TIMES * NUM_TEST_MESHES * sizeof(int32_t));
+    assert(buffer != NULL);
+    for (int t = 0; t < NUM_TEST_TIMES; t++) {
+        for (int c = 0; c < NUM_TEST_MESHES; c++) buffer[(size_t)t * NUM_TEST_MESHES + c] = expected_value(c, t);
+    }
+    assert(h5r_write_bulk_buffer(ctx->h5r_ctx, buffer, NUM_TEST_TIMES, NUM_TEST_MESHES, 0) == 0);
+    free(buffer);
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+}
+
+static int run_export(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("./h5m-export", "h5m-export", "-f", TEST_H5_FILE, "-o", TEST_OUTPUT_DIR, "-j", "2", "-M", "1",
+              (char*)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static void partition_path(char *path, size_t size, int year, uint32_t mesh1) {
+    snprintf(path, size, "%s/year=%d/mesh1=%u.h5mc", TEST_OUTPUT_DIR, year, mesh1);
+}
+
+// Every column of one 1st mesh, in file order, over rows row0..row0+num_times-1
+static void check_partition(int year, uint32_t mesh1, int row0, uint32_t num_times) {
+    char path[256];
+    partition_path(path, sizeof(path), year, mesh1);
+    h5mobaku_h5mc_t part;
+    assert(h5mobaku_read_h5mc(path, &part) == 0);
+    assert(part.year == year && part.mesh1 == mesh1 && part.num_times == num_times);
+
+    uint32_t m = 0;
+    for (int c = 0; c < NUM_TEST_MESHES; c++) {
+        if (file_ids[c] / 100000 != mesh1) continue;
+        assert(m < part.num_meshes && part.mesh_ids[m] == file_ids[c]);
+        for (uint32_t t = 0; t < num_times; t++) {
+            assert(part.values[(size_t)m * num_times + t] == expected_value(c, row0 + (int)t));
+        }
+        m++;
+    }
+    assert(m == part.num_meshes);
+    h5mobaku_h5mc_free(&part);
+}
+
+static void test_round_trip(void) {
+    printf("Testing h5mc round trip...\n");
+
+    assert(run_export() == 0);
+    check_partition(2016, mesh1_a, 0, 8784);
+    check_partition(2016, mesh1_b, 0, 8784);
+    check_partition(2017, mesh1_a, 8784, 48);
+    check_partition(2017, mesh1_b, 8784, 48);
+
+    // Header fields are little-endian on any host: version 1, flags 0, year 2017
+    char path[256];
+    partition_path(path, sizeof(path), 2017, mesh1_a);
+    FILE *fp = fopen(path, "rb");
+    assert(fp != NULL);
+    uint8_t header[H5MC_HEADER_BYTES];
+    assert(fread(header, 1, sizeof(header), fp) == sizeof(header));
+    fclose(fp);
+    const uint8_t expected_head[12] = {'H', '5', 'M', 'C', 1, 0, 0, 0, 0xe1, 0x07, 0, 0};
+    assert(memcmp(header, expected_head, sizeof(expected_head)) == 0);
+    assert(header[28] == 6 && header[29] == 0 && header[30] == 0 && header[31] == 0);
+
+    printf("h5mc round trip test passed\n");
+}
+
+static void test_truncated(void) {
+    printf("Testing truncated h5mc...\n");
+
+    char path[256];
+    partition_path(path, sizeof(path), 2016, mesh1_b);
+    assert(truncate(path, 1000) == 0);
+    h5mobaku_h5mc_t part;
+    assert(h5mobaku_read_h5mc(path, &part) != 0);
+    assert(part.mesh_ids == NULL && part.values == NULL);
+
+    printf("Truncated h5mc test passed\n");
+}
+
+static void remove_output(void) {
+    const int years[] = {2016, 2017};
+    const uint32_t mesh1s[] = {mesh1_a, mesh1_b};
+    char path[256];
+    for (int y = 0; y < 2; y++) {
+        for (int g = 0; g < 2; g++) {
+            partition_path(path, sizeof(path), years[y], mesh1s[g]);
+            unlink(path);
+        }
+        snprintf(path, sizeof(path), "%s/year=%d", TEST_OUTPUT_DIR, years[y]);
+        rmdir(path);
+    }
+    rmdir(TEST_OUTPUT_DIR);
+}
+
+int main(void) {
+    printf("Running h5m-export tests...\n\n");
+
+    create_test_file();
+    test_round_trip();
+    test_truncated();
+
+    remove_output();
+    unlink(TEST_H5_FILE);
+    printf("\nAll h5m-export tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,160 @@
+//
+// Test for h5m-extract regional subset files
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/wait.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5m_extract.h5"
+#define TEST_MESH1_FILE "test_h5m_extract_mesh1.h5"
+#define TEST_BBOX_FILE "test_h5m_extract_bbox.h5"
+#define NUM_TEST_TIMES 2000
+#define INSIDE_PICK 4242
+
+static uint32_t test_mesh1;
+static uint32_t inside_ids[3];
+static uint32_t outside_id;
+
+static int32_t expected_value(int mesh, int t) {
+    return 1000 * (mesh + 1) + t;
+}
+
+// A short national-width file with a few meshes of one 1st mesh and one outside it
+static int create_test_file(void) {
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    config.initial_time_points = NUM_TEST_TIMES;
+    if (h5mobaku_create(TEST_H5_FILE, &config, &ctx) != 0) return -1;
+
+    test_mesh1 = meshid_list[INSIDE_PICK] / 100000;
+    size_t first = INSIDE_PICK, last = INSIDE_PICK;
+    while (first > 0 && meshid_list[first - 1] / 100000 == test_mesh1) first--;
+    while (last + 1 < meshid_list_size && meshid_list[last + 1] / 100000 == test_mesh1) last++;
+    const size_t cols[3] = {first, INSIDE_PICK, last};
+    const size_t outside_col = last + 1;
+    assert(meshid_list[outside_col] / 100000 != test_mesh1);
+
+    for (int m = 0; m < 3; m++) inside_ids[m] = meshid_list[cols[m]];
+    outside_id = meshid_list[outside_col];
+
+    for (int t = 0; t < NUM_TEST_TIMES; t++) {
+        for (int m = 0; m < 3; m++) {
+            if (h5r_write_cell(ctx->h5r_ctx, (uint64_t)t, cols[m], expected_value(m, t)) < 0) goto fail;
+        }
+        if (h5r_write_cell(ctx->h5r_ctx, (uint64_t)t, outside_col, -1) < 0) goto fail;
+    }
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+    return 0;
+
+fail:
+    h5mobaku_close(ctx);
+    return -1;
+}
+
+static int run_extract(const char *output, const char *flag, const char *value, const char *memory_mb) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("./h5m-extract", "h5m-extract", "-f", TEST_H5_FILE, "-o", output, flag, value,
+              "-M", memory_mb, (char*)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+static size_t count_meshes_in_mesh1(uint32_t mesh1) {
+    size_t n = 0;
+    for (size_t i = 0; i < meshid_list_size; i++) {
+        if (meshid_list[i] / 100000 == mesh1) n++;
+    }
+    return n;
+}
+
+static void check_subset(const char *path, cmph_t *hash) {
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(path, &ctx) == 0);
+    assert(h5r_get_mesh_dict(ctx->h5r_ctx) != NULL);
+
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    assert(meta.rows == NUM_TEST_TIMES);
+    assert(meta.cols == count_meshes_in_mesh1(test_mesh1));
+    assert(meta.ccols == (meta.cols < HDF5_MESH_CHUNK ? meta.cols : HDF5_MESH_CHUNK));
+
+    // Columns keep the source order
+    uint32_t *ids = NULL;
+    size_t count = 0;
+    assert(h5r_read_meshid_list(ctx->h5r_ctx, &ids, &count) == 0);
+    assert(count == meta.cols);
+    assert(ids[0] == inside_ids[0]);
+    assert(ids[count - 1] == inside_ids[2]);
+    for (size_t i = 1; i < count; i++) assert(ids[i] / 100000 == test_mesh1);
+    free(ids);
+
+    for (int m = 0; m < 3; m++) {
+        int32_t *series = h5mobaku_read_population_time_series(ctx->h5r_ctx, hash, inside_ids[m], 0, NUM_TEST_TIMES - 1);
+        assert(series != NULL);
+        for (int t = 0; t < NUM_TEST_TIMES; t++) assert(series[t] == expected_value(m, t));
+        h5mobaku_free_data(series);
+    }
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, outside_id) == MESHID_NOT_FOUND);
+    h5mobaku_close(ctx);
+}
+
+static void test_extract_mesh1(cmph_t *hash) {
+    printf("Testing extract by 1st mesh...\n");
+
+    char arg[16];
+    snprintf(arg, sizeof(arg), "%u", test_mesh1);
+    // One chunk-row of the 1st mesh is over 1 MiB, so bands are copied in column groups
+    assert(run_extract(TEST_MESH1_FILE, "-m", arg, "1") == 0);
+    check_subset(TEST_MESH1_FILE, hash);
+
+    // Nothing selected is an error and leaves no file behind
+    unlink(TEST_BBOX_FILE);
+    assert(run_extract(TEST_BBOX_FILE, "-m", "1000", "1") != 0);
+    assert(access(TEST_BBOX_FILE, F_OK) != 0);
+
+    printf("Extract by 1st mesh test passed\n");
+}
+
+static void test_extract_bbox(cmph_t *hash) {
+    printf("Testing extract by bounding box...\n");
+
+    // The box covering exactly the 1st mesh selects the same meshes
+    const double lat0 = (test_mesh1 / 100) / 1.5;
+    const double lon0 = test_mesh1 % 100 + 100.0;
+    char arg[128];
+    snprintf(arg, sizeof(arg), "%.9f,%.9f,%.9f,%.9f", lat0 + 2.0 / 3.0, lon0 + 1.0, lat0, lon0);
+    assert(run_extract(TEST_BBOX_FILE, "-b", arg, "64") == 0);
+    check_subset(TEST_BBOX_FILE, hash);
+
+    printf("Extract by bounding box test passed\n");
+}
+
+int main(void) {
+    printf("Running h5m-extract tests...\n\n");
+
+    assert(create_test_file() == 0);
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+
+    test_extract_mesh1(hash);
+    test_extract_bbox(hash);
+
+    cmph_destroy(hash);
+    unlink(TEST_H5_FILE);
+    unlink(TEST_MESH1_FILE);
+    unlink(TEST_BBOX_FILE);
+    printf("\nAll h5m-extract tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,283 @@
+//
+// Test for the buffered output engine and its formatters
+//
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <assert.h>
+#include <time.h>
+#include <fcntl.h>
+#include "h5m_output.h"
+
+#define NUM_RANDOM_VALUES 100000
+#define NUM_PIPE_LINES 200000
+
+typedef struct {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;
+} pipe_reader_t;
+
+static void *pipe_reader_func(void *arg) {
+    pipe_reader_t *r = (pipe_reader_t*)arg;
+    for (;;) {
+        if (r->cap - r->len < 65536) {
+            r->cap = r->cap ? r->cap * 2 : 1 << 20;
+            r->data = realloc(r->data, r->cap);
+            assert(r->data != NULL);
+        }
+        ssize_t n = read(r->fd, r->data + r->len, r->cap - r->len);
+        assert(n >= 0);
+        if (n == 0) break;
+        r->len += (size_t)n;
+    }
+    return NULL;
+}
+
+static void test_integer_format(void) {
+    printf("Testing integer formatting...\n");
+
+    const int64_t edge[] = {0, 1, 9, 10, 99, 100, 101, 999, 1000, -1, -10, -100,
+                            INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN};
+    char got[32], expected[32];
+    for (size_t i = 0; i < sizeof(edge) / sizeof(edge[0]); i++) {
+        size_t len = h5m_format_int64(got, edge[i]);
+        got[len] = '\0';
+        snprintf(expected, sizeof(expected), "%" PRId64, edge[i]);
+        assert(strcmp(got, expected) == 0);
+    }
+
+    size_t len = h5m_format_uint64(got, UINT64_MAX);
+    got[len] = '\0';
+    assert(strcmp(got, "18446744073709551615") == 0);
+
+    srand(12345);
+    for (int i = 0; i < NUM_RANDOM_VALUES; i++) {
+        int64_t v = ((int64_t)rand() << 32 | (int64_t)rand()) * (rand() % 2 ? 1 : -1);
+        v >>= rand() % 63;
+        len = h5m_format_int64(got, v);
+        got[len] = '\0';
+        snprintf(expected, sizeof(expected), "%" PRId64, v);
+        assert(strcmp(got, expected) == 0);
+    }
+
+    printf("Integer formatting test passed\n");
+}
+
+static void test_datetime_cursor(void) {
+    printf("Testing incremental datetime formatting...\n");
+
+    setenv("TZ", "Asia/Tokyo", 1);
+    tzset();
+
+    // 2016-01-01 00:00:00 JST through the end of 2024, crossing leap days
+    const time_t start = 1451574000;
+    h5m_datetime_cursor_t cursor;
+    h5m_datetime_cursor_init(&cursor, start);
+
+    char got[H5M_DATETIME_LEN + 1], expected[32];
+    got[H5M_DATETIME_LEN] = '\0';
+    for (int h = 0; h < 80000; h++) {
+        time_t t = start + (time_t)h * 3600;
+        struct tm tm;
+        localtime_r(&t, &tm);
+        strftime(expected, sizeof(expected), "%Y-%m-%d %H:%M:%S", &tm);
+
+        h5m_datetime_cursor_format(&cursor, got);
+        assert(strcmp(got, expected) == 0);
+        h5m_datetime_cursor_advance(&cursor);
+    }
+
+    printf("Incremental datetime formatting test passed\n");
+}
+
+// Write a known text through the engine into a pipe and compare what comes out
+static void run_pipe_roundtrip(unsigned flags, size_t buffer_size) {
+    int fds[2];
+    assert(pipe(fds) == 0);
+
+    pipe_reader_t reader = {.fd = fds[0]};
+    pthread_t tid;
+    assert(pthread_create(&tid, NULL, pipe_reader_func, &reader) == 0);
+
+    h5m_output_t out;
+    assert(h5m_output_init(&out, fds[1], buffer_size, flags) == 0);
+
+    size_t expected_cap = (size_t)NUM_PIPE_LINES * 64 + 4 * 1024 * 1024;
+    char *expected = malloc(expected_cap);
+    assert(expected != NULL);
+    size_t expected_len = 0;
+
+    h5m_datetime_cursor_t cursor;
+    h5m_datetime_cursor_init(&cursor, 1451574000);
+    char datetime[H5M_DATETIME_LEN + 1];
+    datetime[H5M_DATETIME_LEN] = '\0';
+
+    for (int i = 0; i < NUM_PIPE_LINES; i++) {
+        int64_t value = (int64_t)i * 7919 - 1000000;
+
+        h5m_output_put_int64(&out, i);
+        h5m_output_put_char(&out, ',');
+        h5m_output_put_datetime(&out, &cursor);
+        h5m_output_put_char(&out, ',');
+        h5m_output_put_int64_padded(&out, value, 12, i % 2);
+        h5m_output_put_str(&out, "\n");
+
+        h5m_datetime_cursor_format(&cursor, datetime);
+        expected_len += (size_t)snprintf(expected + expected_len, expected_cap - expected_len,
+                                         i % 2 ? "%d,%s,%-12" PRId64 "\n" : "%d,%s,%12" PRId64 "\n",
+                                         i, datetime, value);
+        h5m_datetime_cursor_advance(&cursor);
+
+        // Occasionally a block larger than the buffer goes straight to the fd
+        if (i % 50000 == 0) {
+            size_t big = buffer_size * 2 + 3;
+            char *block = malloc(big);
+            assert(block != NULL);
+            memset(block, 'a' + (i / 50000), big);
+            assert(h5m_output_write(&out, block, big) == 0);
+            memcpy(expected + expected_len, block, big);
+            expected_len += big;
+            free(block);
+        }
+    }
+
+    assert(h5m_output_close(&out) == 0);
+    close(fds[1]);
+    pthread_join(tid, NULL);
+    close(fds[0]);
+
+    assert(reader.len == expected_len);
+    assert(memcmp(reader.data, expected, expected_len) == 0);
+
+    free(reader.data);
+    free(expected);
+}
+
+static void test_buffered_output(void) {
+    printf("Testing buffered output through a pipe...\n");
+    run_pipe_roundtrip(0, 4096);
+    run_pipe_roundtrip(0, 0);
+    printf("Buffered output test passed\n");
+
+    printf("Testing vmsplice output through a pipe...\n");
+    run_pipe_roundtrip(H5M_OUTPUT_VMSPLICE, 4096);
+    printf("vmsplice output test passed\n");
+}
+
+static void test_file_output(void) {
+    printf("Testing output to a regular file with vmsplice requested...\n");
+
+    FILE *fp = tmpfile();
+    assert(fp != NULL);
+    int fd = fileno(fp);
+
+    h5m_output_t out;
+    // Not a pipe: the engine silently falls back to write(2)
+    assert(h5m_output_init(&out, fd, 256, H5M_OUTPUT_VMSPLICE) == 0);
+    assert(out.use_vmsplice == 0);
+    for (int i = 0; i < 1000; i++) {
+        h5m_output_put_uint64(&out, (uint64_t)i);
+        h5m_output_put_char(&out, '\n');
+    }
+    assert(h5m_output_close(&out) == 0);
+
+    rewind(fp);
+    char line[32];
+    for (int i = 0; i < 1000; i++) {
+        assert(fgets(line, sizeof(line), fp) != NULL);
+        assert(atoi(line) == i);
+    }
+    assert(fgets(line, sizeof(line), fp) == NULL);
+    fclose(fp);
+
+    printf("File output test passed\n");
+}
+
+// Moves the first block of `from` into another pipe, which keeps referencing its pages, then reads the rest
+typedef struct {
+    int from;
+    int to;
+    size_t moved;
+    pipe_reader_t rest;
+} splice_reader_t;
+
+static void *splice_reader_func(void *arg) {
+    splice_reader_t *r = (splice_reader_t*)arg;
+    while (r->moved < (size_t)fcntl(r->to, F_GETPIPE_SZ)) {
+        ssize_t n = splice(r->from, NULL, r->to, NULL, (size_t)fcntl(r->to, F_GETPIPE_SZ) - r->moved, 0);
+        assert(n > 0);
+        r->moved += (size_t)n;
+    }
+    r->rest.fd = r->from;
+    return pipe_reader_func(&r->rest);
+}
+
+static void test_vmsplice_lifetime(void) {
+    printf("Testing that spliced blocks are not reused...\n");
+
+    int a[2], b[2];
+    assert(pipe(a) == 0 && pipe(b) == 0);
+    h5m_output_t out;
+    assert(h5m_output_init(&out, a[1], 0, H5M_OUTPUT_VMSPLICE) == 0);
+    if (!out.use_vmsplice) {
+        h5m_output_close(&out);
+        printf("vmsplice unavailable, skipped\n");
+        return;
+    }
+    const size_t cap = out.cap;
+    assert(fcntl(b[1], F_SETPIPE_SZ, (int)cap) >= (int)cap);
+    assert((size_t)fcntl(b[1], F_GETPIPE_SZ) == cap);
+
+    splice_reader_t reader = {.from = a[0], .to = b[1]};
+    pthread_t tid;
+    assert(pthread_create(&tid, NULL, splice_reader_func, &reader) == 0);
+
+    // Four full blocks of different bytes; the first one sits in the second pipe meanwhile
+    for (int blk = 0; blk < 4; blk++) {
+        for (size_t i = 0; i < cap; i++) h5m_output_put_char(&out, (char)('a' + blk));
+    }
+    assert(h5m_output_close(&out) == 0);
+    close(a[1]);
+    pthread_join(tid, NULL);
+    close(a[0]);
+    assert(reader.moved == cap && reader.rest.len == 3 * cap);
+    for (size_t i = 0; i < reader.rest.len; i++) assert(reader.rest.data[i] == (char)('b' + i / cap));
+    free(reader.rest.data);
+
+    // Only now is the first block read back, after the engine has filled and freed its buffers
+    char *first = malloc(cap);
+    assert(first != NULL);
+    size_t got = 0;
+    while (got < cap) {
+        ssize_t n = read(b[0], first + got, cap - got);
+        assert(n > 0);
+        got += (size_t)n;
+    }
+    for (size_t i = 0; i < cap; i++) assert(first[i] == 'a');
+    free(first);
+    close(b[0]);
+    close(b[1]);
+
+    printf("Spliced block lifetime test passed\n");
+}
+
+int main(void) {
+    printf("Running output engine tests...\n\n");
+
+    test_integer_format();
+    test_datetime_cursor();
+    test_buffered_output();
+    test_file_output();
+    test_vmsplice_lifetime();
+
+    printf("\nAll output engine tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,205 @@
+//
+// Test for h5m-reader batch mode in CSV and framed raw output
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <assert.h>
+#include <sys/wait.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5m_reader.h5"
+#define TEST_QUERY_FILE "test_h5m_reader_queries.txt"
+#define TEST_OUTPUT_FILE "test_h5m_reader_out.bin"
+#define NUM_TEST_MESHES 3
+#define NUM_TEST_TIMES 24
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+
+static int32_t expected_value(int mesh, int t) {
+    return 100 * (mesh + 1) + t;
+}
+
+static void create_test_file(void) {
+    for (int m = 0; m < NUM_TEST_MESHES; m++) test_meshes[m] = meshid_list[300 + m];
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    config.initial_time_points = NUM_TEST_TIMES;
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_create_with_meshes(TEST_H5_FILE, &config, test_meshes, NUM_TEST_MESHES, &ctx) == 0);
+    for (int t = 0; t < NUM_TEST_TIMES; t++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            assert(h5r_write_cell(ctx->h5r_ctx, (uint64_t)t, (uint64_t)m, expected_value(m, t)) == 0);
+        }
+    }
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+
+    // A series, an aggregate, an unknown mesh, a malformed line and a two-mesh series
+    FILE *fp = fopen(TEST_QUERY_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "# comment\n");
+    fprintf(fp, "%u,2016-01-01 00:00:00,2016-01-01 02:00:00\n", test_meshes[0]);
+    fprintf(fp, "%u;%u,2016-01-01 01:00:00,2016-01-01 02:00:00,sum\n", test_meshes[0], test_meshes[1]);
+    fprintf(fp, "999999999,2016-01-01 00:00:00\n");
+    fprintf(fp, "not a query\n");
+    fprintf(fp, "%u;%u,2016-01-01 03:00:00\n", test_meshes[2], test_meshes[1]);
+    fclose(fp);
+}
+
+// Run h5m-reader with its output going to `output`; returns the exit status
+static int run_reader(const char *output, char *const argv[]) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        int fd = open(output, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0 || dup2(fd, STDOUT_FILENO) < 0) _exit(127);
+        close(fd);
+        execv("./h5m-reader", argv);
+        perror("execv");
+        _exit(127);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// Run a batch into TEST_OUTPUT_FILE; returns the exit status
+static int run_batch(const char *format) {
+    char *const argv[] = {"h5m-reader", "-f", TEST_H5_FILE, "-b", TEST_QUERY_FILE, "-o", (char*)format, NULL};
+    return run_reader(TEST_OUTPUT_FILE, argv);
+}
+
+static char *read_output(size_t *size) {
+    FILE *fp = fopen(TEST_OUTPUT_FILE, "rb");
+    assert(fp != NULL);
+    fseek(fp, 0, SEEK_END);
+    *size = (size_t)ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    char *data = malloc(*size + 1);
+    assert(data != NULL);
+    assert(fread(data, 1, *size, fp) == *size);
+    data[*size] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static void test_batch_csv(void) {
+    printf("Testing batch CSV output...\n");
+
+    // The failing queries are left out but keep their numbers
+    assert(run_batch("csv") == 1);
+    char expected[1024];
+    snprintf(expected, sizeof(expected),
+             "query,mesh_id,datetime,population\n"
+             "0,%u,2016-01-01 00:00:00,100\n"
+             "0,%u,2016-01-01 01:00:00,101\n"
+             "0,%u,2016-01-01 02:00:00,102\n"
+             "1,sum,2016-01-01 01:00:00,302\n"
+             "1,sum,2016-01-01 02:00:00,304\n"
+             "4,%u,2016-01-01 03:00:00,303\n"
+             "4,%u,2016-01-01 03:00:00,203\n",
+             test_meshes[0], test_meshes[0], test_meshes[0], test_meshes[2], test_meshes[1]);
+    size_t size = 0;
+    char *data = read_output(&size);
+    assert(strcmp(data, expected) == 0);
+    free(data);
+
+    printf("Batch CSV output test passed\n");
+}
+
+// Same layout as batch_raw_frame_t in h5m-reader
+typedef struct {
+    uint32_t query;
+    uint16_t status;
+    uint16_t type;
+    uint32_t num_series;
+    uint32_t num_times;
+    uint64_t length;
+} raw_frame_t;
+
+static const char *check_frame(const char *p, uint32_t query, uint16_t status, uint16_t type, uint32_t num_series,
+                               uint32_t num_times, size_t value_size) {
+    raw_frame_t frame;
+    memcpy(&frame, p, sizeof(frame));
+    assert(frame.query == query && frame.status == status && frame.type == type);
+    assert(frame.num_series == num_series && frame.num_times == num_times);
+    assert(frame.length == (uint64_t)num_series * num_times * value_size);
+    return p + sizeof(frame);
+}
+
+static void test_batch_raw(void) {
+    printf("Testing batch raw framing...\n");
+
+    assert(run_batch("raw") == 1);
+    size_t size = 0;
+    char *data = read_output(&size);
+    assert(sizeof(raw_frame_t) == 24);
+    const char *p = data;
+
+    p = check_frame(p, 0, 0, 1, 1, 3, sizeof(uint32_t));
+    for (int t = 0; t < 3; t++, p += sizeof(uint32_t)) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        assert(v == (uint32_t)expected_value(0, t));
+    }
+
+    p = check_frame(p, 1, 0, 2, 1, 2, sizeof(int64_t));
+    for (int t = 1; t <= 2; t++, p += sizeof(int64_t)) {
+        int64_t v;
+        memcpy(&v, p, sizeof(v));
+        assert(v == expected_value(0, t) + expected_value(1, t));
+    }
+
+    // Unknown mesh and malformed line: a failed frame each, with no payload
+    p = check_frame(p, 2, 1, 0, 0, 0, 0);
+    p = check_frame(p, 3, 1, 0, 0, 0, 0);
+
+    p = check_frame(p, 4, 0, 1, 2, 1, sizeof(uint32_t));
+    const int order[2] = {2, 1};
+    for (int m = 0; m < 2; m++, p += sizeof(uint32_t)) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        assert(v == (uint32_t)expected_value(order[m], 3));
+    }
+    assert(p == data + size);
+    free(data);
+
+    printf("Batch raw framing test passed\n");
+}
+
+static void test_output_errors(void) {
+    printf("Testing exit status on output errors...\n");
+
+    // /dev/full fails every write; a failed write must not end with status 0
+    char mesh[16];
+    snprintf(mesh, sizeof(mesh), "%u", test_meshes[0]);
+    char *const batch[] = {"h5m-reader", "-f", TEST_H5_FILE, "-b", TEST_QUERY_FILE, NULL};
+    char *const series[] = {"h5m-reader", "-f", TEST_H5_FILE, "-m", mesh, "-s", "2016-01-01 00:00:00",
+                            "-e", "2016-01-01 05:00:00", NULL};
+    char *const raw[] = {"h5m-reader", "-f", TEST_H5_FILE, "-m", mesh, "-s", "2016-01-01 00:00:00",
+                         "-e", "2016-01-01 05:00:00", "-r", NULL};
+    assert(run_reader(TEST_OUTPUT_FILE, series) == 0);
+    assert(run_reader("/dev/full", batch) != 0);
+    assert(run_reader("/dev/full", series) != 0);
+    assert(run_reader("/dev/full", raw) != 0);
+
+    printf("Output error test passed\n");
+}
+
+int main(void) {
+    printf("Running h5m-reader batch tests...\n\n");
+
+    create_test_file();
+    test_batch_csv();
+    test_batch_raw();
+    test_output_errors();
+
+    unlink(TEST_H5_FILE);
+    unlink(TEST_QUERY_FILE);
+    unlink(TEST_OUTPUT_FILE);
+    printf("\nAll h5m-reader batch tests passed!\n");
+    return 0;
+}
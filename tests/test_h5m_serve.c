@@ -0,0 +1,301 @@
+//
+// Test for h5m-serve query server
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "h5m_protocol.h"
+
+#define TEST_H5_FILE "test_h5m_serve.h5"
+#define TEST_SOCKET "test_h5m_serve.sock"
+#define NUM_TEST_MESHES 3
+#define NUM_TEST_TIMES 48
+#define BIG_TIMES 8784
+#define BIG_REQUESTS 40
+
+static uint32_t test_mesh_ids[NUM_TEST_MESHES];
+
+static int32_t expected_value(int mesh, int t) {
+    return 100 * (mesh + 1) + t;
+}
+
+static int create_test_file(void) {
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    if (h5mobaku_create(TEST_H5_FILE, &config, &ctx) != 0) return -1;
+
+    cmph_t *hash = meshid_prepare_search();
+    if (!hash) {
+        h5mobaku_close(ctx);
+        return -1;
+    }
+
+    // Meshes from different chunks so multi-mesh reads span several blocks
+    const size_t picks[NUM_TEST_MESHES] = {17, 4242, 1000003};
+    for (int m = 0; m < NUM_TEST_MESHES; m++) {
+        test_mesh_ids[m] = meshid_list[picks[m]];
+        uint64_t col = meshid_search_id(hash, test_mesh_ids[m]);
+        for (int t = 0; t < NUM_TEST_TIMES; t++) {
+            if (h5r_write_cell(ctx->h5r_ctx, (uint64_t)t, col, expected_value(m, t)) < 0) {
+                cmph_destroy(hash);
+                h5mobaku_close(ctx);
+                return -1;
+            }
+        }
+    }
+
+    cmph_destroy(hash);
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+    return 0;
+}
+
+static pid_t start_server(void) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        execl("./h5m-serve", "h5m-serve", "-f", TEST_H5_FILE, "-s", TEST_SOCKET, "-j", "2", "-q", "4", "-T", "1",
+              (char*)NULL);
+        perror("execl");
+        _exit(127);
+    }
+    return pid;
+}
+
+static int connect_server(void) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    strcpy(addr.sun_path, TEST_SOCKET);
+
+    // The server needs a moment to open the file and bind
+    for (int attempt = 0; attempt < 100; attempt++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) return fd;
+        close(fd);
+        usleep(100000);
+    }
+    return -1;
+}
+
+static void read_exact(int fd, void *buf, size_t len) {
+    size_t got = 0;
+    while (got < len) {
+        ssize_t n = read(fd, (uint8_t*)buf + got, len - got);
+        assert(n > 0);
+        got += (size_t)n;
+    }
+}
+
+static void send_request(int fd, uint16_t op, uint32_t request_id,
+                         const void *fixed, size_t fixed_len, const uint32_t *ids, uint32_t num_ids) {
+    h5m_frame_header_t hdr = {
+        .magic = H5M_REQUEST_MAGIC,
+        .version = H5M_PROTOCOL_VERSION,
+        .code = op,
+        .request_id = request_id,
+        .payload_len = (uint32_t)(fixed_len + num_ids * sizeof(uint32_t)),
+    };
+    assert(write(fd, &hdr, sizeof(hdr)) == (ssize_t)sizeof(hdr));
+    if (fixed_len) assert(write(fd, fixed, fixed_len) == (ssize_t)fixed_len);
+    if (num_ids) assert(write(fd, ids, num_ids * sizeof(uint32_t)) == (ssize_t)(num_ids * sizeof(uint32_t)));
+}
+
+// Receive one response; the payload is returned malloc'ed (or NULL when empty)
+static uint16_t recv_response(int fd, uint32_t *request_id, void **payload, uint32_t *payload_len) {
+    h5m_frame_header_t hdr;
+    read_exact(fd, &hdr, sizeof(hdr));
+    assert(hdr.magic == H5M_RESPONSE_MAGIC);
+    assert(hdr.version == H5M_PROTOCOL_VERSION);
+    *request_id = hdr.request_id;
+    *payload_len = hdr.payload_len;
+    *payload = NULL;
+    if (hdr.payload_len) {
+        *payload = malloc(hdr.payload_len);
+        assert(*payload != NULL);
+        read_exact(fd, *payload, hdr.payload_len);
+    }
+    return hdr.code;
+}
+
+static void test_queries(int fd) {
+    uint32_t rid, len;
+    void *payload;
+
+    printf("Testing ping and info...\n");
+    send_request(fd, H5M_OP_PING, 1, NULL, 0, NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+    assert(rid == 1 && len == 0);
+
+    h5m_req_info_t info_req = {.slot = 0};
+    send_request(fd, H5M_OP_INFO, 2, &info_req, sizeof(info_req), NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+    assert(rid == 2 && len == sizeof(h5m_resp_info_t));
+    h5m_resp_info_t *info = payload;
+    assert(info->time_points == MOBAKU_TIME_POINTS);
+    assert(info->mesh_count == MOBAKU_MESH_COUNT);
+    assert(info->num_slots == 1);
+    free(payload);
+
+    printf("Testing single query...\n");
+    h5m_req_single_t single = {.slot = 0, .time_index = 5, .mesh_id = test_mesh_ids[1]};
+    send_request(fd, H5M_OP_SINGLE, 3, &single, sizeof(single), NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+    assert(rid == 3 && len == sizeof(int32_t));
+    assert(*(int32_t*)payload == expected_value(1, 5));
+    free(payload);
+
+    printf("Testing multi query...\n");
+    h5m_req_multi_t multi = {.slot = 0, .time_index = 7, .num_meshes = NUM_TEST_MESHES};
+    send_request(fd, H5M_OP_MULTI, 4, &multi, sizeof(multi), test_mesh_ids, NUM_TEST_MESHES);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+    assert(rid == 4 && len == NUM_TEST_MESHES * sizeof(int32_t));
+    for (int m = 0; m < NUM_TEST_MESHES; m++) {
+        assert(((int32_t*)payload)[m] == expected_value(m, 7));
+    }
+    free(payload);
+
+    printf("Testing series query...\n");
+    h5m_req_series_t series = {.slot = 0, .start_time_index = 10, .end_time_index = 20, .mesh_id = test_mesh_ids[2]};
+    send_request(fd, H5M_OP_SERIES, 5, &series, sizeof(series), NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+    assert(rid == 5 && len == 11 * sizeof(int32_t));
+    for (int t = 0; t < 11; t++) {
+        assert(((int32_t*)payload)[t] == expected_value(2, 10 + t));
+    }
+    free(payload);
+
+    printf("Testing pipelined multi-series and aggregate queries...\n");
+    h5m_req_multi_series_t ms = {.slot = 0, .start_time_index = 0, .end_time_index = NUM_TEST_TIMES - 1,
+                                 .num_meshes = NUM_TEST_MESHES};
+    h5m_req_aggregate_t agg = {.slot = 0, .agg = H5M_AGG_SUM, .start_time_index = 0,
+                               .end_time_index = NUM_TEST_TIMES - 1, .num_meshes = NUM_TEST_MESHES};
+    send_request(fd, H5M_OP_MULTI_SERIES, 6, &ms, sizeof(ms), test_mesh_ids, NUM_TEST_MESHES);
+    send_request(fd, H5M_OP_AGGREGATE, 7, &agg, sizeof(agg), test_mesh_ids, NUM_TEST_MESHES);
+
+    // Responses may arrive in any order
+    for (int i = 0; i < 2; i++) {
+        assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_OK);
+        if (rid == 6) {
+            assert(len == NUM_TEST_TIMES * NUM_TEST_MESHES * sizeof(int32_t));
+            for (int t = 0; t < NUM_TEST_TIMES; t++) {
+                for (int m = 0; m < NUM_TEST_MESHES; m++) {
+                    assert(((int32_t*)payload)[t * NUM_TEST_MESHES + m] == expected_value(m, t));
+                }
+            }
+        } else {
+            assert(rid == 7);
+            assert(len == NUM_TEST_TIMES * sizeof(int64_t));
+            for (int t = 0; t < NUM_TEST_TIMES; t++) {
+                int64_t sum = 0;
+                for (int m = 0; m < NUM_TEST_MESHES; m++) sum += expected_value(m, t);
+                assert(((int64_t*)payload)[t] == sum);
+            }
+        }
+        free(payload);
+    }
+
+    printf("Testing error statuses...\n");
+    h5m_req_single_t bad_slot = {.slot = 3, .time_index = 0, .mesh_id = test_mesh_ids[0]};
+    send_request(fd, H5M_OP_SINGLE, 8, &bad_slot, sizeof(bad_slot), NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_BAD_SLOT);
+    assert(rid == 8 && len == 0);
+
+    h5m_req_single_t bad_time = {.slot = 0, .time_index = MOBAKU_TIME_POINTS, .mesh_id = test_mesh_ids[0]};
+    send_request(fd, H5M_OP_SINGLE, 9, &bad_time, sizeof(bad_time), NULL, 0);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_READ_ERROR);
+
+    h5m_req_multi_t truncated = {.slot = 0, .time_index = 0, .num_meshes = 5};
+    send_request(fd, H5M_OP_MULTI, 10, &truncated, sizeof(truncated), test_mesh_ids, 1);
+    assert(recv_response(fd, &rid, &payload, &len) == H5M_STATUS_BAD_REQUEST);
+    assert(rid == 10);
+
+    printf("Query tests passed\n");
+}
+
+// Pipeline year-long multi-series requests, far more than the socket buffers hold
+static void send_big_requests(int fd) {
+    const h5m_req_multi_series_t big = {.slot = 0, .start_time_index = 0, .end_time_index = BIG_TIMES - 1,
+                                        .num_meshes = NUM_TEST_MESHES};
+    for (uint32_t i = 0; i < BIG_REQUESTS; i++) {
+        send_request(fd, H5M_OP_MULTI_SERIES, 100 + i, &big, sizeof(big), test_mesh_ids, NUM_TEST_MESHES);
+    }
+}
+
+static void test_unread_responses(void) {
+    printf("Testing clients that leave responses unread...\n");
+    uint32_t rid, len;
+    void *payload;
+
+    // Responses pile up for a client that is not reading; the workers must stay free for others
+    int slow = connect_server();
+    assert(slow >= 0);
+    send_big_requests(slow);
+    usleep(200000);
+    int other = connect_server();
+    assert(other >= 0);
+    send_request(other, H5M_OP_PING, 1, NULL, 0, NULL, 0);
+    assert(recv_response(other, &rid, &payload, &len) == H5M_STATUS_OK && rid == 1);
+    close(other);
+
+    // Reading now gets every response, with the in-flight cap (-q 4) pausing and resuming the stream
+    int seen[BIG_REQUESTS] = {0};
+    for (int i = 0; i < BIG_REQUESTS; i++) {
+        assert(recv_response(slow, &rid, &payload, &len) == H5M_STATUS_OK);
+        assert(rid >= 100 && rid < 100 + BIG_REQUESTS && !seen[rid - 100]);
+        seen[rid - 100] = 1;
+        assert(len == BIG_TIMES * NUM_TEST_MESHES * sizeof(int32_t));
+        assert(((int32_t*)payload)[5 * NUM_TEST_MESHES + 2] == expected_value(2, 5));
+        free(payload);
+    }
+    close(slow);
+
+    // A client that never reads is dropped after the send timeout (-T 1)
+    int stalled = connect_server();
+    assert(stalled >= 0);
+    send_big_requests(stalled);
+    sleep(3);
+    size_t total = 0;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(stalled, buf, sizeof(buf))) > 0) total += (size_t)n;
+    assert(n == 0 || n < 0);
+    assert(total < (size_t)BIG_REQUESTS * (sizeof(h5m_frame_header_t) + BIG_TIMES * NUM_TEST_MESHES * sizeof(int32_t)));
+    close(stalled);
+
+    printf("Unread response tests passed\n");
+}
+
+int main(void) {
+    printf("Running h5m-serve tests...\n\n");
+
+    assert(create_test_file() == 0);
+
+    pid_t pid = start_server();
+    assert(pid > 0);
+
+    int fd = connect_server();
+    assert(fd >= 0);
+
+    test_queries(fd);
+    close(fd);
+    test_unread_responses();
+
+    // Server shuts down cleanly on SIGTERM and removes its socket
+    kill(pid, SIGTERM);
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    assert(access(TEST_SOCKET, F_OK) != 0);
+
+    unlink(TEST_H5_FILE);
+    printf("\nAll h5m-serve tests passed!\n");
+    return 0;
+}
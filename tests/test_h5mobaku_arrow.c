@@ -0,0 +1,130 @@
+//
+// Test for Arrow C Data Interface export of h5mobaku query results
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "h5mobaku_arrow.h"
+
+#define NUM_TIMES 3
+#define NUM_MESHES 2
+
+static int32_t *make_result(void) {
+    int32_t *data = malloc(NUM_TIMES * NUM_MESHES * sizeof(int32_t));
+    assert(data != NULL);
+    for (int t = 0; t < NUM_TIMES; t++) {
+        for (int m = 0; m < NUM_MESHES; m++) {
+            data[t * NUM_MESHES + m] = t * 100 + m;
+        }
+    }
+    return data;
+}
+
+static void test_plain_export(void) {
+    printf("Testing plain export...\n");
+
+    const uint32_t mesh_ids[NUM_MESHES] = {362257341, 533946395};
+    const time_t start = 1451574000; // 2016-01-01 00:00:00 JST
+    int32_t *data = make_result();
+
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    int ret = h5mobaku_arrow_export_time_mesh(data, mesh_ids, NUM_MESHES, 10, NUM_TIMES, start,
+                                              0, &array, &schema);
+    assert(ret == 0);
+
+    assert(strcmp(schema.format, "+s") == 0);
+    assert(schema.n_children == 3);
+    assert(strcmp(schema.children[0]->format, "I") == 0);
+    assert(strcmp(schema.children[0]->name, "mesh_id") == 0);
+    assert(schema.children[0]->dictionary == NULL);
+    assert(strcmp(schema.children[1]->format, "tss:Asia/Tokyo") == 0);
+    assert(strcmp(schema.children[2]->format, "i") == 0);
+    assert(strcmp(schema.children[2]->name, "population") == 0);
+
+    assert(array.length == NUM_TIMES * NUM_MESHES);
+    assert(array.n_children == 3);
+
+    const uint32_t *ids = array.children[0]->buffers[1];
+    const int64_t *ts = array.children[1]->buffers[1];
+    const int32_t *pop = array.children[2]->buffers[1];
+
+    // Population buffer is handed over without a copy
+    assert(pop == data);
+    for (int t = 0; t < NUM_TIMES; t++) {
+        for (int m = 0; m < NUM_MESHES; m++) {
+            int row = t * NUM_MESHES + m;
+            assert(ids[row] == mesh_ids[m]);
+            assert(ts[row] == (int64_t)start + (10 + t) * 3600);
+            assert(pop[row] == t * 100 + m);
+        }
+    }
+
+    array.release(&array);
+    schema.release(&schema);
+    assert(array.release == NULL);
+    assert(schema.release == NULL);
+
+    printf("Plain export test passed\n");
+}
+
+static void test_dictionary_export(void) {
+    printf("Testing dictionary-encoded export...\n");
+
+    const uint32_t mesh_ids[NUM_MESHES] = {362257341, 533946395};
+    int32_t *data = make_result();
+
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+    int ret = h5mobaku_arrow_export_time_mesh(data, mesh_ids, NUM_MESHES, 0, NUM_TIMES, 0,
+                                              H5MOBAKU_ARROW_DICT_MESH_IDS, &array, &schema);
+    assert(ret == 0);
+
+    assert(strcmp(schema.children[0]->format, "i") == 0);
+    assert(schema.children[0]->dictionary != NULL);
+    assert(strcmp(schema.children[0]->dictionary->format, "I") == 0);
+
+    const struct ArrowArray *mesh_col = array.children[0];
+    assert(mesh_col->dictionary != NULL);
+    assert(mesh_col->dictionary->length == NUM_MESHES);
+
+    const int32_t *indices = mesh_col->buffers[1];
+    const uint32_t *dict = mesh_col->dictionary->buffers[1];
+    for (int row = 0; row < NUM_TIMES * NUM_MESHES; row++) {
+        assert(dict[indices[row]] == mesh_ids[row % NUM_MESHES]);
+    }
+
+    array.release(&array);
+    schema.release(&schema);
+
+    printf("Dictionary export test passed\n");
+}
+
+static void test_invalid_params(void) {
+    printf("Testing invalid parameters...\n");
+
+    const uint32_t mesh_ids[1] = {362257341};
+    int32_t value = 0;
+    struct ArrowArray array;
+    struct ArrowSchema schema;
+
+    assert(h5mobaku_arrow_export_time_mesh(NULL, mesh_ids, 1, 0, 1, 0, 0, &array, &schema) == -1);
+    assert(h5mobaku_arrow_export_time_mesh(&value, NULL, 1, 0, 1, 0, 0, &array, &schema) == -1);
+    assert(h5mobaku_arrow_export_time_mesh(&value, mesh_ids, 0, 0, 1, 0, 0, &array, &schema) == -1);
+    assert(h5mobaku_arrow_export_time_mesh(&value, mesh_ids, 1, -1, 1, 0, 0, &array, &schema) == -1);
+
+    printf("Invalid parameters test passed\n");
+}
+
+int main(void) {
+    printf("Running h5mobaku Arrow export tests...\n\n");
+
+    test_plain_export();
+    test_dictionary_export();
+    test_invalid_params();
+
+    printf("\nAll Arrow export tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,220 @@
+//
+// Test for hour-of-week baselines and anomaly scoring against a direct computation
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <assert.h>
+#include "h5mobaku_baseline.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "test_fixture.h"
+
+#define TEST_H5_FILE "test_h5mobaku_baseline.h5"
+#define NUM_TEST_MESHES 1500
+#define NUM_TEST_HOURS (5 * 168 + 30)
+#define TEST_SLOT0 96   // 2016-01-01 00:00 is a Friday
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+static int32_t test_values[NUM_TEST_HOURS][NUM_TEST_MESHES];
+
+static void create_test_file(cmph_t *hash) {
+    for (int m = 0; m < NUM_TEST_MESHES; m++) test_meshes[m] = meshid_list[1000 + m];
+    srand(11);
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        const int hour_of_day = h % 24;
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            // Daily shape scaled per mesh, noise, and one spike at mesh 7
+            test_values[h][m] = (m % 50 + 1) * (hour_of_day < 8 ? 10 : 40) + rand() % 30;
+        }
+    }
+    test_values[NUM_TEST_HOURS - 5][7] += 5000;
+
+    write_test_file(TEST_H5_FILE, hash, test_meshes, NUM_TEST_MESHES, &test_values[0][0], NUM_TEST_HOURS, 64, 4);
+}
+
+static int compare_double(const void *a, const void *b) {
+    const double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *v, size_t n) {
+    qsort(v, n, sizeof(double), compare_double);
+    return n % 2 ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
+
+// Direct profile of mesh m at hour-of-week slot over hours start..end
+static void expected_profile(h5mobaku_baseline_method_t method, int start, int end, int slot, int m,
+                             double *center, double *spread) {
+    double samples[64];
+    size_t n = 0;
+    for (int t = start; t <= end; t++) {
+        if ((t + TEST_SLOT0) % 168 == slot) samples[n++] = test_values[t][m];
+    }
+    assert(n > 0);
+    if (method == H5MOBAKU_BASELINE_MEAN) {
+        double sum = 0.0, sq = 0.0;
+        for (size_t i = 0; i < n; i++) sum += samples[i];
+        *center = sum / n;
+        for (size_t i = 0; i < n; i++) sq += (samples[i] - *center) * (samples[i] - *center);
+        *spread = sqrt(sq / n);
+        return;
+    }
+    *center = median(samples, n);
+    for (size_t i = 0; i < n; i++) samples[i] = fabs(samples[i] - *center);
+    *spread = 1.4826 * median(samples, n);
+}
+
+static int near(double got, double want) {
+    return fabs(got - want) <= 1e-4 * (1.0 + fabs(want));
+}
+
+static void check_scores(cmph_t *hash, struct h5mobaku *ctx, h5mobaku_baseline_method_t method, int start, int end) {
+    const int picks[] = {7, 0, 1499, 7, 250, 1024};
+    const size_t np = sizeof(picks) / sizeof(picks[0]);
+    uint32_t meshes[sizeof(picks) / sizeof(picks[0])];
+    for (size_t i = 0; i < np; i++) meshes[i] = test_meshes[picks[i]];
+
+    const int t0 = NUM_TEST_HOURS - 60, t1 = NUM_TEST_HOURS - 1;
+    h5mobaku_anomaly_spec_t spec = H5MOBAKU_ANOMALY_DEFAULT_SPEC;
+    for (int score = 0; score < 2; score++) {
+        spec.score = score ? H5MOBAKU_SCORE_RATIO : H5MOBAKU_SCORE_Z;
+        double *data = h5mobaku_read_anomaly(ctx->h5r_ctx, hash, meshes, np, t0, t1, &spec);
+        assert(data != NULL);
+        for (int t = t0; t <= t1; t++) {
+            for (size_t i = 0; i < np; i++) {
+                double c, s;
+                expected_profile(method, start, end, (t + TEST_SLOT0) % 168, picks[i], &c, &s);
+                const double x = test_values[t][picks[i]];
+                const double want = score ? x / fmax(c, 1.0) : (x - c) / fmax(s, 1.0);
+                assert(near(data[(size_t)(t - t0) * np + i], want));
+            }
+        }
+        // The planted spike stands out
+        if (!score) assert(data[(size_t)(NUM_TEST_HOURS - 5 - t0) * np] > 20.0);
+        free(data);
+    }
+
+    // Every column, cut into mesh strips and hour bands, matches the mesh-set result
+    spec.score = H5MOBAKU_SCORE_Z;
+    spec.band_cells = 100000;
+    double *all = h5mobaku_read_anomaly(ctx->h5r_ctx, NULL, NULL, 0, t0, t1, &spec);
+    assert(all != NULL);
+    for (int t = t0; t <= t1; t += 7) {
+        for (int m = 0; m < NUM_TEST_MESHES; m += 37) {
+            double c, s;
+            expected_profile(method, start, end, (t + TEST_SLOT0) % 168, m, &c, &s);
+            assert(near(all[(size_t)(t - t0) * NUM_TEST_MESHES + m], (test_values[t][m] - c) / fmax(s, 1.0)));
+        }
+    }
+    free(all);
+}
+
+static void test_build_and_score(cmph_t *hash) {
+    printf("Testing baseline build and scoring...\n");
+
+    const h5mobaku_baseline_method_t methods[] = {H5MOBAKU_BASELINE_MEDIAN, H5MOBAKU_BASELINE_MEAN};
+    for (int k = 0; k < 2; k++) {
+        // Three weeks ending at hour 3 * 168 + 10
+        struct h5mobaku *rw = NULL;
+        assert(h5mobaku_open_readwrite(TEST_H5_FILE, &rw) == 0);
+        h5mobaku_baseline_spec_t spec = H5MOBAKU_BASELINE_DEFAULT_SPEC;
+        spec.method = methods[k];
+        spec.weeks = 3;
+        spec.end_time = 3 * 168 + 10;
+        assert(h5mobaku_build_baseline(rw, &spec) == 0);
+        h5mobaku_close(rw);
+
+        struct h5mobaku *ctx = NULL;
+        assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+        h5r_baseline_info_t info;
+        assert(h5mobaku_baseline_info(ctx->h5r_ctx, &info) == 0);
+        assert(info.start == 11 && info.end == 3 * 168 + 10 && info.slot0 == TEST_SLOT0 && info.method == methods[k]);
+        check_scores(hash, ctx, methods[k], (int)info.start, (int)info.end);
+        h5mobaku_close(ctx);
+    }
+
+    // Asking for more weeks than the file holds uses the whole weeks available
+    struct h5mobaku *rw = NULL;
+    assert(h5mobaku_open_readwrite(TEST_H5_FILE, &rw) == 0);
+    h5mobaku_baseline_spec_t spec = H5MOBAKU_BASELINE_DEFAULT_SPEC;
+    spec.weeks = 52;
+    assert(h5mobaku_build_baseline(rw, &spec) == 0);
+    h5r_baseline_info_t info;
+    assert(h5mobaku_baseline_info(rw->h5r_ctx, &info) == 0);
+    assert(info.end == NUM_TEST_HOURS - 1 && info.start == NUM_TEST_HOURS - 5 * 168);
+
+    // Less than a week of history
+    spec.end_time = 100;
+    assert(h5mobaku_build_baseline(rw, &spec) != 0);
+    h5mobaku_close(rw);
+
+    printf("Baseline build and scoring test passed\n");
+}
+
+typedef struct {
+    int next_time;
+    size_t calls;
+} stream_check_t;
+
+static int check_sink(void *user, int first_time, size_t num_times, size_t first_mesh, size_t num_meshes,
+                      const double *scores) {
+    stream_check_t *check = user;
+    assert(first_time == check->next_time && first_mesh == 0 && num_meshes == 2);
+    for (size_t i = 0; i < num_times * num_meshes; i++) assert(isfinite(scores[i]));
+    check->next_time += (int)num_times;
+    return ++check->calls == 2;   // Stop after two bands
+}
+
+static void test_stream(cmph_t *hash) {
+    printf("Testing anomaly stream...\n");
+
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    h5mobaku_anomaly_spec_t spec = H5MOBAKU_ANOMALY_DEFAULT_SPEC;
+    spec.band_cells = 20;   // Ten hours of two meshes
+    stream_check_t check = {.next_time = 200};
+    assert(h5mobaku_anomaly_stream(ctx->h5r_ctx, hash, test_meshes, 2, 200, 400, &spec, check_sink, &check) != 0);
+    assert(check.calls == 2 && check.next_time == 220);
+
+    // Invalid requests
+    spec.min_divisor = 0.0;
+    assert(h5mobaku_read_anomaly(ctx->h5r_ctx, hash, test_meshes, 2, 0, 10, &spec) == NULL);
+    spec.min_divisor = 1.0;
+    assert(h5mobaku_read_anomaly(ctx->h5r_ctx, hash, test_meshes, 2, 0, NUM_TEST_HOURS, &spec) == NULL);
+    h5mobaku_close(ctx);
+
+    h5mobaku_baseline_method_t method;
+    h5mobaku_score_t score;
+    assert(h5mobaku_parse_baseline_method("mean", &method) == 0 && method == H5MOBAKU_BASELINE_MEAN);
+    assert(h5mobaku_parse_score("ratio", &score) == 0 && score == H5MOBAKU_SCORE_RATIO);
+    assert(h5mobaku_parse_score("mad", &score) != 0);
+
+    printf("Anomaly stream test passed\n");
+}
+
+int main(void) {
+    printf("Running baseline tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    create_test_file(hash);
+
+    // Scoring needs a baseline first
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    h5mobaku_anomaly_spec_t spec = H5MOBAKU_ANOMALY_DEFAULT_SPEC;
+    assert(h5mobaku_read_anomaly(ctx->h5r_ctx, hash, test_meshes, 1, 0, 10, &spec) == NULL);
+    h5mobaku_close(ctx);
+
+    test_build_and_score(hash);
+    test_stream(hash);
+
+    unlink(TEST_H5_FILE);
+    cmph_destroy(hash);
+    printf("\nAll baseline tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+//
+// Test for the demographic breakdown dataset
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include "h5mobaku_ops.h"
+#include "h5mobaku_breakdown.h"
+#include "csv_to_h5_converter.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5mobaku_breakdown.h5"
+#define TEST_CSV_FILE "test_h5mobaku_breakdown_00000.csv"
+#define NUM_TEST_MESHES 8
+#define NUM_TEST_TIMES 48
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+
+static const h5mobaku_category_t male_20 = {-1, 20, 1};
+static const h5mobaku_category_t female_20 = {-1, 20, 2};
+static const h5mobaku_category_t tokyo = {13, -1, -1};
+
+static void create_subset_file(void) {
+    for (int i = 0; i < NUM_TEST_MESHES; i++) test_meshes[i] = meshid_list[700 + i];
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    config.initial_time_points = NUM_TEST_TIMES;
+    assert(h5mobaku_create_with_meshes(TEST_H5_FILE, &config, test_meshes, NUM_TEST_MESHES, &ctx) == 0);
+    h5mobaku_close(ctx);
+}
+
+static void test_module_roundtrip(void) {
+    printf("Testing breakdown dataset roundtrip...\n");
+    create_subset_file();
+    assert(h5mobaku_breakdown_exists(TEST_H5_FILE) == 0);
+
+    h5mobaku_breakdown_t *bd = NULL;
+    h5mobaku_breakdown_config_t config = H5MOBAKU_BREAKDOWN_DEFAULT_CONFIG;
+    config.chunk_time_size = 24;
+    assert(h5mobaku_breakdown_open(TEST_H5_FILE, 1, &config, &bd) == 0);
+
+    size_t time_points = 0, mesh_count = 0;
+    h5mobaku_breakdown_get_dimensions(bd, &time_points, &mesh_count);
+    assert(time_points == 0 && mesh_count == NUM_TEST_MESHES);
+
+    assert(h5mobaku_breakdown_add_category(bd, male_20) == 0);
+    assert(h5mobaku_breakdown_add_category(bd, female_20) == 1);
+    assert(h5mobaku_breakdown_add_category(bd, male_20) == 0);
+    assert(h5mobaku_breakdown_find_category(bd, tokyo) == -1);
+
+    // Hours 10..39 of mesh 3 cross a chunk boundary
+    int32_t values[30 * 2];
+    for (int t = 0; t < 30; t++) {
+        values[t * 2] = 100 + t;
+        values[t * 2 + 1] = 200 + t;
+    }
+    assert(h5mobaku_breakdown_write(bd, 3, 10, 30, values) == 0);
+
+    // A category added later reads as 0 where nothing was stored
+    assert(h5mobaku_breakdown_add_category(bd, tokyo) == 2);
+    h5mobaku_breakdown_close(bd);
+
+    assert(h5mobaku_breakdown_exists(TEST_H5_FILE) == 1);
+    assert(h5mobaku_breakdown_open(TEST_H5_FILE, 0, NULL, &bd) == 0);
+    size_t ncat = 0;
+    const h5mobaku_category_t *cats = h5mobaku_breakdown_categories(bd, &ncat);
+    assert(ncat == 3);
+    assert(cats[1].age == 20 && cats[1].gender == 2 && cats[2].residence == 13);
+
+    int32_t read_back[50 * 3];
+    assert(h5mobaku_breakdown_read(bd, 3, 0, 50, read_back) == 0);
+    for (int t = 0; t < 50; t++) {
+        const int in_range = t >= 10 && t < 40;
+        assert(read_back[t * 3] == (in_range ? 100 + t - 10 : 0));
+        assert(read_back[t * 3 + 1] == (in_range ? 200 + t - 10 : 0));
+        assert(read_back[t * 3 + 2] == 0);
+    }
+    assert(h5mobaku_breakdown_read(bd, 2, 10, 1, read_back) == 0);
+    assert(read_back[0] == 0 && read_back[1] == 0);
+    assert(h5mobaku_breakdown_add_category(bd, (h5mobaku_category_t){1, 1, 1}) == -1);
+    h5mobaku_breakdown_close(bd);
+
+    unlink(TEST_H5_FILE);
+    printf("Breakdown dataset roundtrip test passed\n");
+}
+
+static void write_breakdown_csv(void) {
+    FILE *fp = fopen(TEST_CSV_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0500,%u,-1,-1,-1,70\n", test_meshes[1]);
+    fprintf(fp, "20160101,0500,%u,-1,20,1,30\n", test_meshes[1]);
+    fprintf(fp, "20160101,0500,%u,-1,20,2,40\n", test_meshes[1]);
+    fprintf(fp, "20160101,0600,%u,-1,20,2,45\n", test_meshes[1]);
+    fprintf(fp, "20160101,0500,%u,13,-1,-1,12\n", test_meshes[5]);
+    fprintf(fp, "20161231,2300,%u,-1,20,1,9\n", test_meshes[5]);
+    fclose(fp);
+}
+
+static void check_converted(cmph_t *hash) {
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+
+    size_t ncat = 0;
+    const h5mobaku_category_t *cats = h5mobaku_get_breakdown_categories(ctx, &ncat);
+    assert(cats != NULL && ncat == 3);
+
+    // Totals are unaffected: the last row for the cell wins as before
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, test_meshes[1], 6) == 45);
+
+    size_t series_ncat = 0;
+    int32_t *series = h5mobaku_read_breakdown_time_series(ctx, hash, test_meshes[1], 4, 6, &series_ncat);
+    assert(series != NULL && series_ncat == ncat);
+    int m20 = -1, f20 = -1, tk = -1;
+    for (size_t c = 0; c < ncat; c++) {
+        if (cats[c].gender == 1) m20 = (int)c;
+        if (cats[c].gender == 2) f20 = (int)c;
+        if (cats[c].residence == 13) tk = (int)c;
+    }
+    assert(m20 >= 0 && f20 >= 0 && tk >= 0);
+    assert(series[0 * ncat + m20] == 0);
+    assert(series[1 * ncat + m20] == 30);
+    assert(series[1 * ncat + f20] == 40);
+    assert(series[2 * ncat + f20] == 45);
+    assert(series[1 * ncat + tk] == 0);
+    h5mobaku_free_data(series);
+
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[5], 5, tokyo) == 12);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[5], 8783, male_20) == 9);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[5], 5, (h5mobaku_category_t){1, 2, 3}) == -1);
+    h5mobaku_close(ctx);
+}
+
+static void test_converter_breakdown(cmph_t *hash) {
+    printf("Testing breakdown rows during conversion...\n");
+    write_breakdown_csv();
+
+    for (int bulk = 0; bulk <= 1; bulk++) {
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = TEST_H5_FILE;
+        config.mesh_ids = test_meshes;
+        config.num_meshes = NUM_TEST_MESHES;
+        config.use_bulk_write = bulk;
+        config.store_breakdown = 1;
+        csv_to_h5_stats_t stats;
+        assert(csv_to_h5_convert_file(TEST_CSV_FILE, &config, &stats) == 0);
+        assert(stats.errors == 0);
+        check_converted(hash);
+    }
+
+    // Appending replaces stored categories it covers and keeps the rest
+    FILE *fp = fopen(TEST_CSV_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0500,%u,-1,20,1,31\n", test_meshes[1]);
+    fclose(fp);
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = TEST_H5_FILE;
+    config.create_new = 0;
+    config.store_breakdown = 1;
+    assert(csv_to_h5_convert_file(TEST_CSV_FILE, &config, NULL) == 0);
+
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, male_20) == 31);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, female_20) == 40);
+    h5mobaku_close(ctx);
+
+    unlink(TEST_CSV_FILE);
+    unlink(TEST_H5_FILE);
+    printf("Breakdown conversion test passed\n");
+}
+
+static void test_staged_breakdown(cmph_t *hash) {
+    printf("Testing breakdown rows written per bulk stage...\n");
+
+    // Two year stages; the 2017 file carries a 2016 row for a cell the 2016 stage already wrote
+    const char *files[] = {"test_breakdown_2016_00000.csv", "test_breakdown_2017_00000.csv"};
+    FILE *fp = fopen(files[0], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0500,%u,-1,20,1,30\n", test_meshes[1]);
+    fprintf(fp, "20160101,0500,%u,-1,20,2,40\n", test_meshes[1]);
+    fclose(fp);
+    fp = fopen(files[1], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20170101,0000,%u,-1,20,1,50\n", test_meshes[2]);
+    fprintf(fp, "20160101,0500,%u,-1,20,1,3\n", test_meshes[1]);
+    fclose(fp);
+
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = TEST_H5_FILE;
+    config.mesh_ids = test_meshes;
+    config.num_meshes = NUM_TEST_MESHES;
+    config.use_bulk_write = 1;
+    config.store_breakdown = 1;
+    config.merge_policy = CSV_TO_H5_MERGE_SUM;
+    assert(csv_to_h5_convert_files(files, 2, &config, NULL) == 0);
+
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, male_20) == 33);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, female_20) == 40);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[2], 8784, male_20) == 50);
+    h5mobaku_close(ctx);
+
+    // Appending with sum replaces a stored cell rather than adding to it, however the rows are flushed
+    fp = fopen(files[0], "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fprintf(fp, "20160101,0500,%u,-1,20,1,4\n", test_meshes[1]);
+    fprintf(fp, "20160101,0500,%u,-1,20,1,5\n", test_meshes[1]);
+    fclose(fp);
+    config.create_new = 0;
+    config.use_bulk_write = 0;
+    assert(csv_to_h5_convert_files(files, 1, &config, NULL) == 0);
+
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, male_20) == 9);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 5, female_20) == 40);
+    h5mobaku_close(ctx);
+
+    for (int i = 0; i < 2; i++) unlink(files[i]);
+    unlink(TEST_H5_FILE);
+    printf("Staged breakdown test passed\n");
+}
+
+int main(void) {
+    printf("Running breakdown tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+
+    test_module_roundtrip();
+    test_converter_breakdown(hash);
+    test_staged_breakdown(hash);
+
+    cmph_destroy(hash);
+    printf("\nAll breakdown tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,133 @@
+//
+// Test for single-open metadata collection and the metadata cache
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <utime.h>
+#include <sys/stat.h>
+#include <hdf5.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5mobaku_open.h5"
+#define TEST_CACHE_FILE "test_h5mobaku_open.cache"
+#define TEST_MESH_PICK 4242
+
+static uint32_t test_mesh_id;
+
+static int create_test_file(void) {
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    if (h5mobaku_create(TEST_H5_FILE, &config, &ctx) != 0) return -1;
+
+    cmph_t *hash = meshid_prepare_search();
+    if (!hash) {
+        h5mobaku_close(ctx);
+        return -1;
+    }
+    test_mesh_id = meshid_list[TEST_MESH_PICK];
+    int ret = h5mobaku_write_population_single(ctx->h5r_ctx, hash, test_mesh_id, 5, 4321);
+    cmph_destroy(hash);
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+    return ret;
+}
+
+static off_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+static void test_metadata(void) {
+    printf("Testing metadata collected at open...\n");
+
+    struct h5r *h5r_ctx = NULL;
+    assert(h5r_open(TEST_H5_FILE, &h5r_ctx) == 0);
+
+    h5r_metadata_t meta;
+    assert(h5r_get_metadata(h5r_ctx, &meta) == 0);
+    assert(meta.rows == MOBAKU_TIME_POINTS);
+    assert(meta.cols == MOBAKU_MESH_COUNT);
+    assert(meta.crows == 8784);
+    assert(meta.ccols == 16);
+    assert(meta.layout == H5D_CHUNKED);
+    assert(meta.has_meshid_list == 1);
+    assert(strcmp(meta.start_datetime, REFERENCE_MOBAKU_DATETIME) == 0);
+
+    size_t time_points, mesh_count;
+    assert(h5r_get_dimensions(h5r_ctx, &time_points, &mesh_count) == 0);
+    assert(time_points == MOBAKU_TIME_POINTS && mesh_count == MOBAKU_MESH_COUNT);
+
+    h5r_close(h5r_ctx);
+    printf("Metadata test passed\n");
+}
+
+static void open_and_check(const h5mobaku_open_config_t *config, cmph_t *hash) {
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open_with_config(TEST_H5_FILE, config, &ctx) == 0);
+    assert(strcmp(ctx->start_datetime_str, REFERENCE_MOBAKU_DATETIME) == 0);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, test_mesh_id, 5) == 4321);
+    h5mobaku_close(ctx);
+}
+
+static void test_metadata_cache(void) {
+    printf("Testing metadata cache...\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    unlink(TEST_CACHE_FILE);
+
+    h5mobaku_open_config_t config = H5MOBAKU_OPEN_DEFAULT_CONFIG;
+    open_and_check(&config, hash);
+    assert(access(TEST_CACHE_FILE, F_OK) != 0);
+
+    // First open fills the cache, the second is served from it
+    config.metadata_cache = TEST_CACHE_FILE;
+    open_and_check(&config, hash);
+    off_t entry_size = file_size(TEST_CACHE_FILE);
+    assert(entry_size > 0);
+    open_and_check(&config, hash);
+    assert(file_size(TEST_CACHE_FILE) == entry_size);
+
+    // A new mtime invalidates the entry, which is replaced rather than appended to
+    struct stat st;
+    assert(stat(TEST_H5_FILE, &st) == 0);
+    for (int i = 1; i <= 3; i++) {
+        struct utimbuf times = {.actime = st.st_atime, .modtime = st.st_mtime + 10 * i};
+        assert(utime(TEST_H5_FILE, &times) == 0);
+        open_and_check(&config, hash);
+        assert(file_size(TEST_CACHE_FILE) == entry_size);
+        open_and_check(&config, hash);
+        assert(file_size(TEST_CACHE_FILE) == entry_size);
+    }
+
+    // Another data file gets its own entry next to the first one
+    assert(system("cp " TEST_H5_FILE " " TEST_H5_FILE ".copy") == 0);
+    struct h5mobaku *copy = NULL;
+    assert(h5mobaku_open_with_config(TEST_H5_FILE ".copy", &config, &copy) == 0);
+    h5mobaku_close(copy);
+    assert(file_size(TEST_CACHE_FILE) == 2 * entry_size);
+    open_and_check(&config, hash);
+    assert(file_size(TEST_CACHE_FILE) == 2 * entry_size);
+    unlink(TEST_H5_FILE ".copy");
+
+    cmph_destroy(hash);
+    unlink(TEST_CACHE_FILE);
+    printf("Metadata cache test passed\n");
+}
+
+int main(void) {
+    printf("Running h5mobaku open tests...\n\n");
+
+    assert(create_test_file() == 0);
+    test_metadata();
+    test_metadata_cache();
+
+    unlink(TEST_H5_FILE);
+    printf("\nAll h5mobaku open tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,127 @@
+//
+// Test for period-over-period comparison against a direct computation
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <assert.h>
+#include "h5mobaku_period.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "test_fixture.h"
+
+#define TEST_H5_FILE "test_h5mobaku_period.h5"
+#define NUM_TEST_MESHES 12
+#define NUM_TEST_HOURS 400
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+static int32_t test_values[NUM_TEST_HOURS][NUM_TEST_MESHES];
+
+static void create_test_file(cmph_t *hash) {
+    for (int m = 0; m < NUM_TEST_MESHES; m++) test_meshes[m] = meshid_list[700 + 2 * m];
+    srand(17);
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) test_values[h][m] = rand() % 500;
+    }
+    // Mesh 3 is empty in the first 50 hours
+    for (int h = 0; h < 50; h++) test_values[h][3] = 0;
+
+    write_test_file(TEST_H5_FILE, hash, test_meshes, NUM_TEST_MESHES, &test_values[0][0], NUM_TEST_HOURS, 64, 4);
+}
+
+static double reduce(h5mobaku_window_t w, int m, h5mobaku_reducer_t reducer) {
+    double sum = 0.0, max = test_values[w.start_time][m];
+    for (int t = w.start_time; t <= w.end_time; t++) {
+        sum += test_values[t][m];
+        if (test_values[t][m] > max) max = test_values[t][m];
+    }
+    if (reducer == H5MOBAKU_REDUCE_MAX) return max;
+    return reducer == H5MOBAKU_REDUCE_MEAN ? sum / (w.end_time - w.start_time + 1) : sum;
+}
+
+static void check_change(const h5mobaku_period_change_t *got, h5mobaku_window_t base, h5mobaku_window_t current,
+                         int m, h5mobaku_reducer_t reducer) {
+    const double b = reduce(base, m, reducer), c = reduce(current, m, reducer);
+    assert(fabs(got->base - b) <= 1e-9 * (1.0 + b));
+    assert(fabs(got->current - c) <= 1e-9 * (1.0 + c));
+    assert(fabs(got->delta - (c - b)) <= 1e-9 * (1.0 + fabs(c - b)));
+    if (b == 0.0) assert(isnan(got->ratio));
+    else assert(fabs(got->ratio - c / b) <= 1e-9 * (1.0 + c / b));
+}
+
+static void test_windows(cmph_t *hash, struct h5mobaku *ctx) {
+    printf("Testing period comparison...\n");
+
+    // Meshes in another order and repeated
+    const int picks[] = {9, 3, 0, 3, 11};
+    uint32_t meshes[5];
+    for (int i = 0; i < 5; i++) meshes[i] = test_meshes[picks[i]];
+
+    // Disjoint, reversed, overlapping, touching, identical and nested windows
+    const h5mobaku_window_t pairs[][2] = {
+        {{0, 23}, {300, 323}},
+        {{300, 399}, {10, 60}},
+        {{100, 200}, {150, 260}},
+        {{40, 49}, {50, 59}},
+        {{70, 90}, {70, 90}},
+        {{0, 399}, {120, 130}},
+        {{5, 5}, {399, 399}},
+    };
+    const h5mobaku_reducer_t reducers[] = {H5MOBAKU_REDUCE_SUM, H5MOBAKU_REDUCE_MEAN, H5MOBAKU_REDUCE_MAX};
+    for (size_t p = 0; p < sizeof(pairs) / sizeof(pairs[0]); p++) {
+        for (size_t r = 0; r < 3; r++) {
+            h5mobaku_period_change_t out[5];
+            assert(h5mobaku_compare_periods(ctx->h5r_ctx, hash, meshes, 5, pairs[p][0], pairs[p][1], reducers[r],
+                                            out) == 0);
+            for (int i = 0; i < 5; i++) check_change(&out[i], pairs[p][0], pairs[p][1], picks[i], reducers[r]);
+        }
+    }
+
+    // Every column of the file
+    h5mobaku_period_change_t all[NUM_TEST_MESHES];
+    const h5mobaku_window_t base = {0, 47}, current = {336, 383};
+    assert(h5mobaku_compare_periods(ctx->h5r_ctx, NULL, NULL, 0, base, current, H5MOBAKU_REDUCE_SUM, all) == 0);
+    for (int m = 0; m < NUM_TEST_MESHES; m++) check_change(&all[m], base, current, m, H5MOBAKU_REDUCE_SUM);
+    assert(isnan(all[3].ratio));
+
+    printf("Period comparison test passed\n");
+}
+
+static void test_invalid(cmph_t *hash, struct h5mobaku *ctx) {
+    printf("Testing invalid period requests...\n");
+
+    h5mobaku_period_change_t out[2];
+    const h5mobaku_window_t ok = {0, 10};
+    assert(h5mobaku_compare_periods(ctx->h5r_ctx, hash, test_meshes, 2, ok, (h5mobaku_window_t){20, 19},
+                                    H5MOBAKU_REDUCE_SUM, out) != 0);
+    assert(h5mobaku_compare_periods(ctx->h5r_ctx, hash, test_meshes, 2, ok, (h5mobaku_window_t){390, NUM_TEST_HOURS},
+                                    H5MOBAKU_REDUCE_SUM, out) != 0);
+    assert(h5mobaku_compare_periods(ctx->h5r_ctx, hash, test_meshes, 2, (h5mobaku_window_t){-1, 3}, ok,
+                                    H5MOBAKU_REDUCE_SUM, out) != 0);
+    const uint32_t unknown[] = {test_meshes[0], meshid_list[5]};
+    assert(h5mobaku_compare_periods(ctx->h5r_ctx, hash, unknown, 2, ok, ok, H5MOBAKU_REDUCE_SUM, out) != 0);
+
+    printf("Invalid period request test passed\n");
+}
+
+int main(void) {
+    printf("Running period comparison tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    create_test_file(hash);
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+
+    test_windows(hash, ctx);
+    test_invalid(hash, ctx);
+
+    h5mobaku_close(ctx);
+    unlink(TEST_H5_FILE);
+    cmph_destroy(hash);
+    printf("\nAll period comparison tests passed!\n");
+    return 0;
+}
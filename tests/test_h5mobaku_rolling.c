@@ -0,0 +1,196 @@
+//
+// Test for rolling-window statistics against a direct computation
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <assert.h>
+#include "h5mobaku_rolling.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "test_fixture.h"
+
+#define TEST_H5_FILE "test_h5mobaku_rolling.h5"
+#define NUM_TEST_MESHES 6
+#define NUM_TEST_HOURS 120
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+static int32_t test_values[NUM_TEST_HOURS][NUM_TEST_MESHES];
+
+static void create_test_file(cmph_t *hash) {
+    for (int m = 0; m < NUM_TEST_MESHES; m++) test_meshes[m] = meshid_list[500 + 3 * m];
+    srand(5);
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) test_values[h][m] = rand() % 1000 - 100;
+    }
+
+    write_test_file(TEST_H5_FILE, hash, test_meshes, NUM_TEST_MESHES, &test_values[0][0], NUM_TEST_HOURS, 16, 4);
+}
+
+// Direct evaluation of one output (m is the position in test_meshes)
+static double expected(const h5mobaku_rolling_spec_t *spec, int start, int t, int m) {
+    const int w = (int)spec->window;
+    if (spec->op == H5MOBAKU_ROLL_EWMA) {
+        int h = start - w + 1 > 0 ? start - w + 1 : 0;
+        double y = test_values[h][m];
+        for (h++; h <= t; h++) y = spec->alpha * test_values[h][m] + (1.0 - spec->alpha) * y;
+        return y;
+    }
+    const int lo = t - w + 1 > 0 ? t - w + 1 : 0;
+    double sum = 0.0, ext = test_values[lo][m];
+    for (int h = lo; h <= t; h++) {
+        sum += test_values[h][m];
+        if (spec->op == H5MOBAKU_ROLL_MIN && test_values[h][m] < ext) ext = test_values[h][m];
+        if (spec->op == H5MOBAKU_ROLL_MAX && test_values[h][m] > ext) ext = test_values[h][m];
+    }
+    switch (spec->op) {
+        case H5MOBAKU_ROLL_SUM: return sum;
+        case H5MOBAKU_ROLL_MEAN: return sum / (t - lo + 1);
+        default: return ext;
+    }
+}
+
+static void test_kernels(cmph_t *hash, struct h5mobaku *ctx) {
+    printf("Testing rolling kernels...\n");
+
+    // Meshes in another order and repeated
+    const int picks[] = {4, 0, 2, 2, 5};
+    uint32_t meshes[5];
+    for (int i = 0; i < 5; i++) meshes[i] = test_meshes[picks[i]];
+
+    const h5mobaku_rolling_op_t ops[] = {H5MOBAKU_ROLL_SUM, H5MOBAKU_ROLL_MEAN, H5MOBAKU_ROLL_MIN,
+                                         H5MOBAKU_ROLL_MAX, H5MOBAKU_ROLL_EWMA};
+    const size_t windows[] = {1, 5, 24, 50};
+    const size_t bands[] = {0, 1, 7};
+    const size_t cells[] = {0, 100};     // One strip, or strips of one or two meshes
+    const int ranges[][2] = {{0, NUM_TEST_HOURS - 1}, {3, 40}, {60, 119}};
+
+    for (size_t o = 0; o < 5; o++) {
+        for (size_t w = 0; w < 4; w++) {
+            for (size_t b = 0; b < 3; b++) {
+                for (size_t r = 0; r < 6; r++) {
+                    h5mobaku_rolling_spec_t spec = H5MOBAKU_ROLLING_DEFAULT_SPEC;
+                    spec.op = ops[o];
+                    spec.window = windows[w];
+                    spec.band_hours = bands[b];
+                    spec.band_cells = cells[r / 3];
+                    spec.alpha = 0.3;
+                    const int start = ranges[r % 3][0], end = ranges[r % 3][1];
+                    double *data = h5mobaku_read_rolling(ctx->h5r_ctx, hash, meshes, 5, start, end, &spec);
+                    assert(data != NULL);
+                    for (int t = start; t <= end; t++) {
+                        for (int i = 0; i < 5; i++) {
+                            double want = expected(&spec, start, t, picks[i]);
+                            assert(fabs(data[(size_t)(t - start) * 5 + i] - want) <= 1e-9 * (1.0 + fabs(want)));
+                        }
+                    }
+                    free(data);
+                }
+            }
+        }
+    }
+
+    printf("Rolling kernel test passed\n");
+}
+
+typedef struct {
+    int next_time;
+    size_t calls;
+} stream_check_t;
+
+static int check_sink(void *user, int first_time, size_t num_times, size_t first_mesh, size_t num_meshes,
+                      const double *values) {
+    stream_check_t *check = user;
+    assert(first_time == check->next_time && first_mesh == 0 && num_meshes == 1);
+    for (size_t i = 0; i < num_times; i++) assert(values[i] == test_values[first_time + i][1]);
+    check->next_time += (int)num_times;
+    return ++check->calls == 3;   // Stop after three bands
+}
+
+typedef struct {
+    size_t next_mesh;
+    int next_time;
+    size_t strips;
+} strip_check_t;
+
+static int strip_sink(void *user, int first_time, size_t num_times, size_t first_mesh, size_t num_meshes,
+                      const double *values) {
+    strip_check_t *check = user;
+    (void)values;
+    // Chunks are 4 meshes wide and the file has 6: a strip of 4 then one of 2, each cut into bands
+    if (check->next_time == 100) {
+        check->next_mesh += 4;
+        check->next_time = 10;
+    }
+    assert(first_mesh == check->next_mesh && num_meshes == (first_mesh == 0 ? 4 : 2));
+    assert(first_time == check->next_time && num_times * num_meshes <= 200);
+    if (first_time == 10) check->strips++;
+    check->next_time += (int)num_times;
+    return 0;
+}
+
+static void test_stream(cmph_t *hash, struct h5mobaku *ctx) {
+    printf("Testing rolling stream...\n");
+
+    // A one-hour window passes the series through, band by band, until the sink stops it
+    h5mobaku_rolling_spec_t spec = H5MOBAKU_ROLLING_DEFAULT_SPEC;
+    spec.op = H5MOBAKU_ROLL_MAX;
+    spec.window = 1;
+    spec.band_hours = 10;
+    stream_check_t check = {.next_time = 5};
+    assert(h5mobaku_rolling_stream(ctx->h5r_ctx, hash, &test_meshes[1], 1, 5, 100, &spec, check_sink, &check) != 0);
+    assert(check.calls == 3 && check.next_time == 35);
+
+    // Whole file in strips of one chunk column, each over the whole range before the next
+    spec.op = H5MOBAKU_ROLL_SUM;
+    spec.window = 6;
+    spec.band_hours = 0;
+    spec.band_cells = 200;
+    strip_check_t strips = {.next_mesh = 0, .next_time = 10};
+    assert(h5mobaku_rolling_stream(ctx->h5r_ctx, NULL, NULL, 0, 10, 99, &spec, strip_sink, &strips) == 0);
+    assert(strips.strips == 2 && strips.next_mesh == 4 && strips.next_time == 100);
+    double *all = h5mobaku_read_rolling(ctx->h5r_ctx, NULL, NULL, 0, 10, 99, &spec);
+    assert(all != NULL);
+    for (int t = 10; t <= 99; t++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            assert(all[(size_t)(t - 10) * NUM_TEST_MESHES + m] == expected(&spec, 10, t, m));
+        }
+    }
+    free(all);
+    spec.band_cells = 0;
+
+    // Invalid specs
+    spec.window = 0;
+    assert(h5mobaku_read_rolling(ctx->h5r_ctx, hash, test_meshes, 1, 0, 10, &spec) == NULL);
+    spec.window = 3;
+    spec.op = H5MOBAKU_ROLL_EWMA;
+    spec.alpha = 0.0;
+    assert(h5mobaku_read_rolling(ctx->h5r_ctx, hash, test_meshes, 1, 0, 10, &spec) == NULL);
+    h5mobaku_rolling_op_t op;
+    assert(h5mobaku_parse_rolling_op("ewma", &op) == 0 && op == H5MOBAKU_ROLL_EWMA);
+    assert(h5mobaku_parse_rolling_op("median", &op) != 0);
+
+    printf("Rolling stream test passed\n");
+}
+
+int main(void) {
+    printf("Running rolling window tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    create_test_file(hash);
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+
+    test_kernels(hash, ctx);
+    test_stream(hash, ctx);
+
+    h5mobaku_close(ctx);
+    unlink(TEST_H5_FILE);
+    cmph_destroy(hash);
+    printf("\nAll rolling window tests passed!\n");
+    return 0;
+}
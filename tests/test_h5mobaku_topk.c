@@ -0,0 +1,193 @@
+//
+// Test for top-K mesh queries with and without chunk_max pruning
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include "h5mobaku_topk.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "test_fixture.h"
+
+#define TEST_H5_FILE "test_h5mobaku_topk.h5"
+#define NUM_TEST_MESHES 40
+#define NUM_TEST_HOURS 96
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+static int32_t test_values[NUM_TEST_HOURS][NUM_TEST_MESHES];
+
+static void create_test_file(cmph_t *hash) {
+    // Two 1st meshes; one mesh is busy in a single hour only, so MAX and SUM rank differently
+    for (int m = 0; m < NUM_TEST_MESHES; m++) {
+        test_meshes[m] = meshid_list[m < NUM_TEST_MESHES / 2 ? m : 100000 + m];
+    }
+    srand(11);
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) test_values[h][m] = rand() % 500 + (m % 7) * 100;
+    }
+    test_values[30][5] = 50000;
+
+    write_test_file(TEST_H5_FILE, hash, test_meshes, NUM_TEST_MESHES, &test_values[0][0], NUM_TEST_HOURS, 24, 4);
+}
+
+static int entry_order(const void *a, const void *b) {
+    const h5mobaku_topk_entry_t *ea = a, *eb = b;
+    if (ea->value != eb->value) return ea->value > eb->value ? -1 : 1;
+    return (ea->mesh_id > eb->mesh_id) - (ea->mesh_id < eb->mesh_id);
+}
+
+// Reference answer by reducing every mesh
+static size_t brute_force(size_t k, int t0, int t1, h5mobaku_reducer_t reducer, uint32_t mesh1,
+                          h5mobaku_topk_entry_t *out) {
+    h5mobaku_topk_entry_t all[NUM_TEST_MESHES];
+    size_t n = 0;
+    for (int m = 0; m < NUM_TEST_MESHES; m++) {
+        if (mesh1 && test_meshes[m] / 100000 != mesh1) continue;
+        double v = reducer == H5MOBAKU_REDUCE_MAX ? test_values[t0][m] : 0.0;
+        for (int h = t0; h <= t1; h++) {
+            if (reducer == H5MOBAKU_REDUCE_MAX) v = test_values[h][m] > v ? test_values[h][m] : v;
+            else v += test_values[h][m];
+        }
+        if (reducer == H5MOBAKU_REDUCE_MEAN) v /= (t1 - t0 + 1);
+        all[n++] = (h5mobaku_topk_entry_t){test_meshes[m], v};
+    }
+    qsort(all, n, sizeof(all[0]), entry_order);
+    n = n < k ? n : k;
+    memcpy(out, all, n * sizeof(all[0]));
+    return n;
+}
+
+static void check_queries(struct h5mobaku *ctx, int use_chunk_max) {
+    const h5mobaku_reducer_t reducers[] = {H5MOBAKU_REDUCE_SUM, H5MOBAKU_REDUCE_MEAN, H5MOBAKU_REDUCE_MAX};
+    const int ranges[][2] = {{18, 18}, {0, NUM_TEST_HOURS - 1}, {20, 50}};
+    const size_t ks[] = {1, 5, NUM_TEST_MESHES + 3};
+    const int threads[] = {1, 4};
+    const uint32_t mesh1 = test_meshes[NUM_TEST_MESHES - 1] / 100000;
+
+    for (size_t r = 0; r < 3; r++) {
+        for (size_t t = 0; t < 3; t++) {
+            for (size_t i = 0; i < 3; i++) {
+                for (size_t j = 0; j < 2; j++) {
+                    for (int region = 0; region <= 1; region++) {
+                        h5mobaku_topk_config_t config = H5MOBAKU_TOPK_DEFAULT_CONFIG;
+                        config.threads = threads[j];
+                        config.use_chunk_max = use_chunk_max;
+                        if (region) {
+                            config.mesh1 = &mesh1;
+                            config.num_mesh1 = 1;
+                        }
+                        h5mobaku_topk_entry_t got[NUM_TEST_MESHES + 3], want[NUM_TEST_MESHES + 3];
+                        size_t count = 0;
+                        assert(h5mobaku_top_k(ctx, ks[i], ranges[t][0], ranges[t][1], reducers[r], &config,
+                                              got, &count) == 0);
+                        size_t expected = brute_force(ks[i], ranges[t][0], ranges[t][1], reducers[r],
+                                                      region ? mesh1 : 0, want);
+                        assert(count == expected);
+                        for (size_t e = 0; e < count; e++) {
+                            assert(got[e].mesh_id == want[e].mesh_id && got[e].value == want[e].value);
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void test_top_k(cmph_t *hash) {
+    printf("Testing top-k queries...\n");
+    create_test_file(hash);
+
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    check_queries(ctx, 1);
+
+    h5mobaku_topk_entry_t top;
+    size_t count = 0;
+    assert(h5mobaku_top_k(ctx, 1, 25, 35, H5MOBAKU_REDUCE_MAX, NULL, &top, &count) == 0);
+    assert(count == 1 && top.mesh_id == test_meshes[5] && top.value == 50000);
+    assert(h5mobaku_top_k(ctx, 1, 0, NUM_TEST_HOURS, H5MOBAKU_REDUCE_SUM, NULL, &top, &count) != 0);
+    assert(h5mobaku_top_k(ctx, 0, 0, 1, H5MOBAKU_REDUCE_SUM, NULL, &top, &count) != 0);
+    h5mobaku_close(ctx);
+
+    printf("Top-k test passed\n");
+}
+
+static void test_chunk_max(cmph_t *hash) {
+    printf("Testing chunk_max pruning...\n");
+
+    // Chunks are 24 hours x 4 meshes
+    assert(h5mobaku_build_chunk_max(TEST_H5_FILE) == 0);
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    int32_t *max = NULL;
+    uint64_t ntime = 0, nmesh = 0;
+    assert(h5r_read_chunk_max(ctx->h5r_ctx, &max, &ntime, &nmesh) == 0);
+    assert(ntime == NUM_TEST_HOURS / 24 && nmesh == NUM_TEST_MESHES / 4);
+    for (uint64_t tc = 0; tc < ntime; tc++) {
+        for (uint64_t mc = 0; mc < nmesh; mc++) {
+            int32_t expected = test_values[tc * 24][mc * 4];
+            for (int h = 0; h < 24; h++) {
+                for (int m = 0; m < 4; m++) {
+                    int32_t v = test_values[tc * 24 + h][mc * 4 + m];
+                    expected = v > expected ? v : expected;
+                }
+            }
+            assert(max[tc * nmesh + mc] == expected);
+        }
+    }
+    free(max);
+
+    // Pruned answers match the full scan
+    check_queries(ctx, 1);
+    h5mobaku_close(ctx);
+
+    // A write inside the covered rows drops the maxima: a cell raised above the K-th value in a
+    // band the stale maxima would prune must still win
+    assert(h5mobaku_open_readwrite(TEST_H5_FILE, &ctx) == 0);
+    test_values[40][0] = 90000;
+    assert(h5mobaku_write_population_single(ctx->h5r_ctx, hash, test_meshes[0], 40, 90000) == 0);
+    h5mobaku_close(ctx);
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    assert(h5r_read_chunk_max(ctx->h5r_ctx, &max, &ntime, &nmesh) != 0);
+    h5mobaku_topk_entry_t top;
+    size_t count = 0;
+    assert(h5mobaku_top_k(ctx, 1, 20, 50, H5MOBAKU_REDUCE_MAX, NULL, &top, &count) == 0);
+    assert(count == 1 && top.mesh_id == test_meshes[0] && top.value == 90000);
+    check_queries(ctx, 1);
+    h5mobaku_close(ctx);
+
+    // Rebuilding restores pruning with the new value
+    assert(h5mobaku_build_chunk_max(TEST_H5_FILE) == 0);
+    assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+    assert(h5r_read_chunk_max(ctx->h5r_ctx, &max, &ntime, &nmesh) == 0);
+    assert(max[(40 / 24) * nmesh] == 90000);
+    free(max);
+    check_queries(ctx, 1);
+    h5mobaku_close(ctx);
+
+    // Maxima from before an extension are ignored
+    assert(h5mobaku_open_readwrite(TEST_H5_FILE, &ctx) == 0);
+    assert(h5mobaku_extend_time_dimension(ctx, NUM_TEST_HOURS + 24) == 0);
+    assert(h5r_read_chunk_max(ctx->h5r_ctx, &max, &ntime, &nmesh) != 0);
+    h5mobaku_close(ctx);
+
+    unlink(TEST_H5_FILE);
+    printf("chunk_max pruning test passed\n");
+}
+
+int main(void) {
+    printf("Running top-k tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+
+    test_top_k(hash);
+    test_chunk_max(hash);
+
+    cmph_destroy(hash);
+    printf("\nAll top-k tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,253 @@
+//
+// Test for multi-row/multi-column, periodic and point reads through hyperslab unions and chunk gathers
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <hdf5.h>
+#include "H5MR/h5mr.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_H5_FILE "test_h5mr_read.h5"
+#define TEST_SUBSET_FILE "test_h5mr_read_subset.h5"
+#define TEST_ROWS 400
+#define TEST_COLS 96
+#define TEST_CHUNK_ROWS 64
+#define TEST_CHUNK_COLS 16
+
+static int32_t cell_value(uint64_t row, uint64_t col) {
+    return (int32_t)(row * 1000 + col);
+}
+
+static void create_test_file(void) {
+    int32_t *data = malloc((size_t)TEST_ROWS * TEST_COLS * sizeof(int32_t));
+    assert(data != NULL);
+    for (size_t r = 0; r < TEST_ROWS; r++) {
+        for (size_t c = 0; c < TEST_COLS; c++) data[r * TEST_COLS + c] = cell_value(r, c);
+    }
+
+    hid_t file = H5Fcreate(TEST_H5_FILE, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    hid_t space = H5Screate_simple(2, (hsize_t[]){TEST_ROWS, TEST_COLS}, NULL);
+    hid_t dcpl = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_chunk(dcpl, 2, (hsize_t[]){TEST_CHUNK_ROWS, TEST_CHUNK_COLS});
+    hid_t dset = H5Dcreate2(file, "population_data", H5T_STD_I32LE, space, H5P_DEFAULT, dcpl, H5P_DEFAULT);
+    assert(dset >= 0);
+    assert(H5Dwrite(dset, H5T_NATIVE_INT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, data) >= 0);
+    H5Dclose(dset);
+    H5Pclose(dcpl);
+    H5Sclose(space);
+    H5Fclose(file);
+    free(data);
+}
+
+static void check_read(struct h5r *ctx, uint64_t *rows, size_t nrows, uint64_t *cols, size_t ncols) {
+    int32_t *values = malloc(nrows * ncols * sizeof(int32_t));
+    assert(values != NULL);
+    memset(values, 0xff, nrows * ncols * sizeof(int32_t));
+    assert(h5r_read_columns_range(ctx, rows, nrows, cols, ncols, values) == 0);
+    for (size_t r = 0; r < nrows; r++) {
+        for (size_t c = 0; c < ncols; c++) assert(values[r * ncols + c] == cell_value(rows[r], cols[c]));
+    }
+    free(values);
+}
+
+static void test_runs(struct h5r *ctx) {
+    printf("Testing reads of row and column runs...\n");
+
+    // Sorted runs spanning chunk boundaries
+    uint64_t rows[120], cols[40];
+    for (size_t i = 0; i < 120; i++) rows[i] = 50 + i;
+    for (size_t i = 0; i < 20; i++) cols[i] = 10 + i;
+    for (size_t i = 0; i < 20; i++) cols[20 + i] = 60 + i;
+    check_read(ctx, rows, 120, cols, 40);
+
+    // Unsorted input with duplicates keeps the caller's order
+    uint64_t mixed_rows[] = {399, 3, 200, 3, 64, 63};
+    uint64_t mixed_cols[] = {95, 0, 17, 17, 16, 15, 40};
+    check_read(ctx, mixed_rows, 6, mixed_cols, 7);
+
+    // Single row through h5r_read_cells, scattered columns
+    int32_t values[7];
+    assert(h5r_read_cells(ctx, 123, mixed_cols, 7, values) == 0);
+    for (size_t c = 0; c < 7; c++) assert(values[c] == cell_value(123, mixed_cols[c]));
+
+    // Out of range indices fail instead of reading
+    uint64_t bad_row = TEST_ROWS;
+    assert(h5r_read_columns_range(ctx, &bad_row, 1, mixed_cols, 7, values) != 0);
+
+    printf("Run read test passed\n");
+}
+
+static void test_fragmented(struct h5r *ctx) {
+    printf("Testing fragmented reads gathered from chunks...\n");
+
+    // Every other row and column: 200 x 48 runs, past the hyperslab limit
+    uint64_t rows[TEST_ROWS / 2], cols[TEST_COLS / 2];
+    for (size_t i = 0; i < TEST_ROWS / 2; i++) rows[i] = 2 * i;
+    for (size_t i = 0; i < TEST_COLS / 2; i++) cols[i] = 2 * i + 1;
+    check_read(ctx, rows, TEST_ROWS / 2, cols, TEST_COLS / 2);
+
+    // Same cells in reverse order
+    for (size_t i = 0; i < TEST_ROWS / 4; i++) {
+        uint64_t t = rows[i];
+        rows[i] = rows[TEST_ROWS / 2 - 1 - i];
+        rows[TEST_ROWS / 2 - 1 - i] = t;
+    }
+    check_read(ctx, rows, TEST_ROWS / 2, cols, TEST_COLS / 2);
+
+    printf("Fragmented read test passed\n");
+}
+
+static void check_pattern(struct h5r *ctx, const h5r_time_pattern_t *pattern, uint64_t *cols, size_t ncols) {
+    const uint64_t nrows = h5r_pattern_rows(pattern);
+    assert(nrows == pattern->count * pattern->block);
+    int32_t *values = malloc(nrows * ncols * sizeof(int32_t));
+    assert(values != NULL);
+    assert(h5r_read_pattern(ctx, pattern, cols, ncols, values) == 0);
+    for (uint64_t k = 0; k < pattern->count; k++) {
+        for (uint64_t b = 0; b < pattern->block; b++) {
+            const uint64_t row = pattern->start + k * pattern->stride + b;
+            for (size_t c = 0; c < ncols; c++) {
+                assert(values[(k * pattern->block + b) * ncols + c] == cell_value(row, cols[c]));
+            }
+        }
+    }
+    free(values);
+}
+
+static void test_patterns(struct h5r *ctx) {
+    printf("Testing periodic time selections...\n");
+
+    uint64_t one_col = 37;
+    uint64_t mixed_cols[] = {95, 0, 17, 17, 16, 15, 40};
+    uint64_t all_odd[TEST_COLS / 2];
+    for (size_t i = 0; i < TEST_COLS / 2; i++) all_odd[i] = 2 * i + 1;
+
+    // Every day at 09:00, single and multiple meshes
+    const h5r_time_pattern_t daily = {.start = 9, .stride = 24, .block = 1, .count = 16};
+    check_pattern(ctx, &daily, &one_col, 1);
+    check_pattern(ctx, &daily, mixed_cols, 7);
+
+    // Nine business hours once a week, ending on the last row
+    const h5r_time_pattern_t weekly = {.start = 8, .stride = 168, .block = 9, .count = 3};
+    check_pattern(ctx, &weekly, mixed_cols, 7);
+    const h5r_time_pattern_t tail = {.start = TEST_ROWS - 9, .stride = 0, .block = 9, .count = 1};
+    check_pattern(ctx, &tail, &one_col, 1);
+
+    // Many periods over scattered columns take the chunk gather
+    const h5r_time_pattern_t dense = {.start = 1, .stride = 4, .block = 1, .count = 99};
+    check_pattern(ctx, &dense, all_odd, TEST_COLS / 2);
+
+    // Overlapping periods, empty patterns and periods past the end are refused
+    int32_t values[64];
+    const h5r_time_pattern_t overlap = {.start = 0, .stride = 2, .block = 3, .count = 2};
+    const h5r_time_pattern_t empty = {.start = 0, .stride = 24, .block = 1, .count = 0};
+    const h5r_time_pattern_t past_end = {.start = 24, .stride = 24, .block = 1, .count = TEST_ROWS / 24 + 1};
+    assert(h5r_pattern_rows(&overlap) == 0 && h5r_pattern_rows(&empty) == 0);
+    assert(h5r_read_pattern(ctx, &overlap, &one_col, 1, values) != 0);
+    assert(h5r_read_pattern(ctx, &past_end, &one_col, 1, values) != 0);
+
+    printf("Periodic selection test passed\n");
+}
+
+static void test_points(struct h5r *ctx) {
+    printf("Testing arbitrary point reads...\n");
+
+    enum { NUM_POINTS = 200000 };
+    uint64_t *rows = malloc(NUM_POINTS * sizeof(uint64_t));
+    uint64_t *cols = malloc(NUM_POINTS * sizeof(uint64_t));
+    int32_t *values = malloc(NUM_POINTS * sizeof(int32_t));
+    assert(rows && cols && values);
+    srand(7);
+    for (size_t i = 0; i < NUM_POINTS; i++) {
+        rows[i] = (uint64_t)rand() % TEST_ROWS;
+        cols[i] = (uint64_t)rand() % TEST_COLS;
+    }
+    rows[1] = rows[0];
+    cols[1] = cols[0];
+    assert(h5r_read_points(ctx, rows, cols, NUM_POINTS, values) == 0);
+    for (size_t i = 0; i < NUM_POINTS; i++) assert(values[i] == cell_value(rows[i], cols[i]));
+
+    // One point, and a point past the last column
+    assert(h5r_read_points(ctx, &rows[5], &cols[5], 1, values) == 0);
+    assert(values[0] == cell_value(rows[5], cols[5]));
+    cols[3] = TEST_COLS;
+    assert(h5r_read_points(ctx, rows, cols, NUM_POINTS, values) != 0);
+
+    free(rows);
+    free(cols);
+    free(values);
+    printf("Point read test passed\n");
+}
+
+static void test_mesh_id_reads(void) {
+    printf("Testing periodic and point reads by mesh ID...\n");
+
+    const uint32_t subset[] = {100000001, 100000002, 100000003, 100000004};
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    assert(h5mobaku_create_with_meshes(TEST_SUBSET_FILE, &config, subset, 4, &ctx) == 0);
+    for (int day = 0; day < 10; day++) {
+        const int32_t values[] = {day, 100 + day, 200 + day, 300 + day};
+        assert(h5mobaku_write_population_multi(ctx->h5r_ctx, hash, (uint32_t *)subset, values, 4, day * 24 + 9) == 0);
+    }
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+
+    assert(h5mobaku_open(TEST_SUBSET_FILE, &ctx) == 0);
+    h5r_time_pattern_t pattern;
+    assert(h5mobaku_time_pattern_at(ctx, "2016-01-01 09:00:00", 24, 1, 10, &pattern) == 0);
+    assert(pattern.start == 9);
+    assert(h5mobaku_time_pattern_at(ctx, "2016-01-01 09:00:00", 2, 3, 10, &pattern) != 0);
+    pattern = (h5r_time_pattern_t){.start = 9, .stride = 24, .block = 1, .count = 10};
+
+    uint32_t meshes[] = {subset[3], subset[0]};
+    int32_t *data = h5mobaku_read_population_pattern(ctx->h5r_ctx, hash, meshes, 2, &pattern);
+    assert(data != NULL);
+    for (int day = 0; day < 10; day++) {
+        assert(data[day * 2] == 300 + day && data[day * 2 + 1] == day);
+    }
+    h5mobaku_free_data(data);
+
+    uint32_t unknown = 100000009;
+    assert(h5mobaku_read_population_pattern(ctx->h5r_ctx, hash, &unknown, 1, &pattern) == NULL);
+
+    const int times[] = {9, 33, 9, 225, 10};
+    const uint32_t point_meshes[] = {subset[2], subset[2], subset[1], subset[3], subset[0]};
+    int32_t out[5];
+    assert(h5mobaku_read_points(ctx->h5r_ctx, hash, times, point_meshes, 5, out) == 0);
+    assert(out[0] == 200 && out[1] == 201 && out[2] == 100 && out[3] == 309 && out[4] == 0);
+    const uint32_t bad_meshes[] = {subset[0], unknown};
+    assert(h5mobaku_read_points(ctx->h5r_ctx, hash, times, bad_meshes, 2, out) != 0);
+    h5mobaku_close(ctx);
+
+    cmph_destroy(hash);
+    unlink(TEST_SUBSET_FILE);
+    printf("Periodic and point read by mesh ID test passed\n");
+}
+
+int main(void) {
+    printf("Running h5r read tests...\n\n");
+
+    create_test_file();
+    struct h5r *ctx = NULL;
+    assert(h5r_open(TEST_H5_FILE, &ctx) == 0);
+
+    test_runs(ctx);
+    test_fragmented(ctx);
+    test_patterns(ctx);
+    test_points(ctx);
+
+    h5r_close(ctx);
+    unlink(TEST_H5_FILE);
+
+    test_mesh_id_reads();
+    printf("\nAll h5r read tests passed!\n");
+    return 0;
+}
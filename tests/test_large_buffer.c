@@ -0,0 +1,102 @@
+//
+// Test for the parallel first-touch large buffer allocator
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+#include "large_buffer.h"
+#include "h5mobaku_ops.h"
+
+// Not a multiple of the 2 MiB block, so the last block is partial
+#define TEST_BUFFER_SIZE ((size_t)37 * 1024 * 1024 + 12345)
+
+static int all_zero(const unsigned char *buf, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (buf[i] != 0) return 0;
+    }
+    return 1;
+}
+
+static void check_placement(large_buffer_placement_t placement, int threads, int huge_pages) {
+    large_buffer_config_t config = LARGE_BUFFER_DEFAULT_CONFIG;
+    config.placement = placement;
+    config.threads = threads;
+    config.huge_pages = huge_pages;
+
+    unsigned char *buf = large_buffer_alloc(TEST_BUFFER_SIZE, &config);
+    assert(buf != NULL);
+    assert(((uintptr_t)buf & 4095) == 0);
+    assert(all_zero(buf, TEST_BUFFER_SIZE));
+
+    memset(buf, 0xab, TEST_BUFFER_SIZE);
+    assert(large_buffer_zero(buf) == 0);
+    assert(all_zero(buf, TEST_BUFFER_SIZE));
+
+    assert(large_buffer_free(buf) == 0);
+}
+
+static void test_placements(void) {
+    printf("Testing placements...\n");
+    check_placement(LARGE_BUFFER_INTERLEAVE, 0, 1);
+    check_placement(LARGE_BUFFER_NODE, 0, 1);
+    check_placement(LARGE_BUFFER_PARTITION, 0, 1);
+    check_placement(LARGE_BUFFER_INTERLEAVE, 4, 0);
+    check_placement(LARGE_BUFFER_PARTITION, 3, 0);
+    printf("Placement test passed\n");
+}
+
+static void test_small_and_default(void) {
+    printf("Testing small buffers and default config...\n");
+    unsigned char *small = large_buffer_alloc(100, NULL);
+    assert(small != NULL);
+    assert(all_zero(small, 100));
+    assert(large_buffer_free(small) == 0);
+
+    // An out-of-range node falls back to node 0
+    large_buffer_config_t config = LARGE_BUFFER_DEFAULT_CONFIG;
+    config.placement = LARGE_BUFFER_NODE;
+    config.node = 1000;
+    unsigned char *buf = large_buffer_alloc(3 * 1024 * 1024, &config);
+    assert(buf != NULL);
+    assert(all_zero(buf, 3 * 1024 * 1024));
+    assert(large_buffer_free(buf) == 0);
+
+    assert(large_buffer_alloc(0, NULL) == NULL);
+    printf("Small buffer test passed\n");
+}
+
+static void test_foreign_pointers(void) {
+    printf("Testing pointers from other allocators...\n");
+    void *plain = malloc(64);
+    assert(plain != NULL);
+    assert(large_buffer_free(plain) == -1);
+    assert(large_buffer_zero(plain) == -1);
+    assert(large_buffer_free(NULL) == -1);
+    free(plain);
+
+    // Double free is refused
+    void *buf = large_buffer_alloc(4096, NULL);
+    assert(buf != NULL);
+    assert(large_buffer_free(buf) == 0);
+    assert(large_buffer_free(buf) == -1);
+
+    // h5mobaku_free_data releases both kinds
+    h5mobaku_free_data(large_buffer_alloc(8 * 1024 * 1024, NULL));
+    h5mobaku_free_data(malloc(16));
+    h5mobaku_free_data(NULL);
+    printf("Foreign pointer test passed\n");
+}
+
+int main(void) {
+    printf("Running large buffer tests...\n\n");
+
+    test_placements();
+    test_small_and_default();
+    test_foreign_pointers();
+
+    printf("\nAll large buffer tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,192 @@
+//
+// Test for meshid_list verification and file-specific mesh lookup
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <time.h>
+#include <hdf5.h>
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+#include "mesh_dict.h"
+
+#define TEST_H5_FILE "test_mesh_dict.h5"
+#define SWAP_A 17
+#define SWAP_B 1000003
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void test_dict_lookup(void) {
+    printf("Testing mesh dictionary lookup...\n");
+
+    mesh_dict_t *dict = mesh_dict_create(meshid_list, meshid_list_size);
+    assert(dict != NULL);
+    assert(mesh_dict_size(dict) == meshid_list_size);
+    for (size_t i = 0; i < meshid_list_size; i++) {
+        assert(mesh_dict_lookup(dict, meshid_list[i]) == (uint32_t)i);
+    }
+    assert(mesh_dict_lookup(dict, 0) == MESHID_NOT_FOUND);
+    assert(mesh_dict_lookup(dict, 999999999) == MESHID_NOT_FOUND);
+    mesh_dict_destroy(dict);
+
+    printf("Mesh dictionary lookup test passed\n");
+}
+
+static void test_list_compare(void) {
+    printf("Testing vectorized list comparison...\n");
+
+    uint32_t *copy = malloc(meshid_list_size * sizeof(uint32_t));
+    assert(copy != NULL);
+    memcpy(copy, meshid_list, meshid_list_size * sizeof(uint32_t));
+
+    double t0 = now_sec();
+    assert(mesh_list_equal(copy, meshid_list, meshid_list_size) == 1);
+    printf("  Compared %zu entries in %.3f ms\n", meshid_list_size, (now_sec() - t0) * 1e3);
+
+    // A difference anywhere, including the scalar tail, must be found
+    const size_t positions[] = {0, 1, 15, 4095, 4096, 777777, meshid_list_size - 2, meshid_list_size - 1};
+    for (size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        copy[positions[i]] ^= 0x100;
+        assert(mesh_list_equal(copy, meshid_list, meshid_list_size) == 0);
+        copy[positions[i]] ^= 0x100;
+    }
+    assert(mesh_list_equal(copy, meshid_list, 7) == 1);
+    free(copy);
+
+    printf("Vectorized list comparison test passed\n");
+}
+
+// Write a value for mesh SWAP_A, then swap SWAP_A and SWAP_B in the stored meshid_list
+static void create_swapped_file(void) {
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    assert(h5mobaku_create(TEST_H5_FILE, &config, &ctx) == 0);
+    assert(h5r_write_cell(ctx->h5r_ctx, 3, SWAP_A, 777) >= 0);
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+
+    uint32_t *ids = malloc(meshid_list_size * sizeof(uint32_t));
+    assert(ids != NULL);
+    memcpy(ids, meshid_list, meshid_list_size * sizeof(uint32_t));
+    ids[SWAP_A] = meshid_list[SWAP_B];
+    ids[SWAP_B] = meshid_list[SWAP_A];
+
+    hid_t file = H5Fopen(TEST_H5_FILE, H5F_ACC_RDWR, H5P_DEFAULT);
+    assert(file >= 0);
+    hid_t dset = H5Dopen2(file, "meshid_list", H5P_DEFAULT);
+    assert(dset >= 0);
+    assert(H5Dwrite(dset, H5T_NATIVE_UINT32, H5S_ALL, H5S_ALL, H5P_DEFAULT, ids) >= 0);
+    H5Dclose(dset);
+    H5Fclose(file);
+    free(ids);
+}
+
+static void test_verify_on_open(void) {
+    printf("Testing meshid_list verification on open...\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    h5mobaku_open_config_t config = H5MOBAKU_OPEN_DEFAULT_CONFIG;
+
+    // Matching list: the compiled-in hash stays in use
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t wconfig = H5R_WRITER_DEFAULT_CONFIG;
+    assert(h5mobaku_create(TEST_H5_FILE, &wconfig, &ctx) == 0);
+    h5mobaku_close(ctx);
+    config.verify_meshid_list = 1;
+    assert(h5mobaku_open_with_config(TEST_H5_FILE, &config, &ctx) == 0);
+    assert(h5r_get_mesh_dict(ctx->h5r_ctx) == NULL);
+    h5mobaku_close(ctx);
+
+    create_swapped_file();
+    const uint32_t mesh_a = meshid_list[SWAP_A];
+    const uint32_t mesh_b = meshid_list[SWAP_B];
+
+    // Without verification the compiled-in order is assumed
+    config.verify_meshid_list = 0;
+    assert(h5mobaku_open_with_config(TEST_H5_FILE, &config, &ctx) == 0);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, mesh_a, 3) == 777);
+    h5mobaku_close(ctx);
+
+    // With verification the file's own order wins
+    config.verify_meshid_list = 1;
+    double t0 = now_sec();
+    assert(h5mobaku_open_with_config(TEST_H5_FILE, &config, &ctx) == 0);
+    printf("  Open with verification took %.3f ms\n", (now_sec() - t0) * 1e3);
+    assert(h5r_get_mesh_dict(ctx->h5r_ctx) != NULL);
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, mesh_b) == SWAP_A);
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, mesh_a) == SWAP_B);
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, 999999999) == MESHID_NOT_FOUND);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, mesh_b, 3) == 777);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, mesh_a, 3) == 0);
+
+    uint32_t both[2] = {mesh_a, mesh_b};
+    int32_t *series = h5mobaku_read_multi_mesh_time_series(ctx->h5r_ctx, hash, both, 2, 2, 4);
+    assert(series != NULL);
+    assert(series[1 * 2 + 0] == 0);
+    assert(series[1 * 2 + 1] == 777);
+    h5mobaku_free_data(series);
+    h5mobaku_close(ctx);
+
+    cmph_destroy(hash);
+    unlink(TEST_H5_FILE);
+    printf("meshid_list verification test passed\n");
+}
+
+static void test_subset_file(void) {
+    printf("Testing subset file with its own mesh dictionary...\n");
+
+    // IDs unknown to the compiled-in hash work because the file carries its own list
+    const uint32_t subset[] = {100000003, 100000001, 100000002};
+    const uint32_t duplicated[] = {100000001, 100000001};
+    struct h5mobaku *ctx = NULL;
+    h5r_writer_config_t config = H5R_WRITER_DEFAULT_CONFIG;
+    assert(h5mobaku_create_with_meshes(TEST_H5_FILE, &config, duplicated, 2, &ctx) != 0);
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+    assert(h5mobaku_create_with_meshes(TEST_H5_FILE, &config, subset, 3, &ctx) == 0);
+    assert(h5r_get_mesh_dict(ctx->h5r_ctx) != NULL);
+    for (int m = 0; m < 3; m++) {
+        assert(h5mobaku_write_population_single(ctx->h5r_ctx, hash, subset[m], 10, 100 + m) == 0);
+    }
+    h5r_flush(ctx->h5r_ctx);
+    h5mobaku_close(ctx);
+
+    // The table is built on open even without verification
+    h5mobaku_open_config_t open_config = H5MOBAKU_OPEN_DEFAULT_CONFIG;
+    assert(h5mobaku_open_with_config(TEST_H5_FILE, &open_config, &ctx) == 0);
+    h5r_metadata_t meta;
+    h5r_get_metadata(ctx->h5r_ctx, &meta);
+    assert(meta.cols == 3);
+    assert(meta.ccols == 3);
+    for (int m = 0; m < 3; m++) {
+        assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, subset[m]) == (uint32_t)m);
+        assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, subset[m], 10) == 100 + m);
+    }
+    assert(h5mobaku_mesh_index(ctx->h5r_ctx, hash, meshid_list[0]) == MESHID_NOT_FOUND);
+    h5mobaku_close(ctx);
+
+    cmph_destroy(hash);
+    unlink(TEST_H5_FILE);
+    printf("Subset file test passed\n");
+}
+
+int main(void) {
+    printf("Running mesh dictionary tests...\n\n");
+
+    test_dict_lookup();
+    test_list_compare();
+    test_verify_on_open();
+    test_subset_file();
+
+    printf("\nAll mesh dictionary tests passed!\n");
+    return 0;
+}
@@ -94,6 +94,18 @@ int main() {
     printf("Time taken for little hash search %f seconds\n", time_taken);
     printf("Little local hash test passed\n");
 
+    assert(meshid_get_time_index_of_year(2016) == 0);
+    assert(meshid_get_time_index_of_year(2017) == 8784);
+    assert(meshid_get_time_index_of_year(2024) == 8 * 8760 + 2 * 24);
+    assert(meshid_get_time_index_of_year(2015) == -8760);
+    assert(meshid_get_hours_in_year(2016) == 8784);
+    assert(meshid_get_hours_in_year(2017) == 8760);
+    assert(meshid_get_year_from_time_index(0) == 2016);
+    assert(meshid_get_year_from_time_index(8783) == 2016);
+    assert(meshid_get_year_from_time_index(8784) == 2017);
+    assert(meshid_get_year_from_time_index(74160 - 1) == 2024);
+    printf("Calendar year helper test passed\n");
+
     printf("All tests passed!\n");
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+//
+// Test for the PostgreSQL binary COPY reader and its converter path
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <assert.h>
+#include <endian.h>
+#include "pgcopy_ops.h"
+#include "csv_to_h5_converter.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_PGCOPY_FILE "test_pgcopy_ops.pgcopy"
+#define TEST_H5_FILE "test_pgcopy_ops.h5"
+#define NUM_TEST_MESHES 5
+#define NUM_TEST_HOURS 40
+
+// Days from 2000-01-01 (the PostgreSQL epoch) to 2016-01-01
+#define PG_DAYS_2016 5844
+
+static FILE* begin_file(const char* path, uint32_t flags) {
+    FILE* fp = fopen(path, "wb");
+    assert(fp != NULL);
+    fwrite("PGCOPY\n\377\r\n", 11, 1, fp);
+    uint32_t be_flags = htobe32(flags), ext = 0;
+    fwrite(&be_flags, 4, 1, fp);
+    fwrite(&ext, 4, 1, fp);
+    return fp;
+}
+
+static void put_count(FILE* fp, int16_t count) {
+    uint16_t v = htobe16((uint16_t)count);
+    fwrite(&v, 2, 1, fp);
+}
+
+static void put_null(FILE* fp) {
+    uint32_t len = htobe32(0xFFFFFFFFu);
+    fwrite(&len, 4, 1, fp);
+}
+
+static void put_int(FILE* fp, int width, int64_t value) {
+    uint32_t len = htobe32((uint32_t)width);
+    fwrite(&len, 4, 1, fp);
+    if (width == 2) {
+        uint16_t v = htobe16((uint16_t)value);
+        fwrite(&v, 2, 1, fp);
+    } else if (width == 4) {
+        uint32_t v = htobe32((uint32_t)value);
+        fwrite(&v, 4, 1, fp);
+    } else {
+        uint64_t v = htobe64((uint64_t)value);
+        fwrite(&v, 8, 1, fp);
+    }
+}
+
+// timestamp without time zone for JST wall-clock hour h after 2016-01-01 00:00
+static void put_timestamp(FILE* fp, int h) {
+    put_int(fp, 8, ((int64_t)PG_DAYS_2016 * 86400 + (int64_t)h * 3600) * 1000000);
+}
+
+static void end_file(FILE* fp) {
+    put_count(fp, -1);
+    fclose(fp);
+}
+
+static void test_layouts(void) {
+    printf("Testing PGCOPY column layouts...\n");
+    csv_row_t row;
+
+    // CSV columns with integer date/time, then with PostgreSQL date/time; NULL breakdown columns
+    FILE* fp = begin_file(TEST_PGCOPY_FILE, 0);
+    put_count(fp, 7);
+    put_int(fp, 4, 20160102); put_int(fp, 2, 1300); put_int(fp, 8, 362257341);
+    put_null(fp); put_int(fp, 2, 20); put_null(fp); put_int(fp, 4, 77);
+    put_count(fp, 7);
+    put_int(fp, 4, PG_DAYS_2016 + 1); put_int(fp, 8, (int64_t)(13 * 3600 + 30 * 60) * 1000000);
+    put_int(fp, 4, 362257342); put_int(fp, 4, 13); put_int(fp, 4, 30); put_int(fp, 4, 2); put_int(fp, 8, 88);
+    end_file(fp);
+
+    assert(pgcopy_is_pgcopy(TEST_PGCOPY_FILE) == 1);
+    pgcopy_reader_t* reader = pgcopy_open(TEST_PGCOPY_FILE);
+    assert(reader != NULL);
+    assert(pgcopy_read_row(reader, &row) == 0);
+    assert(row.date == 20160102 && row.time == 1300 && row.area == 362257341);
+    assert(row.residence == -1 && row.age == 20 && row.gender == -1 && row.population == 77);
+    assert(pgcopy_read_row(reader, &row) == 0);
+    assert(row.date == 20160102 && row.time == 1330 && row.area == 362257342);
+    assert(row.residence == 13 && row.age == 30 && row.gender == 2 && row.population == 88);
+    assert(pgcopy_read_row(reader, &row) == 1);
+    assert(pgcopy_get_tuple_number(reader) == 2);
+    pgcopy_close(reader);
+
+    // Timestamp layouts, with OIDs in the file
+    fp = begin_file(TEST_PGCOPY_FILE, 1u << 16);
+    put_count(fp, 6);
+    put_int(fp, 4, 12345);
+    put_timestamp(fp, 24 * 366 + 5); put_int(fp, 4, 362257341); put_null(fp); put_null(fp); put_int(fp, 2, 1);
+    put_int(fp, 4, 9);
+    put_count(fp, 3);
+    put_int(fp, 4, 12346);
+    put_timestamp(fp, 23); put_int(fp, 8, 362257343); put_int(fp, 2, 11);
+    end_file(fp);
+
+    reader = pgcopy_open(TEST_PGCOPY_FILE);
+    assert(reader != NULL);
+    assert(pgcopy_read_row(reader, &row) == 0);
+    assert(row.date == 20170101 && row.time == 500 && row.residence == -1 && row.gender == 1 && row.population == 9);
+    assert(pgcopy_read_row(reader, &row) == 0);
+    assert(row.date == 20160101 && row.time == 2300 && row.area == 362257343 && row.age == -1 && row.population == 11);
+    assert(pgcopy_read_row(reader, &row) == 1);
+    pgcopy_close(reader);
+
+    // A tuple cut short is an error, not the end of the file
+    fp = begin_file(TEST_PGCOPY_FILE, 0);
+    put_count(fp, 3);
+    put_timestamp(fp, 0); put_int(fp, 4, 362257341);
+    fclose(fp);
+    reader = pgcopy_open(TEST_PGCOPY_FILE);
+    assert(reader != NULL);
+    assert(pgcopy_read_row(reader, &row) == -1);
+    pgcopy_close(reader);
+
+    // CSV text is not PGCOPY
+    fp = fopen(TEST_PGCOPY_FILE, "w");
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fclose(fp);
+    assert(pgcopy_is_pgcopy(TEST_PGCOPY_FILE) == 0);
+    assert(pgcopy_open(TEST_PGCOPY_FILE) == NULL);
+
+    unlink(TEST_PGCOPY_FILE);
+    printf("Layout test passed\n");
+}
+
+static void test_parts(void) {
+    printf("Testing split reading of fixed-width files...\n");
+    enum { NUM_TUPLES = 1000 };
+    FILE* fp = begin_file(TEST_PGCOPY_FILE, 0);
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        put_count(fp, 3);
+        put_timestamp(fp, i / 10); put_int(fp, 4, 362257341 + i % 10); put_int(fp, 4, i);
+    }
+    end_file(fp);
+
+    assert(pgcopy_count_parts(TEST_PGCOPY_FILE, 1, 0) == 1);
+    assert(pgcopy_count_parts(TEST_PGCOPY_FILE, 4, 0) == 4);
+    assert(pgcopy_count_parts(TEST_PGCOPY_FILE, 4, 1 << 30) == 1);
+
+    // The parts cover every tuple once, in order
+    int next = 0;
+    for (int part = 0; part < 4; part++) {
+        pgcopy_reader_t* reader = pgcopy_open_part(TEST_PGCOPY_FILE, part, 4);
+        assert(reader != NULL);
+        csv_row_t row;
+        int status;
+        while ((status = pgcopy_read_row(reader, &row)) == 0) assert(row.population == next++);
+        assert(status == 1);
+        pgcopy_close(reader);
+    }
+    assert(next == NUM_TUPLES);
+
+    // Tuple ranges, and single tuples read out of order
+    size_t width = 0;
+    assert(pgcopy_count_tuples(TEST_PGCOPY_FILE, &width) == NUM_TUPLES && width > 0);
+    pgcopy_reader_t* reader = pgcopy_open_tuples(TEST_PGCOPY_FILE, 250, 260);
+    assert(reader != NULL);
+    csv_row_t row;
+    next = 250;
+    while (pgcopy_read_row(reader, &row) == 0) assert(row.population == next++);
+    assert(next == 260);
+    assert(pgcopy_read_row_at(reader, 999, &row) == 0 && row.population == 999);
+    assert(pgcopy_read_row_at(reader, 3, &row) == 0 && row.population == 3);
+    assert(pgcopy_read_row_at(reader, NUM_TUPLES, &row) < 0);
+    pgcopy_close(reader);
+    assert(pgcopy_open_tuples(TEST_PGCOPY_FILE, 10, NUM_TUPLES + 1) == NULL);
+
+    // A NULL changes the width of one tuple, so the file is read whole
+    fp = begin_file(TEST_PGCOPY_FILE, 0);
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        put_count(fp, 6);
+        put_timestamp(fp, i); put_int(fp, 4, 362257341);
+        if (i == 700) put_null(fp); else put_int(fp, 4, 1);
+        put_int(fp, 4, 1); put_int(fp, 4, 1); put_int(fp, 4, i);
+    }
+    end_file(fp);
+    assert(pgcopy_count_parts(TEST_PGCOPY_FILE, 4, 0) == 1);
+    assert(pgcopy_count_tuples(TEST_PGCOPY_FILE, &width) == 0);
+
+    // Wider and narrower integers that cancel out keep the size a multiple of the first width and
+    // leave every split point on a tuple start; the file is still read whole
+    fp = begin_file(TEST_PGCOPY_FILE, 0);
+    for (int i = 0; i < NUM_TUPLES; i++) {
+        put_count(fp, 3);
+        put_timestamp(fp, i / 10);
+        put_int(fp, i == 100 ? 8 : 4, 362257341);
+        put_int(fp, i == 101 || i == 102 ? 2 : 4, i);
+    }
+    end_file(fp);
+    assert(pgcopy_count_parts(TEST_PGCOPY_FILE, 4, 0) == 1);
+    assert(pgcopy_count_tuples(TEST_PGCOPY_FILE, &width) == 0);
+    reader = pgcopy_open(TEST_PGCOPY_FILE);
+    assert(reader != NULL);
+    next = 0;
+    while (pgcopy_read_row(reader, &row) == 0) assert(row.population == next++);
+    assert(next == NUM_TUPLES);
+    pgcopy_close(reader);
+
+    unlink(TEST_PGCOPY_FILE);
+    printf("Split reading test passed\n");
+}
+
+static void test_converter(cmph_t* hash) {
+    printf("Testing PGCOPY conversion...\n");
+    uint32_t meshes[NUM_TEST_MESHES];
+    for (int m = 0; m < NUM_TEST_MESHES; m++) meshes[m] = meshid_list[3000 + m];
+
+    FILE* fp = begin_file(TEST_PGCOPY_FILE, 0);
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            put_count(fp, 3);
+            put_timestamp(fp, h); put_int(fp, 4, meshes[m]); put_int(fp, 4, 100 * m + h);
+        }
+    }
+    end_file(fp);
+
+    for (int bulk = 0; bulk <= 1; bulk++) {
+        const char* files[] = {TEST_PGCOPY_FILE};
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = TEST_H5_FILE;
+        config.mesh_ids = meshes;
+        config.num_meshes = NUM_TEST_MESHES;
+        config.use_bulk_write = bulk;
+        csv_to_h5_stats_t stats;
+        assert(csv_to_h5_convert_files(files, 1, &config, &stats) == 0);
+        assert(stats.total_rows_processed == NUM_TEST_MESHES * NUM_TEST_HOURS);
+        assert(stats.errors == 0);
+
+        struct h5mobaku* ctx = NULL;
+        assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            int32_t* series = h5mobaku_read_population_time_series(ctx->h5r_ctx, hash, meshes[m], 0, NUM_TEST_HOURS - 1);
+            assert(series != NULL);
+            for (int h = 0; h < NUM_TEST_HOURS; h++) assert(series[h] == 100 * m + h);
+            h5mobaku_free_data(series);
+        }
+        h5mobaku_close(ctx);
+        unlink(TEST_H5_FILE);
+    }
+
+    unlink(TEST_PGCOPY_FILE);
+    printf("PGCOPY conversion test passed\n");
+}
+
+// A time-ordered dump from the end of 2016 into 2017, staged in bulk mode one year at a time
+static void test_multi_year(cmph_t* hash) {
+    printf("Testing a multi-year PGCOPY dump...\n");
+    enum { FIRST_HOUR = 8784 - 30, LAST_HOUR = 8784 + 30 };
+    uint32_t meshes[NUM_TEST_MESHES];
+    for (int m = 0; m < NUM_TEST_MESHES; m++) meshes[m] = meshid_list[4000 + m];
+
+    FILE* fp = begin_file(TEST_PGCOPY_FILE, 0);
+    for (int h = FIRST_HOUR; h <= LAST_HOUR; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            put_count(fp, 3);
+            put_timestamp(fp, h); put_int(fp, 4, meshes[m]); put_int(fp, 4, 1000 * m + h);
+        }
+    }
+    end_file(fp);
+
+    for (int bulk = 0; bulk <= 1; bulk++) {
+        const char* files[] = {TEST_PGCOPY_FILE};
+        csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+        config.output_h5_file = TEST_H5_FILE;
+        config.mesh_ids = meshes;
+        config.num_meshes = NUM_TEST_MESHES;
+        config.use_bulk_write = bulk;
+        csv_to_h5_stats_t stats;
+        assert(csv_to_h5_convert_files(files, 1, &config, &stats) == 0);
+        assert(stats.total_rows_processed == NUM_TEST_MESHES * (LAST_HOUR - FIRST_HOUR + 1));
+        assert(stats.errors == 0);
+
+        struct h5mobaku* ctx = NULL;
+        assert(h5mobaku_open(TEST_H5_FILE, &ctx) == 0);
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            int32_t* series = h5mobaku_read_population_time_series(ctx->h5r_ctx, hash, meshes[m], FIRST_HOUR, LAST_HOUR);
+            assert(series != NULL);
+            for (int h = FIRST_HOUR; h <= LAST_HOUR; h++) assert(series[h - FIRST_HOUR] == 1000 * m + h);
+            h5mobaku_free_data(series);
+        }
+        h5mobaku_close(ctx);
+        unlink(TEST_H5_FILE);
+    }
+
+    unlink(TEST_PGCOPY_FILE);
+    printf("Multi-year PGCOPY test passed\n");
+}
+
+int main(void) {
+    printf("Running PGCOPY tests...\n\n");
+
+    cmph_t* hash = meshid_prepare_search();
+    assert(hash != NULL);
+
+    test_layouts();
+    test_parts();
+    test_converter(hash);
+    test_multi_year(hash);
+
+    cmph_destroy(hash);
+    printf("\nAll PGCOPY tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,253 @@
+//
+// Test for pre-parsed record files and rebuilding HDF5 files from them
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+#include <sys/stat.h>
+#include "record_stream.h"
+#include "csv_to_h5_converter.h"
+#include "h5mobaku_ops.h"
+#include "meshid_ops.h"
+
+#define TEST_RECORD_FILE "test_record_stream.mrec"
+#define TEST_RECORD_DIR "test_record_stream_dir"
+#define TEST_CSV_A "test_record_stream_a_00000.csv"
+#define TEST_CSV_B "test_record_stream_b_00000.csv"
+#define NUM_TEST_MESHES 6
+#define NUM_TEST_HOURS 30
+
+static uint32_t test_meshes[NUM_TEST_MESHES];
+
+static void test_writer_and_reader(void) {
+    printf("Testing record file roundtrip...\n");
+
+    // Chunks of 4 hours x 2 columns; records arrive in no particular order
+    record_stream_writer_t *writer = record_stream_writer_create(TEST_RECORD_FILE, 4, 2);
+    assert(writer != NULL);
+    assert(record_stream_writer_add(writer, 9, 3, 1, -1, -1, -1) == 0);
+    assert(record_stream_writer_add(writer, 1, 2, 2, -1, -1, -1) == 0);
+    assert(record_stream_writer_add(writer, 0, 1, 3, -1, -1, -1) == 0);
+    assert(record_stream_writer_add(writer, 5, 0, 4, 13101, 20, 2) == 0);
+    assert(record_stream_writer_add(writer, 1, 2, 5, -1, -1, -1) == 0);    // Same cell as the second record
+    assert(record_stream_writer_add(writer, 2, 0, 6, -1, -1, -1) == 0);
+    assert(record_stream_writer_add(writer, 2, 0, 6, -1, 40000, -1) < 0);    // Age does not fit
+    assert(record_stream_writer_close(writer) == 0);
+    assert(access(TEST_RECORD_FILE ".tmp", F_OK) != 0);
+
+    assert(record_stream_is_stream(TEST_RECORD_FILE) == 1);
+    record_stream_t *stream = record_stream_open(TEST_RECORD_FILE);
+    assert(stream != NULL);
+    const record_stream_header_t *header = record_stream_header(stream);
+    assert(header->count == 6 && header->chunk_rows == 4 && header->chunk_cols == 2);
+    assert(header->min_time == 0 && header->max_time == 9);
+
+    // Chunk (0,0): (0,1) (2,0); chunk (0,1): (1,2) twice in arrival order; chunk (1,0): (5,0); chunk (2,1): (9,3)
+    const int32_t expected[] = {3, 6, 2, 5, 4, 1};
+    size_t count = 0;
+    const record_stream_record_t *records = record_stream_records(stream, &count);
+    assert(count == 6);
+    for (size_t i = 0; i < count; i++) assert(records[i].population == expected[i]);
+    assert(records[2].time_index == 1 && records[2].mesh_index == 2);
+    assert(records[4].residence == 13101 && records[4].age == 20 && records[4].gender == 2);
+    assert(records[0].residence == -1 && records[0].age == -1 && records[0].gender == -1);
+    record_stream_close(stream);
+
+    // Truncated and foreign files are refused
+    assert(truncate(TEST_RECORD_FILE, sizeof(record_stream_header_t) + 5) == 0);
+    assert(record_stream_open(TEST_RECORD_FILE) == NULL);
+    FILE *fp = fopen(TEST_RECORD_FILE, "w");
+    assert(fp != NULL);
+    fprintf(fp, "date,time,area,residence,age,gender,population\n");
+    fclose(fp);
+    assert(record_stream_is_stream(TEST_RECORD_FILE) == 0);
+    assert(record_stream_open(TEST_RECORD_FILE) == NULL);
+    unlink(TEST_RECORD_FILE);
+
+    // Empty writers still produce a valid file
+    writer = record_stream_writer_create(TEST_RECORD_FILE, 8784, 16);
+    assert(writer != NULL);
+    assert(record_stream_writer_close(writer) == 0);
+    stream = record_stream_open(TEST_RECORD_FILE);
+    assert(stream != NULL && record_stream_header(stream)->count == 0);
+    record_stream_close(stream);
+    unlink(TEST_RECORD_FILE);
+
+    char *path = record_stream_path_for("out", "/data/2016/x_00000.csv");
+    assert(path != NULL && strcmp(path, "out/x_00000.mrec") == 0);
+    free(path);
+
+    printf("Record file roundtrip test passed\n");
+}
+
+// Value of mesh m at hour h; file B also carries breakdown rows that add up to 100 at hour 3
+static int32_t expected_value(int m, int h, csv_to_h5_merge_policy_t policy) {
+    if (m == 1 && h == 3) return policy == CSV_TO_H5_MERGE_SUM ? 100 : 60;
+    return 1000 * m + h;
+}
+
+static void write_test_csvs(void) {
+    FILE *a = fopen(TEST_CSV_A, "w");
+    FILE *b = fopen(TEST_CSV_B, "w");
+    assert(a && b);
+    fprintf(a, "date,time,area,residence,age,gender,population\n");
+    fprintf(b, "date,time,area,residence,age,gender,population\n");
+    for (int h = 0; h < NUM_TEST_HOURS; h++) {
+        for (int m = 0; m < NUM_TEST_MESHES; m++) {
+            if (m == 1 && h == 3) continue;
+            FILE *fp = m % 2 == 0 ? a : b;
+            fprintf(fp, "201601%02d,%02d00,%u,-1,-1,-1,%d\n", h / 24 + 1, h % 24, test_meshes[m], 1000 * m + h);
+        }
+    }
+    fprintf(b, "20160101,0300,%u,1,20,1,40\n", test_meshes[1]);
+    fprintf(b, "20160101,0300,%u,1,30,2,60\n", test_meshes[1]);
+    // A row outside the subset is skipped in the first build but recorded for wider rebuilds;
+    // an ID that is no mesh at all is left out of both
+    fprintf(b, "20160101,0000,%u,-1,-1,-1,7\n", meshid_list[5]);
+    fprintf(b, "20160101,0000,999999999,-1,-1,-1,8\n");
+    fclose(a);
+    fclose(b);
+}
+
+static void check_file(const char *h5_file, cmph_t *hash, csv_to_h5_merge_policy_t policy) {
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(h5_file, &ctx) == 0);
+    for (int m = 0; m < NUM_TEST_MESHES; m++) {
+        int32_t *series = h5mobaku_read_population_time_series(ctx->h5r_ctx, hash, test_meshes[m], 0,
+                                                               NUM_TEST_HOURS - 1);
+        assert(series != NULL);
+        for (int h = 0; h < NUM_TEST_HOURS; h++) assert(series[h] == expected_value(m, h, policy));
+        h5mobaku_free_data(series);
+    }
+    h5mobaku_close(ctx);
+}
+
+// The breakdown rows of file B come back from the records as from the CSV text
+static void check_breakdown(const char *h5_file, cmph_t *hash) {
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(h5_file, &ctx) == 0);
+    size_t ncat = 0;
+    assert(h5mobaku_get_breakdown_categories(ctx, &ncat) != NULL && ncat == 2);
+    const h5mobaku_category_t young = {1, 20, 1}, older = {1, 30, 2};
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 3, young) == 40);
+    assert(h5mobaku_read_breakdown_single(ctx, hash, test_meshes[1], 3, older) == 60);
+    h5mobaku_close(ctx);
+}
+
+static void test_rebuild_from_records(cmph_t *hash) {
+    printf("Testing rebuilds from record files...\n");
+    for (int m = 0; m < NUM_TEST_MESHES; m++) test_meshes[m] = meshid_list[1200 + m * 7];
+    write_test_csvs();
+
+    // Parse once, keeping the records
+    const char *csv_files[] = {TEST_CSV_A, TEST_CSV_B};
+    csv_to_h5_config_t config = CSV_TO_H5_DEFAULT_CONFIG;
+    config.output_h5_file = "test_record_stream_csv.h5";
+    config.mesh_ids = test_meshes;
+    config.num_meshes = NUM_TEST_MESHES;
+    config.reader_threads = 1;
+    config.record_output_dir = TEST_RECORD_DIR;
+    config.store_breakdown = 1;
+    csv_to_h5_stats_t stats;
+    assert(csv_to_h5_convert_files(csv_files, 2, &config, &stats) == 0);
+    assert(stats.errors == 0);
+    const size_t csv_timestamps = stats.unique_timestamps;
+    assert(csv_timestamps == NUM_TEST_HOURS);
+    check_file(config.output_h5_file, hash, CSV_TO_H5_MERGE_OVERWRITE);
+    check_breakdown(config.output_h5_file, hash);
+    unlink(config.output_h5_file);
+
+    char **record_files = NULL;
+    size_t num_records = 0, capacity = 0;
+    record_stream_find_files(TEST_RECORD_DIR, &record_files, &num_records, &capacity);
+    assert(num_records == 2);
+    size_t total = 0;
+    for (size_t i = 0; i < num_records; i++) {
+        record_stream_t *stream = record_stream_open(record_files[i]);
+        assert(stream != NULL);
+        total += record_stream_header(stream)->count;
+        record_stream_close(stream);
+    }
+    assert(total == NUM_TEST_MESHES * NUM_TEST_HOURS + 2);
+
+    // Rebuild from the records alone, in both modes and with another merge policy
+    const struct { int bulk; csv_to_h5_merge_policy_t policy; } cases[] = {
+        {0, CSV_TO_H5_MERGE_OVERWRITE},
+        {1, CSV_TO_H5_MERGE_OVERWRITE},
+        {0, CSV_TO_H5_MERGE_SUM},
+        {1, CSV_TO_H5_MERGE_SUM},
+    };
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        csv_to_h5_config_t rebuild = CSV_TO_H5_DEFAULT_CONFIG;
+        rebuild.output_h5_file = "test_record_stream_rebuilt.h5";
+        rebuild.mesh_ids = test_meshes;
+        rebuild.num_meshes = NUM_TEST_MESHES;
+        rebuild.reader_threads = 1;
+        rebuild.use_bulk_write = cases[c].bulk;
+        rebuild.merge_policy = cases[c].policy;
+        rebuild.store_breakdown = 1;
+        assert(csv_to_h5_convert_files((const char **)record_files, num_records, &rebuild, &stats) == 0);
+        assert(stats.total_rows_processed == total - 1);
+        assert(stats.errors == 0);
+        if (!cases[c].bulk) assert(stats.unique_timestamps == csv_timestamps);
+        check_file(rebuild.output_h5_file, hash, cases[c].policy);
+        check_breakdown(rebuild.output_h5_file, hash);
+        unlink(rebuild.output_h5_file);
+    }
+
+    // A narrower subset takes only its own columns
+    csv_to_h5_config_t narrow = CSV_TO_H5_DEFAULT_CONFIG;
+    narrow.output_h5_file = "test_record_stream_narrow.h5";
+    narrow.mesh_ids = &test_meshes[2];
+    narrow.num_meshes = 1;
+    assert(csv_to_h5_convert_files((const char **)record_files, num_records, &narrow, &stats) == 0);
+    assert(stats.total_rows_processed == NUM_TEST_HOURS);
+    struct h5mobaku *ctx = NULL;
+    assert(h5mobaku_open(narrow.output_h5_file, &ctx) == 0);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, test_meshes[2], 17) == expected_value(2, 17, 0));
+    h5mobaku_close(ctx);
+    unlink(narrow.output_h5_file);
+
+    // A wider subset picks up the row the first build left out
+    uint32_t wide_meshes[NUM_TEST_MESHES + 1];
+    memcpy(wide_meshes, test_meshes, sizeof(test_meshes));
+    wide_meshes[NUM_TEST_MESHES] = meshid_list[5];
+    csv_to_h5_config_t wide = CSV_TO_H5_DEFAULT_CONFIG;
+    wide.output_h5_file = "test_record_stream_wide.h5";
+    wide.mesh_ids = wide_meshes;
+    wide.num_meshes = NUM_TEST_MESHES + 1;
+    assert(csv_to_h5_convert_files((const char **)record_files, num_records, &wide, &stats) == 0);
+    assert(stats.total_rows_processed == total);
+    check_file(wide.output_h5_file, hash, CSV_TO_H5_MERGE_OVERWRITE);
+    assert(h5mobaku_open(wide.output_h5_file, &ctx) == 0);
+    assert(h5mobaku_read_population_single(ctx->h5r_ctx, hash, meshid_list[5], 0) == 7);
+    h5mobaku_close(ctx);
+    unlink(wide.output_h5_file);
+
+    for (size_t i = 0; i < num_records; i++) {
+        unlink(record_files[i]);
+        free(record_files[i]);
+    }
+    free(record_files);
+    rmdir(TEST_RECORD_DIR);
+    unlink(TEST_CSV_A);
+    unlink(TEST_CSV_B);
+    printf("Rebuild test passed\n");
+}
+
+int main(void) {
+    printf("Running record stream tests...\n\n");
+
+    cmph_t *hash = meshid_prepare_search();
+    assert(hash != NULL);
+
+    test_writer_and_reader();
+    test_rebuild_from_records(hash);
+
+    cmph_destroy(hash);
+    printf("\nAll record stream tests passed!\n");
+    return 0;
+}